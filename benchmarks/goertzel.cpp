@@ -0,0 +1,101 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/goertzel.hpp>
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <numbers>
+#include <span>
+#include <vector>
+
+#include <libhal/units.hpp>
+
+namespace {
+constexpr hal::hertz sample_rate = 8000.0f;
+constexpr std::size_t block_size = 205;
+constexpr std::size_t blocks = 20'000;
+
+/// Keeps the results observable so the work is not optimized away
+float volatile sink = 0.0f;
+
+std::vector<float> make_samples()
+{
+  std::vector<float> samples(block_size * 16);
+  for (std::size_t i = 0; i < samples.size(); i++) {
+    auto const time = static_cast<double>(i) / sample_rate;
+    samples[i] =
+      static_cast<float>(std::sin(2.0 * std::numbers::pi * 697.0 * time) +
+                         std::sin(2.0 * std::numbers::pi * 1209.0 * time));
+  }
+  return samples;
+}
+
+/// Nanoseconds spent per sample per tone running tone_count filters
+template<std::size_t tone_count>
+double measure(std::span<float const> p_samples)
+{
+  std::array<hal::hertz, tone_count> frequencies{};
+  for (std::size_t i = 0; i < tone_count; i++) {
+    frequencies[i] = 600.0f + 100.0f * static_cast<float>(i);
+  }
+  std::span<hal::hertz const, tone_count> const targets(frequencies);
+  hal::goertzel_bank<tone_count> bank(sample_rate, targets, block_size);
+
+  auto const start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < blocks; i++) {
+    auto const offset = (i % (p_samples.size() / block_size)) * block_size;
+    bank.process(p_samples.subspan(offset, block_size));
+    sink = sink + bank.power()[0];
+  }
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+
+  auto const nanoseconds =
+    std::chrono::duration<double, std::nano>(elapsed).count();
+  return nanoseconds / static_cast<double>(blocks * block_size * tone_count);
+}
+
+template<std::size_t tone_count>
+void report(std::span<float const> p_samples, double p_clock_ghz)
+{
+  auto const per_tone = measure<tone_count>(p_samples);
+  if (p_clock_ghz > 0.0) {
+    std::printf("%2zu tones: %6.3f ns, %6.2f cycles per sample per tone\n",
+                tone_count,
+                per_tone,
+                per_tone * p_clock_ghz);
+  } else {
+    std::printf(
+      "%2zu tones: %6.3f ns per sample per tone\n", tone_count, per_tone);
+  }
+}
+}  // namespace
+
+int main(int p_argc, char** p_argv)
+{
+  // Cycles are estimated from the time when the CPU clock is given
+  auto const clock_ghz = p_argc > 1 ? std::strtod(p_argv[1], nullptr) : 0.0;
+  auto const samples = make_samples();
+
+  report<1>(samples, clock_ghz);
+  report<2>(samples, clock_ghz);
+  report<4>(samples, clock_ghz);
+  report<8>(samples, clock_ghz);
+  report<16>(samples, clock_ghz);
+  return 0;
+}
@@ -0,0 +1,807 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstdio>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "cobs.hpp"
+#include "error.hpp"
+#include "functional.hpp"
+#include "serial_tx_queue.hpp"
+#include "units.hpp"
+
+namespace hal {
+/// Severity of a log message
+enum class log_level : hal::byte
+{
+  trace = 0,
+  debug = 1,
+  info = 2,
+  warning = 3,
+  error = 4,
+};
+
+/**
+ * @brief Compile time format string for the binary logger
+ *
+ * Used as a template argument so that the format string never exists at
+ * runtime on the device, only its ID.
+ *
+ * @tparam length - length of the string literal including the null terminator
+ */
+template<std::size_t length>
+struct log_string
+{
+  consteval log_string(char const (&p_text)[length])  // NOLINT
+  {
+    std::copy_n(p_text, length, text);
+  }
+
+  [[nodiscard]] constexpr std::string_view view() const
+  {
+    return { text, length - 1 };
+  }
+
+  char text[length]{};
+};
+
+namespace detail {
+/// Argument conversions of a log format string
+struct log_conversions
+{
+  std::array<char, 16> types{};
+  std::size_t count = 0;
+};
+
+consteval log_conversions parse_log_format(std::string_view p_format)
+{
+  constexpr std::string_view modifiers = "-+ #0123456789.";
+  constexpr std::string_view supported = "diuxXcfeEgGs";
+  log_conversions result{};
+  for (std::size_t i = 0; i < p_format.size(); i++) {
+    if (p_format[i] != '%') {
+      continue;
+    }
+    i++;
+    while (i < p_format.size() && modifiers.find(p_format[i]) !=
+                                    std::string_view::npos) {
+      i++;
+    }
+    if (i < p_format.size() && p_format[i] == '%') {
+      continue;
+    }
+    if (i == p_format.size() ||
+        supported.find(p_format[i]) == std::string_view::npos ||
+        result.count == result.types.size()) {
+      // Not a constant expression, making an unsupported conversion a compile
+      // error.
+      hal::safe_throw(hal::argument_out_of_domain(nullptr));
+    }
+    result.types[result.count++] = p_format[i];
+  }
+  return result;
+}
+
+constexpr std::uint32_t log_id(log_level p_level, std::string_view p_format)
+{
+  // 32-bit FNV-1a of the level followed by the format string
+  std::uint32_t hash = 2166136261U;
+  hash = (hash ^ static_cast<std::uint32_t>(p_level)) * 16777619U;
+  for (auto const character : p_format) {
+    hash = (hash ^ static_cast<hal::byte>(character)) * 16777619U;
+  }
+  return hash;
+}
+
+template<class T>
+concept log_string_argument = std::convertible_to<T, std::string_view>;
+
+template<char conversion, class T>
+consteval bool log_argument_matches()
+{
+  switch (conversion) {
+    case 's':
+      return log_string_argument<T>;
+    case 'f':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+      return std::is_floating_point_v<T>;
+    default:
+      return std::is_integral_v<T> || std::is_enum_v<T>;
+  }
+}
+
+/// Bytes identifying a format record within a firmware image
+inline constexpr std::array<hal::byte, 4> log_record_magic{
+  'h', 'l', 'o', 'g'
+};
+/// Bytes of a format record preceding the characters of the format string
+inline constexpr std::size_t log_record_header = 11;
+
+/**
+ * @brief Format record kept in the firmware image for each log call site
+ *
+ * Layout: magic, id (4 bytes little endian), level, length (2 bytes little
+ * endian) and the characters of the format string without a terminator.
+ */
+template<log_level message_level, log_string format>
+struct log_format_entry
+{
+  static constexpr std::uint32_t id = log_id(message_level, format.view());
+  static constexpr std::size_t length = format.view().size();
+
+  struct record_t
+  {
+    std::array<hal::byte, 4> magic;
+    std::array<hal::byte, 4> id_le;
+    hal::byte severity;
+    std::array<hal::byte, 2> length_le;
+    std::array<char, length> text;
+  };
+
+  static constexpr record_t make_record()
+  {
+    record_t result{};
+    result.magic = log_record_magic;
+    for (std::size_t i = 0; i < result.id_le.size(); i++) {
+      result.id_le[i] = static_cast<hal::byte>(id >> (i * 8));
+    }
+    result.severity = static_cast<hal::byte>(message_level);
+    result.length_le[0] = static_cast<hal::byte>(length);
+    result.length_le[1] = static_cast<hal::byte>(length >> 8);
+    std::ranges::copy(format.view(), result.text.begin());
+    return result;
+  }
+
+  // Retained through link time garbage collection so the host can find it,
+  // the linker script keeps the section out of the image
+#if defined(__ELF__)
+  [[gnu::used, gnu::retain, gnu::section(".hal_log_formats")]]
+#else
+  [[gnu::used]]
+#endif
+  static constexpr record_t record = make_record();
+};
+}  // namespace detail
+
+/**
+ * @brief Deferred formatting binary logger
+ *
+ * Format strings are interned at compile time: each call site is identified
+ * by a 32-bit hash of its level and format string, and only that ID plus the
+ * raw arguments are sent. Formatting happens on the host with
+ * hal::log_decoder, removing printf from the device and shrinking messages
+ * several times over.
+ *
+ * USAGE:
+ *
+ *      logger.info<"temperature=%d.%u C">(whole, tenths);
+ *
+ * The format string is checked at compile time. Supported conversions are
+ * `%d %i` (signed), `%u %x %X %c` (unsigned), `%f %e %g` (floating point,
+ * sent as float) and `%s` (string), each with optional flags, width and
+ * precision, plus `%%`.
+ *
+ * Every format string used is kept in the ELF file as a self describing
+ * record holding its ID and level. hal::log_decoder locates these records by
+ * scanning the ELF file, so no separate table needs to be generated or kept
+ * in sync. On ELF targets the records are placed in the `.hal_log_formats`
+ * section. GCC ignores section attributes on template members and places
+ * each record in a `.rodata.` section named after its symbol instead. Either
+ * way, the records are only needed by the host, so gather them into a section
+ * that is not allocated, before the `.rodata` statement of the linker script,
+ * so the strings take no flash:
+ *
+ *      .hal_log_formats 0 (INFO) : {
+ *        KEEP(*(.hal_log_formats))
+ *        KEEP(*(.rodata._ZN3hal6detail16log_format_entry*))
+ *      }
+ *
+ * NOLOAD in place of INFO also works. Without either, the records are
+ * placed with the other read only data in flash.
+ *
+ * Messages are pushed as whole frames into a hal::serial_tx_queue, making
+ * logging lock-free and safe from any number of threads and interrupts.
+ *
+ * Each message is encoded with consistent overhead byte stuffing (COBS) and
+ * terminated by a zero byte, so a decoder joining the stream part way, or
+ * losing bytes, resynchronizes at the next zero byte. Before encoding, a
+ * message holds:
+ *
+ *      4 bytes: little endian format ID
+ *      arguments: signed integers as zigzag varints, unsigned integers as
+ *      varints, floating point as 4 byte little endian float, strings as a
+ *      varint length followed by the characters.
+ */
+class binary_logger
+{
+public:
+  /// Largest encoded message, including its COBS overhead and zero
+  /// delimiter. Strings are
+  /// truncated to leave room for the largest possible encoding of the
+  /// arguments after them. Formats whose other arguments could exceed this
+  /// size are a compile error.
+  static constexpr std::size_t max_message_size = 128;
+
+  /**
+   * @brief Construct a new binary logger object
+   *
+   * @param p_queue - transmit queue shared with other users of the serial port
+   * @param p_level - messages below this level are discarded
+   * @throws hal::argument_out_of_domain - if the queue cannot hold a message of
+   * max_message_size bytes
+   */
+  explicit binary_logger(serial_tx_queue& p_queue,
+                         log_level p_level = log_level::info)
+    : m_queue(&p_queue)
+    , m_level(p_level)
+  {
+    if (p_queue.max_frame_size() < max_message_size) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+  }
+
+  /**
+   * @brief Set the minimum level of messages to send
+   *
+   * @param p_level - messages below this level are discarded
+   */
+  void level(log_level p_level)
+  {
+    m_level.store(p_level, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Get the minimum level of messages sent
+   *
+   * @return log_level - current level
+   */
+  [[nodiscard]] log_level level() const
+  {
+    return m_level.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Send a log message
+   *
+   * @tparam message_level - severity of the message
+   * @tparam format - printf style format string
+   * @param p_args - arguments for each conversion of the format string
+   * @return true - the message was queued or is below the current level
+   * @return false - the message was dropped because the queue is full
+   */
+  template<log_level message_level, log_string format, class... args_t>
+  bool log(args_t const&... p_args)
+  {
+    using entry = detail::log_format_entry<message_level, format>;
+    constexpr auto conversions = detail::parse_log_format(format.view());
+    static_assert(conversions.count == sizeof...(args_t),
+                  "Number of arguments does not match the format string");
+    // Reference the format record so that it is emitted into the image
+    [[maybe_unused]] auto const* record = &entry::record;
+
+    if (message_level < level()) {
+      return true;
+    }
+
+    // Left uninitialized, only the encoded prefixes are used
+    message_t message;
+    std::size_t position = 0;
+    for (std::size_t i = 0; i < 4; i++) {
+      message[position++] = static_cast<hal::byte>(entry::id >> (i * 8));
+    }
+    encode_all<conversions>(message,
+                            position,
+                            std::index_sequence_for<args_t...>{},
+                            p_args...);
+    std::array<hal::byte, max_message_size> frame;
+    auto length =
+      detail::cobs_encode(std::span(message).first(position), frame);
+    frame[length++] = 0;
+    return m_queue->push(std::span(frame).first(length));
+  }
+
+  /// Send a log message at log_level::trace
+  template<log_string format, class... args_t>
+  bool trace(args_t const&... p_args)
+  {
+    return log<log_level::trace, format>(p_args...);
+  }
+
+  /// Send a log message at log_level::debug
+  template<log_string format, class... args_t>
+  bool debug(args_t const&... p_args)
+  {
+    return log<log_level::debug, format>(p_args...);
+  }
+
+  /// Send a log message at log_level::info
+  template<log_string format, class... args_t>
+  bool info(args_t const&... p_args)
+  {
+    return log<log_level::info, format>(p_args...);
+  }
+
+  /// Send a log message at log_level::warning
+  template<log_string format, class... args_t>
+  bool warning(args_t const&... p_args)
+  {
+    return log<log_level::warning, format>(p_args...);
+  }
+
+  /// Send a log message at log_level::error
+  template<log_string format, class... args_t>
+  bool error(args_t const&... p_args)
+  {
+    return log<log_level::error, format>(p_args...);
+  }
+
+private:
+  /// Message before encoding, short enough for one COBS code byte
+  using message_t = std::array<hal::byte, max_message_size - 2>;
+
+  /// COBS code byte, format ID and zero delimiter
+  static constexpr std::size_t header_size = 6;
+
+  /// Largest encoding of an argument, not counting the characters of strings
+  template<char conversion, class T>
+  static consteval std::size_t max_encoded_size()
+  {
+    if constexpr (conversion == 's') {
+      // Strings are shorter than a message, so their length is one byte
+      return 1;
+    } else if constexpr (std::is_floating_point_v<T>) {
+      return 4;
+    } else if constexpr (conversion != 'd' && conversion != 'i' &&
+                         std::is_signed_v<T>) {
+      // Negative values sign extend to a full 64-bit varint
+      return 10;
+    } else {
+      return (sizeof(T) * 8 + 6) / 7;
+    }
+  }
+
+  template<std::size_t count>
+  static consteval std::array<std::size_t, count> reserved_after(
+    std::array<std::size_t, count> p_sizes)
+  {
+    std::array<std::size_t, count> result{};
+    std::size_t total = 0;
+    for (std::size_t i = count; i-- != 0;) {
+      result[i] = total;
+      total += p_sizes[i];
+    }
+    return result;
+  }
+
+  template<detail::log_conversions conversions,
+           std::size_t... indexes,
+           class... args_t>
+  static void encode_all(message_t& p_message,
+                         std::size_t& p_position,
+                         std::index_sequence<indexes...>,
+                         args_t const&... p_args)
+  {
+    constexpr std::array<std::size_t, sizeof...(args_t)> sizes{
+      max_encoded_size<conversions.types[indexes], args_t>()...
+    };
+    static_assert(header_size + (0 + ... + sizes[indexes]) <= max_message_size,
+                  "Arguments can exceed max_message_size");
+    // Bytes kept free after each argument for those that follow it
+    [[maybe_unused]] constexpr auto reserved = reserved_after(sizes);
+    (encode<conversions.types[indexes], reserved[indexes]>(
+       p_message, p_position, p_args),
+     ...);
+  }
+
+  template<char conversion, std::size_t reserved, class T>
+  static void encode(message_t& p_message,
+                     std::size_t& p_position,
+                     T const& p_value)
+  {
+    static_assert(detail::log_argument_matches<conversion, T>(),
+                  "Argument type does not match its format conversion");
+    if constexpr (conversion == 's') {
+      std::string_view const text = p_value;
+      // Leave room for the length byte and the arguments that follow
+      auto const room = p_message.size() - p_position - 1 - reserved;
+      auto const length = std::min(text.size(), room);
+      put_varint(p_message, p_position, length);
+      std::ranges::copy(text.substr(0, length),
+                        p_message.data() + p_position);
+      p_position += length;
+    } else if constexpr (std::is_floating_point_v<T>) {
+      auto const bits =
+        std::bit_cast<std::uint32_t>(static_cast<float>(p_value));
+      for (std::size_t i = 0; i < 4; i++) {
+        p_message[p_position++] = static_cast<hal::byte>(bits >> (i * 8));
+      }
+    } else if constexpr (conversion == 'd' || conversion == 'i') {
+      auto const value = static_cast<std::int64_t>(p_value);
+      auto const zigzag = (static_cast<std::uint64_t>(value) << 1) ^
+                          static_cast<std::uint64_t>(value >> 63);
+      put_varint(p_message, p_position, zigzag);
+    } else {
+      put_varint(p_message, p_position, static_cast<std::uint64_t>(p_value));
+    }
+  }
+
+  static void put_varint(message_t& p_message,
+                         std::size_t& p_position,
+                         std::uint64_t p_value)
+  {
+    do {
+      auto const low = static_cast<hal::byte>(p_value & 0x7F);
+      p_value >>= 7;
+      p_message[p_position++] =
+        static_cast<hal::byte>(low | (p_value != 0 ? 0x80 : 0x00));
+    } while (p_value != 0);
+  }
+
+  serial_tx_queue* m_queue;
+  std::atomic<log_level> m_level;
+};
+
+/// Format string of a log call site, found within a firmware image
+struct log_format
+{
+  std::uint32_t id = 0;
+  log_level level = log_level::error;
+  std::string_view text{};
+};
+
+/**
+ * @brief Host side decoder for messages sent by hal::binary_logger
+ *
+ * Typically runs within a host tool reading the serial stream, with the
+ * firmware's ELF file loaded into memory. On targets that are not ELF the
+ * records stay within the image, so a raw binary works as well.
+ *
+ * Frames that fail to decode, are too long, or do not match their format
+ * string are skipped and counted by `errors()`; decoding resumes with the
+ * frame after the next zero byte.
+ */
+class log_decoder
+{
+public:
+  /**
+   * @brief Construct a new log decoder object
+   *
+   * Scans the image for format records. A record is only accepted when its ID
+   * matches the hash of its level and text, so stray bytes resembling a
+   * record are ignored.
+   *
+   * @param p_image - contents of the firmware image. Must outlive the decoder
+   * as the format strings refer to it.
+   * @param p_formats - storage for the format strings found
+   * @throws hal::argument_out_of_domain - if the image contains more formats
+   * than p_formats can hold
+   */
+  log_decoder(std::span<hal::byte const> p_image,
+              std::span<log_format> p_formats)
+    : m_formats(p_formats)
+  {
+    auto const& magic = detail::log_record_magic;
+    auto const header = detail::log_record_header;
+    for (std::size_t i = 0; i + header <= p_image.size(); i++) {
+      if (not std::ranges::equal(p_image.subspan(i, magic.size()), magic)) {
+        continue;
+      }
+      auto const id = read_le(p_image.subspan(i + 4, 4));
+      auto const level = static_cast<log_level>(p_image[i + 8]);
+      std::size_t const length = read_le(p_image.subspan(i + 9, 2));
+      if (i + header + length > p_image.size()) {
+        continue;
+      }
+      std::string_view const text(
+        reinterpret_cast<char const*>(p_image.data() + i + header), length);
+      if (detail::log_id(level, text) != id || find(id) != nullptr) {
+        continue;
+      }
+      if (m_count == m_formats.size()) {
+        hal::safe_throw(hal::argument_out_of_domain(this));
+      }
+      m_formats[m_count++] = { .id = id, .level = level, .text = text };
+      i += header + length - 1;
+    }
+  }
+
+  /**
+   * @brief Format strings found within the image
+   *
+   * @return std::span<log_format const> - every distinct format string
+   */
+  [[nodiscard]] std::span<log_format const> formats() const
+  {
+    return m_formats.first(m_count);
+  }
+
+  /**
+   * @brief Decode every complete message within a stream of bytes
+   *
+   * Messages with an ID missing from the image are reported as an error level
+   * message naming the ID.
+   *
+   * @param p_stream - bytes received from the serial port
+   * @param p_handler - called with the level and formatted text of each
+   * message
+   * @return std::size_t - number of bytes consumed. Bytes of an incomplete
+   * message at the end of p_stream are not consumed and should be passed
+   * again, followed by more data. An incomplete message longer than any valid
+   * message is consumed and the rest of it skipped.
+   */
+  std::size_t decode(
+    std::span<hal::byte const> p_stream,
+    hal::function_ref<void(log_level, std::string_view)> p_handler)
+  {
+    std::size_t consumed = 0;
+    while (consumed < p_stream.size()) {
+      auto const rest = p_stream.subspan(consumed);
+      auto const delimiter = std::ranges::find(rest, hal::byte{ 0 });
+      if (delimiter == rest.end()) {
+        if (rest.size() > binary_logger::max_message_size) {
+          m_errors++;
+          m_skipping = true;
+          consumed = p_stream.size();
+        }
+        break;
+      }
+      auto const length =
+        static_cast<std::size_t>(std::distance(rest.begin(), delimiter));
+      if (m_skipping) {
+        m_skipping = false;
+      } else if (not decode_frame(rest.first(length), p_handler)) {
+        m_errors++;
+      }
+      consumed += length + 1;
+    }
+    return consumed;
+  }
+
+  /**
+   * @brief Number of frames skipped as invalid
+   *
+   * @return std::uint32_t - skipped frame count
+   */
+  [[nodiscard]] std::uint32_t errors() const
+  {
+    return m_errors;
+  }
+
+private:
+  [[nodiscard]] log_format const* find(std::uint32_t p_id) const
+  {
+    for (auto const& format : formats()) {
+      if (format.id == p_id) {
+        return &format;
+      }
+    }
+    return nullptr;
+  }
+
+  static std::uint32_t read_le(std::span<hal::byte const> p_bytes)
+  {
+    std::uint32_t value = 0;
+    for (std::size_t i = 0; i < p_bytes.size(); i++) {
+      value |= static_cast<std::uint32_t>(p_bytes[i]) << (i * 8);
+    }
+    return value;
+  }
+
+  bool decode_frame(
+    std::span<hal::byte const> p_encoded,
+    hal::function_ref<void(log_level, std::string_view)> p_handler)
+  {
+    if (p_encoded.size() > m_frame.size()) {
+      return false;
+    }
+    auto const decoded = detail::cobs_decode(p_encoded, m_frame);
+    if (not decoded) {
+      return false;
+    }
+    return decode_message(std::span(m_frame).first(*decoded), p_handler);
+  }
+
+  bool decode_message(
+    std::span<hal::byte const> p_message,
+    hal::function_ref<void(log_level, std::string_view)> p_handler)
+  {
+    if (p_message.size() < 4) {
+      return false;
+    }
+    auto const id = read_le(p_message.first(4));
+    auto const* format = find(id);
+    m_length = 0;
+    if (format == nullptr) {
+      append("<unknown log id 0x%08X>", static_cast<unsigned>(id));
+      p_handler(log_level::error, std::string_view(m_text.data(), m_length));
+      return true;
+    }
+
+    std::size_t position = 4;
+    auto const text = format->text;
+    std::size_t i = 0;
+    while (i < text.size()) {
+      if (text[i] != '%') {
+        append_literal(text.substr(i, 1));
+        i++;
+        continue;
+      }
+      auto const start = i++;
+      while (i < text.size() &&
+             std::string_view("-+ #0123456789.").find(text[i]) !=
+               std::string_view::npos) {
+        i++;
+      }
+      if (i == text.size()) {
+        return false;
+      }
+      auto const conversion = text[i++];
+      if (conversion == '%') {
+        append_literal("%");
+        continue;
+      }
+      if (not decode_argument(p_message,
+                              position,
+                              text.substr(start, i - start - 1),
+                              conversion)) {
+        return false;
+      }
+    }
+    // Leftover bytes mean the message does not match its format string
+    if (position != p_message.size()) {
+      return false;
+    }
+    p_handler(format->level, std::string_view(m_text.data(), m_length));
+    return true;
+  }
+
+  bool decode_argument(std::span<hal::byte const> p_message,
+                       std::size_t& p_position,
+                       std::string_view p_spec,
+                       char p_conversion)
+  {
+    // Rebuild the conversion with the length modifier for the decoded type
+    std::array<char, 24> spec{};
+    if (p_spec.size() + 4 > spec.size()) {
+      return false;
+    }
+    std::ranges::copy(p_spec, spec.begin());
+    auto* end = spec.data() + p_spec.size();
+
+    switch (p_conversion) {
+      case 'd':
+      case 'i': {
+        auto const zigzag = get_varint(p_message, p_position);
+        if (not zigzag) {
+          return false;
+        }
+        auto const value = static_cast<long long>(*zigzag >> 1) ^
+                           -static_cast<long long>(*zigzag & 1);
+        std::ranges::copy(std::string_view("lld"), end);
+        append(spec.data(), value);
+        break;
+      }
+      case 'f':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G': {
+        if (p_position + 4 > p_message.size()) {
+          return false;
+        }
+        auto const bits = read_le(p_message.subspan(p_position, 4));
+        p_position += 4;
+        *end = p_conversion;
+        append(spec.data(), static_cast<double>(std::bit_cast<float>(bits)));
+        break;
+      }
+      case 's': {
+        auto const length = get_varint(p_message, p_position);
+        if (not length || *length > p_message.size() - p_position) {
+          return false;
+        }
+        std::ranges::copy(std::string_view(".*s"), end);
+        append(spec.data(),
+               static_cast<int>(*length),
+               reinterpret_cast<char const*>(p_message.data() + p_position));
+        p_position += *length;
+        break;
+      }
+      case 'c': {
+        *end = 'c';
+        auto const value = get_varint(p_message, p_position);
+        if (not value) {
+          return false;
+        }
+        append(spec.data(), static_cast<int>(*value));
+        break;
+      }
+      default: {
+        end[0] = 'l';
+        end[1] = 'l';
+        end[2] = p_conversion;
+        auto const value = get_varint(p_message, p_position);
+        if (not value) {
+          return false;
+        }
+        append(spec.data(), static_cast<unsigned long long>(*value));
+        break;
+      }
+    }
+    return true;
+  }
+
+  static std::optional<std::uint64_t> get_varint(
+    std::span<hal::byte const> p_message,
+    std::size_t& p_position)
+  {
+    std::uint64_t value = 0;
+    for (std::size_t shift = 0; shift < 64; shift += 7) {
+      if (p_position == p_message.size()) {
+        return std::nullopt;
+      }
+      auto const encoded = p_message[p_position++];
+      value |= static_cast<std::uint64_t>(encoded & 0x7F) << shift;
+      if ((encoded & 0x80) == 0) {
+        return value;
+      }
+    }
+    return std::nullopt;
+  }
+
+  void append_literal(std::string_view p_text)
+  {
+    auto const count = std::min(p_text.size(), m_text.size() - 1 - m_length);
+    std::ranges::copy(p_text.substr(0, count), m_text.begin() + m_length);
+    m_length += count;
+  }
+
+  template<class... args_t>
+  void append(char const* p_format, args_t... p_args)
+  {
+    auto const remaining = m_text.size() - m_length;
+    auto const written =
+      std::snprintf(m_text.data() + m_length, remaining, p_format, p_args...);
+    if (written > 0) {
+      m_length += std::min(static_cast<std::size_t>(written), remaining - 1);
+    }
+  }
+
+  std::span<log_format> m_formats;
+  std::size_t m_count = 0;
+  std::array<hal::byte, binary_logger::max_message_size> m_frame{};
+  std::array<char, 256> m_text{};
+  std::size_t m_length = 0;
+  std::uint32_t m_errors = 0;
+  bool m_skipping = false;
+};
+}  // namespace hal
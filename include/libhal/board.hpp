@@ -0,0 +1,330 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "initializers.hpp"
+
+namespace hal {
+namespace detail {
+template<template<std::int64_t> class selector_t, class... args_t>
+consteval std::int64_t board_selector(args_t... p_args)
+{
+  std::int64_t result = -1;
+  (
+    [&result]<class arg_t>(arg_t) {
+      if constexpr (requires { arg_t::val; }) {
+        if constexpr (std::is_same_v<selector_t<arg_t::val>, arg_t>) {
+          result = arg_t::val;
+        }
+      }
+    }(p_args),
+    ...);
+  return result;
+}
+}  // namespace detail
+
+/**
+ * @brief Board entry for a peripheral driver constructed from selectors
+ *
+ * The driver is constructed with `driver_t(p_args...)`. Any `port`, `pin`,
+ * `bus` and `channel` selectors within p_args describe the hardware the
+ * peripheral claims:
+ *
+ * - An entry with a `pin` claims that pin of its `port` (port 0 if none is
+ *   given). No two entries of a board may claim the same pin.
+ * - An entry without a `pin` claims the peripheral identified by its `port`,
+ *   `bus` and `channel` selectors. No two entries with the same driver type
+ *   may claim the same peripheral.
+ * - An entry without any selectors claims nothing, so any number of them may
+ *   share a driver type.
+ *
+ * USAGE:
+ *
+ *      hal::peripheral<struct led, lpc40::output_pin, port<1>, pin<10>>
+ *
+ * @tparam tag_t - unique type used to look up the driver within the board
+ * @tparam driver_t - driver type
+ * @tparam p_args - constructor arguments, usually selectors
+ */
+template<class tag_t, class driver_t, auto... p_args>
+struct peripheral
+{
+  using tag = tag_t;
+  using driver = driver_t;
+
+  template<class board_t>
+  static constexpr driver_t construct(board_t&)
+  {
+    return driver_t(p_args...);
+  }
+
+  /// Port selector value, or -1 if not given
+  static constexpr std::int64_t port_value =
+    detail::board_selector<port_t>(p_args...);
+  /// Pin selector value, or -1 if not given
+  static constexpr std::int64_t pin_value =
+    detail::board_selector<pin_t>(p_args...);
+  /// Bus selector value, or -1 if not given
+  static constexpr std::int64_t bus_value =
+    detail::board_selector<bus_t>(p_args...);
+  /// Channel selector value, or -1 if not given
+  static constexpr std::int64_t channel_value =
+    detail::board_selector<channel_t>(p_args...);
+};
+
+/**
+ * @brief List of board entry tags a device is constructed from
+ *
+ * @tparam tags_t - tags of entries declared earlier in the board
+ */
+template<class... tags_t>
+struct depends
+{};
+
+/**
+ * @brief Board entry for a device driver constructed from other entries
+ *
+ * The driver is constructed with references to the drivers of each tag in
+ * `depends_t` followed by p_args. Devices claim no hardware resources of their
+ * own; they share the peripherals they depend on.
+ *
+ * USAGE:
+ *
+ *      hal::device<struct imu, mpu6050, hal::depends<i2c2>, 0x68>
+ *
+ * @tparam tag_t - unique type used to look up the driver within the board
+ * @tparam driver_t - driver type
+ * @tparam depends_t - hal::depends list of tags this device uses
+ * @tparam p_args - constructor arguments passed after the dependencies
+ */
+template<class tag_t, class driver_t, class depends_t, auto... p_args>
+struct device;
+
+template<class tag_t,
+         class driver_t,
+         class... dependency_tags_t,
+         auto... p_args>
+struct device<tag_t, driver_t, depends<dependency_tags_t...>, p_args...>
+{
+  using tag = tag_t;
+  using driver = driver_t;
+
+  template<class board_t>
+  static constexpr driver_t construct(board_t& p_board)
+  {
+    static_assert(
+      (board_t::template declared_before<dependency_tags_t, tag_t>() && ...),
+      "A device must be declared after the entries it depends on");
+    return driver_t(p_board.template get<dependency_tags_t>()..., p_args...);
+  }
+
+  static constexpr std::int64_t port_value = -1;
+  static constexpr std::int64_t pin_value = -1;
+  static constexpr std::int64_t bus_value = -1;
+  static constexpr std::int64_t channel_value = -1;
+};
+
+namespace detail {
+template<class board_t, std::size_t index, class entry_t>
+struct board_slot
+{
+  constexpr explicit board_slot(board_t& p_board)
+    : m_driver(entry_t::construct(p_board))
+  {
+  }
+
+  typename entry_t::driver m_driver;
+};
+
+template<class board_t, class sequence_t, class... entries_t>
+struct board_storage;
+
+template<class board_t, std::size_t... indexes, class... entries_t>
+struct board_storage<board_t, std::index_sequence<indexes...>, entries_t...>
+  : board_slot<board_t, indexes, entries_t>...
+{
+  constexpr explicit board_storage(board_t& p_board)
+    : board_slot<board_t, indexes, entries_t>(p_board)...
+  {
+  }
+};
+
+template<class entry_t>
+consteval bool board_entry_has_selector()
+{
+  return entry_t::port_value != -1 || entry_t::pin_value != -1 ||
+         entry_t::bus_value != -1 || entry_t::channel_value != -1;
+}
+
+template<class first_t, class second_t>
+consteval bool board_entries_conflict()
+{
+  // Entries without selectors, such as devices, claim no hardware
+  if (not board_entry_has_selector<first_t>() ||
+      not board_entry_has_selector<second_t>()) {
+    return false;
+  }
+  if (first_t::pin_value != -1 || second_t::pin_value != -1) {
+    return first_t::pin_value == second_t::pin_value &&
+           std::max(first_t::port_value, std::int64_t{ 0 }) ==
+             std::max(second_t::port_value, std::int64_t{ 0 });
+  }
+  return std::is_same_v<typename first_t::driver, typename second_t::driver> &&
+         first_t::port_value == second_t::port_value &&
+         first_t::bus_value == second_t::bus_value &&
+         first_t::channel_value == second_t::channel_value;
+}
+}  // namespace detail
+
+/**
+ * @brief Compile time description of a board's peripherals and devices
+ *
+ * Every driver of the board is a member of the board object, constructed in
+ * declaration order when the board is constructed. Declaring the board at
+ * namespace scope places every driver in static storage without any heap or
+ * scattered globals, and when every driver has a constexpr constructor the
+ * board can be declared `constinit`, removing driver initialization from
+ * startup entirely.
+ *
+ * Wiring mistakes are rejected at compile time: duplicate tags, two entries
+ * claiming the same pin, the same peripheral constructed twice and devices
+ * declared before their dependencies all fail a static_assert.
+ *
+ * USAGE:
+ *
+ *      using board_t = hal::board<
+ *        hal::peripheral<struct led, lpc40::output_pin, port<1>, pin<10>>,
+ *        hal::peripheral<struct i2c2, lpc40::i2c, bus<2>>,
+ *        hal::device<struct imu, mpu6050, hal::depends<i2c2>, 0x68>>;
+ *
+ *      board_t board;
+ *
+ *      board.get<led>().level(true);
+ *
+ * @tparam entries_t - hal::peripheral and hal::device entries
+ */
+template<class... entries_t>
+class board
+{
+public:
+  /// Number of entries within the board
+  static constexpr std::size_t size = sizeof...(entries_t);
+
+  /**
+   * @brief Construct every driver of the board in declaration order
+   *
+   */
+  constexpr board()
+    : m_storage(*this)
+  {
+  }
+
+  board(board const&) = delete;
+  board& operator=(board const&) = delete;
+  board(board&&) = delete;
+  board& operator=(board&&) = delete;
+
+  /**
+   * @brief Access a driver by its tag
+   *
+   * @tparam tag_t - tag of the entry
+   * @return auto& - reference to the driver
+   */
+  template<class tag_t>
+  constexpr auto& get()
+  {
+    constexpr auto index = index_of<tag_t>();
+    static_assert(index < size, "No board entry has this tag");
+    using entry_t = std::tuple_element_t<index, std::tuple<entries_t...>>;
+    return static_cast<detail::board_slot<board, index, entry_t>&>(m_storage)
+      .m_driver;
+  }
+
+  /**
+   * @brief Position of an entry within the board
+   *
+   * @tparam tag_t - tag of the entry
+   * @return std::size_t - index of the entry, or `size` if not present
+   */
+  template<class tag_t>
+  static consteval std::size_t index_of()
+  {
+    constexpr std::array matches{ std::is_same_v<typename entries_t::tag,
+                                                 tag_t>... };
+    for (std::size_t i = 0; i < matches.size(); i++) {
+      if (matches[i]) {
+        return i;
+      }
+    }
+    return size;
+  }
+
+  /**
+   * @brief Determine if one entry is declared before another
+   *
+   * @tparam first_t - tag of the entry expected first
+   * @tparam second_t - tag of the entry expected second
+   * @return true - first_t is an entry declared before second_t
+   */
+  template<class first_t, class second_t>
+  static consteval bool declared_before()
+  {
+    return index_of<first_t>() < index_of<second_t>();
+  }
+
+private:
+  static consteval bool unique_tags()
+  {
+    constexpr std::array indexes{ index_of<typename entries_t::tag>()... };
+    for (std::size_t i = 0; i < indexes.size(); i++) {
+      if (indexes[i] != i) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template<class first_t, class... rest_t>
+  static consteval bool conflict_free()
+  {
+    bool const clear =
+      (not detail::board_entries_conflict<first_t, rest_t>() && ...);
+    if constexpr (sizeof...(rest_t) > 0) {
+      return clear && conflict_free<rest_t...>();
+    } else {
+      return clear;
+    }
+  }
+
+  static_assert(size > 0, "A board requires at least one entry");
+  static_assert(unique_tags(), "Board entry tags must be unique");
+  static_assert(conflict_free<entries_t...>(),
+                "Two board entries claim the same pin or peripheral");
+
+  using storage = detail::
+    board_storage<board, std::index_sequence_for<entries_t...>, entries_t...>;
+
+  storage m_storage;
+};
+}  // namespace hal
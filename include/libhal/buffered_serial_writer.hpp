@@ -0,0 +1,200 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <chrono>
+#include <span>
+
+#include "error.hpp"
+#include "serial.hpp"
+#include "steady_clock.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Serial port that coalesces small writes into large ones
+ *
+ * Every `write()` copies its bytes into a buffer rather than passing them to
+ * the underlying serial port, so hundreds of small writes become a handful of
+ * large ones, each paying the driver's per-write setup (and on DMA drivers,
+ * per-transfer) cost once. The buffer is written to the serial port when:
+ *
+ * - it becomes full,
+ * - `flush_writes()` is called, or
+ * - the oldest buffered byte has waited longer than the deadline. This is
+ *   checked by every `write()` and by `poll()`, which should be called
+ *   periodically so the last bytes written before an idle period are not
+ *   held indefinitely.
+ *
+ * Bytes the serial port does not accept stay buffered and are written first
+ * the next time the buffer is written. When the buffer is full and the port
+ * accepts nothing, `write()` returns the bytes it accepted so far, as
+ * `hal::serial::write` allows.
+ *
+ * Writes at least as large as the buffer are passed straight through when
+ * nothing is buffered. Reads, `configure()` and `flush()` (which discards
+ * received bytes) are forwarded to the underlying serial port, after
+ * writing any buffered bytes in the case of `configure()`.
+ */
+class buffered_serial_writer : public hal::serial
+{
+public:
+  /**
+   * @brief Construct a new buffered serial writer object
+   *
+   * @param p_serial - serial port to write to
+   * @param p_clock - clock used to measure the deadline
+   * @param p_buffer - buffer for pending bytes, larger buffers give fewer and
+   * larger writes
+   * @param p_deadline - longest time a byte is held before being written
+   * @throws hal::argument_out_of_domain - if p_buffer is empty
+   */
+  buffered_serial_writer(hal::serial& p_serial,
+                         hal::steady_clock& p_clock,
+                         std::span<hal::byte> p_buffer,
+                         hal::time_duration p_deadline)
+    : m_serial(&p_serial)
+    , m_clock(&p_clock)
+    , m_buffer(p_buffer)
+    , m_deadline_ticks(static_cast<std::uint64_t>(
+        std::chrono::duration<float>(p_deadline).count() *
+        p_clock.frequency()))
+  {
+    if (p_buffer.empty()) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+  }
+
+  buffered_serial_writer(buffered_serial_writer const&) = delete;
+  buffered_serial_writer& operator=(buffered_serial_writer const&) = delete;
+  buffered_serial_writer(buffered_serial_writer&&) = delete;
+  buffered_serial_writer& operator=(buffered_serial_writer&&) = delete;
+
+  /**
+   * @brief Write buffered bytes to the serial port now
+   *
+   * Bytes the serial port does not accept remain buffered.
+   */
+  void flush_writes()
+  {
+    while (m_length != 0) {
+      auto const written =
+        m_serial->write(m_buffer.first(m_length)).data.size();
+      if (written == 0) {
+        return;
+      }
+      m_serial_writes++;
+      std::copy(m_buffer.begin() + written,
+                m_buffer.begin() + m_length,
+                m_buffer.begin());
+      m_length -= written;
+    }
+  }
+
+  /**
+   * @brief Write buffered bytes if the oldest has passed its deadline
+   *
+   * @return true - buffered bytes were written
+   * @return false - nothing was due to be written
+   */
+  bool poll()
+  {
+    if (m_length == 0 || m_clock->uptime() - m_oldest < m_deadline_ticks) {
+      return false;
+    }
+    flush_writes();
+    return true;
+  }
+
+  /**
+   * @brief Number of bytes waiting to be written
+   *
+   * @return std::size_t - buffered byte count
+   */
+  [[nodiscard]] std::size_t buffered() const
+  {
+    return m_length;
+  }
+
+  /**
+   * @brief Number of writes to the underlying serial port that accepted bytes
+   *
+   * @return std::uint32_t - write count
+   */
+  [[nodiscard]] std::uint32_t serial_writes() const
+  {
+    return m_serial_writes;
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    flush_writes();
+    m_serial->configure(p_settings);
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    auto remaining = p_data;
+    if (m_length == 0 && remaining.size() >= m_buffer.size()) {
+      auto const written = m_serial->write(remaining).data.size();
+      if (written != 0) {
+        m_serial_writes++;
+      }
+      remaining = remaining.subspan(written);
+    }
+    while (not remaining.empty()) {
+      if (m_length == m_buffer.size()) {
+        // Still full after writing, the port is not accepting bytes
+        break;
+      }
+      if (m_length == 0) {
+        m_oldest = m_clock->uptime();
+      }
+      auto const count = std::min(remaining.size(), m_buffer.size() - m_length);
+      std::copy_n(remaining.begin(), count, m_buffer.begin() + m_length);
+      m_length += count;
+      remaining = remaining.subspan(count);
+      if (m_length == m_buffer.size()) {
+        flush_writes();
+      }
+    }
+    poll();
+    return { .data = p_data.first(p_data.size() - remaining.size()) };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    return m_serial->read(p_data);
+  }
+
+  void driver_flush() override
+  {
+    m_serial->flush();
+  }
+
+  hal::serial* m_serial;
+  hal::steady_clock* m_clock;
+  std::span<hal::byte> m_buffer;
+  std::uint64_t m_deadline_ticks;
+  std::uint64_t m_oldest = 0;
+  std::size_t m_length = 0;
+  std::uint32_t m_serial_writes = 0;
+};
+}  // namespace hal
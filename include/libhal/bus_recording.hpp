@@ -0,0 +1,795 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <type_traits>
+
+#include "error.hpp"
+#include "i2c.hpp"
+#include "serial.hpp"
+#include "spi.hpp"
+#include "steady_clock.hpp"
+
+namespace hal {
+/**
+ * @brief Kind of call stored in a bus log entry
+ *
+ */
+enum class bus_log_kind : std::uint8_t
+{
+  /// hal::i2c::transaction(), argument = address
+  i2c_transaction = 1,
+  /// hal::spi::transfer(), argument = filler byte
+  spi_transfer = 2,
+  /// hal::serial::write(), data_out = bytes written
+  serial_write = 3,
+  /// hal::serial::read() that returned data, data_in = bytes read
+  serial_read = 4,
+};
+
+/**
+ * @brief A single recorded bus call
+ *
+ * When read back from a log, the data spans refer to memory within the log.
+ */
+struct bus_log_entry
+{
+  bus_log_kind kind = bus_log_kind::i2c_transaction;
+  /// True if the call exited via an exception
+  bool failed = false;
+  /// Error code of the hal::exception thrown, std::errc{} if not a
+  /// hal::exception
+  std::errc error{};
+  /// i2c address or spi filler byte, 0 for serial
+  hal::byte argument = 0;
+  /// steady_clock uptime at the start of the call
+  std::uint64_t start = 0;
+  /// steady_clock ticks spent in the call
+  std::uint64_t duration = 0;
+  std::span<hal::byte const> data_out{};
+  std::span<hal::byte const> data_in{};
+};
+
+/**
+ * @brief Appends bus log entries to a memory buffer
+ *
+ * Entries are encoded as:
+ *
+ *     kind (bit 7 set if failed)
+ *     varint: start ticks since the previous entry's start
+ *     varint: duration ticks
+ *     varint: std::errc value, only if failed
+ *     argument byte
+ *     varint: data_out length, data_out bytes
+ *     varint: data_in length, data_in bytes
+ *
+ * Varints are unsigned LEB128, so typical entries carry under 8 bytes of
+ * overhead. The buffer contents can be saved as is, for example by writing
+ * `data()` to a file, and loaded back into a bus_log_reader.
+ *
+ * Entries that do not fit in the remaining space are dropped in their
+ * entirety, and recording stops, so a full log is always a valid prefix of the
+ * recorded session.
+ */
+class bus_log_writer
+{
+public:
+  /**
+   * @brief Construct a new bus log writer object
+   *
+   * @param p_storage - memory to record into
+   */
+  explicit bus_log_writer(std::span<hal::byte> p_storage)
+    : m_storage(p_storage)
+  {
+  }
+
+  /**
+   * @brief Append an entry to the log
+   *
+   * @param p_entry - entry to append
+   * @return true - if the entry was stored, false if the log is full
+   */
+  bool append(bus_log_entry const& p_entry)
+  {
+    if (m_overflowed) {
+      return false;
+    }
+    auto const begin = m_position;
+    auto kind = static_cast<hal::byte>(p_entry.kind);
+    if (p_entry.failed) {
+      kind |= failed_flag;
+    }
+    auto const stored =
+      put(kind) && put_varint(p_entry.start - m_last_start) &&
+      put_varint(p_entry.duration) &&
+      (not p_entry.failed ||
+       put_varint(static_cast<std::uint64_t>(p_entry.error))) &&
+      put(p_entry.argument) && put_bytes(p_entry.data_out) &&
+      put_bytes(p_entry.data_in);
+    if (not stored) {
+      m_position = begin;
+      m_overflowed = true;
+      return false;
+    }
+    m_last_start = p_entry.start;
+    return true;
+  }
+
+  /**
+   * @brief Encoded log contents
+   *
+   * @return std::span<hal::byte const> - the bytes written so far
+   */
+  [[nodiscard]] std::span<hal::byte const> data() const
+  {
+    return m_storage.first(m_position);
+  }
+
+  /**
+   * @brief Determine if entries have been dropped due to lack of space
+   *
+   * @return true - if the log is full
+   */
+  [[nodiscard]] bool overflowed() const
+  {
+    return m_overflowed;
+  }
+
+  /**
+   * @brief Discard all entries
+   *
+   */
+  void clear()
+  {
+    m_position = 0;
+    m_last_start = 0;
+    m_overflowed = false;
+  }
+
+  /// Bit set in the kind byte of entries that exited via an exception
+  static constexpr hal::byte failed_flag = 0x80;
+
+private:
+  bool put(hal::byte p_byte)
+  {
+    if (m_position == m_storage.size()) {
+      return false;
+    }
+    m_storage[m_position++] = p_byte;
+    return true;
+  }
+
+  bool put_varint(std::uint64_t p_value)
+  {
+    do {
+      auto encoded = static_cast<hal::byte>(p_value & 0x7F);
+      p_value >>= 7;
+      if (p_value != 0) {
+        encoded |= 0x80;
+      }
+      if (not put(encoded)) {
+        return false;
+      }
+    } while (p_value != 0);
+    return true;
+  }
+
+  bool put_bytes(std::span<hal::byte const> p_bytes)
+  {
+    if (not put_varint(p_bytes.size()) ||
+        m_storage.size() - m_position < p_bytes.size()) {
+      return false;
+    }
+    std::ranges::copy(p_bytes, m_storage.begin() + m_position);
+    m_position += p_bytes.size();
+    return true;
+  }
+
+  std::span<hal::byte> m_storage;
+  std::size_t m_position = 0;
+  std::uint64_t m_last_start = 0;
+  bool m_overflowed = false;
+};
+
+/**
+ * @brief Reads entries from a log produced by bus_log_writer
+ *
+ */
+class bus_log_reader
+{
+public:
+  /**
+   * @brief Construct a new bus log reader object
+   *
+   * @param p_log - encoded log
+   */
+  explicit bus_log_reader(std::span<hal::byte const> p_log)
+    : m_log(p_log)
+  {
+  }
+
+  /**
+   * @brief Decode the next entry
+   *
+   * @return std::optional<bus_log_entry> - the entry, or std::nullopt at the
+   * end of the log.
+   * @throws hal::io_error - if the log is truncated or corrupt
+   */
+  std::optional<bus_log_entry> next()
+  {
+    if (m_position == m_log.size()) {
+      return std::nullopt;
+    }
+    bus_log_entry entry{};
+    auto const kind = get();
+    entry.failed = (kind & bus_log_writer::failed_flag) != 0;
+    entry.kind = static_cast<bus_log_kind>(kind & ~bus_log_writer::failed_flag);
+    if (entry.kind < bus_log_kind::i2c_transaction ||
+        entry.kind > bus_log_kind::serial_read) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    m_start += get_varint();
+    entry.start = m_start;
+    entry.duration = get_varint();
+    if (entry.failed) {
+      entry.error = static_cast<std::errc>(get_varint());
+    }
+    entry.argument = get();
+    entry.data_out = get_bytes();
+    entry.data_in = get_bytes();
+    return entry;
+  }
+
+  /**
+   * @brief Restart reading from the first entry
+   *
+   */
+  void rewind()
+  {
+    m_position = 0;
+    m_start = 0;
+  }
+
+private:
+  hal::byte get()
+  {
+    if (m_position == m_log.size()) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    return m_log[m_position++];
+  }
+
+  std::uint64_t get_varint()
+  {
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      auto const encoded = get();
+      value |= static_cast<std::uint64_t>(encoded & 0x7F) << shift;
+      if ((encoded & 0x80) == 0) {
+        return value;
+      }
+    }
+    hal::safe_throw(hal::io_error(this));
+  }
+
+  std::span<hal::byte const> get_bytes()
+  {
+    auto const length = get_varint();
+    if (length > m_log.size() - m_position) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    auto const bytes = m_log.subspan(m_position, length);
+    m_position += length;
+    return bytes;
+  }
+
+  std::span<hal::byte const> m_log;
+  std::size_t m_position = 0;
+  std::uint64_t m_start = 0;
+};
+
+namespace detail {
+/**
+ * @brief Append an entry for a call, capturing any exception it throws
+ *
+ * @param p_log - log to append to
+ * @param p_clock - clock used to timestamp the call
+ * @param p_entry - entry with kind, argument and data_out filled in
+ * @param p_call - performs the call and returns the bytes to store in data_in.
+ * If it accepts a `bus_log_entry&`, it may also update the entry, for example
+ * to record only the part of data_out that was accepted.
+ */
+template<class call_t>
+void record_bus_call(bus_log_writer& p_log,
+                     hal::steady_clock& p_clock,
+                     bus_log_entry p_entry,
+                     call_t&& p_call)
+{
+  p_entry.start = p_clock.uptime();
+  try {
+    if constexpr (std::is_invocable_v<call_t, bus_log_entry&>) {
+      p_entry.data_in = p_call(p_entry);
+    } else {
+      p_entry.data_in = p_call();
+    }
+  } catch (hal::exception const& p_exception) {
+    p_entry.failed = true;
+    p_entry.error = p_exception.error_code();
+    p_entry.duration = p_clock.uptime() - p_entry.start;
+    p_log.append(p_entry);
+    throw;
+  } catch (...) {
+    p_entry.failed = true;
+    p_entry.duration = p_clock.uptime() - p_entry.start;
+    p_log.append(p_entry);
+    throw;
+  }
+  p_entry.duration = p_clock.uptime() - p_entry.start;
+  p_log.append(p_entry);
+}
+
+/**
+ * @brief Throw the exception that a recorded call failed with
+ *
+ * @param p_entry - failed entry
+ * @param p_instance - replaying driver
+ */
+[[noreturn]] inline void replay_failure(bus_log_entry const& p_entry,
+                                        void* p_instance)
+{
+  switch (p_entry.error) {
+    case std::errc::no_such_device:
+      hal::safe_throw(hal::no_such_device(p_entry.argument, p_instance));
+    case std::errc::timed_out:
+      hal::safe_throw(hal::timed_out(p_instance));
+    case std::errc::resource_unavailable_try_again:
+      hal::safe_throw(hal::resource_unavailable_try_again(p_instance));
+    case std::errc::io_error:
+      hal::safe_throw(hal::io_error(p_instance));
+    default:
+      hal::safe_throw(hal::unknown(p_instance));
+  }
+}
+}  // namespace detail
+
+/**
+ * @brief i2c decorator that records every transaction to a bus log
+ *
+ * Recording never throws; once the log is full, further transactions are
+ * forwarded but not recorded.
+ */
+class recording_i2c : public hal::i2c
+{
+public:
+  /**
+   * @brief Construct a new recording i2c object
+   *
+   * @param p_i2c - i2c to forward calls to
+   * @param p_log - log to record into
+   * @param p_clock - clock used to timestamp transactions
+   */
+  recording_i2c(hal::i2c& p_i2c,
+                bus_log_writer& p_log,
+                hal::steady_clock& p_clock)
+    : m_i2c(&p_i2c)
+    , m_log(&p_log)
+    , m_clock(&p_clock)
+  {
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    m_i2c->configure(p_settings);
+  }
+
+  void driver_transaction(
+    hal::byte p_address,
+    std::span<hal::byte const> p_data_out,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    detail::record_bus_call(
+      *m_log,
+      *m_clock,
+      { .kind = bus_log_kind::i2c_transaction,
+        .argument = p_address,
+        .data_out = p_data_out },
+      [&]() -> std::span<hal::byte const> {
+        m_i2c->transaction(p_address, p_data_out, p_data_in, p_timeout);
+        return p_data_in;
+      });
+  }
+
+  hal::i2c* m_i2c;
+  bus_log_writer* m_log;
+  hal::steady_clock* m_clock;
+};
+
+/**
+ * @brief spi decorator that records every transfer to a bus log
+ *
+ */
+class recording_spi : public hal::spi
+{
+public:
+  /**
+   * @brief Construct a new recording spi object
+   *
+   * @param p_spi - spi to forward calls to
+   * @param p_log - log to record into
+   * @param p_clock - clock used to timestamp transfers
+   */
+  recording_spi(hal::spi& p_spi,
+                bus_log_writer& p_log,
+                hal::steady_clock& p_clock)
+    : m_spi(&p_spi)
+    , m_log(&p_log)
+    , m_clock(&p_clock)
+  {
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    m_spi->configure(p_settings);
+  }
+
+  void driver_transfer(std::span<hal::byte const> p_data_out,
+                       std::span<hal::byte> p_data_in,
+                       hal::byte p_filler) override
+  {
+    detail::record_bus_call(
+      *m_log,
+      *m_clock,
+      { .kind = bus_log_kind::spi_transfer,
+        .argument = p_filler,
+        .data_out = p_data_out },
+      [&]() -> std::span<hal::byte const> {
+        m_spi->transfer(p_data_out, p_data_in, p_filler);
+        return p_data_in;
+      });
+  }
+
+  hal::spi* m_spi;
+  bus_log_writer* m_log;
+  hal::steady_clock* m_clock;
+};
+
+/**
+ * @brief serial decorator that records writes and received data to a bus log
+ *
+ * Reads that return no data are not recorded.
+ */
+class recording_serial : public hal::serial
+{
+public:
+  /**
+   * @brief Construct a new recording serial object
+   *
+   * @param p_serial - serial to forward calls to
+   * @param p_log - log to record into
+   * @param p_clock - clock used to timestamp calls
+   */
+  recording_serial(hal::serial& p_serial,
+                   bus_log_writer& p_log,
+                   hal::steady_clock& p_clock)
+    : m_serial(&p_serial)
+    , m_log(&p_log)
+    , m_clock(&p_clock)
+  {
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    m_serial->configure(p_settings);
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    write_t result{};
+    detail::record_bus_call(
+      *m_log,
+      *m_clock,
+      { .kind = bus_log_kind::serial_write, .data_out = p_data },
+      [&](bus_log_entry& p_entry) -> std::span<hal::byte const> {
+        result = m_serial->write(p_data);
+        // A partial write is retried by the caller, so record only the bytes
+        // accepted, otherwise the retried bytes would be in the log twice
+        p_entry.data_out = result.data;
+        return {};
+      });
+    return result;
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    auto const start = m_clock->uptime();
+    auto const result = m_serial->read(p_data);
+    if (not result.data.empty()) {
+      m_log->append({
+        .kind = bus_log_kind::serial_read,
+        .start = start,
+        .duration = m_clock->uptime() - start,
+        .data_in = result.data,
+      });
+    }
+    return result;
+  }
+
+  void driver_flush() override
+  {
+    m_serial->flush();
+  }
+
+  hal::serial* m_serial;
+  bus_log_writer* m_log;
+  hal::steady_clock* m_clock;
+};
+
+/**
+ * @brief i2c that serves transactions from a recorded bus log
+ *
+ * Each transaction must match the next recorded transaction's address, written
+ * bytes and read length, otherwise the code under test has diverged from the
+ * recording and hal::io_error is thrown. Transactions that failed during
+ * recording throw the same kind of exception during replay.
+ *
+ * Replay is not paced by the recorded timestamps, making it suitable for
+ * benchmarking drivers against real traffic as fast as the host can run.
+ */
+class replay_i2c : public hal::i2c
+{
+public:
+  /**
+   * @brief Construct a new replay i2c object
+   *
+   * @param p_log - log recorded by recording_i2c
+   */
+  explicit replay_i2c(std::span<hal::byte const> p_log)
+    : m_reader(p_log)
+  {
+  }
+
+  /**
+   * @brief Restart from the beginning of the log
+   *
+   */
+  void rewind()
+  {
+    m_reader.rewind();
+  }
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  void driver_transaction(
+    hal::byte p_address,
+    std::span<hal::byte const> p_data_out,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function>) override
+  {
+    auto const entry = m_reader.next();
+    if (not entry || entry->kind != bus_log_kind::i2c_transaction ||
+        entry->argument != p_address ||
+        not std::ranges::equal(entry->data_out, p_data_out)) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    if (entry->failed) {
+      detail::replay_failure(*entry, this);
+    }
+    if (entry->data_in.size() != p_data_in.size()) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    std::ranges::copy(entry->data_in, p_data_in.begin());
+  }
+
+  bus_log_reader m_reader;
+};
+
+/**
+ * @brief spi that serves transfers from a recorded bus log
+ *
+ * Follows the same matching rules as hal::replay_i2c, with the filler byte in
+ * place of the address.
+ */
+class replay_spi : public hal::spi
+{
+public:
+  /**
+   * @brief Construct a new replay spi object
+   *
+   * @param p_log - log recorded by recording_spi
+   */
+  explicit replay_spi(std::span<hal::byte const> p_log)
+    : m_reader(p_log)
+  {
+  }
+
+  /**
+   * @brief Restart from the beginning of the log
+   *
+   */
+  void rewind()
+  {
+    m_reader.rewind();
+  }
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  void driver_transfer(std::span<hal::byte const> p_data_out,
+                       std::span<hal::byte> p_data_in,
+                       hal::byte p_filler) override
+  {
+    auto const entry = m_reader.next();
+    if (not entry || entry->kind != bus_log_kind::spi_transfer ||
+        entry->argument != p_filler ||
+        not std::ranges::equal(entry->data_out, p_data_out)) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    if (entry->failed) {
+      detail::replay_failure(*entry, this);
+    }
+    if (entry->data_in.size() != p_data_in.size()) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    std::ranges::copy(entry->data_in, p_data_in.begin());
+  }
+
+  bus_log_reader m_reader;
+};
+
+/**
+ * @brief serial that serves received data from a recorded bus log
+ *
+ * Received and written data are replayed as two independent byte streams, so
+ * code under test may read and write with different chunk sizes or
+ * interleaving than the recorded session. Written bytes must match the
+ * recorded written bytes, otherwise hal::io_error is thrown. Writes are always
+ * accepted in full. A write that reaches a recorded failed write throws the
+ * recorded error.
+ *
+ * Reads return as much recorded data as fits in the buffer, and return no data
+ * once the log is exhausted. The `capacity` field of read_t reports the size of
+ * the log.
+ */
+class replay_serial : public hal::serial
+{
+public:
+  /**
+   * @brief Construct a new replay serial object
+   *
+   * @param p_log - log recorded by recording_serial
+   */
+  explicit replay_serial(std::span<hal::byte const> p_log)
+    : m_log(p_log)
+    , m_read_cursor(p_log)
+    , m_write_cursor(p_log)
+  {
+  }
+
+  /**
+   * @brief Restart from the beginning of the log
+   *
+   */
+  void rewind()
+  {
+    m_read_cursor.rewind();
+    m_write_cursor.rewind();
+    m_pending_read = {};
+    m_pending_write = {};
+  }
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    auto remaining = p_data;
+    while (not remaining.empty()) {
+      if (m_pending_write.empty()) {
+        auto const entry =
+          next_entry(m_write_cursor, bus_log_kind::serial_write);
+        if (not entry) {
+          hal::safe_throw(hal::io_error(this));
+        }
+        if (entry->failed) {
+          auto const count = std::min(remaining.size(), entry->data_out.size());
+          if (not std::ranges::equal(remaining.first(count),
+                                     entry->data_out.first(count))) {
+            hal::safe_throw(hal::io_error(this));
+          }
+          detail::replay_failure(*entry, this);
+        }
+        m_pending_write = entry->data_out;
+        continue;
+      }
+      auto const count = std::min(remaining.size(), m_pending_write.size());
+      if (not std::ranges::equal(remaining.first(count),
+                                 m_pending_write.first(count))) {
+        hal::safe_throw(hal::io_error(this));
+      }
+      remaining = remaining.subspan(count);
+      m_pending_write = m_pending_write.subspan(count);
+    }
+    return { .data = p_data };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    std::size_t count = 0;
+    while (count < p_data.size()) {
+      if (m_pending_read.empty()) {
+        auto const entry = next_entry(m_read_cursor, bus_log_kind::serial_read);
+        if (not entry) {
+          break;
+        }
+        m_pending_read = entry->data_in;
+        continue;
+      }
+      auto const chunk =
+        std::min(p_data.size() - count, m_pending_read.size());
+      std::ranges::copy(m_pending_read.first(chunk), p_data.begin() + count);
+      m_pending_read = m_pending_read.subspan(chunk);
+      count += chunk;
+    }
+    return {
+      .data = p_data.first(count),
+      .available = m_pending_read.size(),
+      .capacity = m_log.size(),
+    };
+  }
+
+  void driver_flush() override
+  {
+    m_pending_read = {};
+  }
+
+  /// Advance a cursor to the next entry of a kind, std::nullopt at the end of
+  /// the log
+  static std::optional<bus_log_entry> next_entry(bus_log_reader& p_cursor,
+                                                 bus_log_kind p_kind)
+  {
+    while (auto const entry = p_cursor.next()) {
+      if (entry->kind == p_kind) {
+        return entry;
+      }
+    }
+    return std::nullopt;
+  }
+
+  std::span<hal::byte const> m_log;
+  bus_log_reader m_read_cursor;
+  bus_log_reader m_write_cursor;
+  std::span<hal::byte const> m_pending_read{};
+  std::span<hal::byte const> m_pending_write{};
+};
+}  // namespace hal
@@ -0,0 +1,416 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <span>
+
+#include "can.hpp"
+#include "error.hpp"
+#include "functional.hpp"
+#include "steady_clock.hpp"
+#include "timer.hpp"
+#include "timer_wheel.hpp"
+#include "units.hpp"
+
+namespace hal {
+class can_cyclic_scheduler;
+
+/**
+ * @brief Transmission statistics of a cyclic message
+ *
+ * Intervals are measured between consecutive calls to `hal::can::send()` for
+ * the message, in ticks of the scheduler's steady clock.
+ */
+struct can_cyclic_statistics
+{
+  /// Number of successful sends
+  std::uint32_t sent = 0;
+  /// Number of sends that threw
+  std::uint32_t failed = 0;
+  /// Shortest interval between consecutive sends
+  std::uint64_t min_interval = std::numeric_limits<std::uint64_t>::max();
+  /// Longest interval between consecutive sends
+  std::uint64_t max_interval = 0;
+  /// Largest difference between an interval and the message's period
+  std::uint64_t max_jitter = 0;
+};
+
+/**
+ * @brief A CAN message sent periodically by a hal::can_cyclic_scheduler
+ *
+ */
+class can_cyclic_message
+{
+public:
+  /// Called before every send to fill in the message's payload
+  using update_handler = void(hal::can::message_t& p_message);
+
+  /**
+   * @brief Construct a new cyclic message object
+   *
+   * @param p_message - message to send, its payload may be changed at any
+   * time between sends or by p_update
+   * @param p_period - time between sends, rounded up to a whole number of the
+   * scheduler's ticks
+   * @param p_update - called just before every send
+   */
+  can_cyclic_message(
+    hal::can::message_t const& p_message,
+    hal::time_duration p_period,
+    hal::callback<update_handler> p_update = [](hal::can::message_t&) {})
+    : message(p_message)
+    , m_period(p_period)
+    , m_update(p_update)
+  {
+  }
+
+  can_cyclic_message(can_cyclic_message const&) = delete;
+  can_cyclic_message& operator=(can_cyclic_message const&) = delete;
+  can_cyclic_message(can_cyclic_message&&) = delete;
+  can_cyclic_message& operator=(can_cyclic_message&&) = delete;
+
+  /**
+   * @brief Time between sends
+   *
+   * @return hal::time_duration - the period given on construction
+   */
+  [[nodiscard]] hal::time_duration period() const
+  {
+    return m_period;
+  }
+
+  /**
+   * @brief Transmission statistics since start or the last reset
+   *
+   * @return can_cyclic_statistics const& - statistics of this message
+   */
+  [[nodiscard]] can_cyclic_statistics const& statistics() const
+  {
+    return m_statistics;
+  }
+
+  /**
+   * @brief Clear the transmission statistics
+   *
+   * The next interval is measured from the next send.
+   */
+  void reset_statistics()
+  {
+    m_statistics = {};
+    m_last_send = 0;
+  }
+
+  /// Message sent every period
+  hal::can::message_t message;
+
+private:
+  friend class can_cyclic_scheduler;
+
+  hal::time_duration m_period;
+  hal::callback<update_handler> m_update;
+  hal::timer_wheel_entry m_entry;
+  can_cyclic_statistics m_statistics{};
+  std::uint64_t m_last_send = 0;
+  std::uint32_t m_period_ticks = 1;
+};
+
+/**
+ * @brief Sends a table of periodic CAN messages from a single timer
+ *
+ * Each message is an entry on a hal::timer_wheel, so a tick costs time only
+ * for the messages due on it no matter how many messages there are. The
+ * wheel is advanced by one hal::timer, which is rescheduled for the next
+ * tick boundary measured on a steady clock so that the schedule does not
+ * drift. If the timer runs late, the missed ticks are run immediately.
+ *
+ * When started, each message is given the phase (tick of its first send)
+ * that overlaps least with the messages before it, so that messages sharing
+ * a period are spread across the ticks of that period instead of all being
+ * sent in one burst.
+ *
+ * Other users of the wheel, such as hal::j1939::stack, are ticked by the same
+ * timer, so all CAN timing of a node can share one hardware timer.
+ *
+ * Messages are sent from within the timer callback. Errors thrown by
+ * `hal::can::send()` or an update handler are counted in the message's
+ * statistics rather than propagated, so a bus-off condition does not stop the
+ * schedule.
+ *
+ * USAGE:
+ *
+ *      std::array<hal::can_cyclic_message, 2> messages{ {
+ *        { { .id = 0x100, .length = 8 }, 10ms, update_speed },
+ *        { { .id = 0x200, .length = 2 }, 100ms },
+ *      } };
+ *      hal::can_cyclic_scheduler scheduler(can, timer, clock, wheel, messages);
+ *      scheduler.start();
+ */
+class can_cyclic_scheduler
+{
+public:
+  /// Number of ticks over which phases are spread
+  static constexpr std::size_t phase_horizon = 128;
+
+  /**
+   * @brief Construct a new cyclic scheduler object
+   *
+   * @param p_can - can port to send the messages on
+   * @param p_timer - timer driving the wheel
+   * @param p_clock - clock used to place ticks and measure intervals
+   * @param p_wheel - wheel to schedule the messages on, its tick period is
+   * the scheduling resolution
+   * @param p_messages - table of messages to send
+   */
+  can_cyclic_scheduler(hal::can& p_can,
+                       hal::timer& p_timer,
+                       hal::steady_clock& p_clock,
+                       hal::timer_wheel& p_wheel,
+                       std::span<can_cyclic_message> p_messages)
+    : m_can(&p_can)
+    , m_timer(&p_timer)
+    , m_clock(&p_clock)
+    , m_wheel(&p_wheel)
+    , m_messages(p_messages)
+    , m_frequency(p_clock.frequency())
+    , m_clocks_per_tick(std::max(
+        std::chrono::duration<double>(p_wheel.tick_period()).count() *
+          static_cast<double>(m_frequency),
+        1.0))
+  {
+  }
+
+  can_cyclic_scheduler(can_cyclic_scheduler const&) = delete;
+  can_cyclic_scheduler& operator=(can_cyclic_scheduler const&) = delete;
+  can_cyclic_scheduler(can_cyclic_scheduler&&) = delete;
+  can_cyclic_scheduler& operator=(can_cyclic_scheduler&&) = delete;
+
+  ~can_cyclic_scheduler()
+  {
+    stop();
+  }
+
+  /**
+   * @brief Assign phases and start sending the messages
+   *
+   * Restarts the schedule if already started. Statistics are reset.
+   *
+   * @throws hal::argument_out_of_domain - if a message's period is not
+   * positive
+   */
+  void start()
+  {
+    stop();
+
+    for (auto const& message : m_messages) {
+      if (message.m_period <= hal::time_duration::zero()) {
+        hal::safe_throw(hal::argument_out_of_domain(this));
+      }
+    }
+
+    std::array<std::uint16_t, phase_horizon> load{};
+    for (auto& message : m_messages) {
+      message.m_period_ticks = m_wheel->ticks(message.m_period);
+      message.reset_statistics();
+      auto const phase = least_loaded_phase(load, message.m_period_ticks);
+      m_wheel->schedule(message.m_entry, phase + 1, [this, &message]() {
+        transmit(message);
+      });
+    }
+
+    m_start = m_clock->uptime();
+    m_ticks = 0;
+    schedule_next_tick();
+  }
+
+  /**
+   * @brief Stop sending the messages
+   *
+   * Entries of other users of the wheel are left scheduled, but the wheel is
+   * no longer ticked.
+   */
+  void stop()
+  {
+    m_timer->cancel();
+    for (auto& message : m_messages) {
+      m_wheel->cancel(message.m_entry);
+    }
+  }
+
+  /**
+   * @brief Number of ticks run a whole tick or more after their deadline
+   *
+   * Late ticks are caused by the timer callback being delayed, for example by
+   * higher priority interrupts, or by sends that take longer than a tick.
+   *
+   * @return std::uint32_t - late tick count
+   */
+  [[nodiscard]] std::uint32_t late_ticks() const
+  {
+    return m_late_ticks;
+  }
+
+  /**
+   * @brief Length of one tick of the wheel
+   *
+   * Deadlines are placed with the exact, possibly fractional, ratio of the
+   * tick period to the clock period, so the schedule does not drift when the
+   * clock frequency is not a multiple of the tick rate.
+   *
+   * @return std::uint64_t - tick period in ticks of the steady clock, rounded
+   * to the nearest tick
+   */
+  [[nodiscard]] std::uint64_t tick_clocks() const
+  {
+    return clocks_for(1);
+  }
+
+private:
+  static std::uint32_t least_loaded_phase(
+    std::array<std::uint16_t, phase_horizon>& p_load,
+    std::uint32_t p_period)
+  {
+    auto const candidates = std::min<std::size_t>(p_period, phase_horizon);
+    std::uint32_t best = 0;
+    std::uint32_t best_cost = std::numeric_limits<std::uint32_t>::max();
+    for (std::uint32_t phase = 0; phase < candidates; phase++) {
+      std::uint32_t cost = 0;
+      for (auto tick = phase; tick < phase_horizon; tick += p_period) {
+        cost += p_load[tick];
+      }
+      if (cost < best_cost) {
+        best = phase;
+        best_cost = cost;
+      }
+    }
+    for (auto tick = best; tick < phase_horizon; tick += p_period) {
+      p_load[tick]++;
+    }
+    return best;
+  }
+
+  void transmit(can_cyclic_message& p_message)
+  {
+    // Reschedule first, relative to this tick, so the period does not drift
+    m_wheel->schedule(
+      p_message.m_entry, p_message.m_period_ticks, [this, &p_message]() {
+        transmit(p_message);
+      });
+
+    auto& statistics = p_message.m_statistics;
+    try {
+      p_message.m_update(p_message.message);
+      auto const now = m_clock->uptime();
+      m_can->send(p_message.message);
+      record_interval(p_message, now);
+    } catch (hal::exception const&) {
+      statistics.failed++;
+    }
+  }
+
+  void record_interval(can_cyclic_message& p_message, std::uint64_t p_now)
+  {
+    auto& statistics = p_message.m_statistics;
+    if (statistics.sent != 0) {
+      auto const interval = p_now - p_message.m_last_send;
+      auto const nominal = clocks_for(p_message.m_period_ticks);
+      auto const jitter =
+        interval > nominal ? interval - nominal : nominal - interval;
+      statistics.min_interval = std::min(statistics.min_interval, interval);
+      statistics.max_interval = std::max(statistics.max_interval, interval);
+      statistics.max_jitter = std::max(statistics.max_jitter, jitter);
+    }
+    statistics.sent++;
+    p_message.m_last_send = p_now;
+  }
+
+  void on_timer()
+  {
+    // A send that outlasts a tick can let the timer fire again before this
+    // call returns, the loop below catches up for it
+    if (m_ticking) {
+      return;
+    }
+    m_ticking = true;
+    auto due = ticks_due(m_clock->uptime());
+    // Sending takes time, so keep catching up until no tick is due
+    while (m_ticks < due) {
+      if (due > m_ticks + 1) {
+        m_late_ticks++;
+      }
+      m_ticks++;
+      m_wheel->tick();
+      if (m_ticks == due) {
+        due = ticks_due(m_clock->uptime());
+      }
+    }
+    m_ticking = false;
+    schedule_next_tick();
+  }
+
+  /// Clock ticks spanned by p_ticks wheel ticks, rounded to the nearest
+  [[nodiscard]] std::uint64_t clocks_for(std::uint64_t p_ticks) const
+  {
+    return static_cast<std::uint64_t>(
+      std::llround(static_cast<double>(p_ticks) * m_clocks_per_tick));
+  }
+
+  /// Number of wheel ticks whose deadline is at or before p_now
+  [[nodiscard]] std::uint64_t ticks_due(std::uint64_t p_now) const
+  {
+    auto const elapsed = p_now - m_start;
+    // Estimate with the ratio, then settle on the rounded deadlines
+    auto due = static_cast<std::uint64_t>(static_cast<double>(elapsed) /
+                                          m_clocks_per_tick);
+    while (clocks_for(due + 1) <= elapsed) {
+      due++;
+    }
+    while (due != 0 && clocks_for(due) > elapsed) {
+      due--;
+    }
+    return due;
+  }
+
+  void schedule_next_tick()
+  {
+    auto const deadline = m_start + clocks_for(m_ticks + 1);
+    auto const now = m_clock->uptime();
+    auto const remaining = deadline > now ? deadline - now : 0;
+    auto const delay = std::chrono::ceil<hal::time_duration>(
+      std::chrono::duration<double>(static_cast<double>(remaining) /
+                                    static_cast<double>(m_frequency)));
+    m_timer->schedule([this]() { on_timer(); }, delay);
+  }
+
+  hal::can* m_can;
+  hal::timer* m_timer;
+  hal::steady_clock* m_clock;
+  hal::timer_wheel* m_wheel;
+  std::span<can_cyclic_message> m_messages;
+  hertz m_frequency;
+  double m_clocks_per_tick;
+  std::uint64_t m_start = 0;
+  std::uint64_t m_ticks = 0;
+  std::uint32_t m_late_ticks = 0;
+  bool m_ticking = false;
+};
+}  // namespace hal
@@ -0,0 +1,489 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "error.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Bit numbering of a CAN signal within the payload
+ *
+ */
+enum class can_byte_order : std::uint8_t
+{
+  /// "Intel", `@1` in DBC files, the start bit is the least significant bit
+  little_endian,
+  /// "Motorola", `@0` in DBC files, the start bit is the most significant bit
+  big_endian,
+};
+
+/**
+ * @brief Location and scaling of a signal within a CAN payload
+ *
+ * Bits are numbered as in DBC files: bit 0 is the least significant bit of
+ * payload byte 0 and bit 63 is the most significant bit of payload byte 7.
+ *
+ * The physical value of a signal is `raw * scale + offset`.
+ */
+struct can_signal_definition
+{
+  /// Bit number of the least (little endian) or most (big endian)
+  /// significant bit
+  std::uint8_t start_bit = 0;
+  /// Number of bits in the signal, 1 to 64
+  std::uint8_t length = 1;
+  can_byte_order byte_order = can_byte_order::little_endian;
+  /// Raw value is two's complement
+  bool is_signed = false;
+  float scale = 1.0f;
+  float offset = 0.0f;
+
+  [[nodiscard]] constexpr bool operator==(
+    can_signal_definition const&) const = default;
+};
+
+namespace detail {
+/// Bits of a signal held in one payload byte
+struct can_signal_segment
+{
+  std::uint8_t byte;
+  /// Position of the segment's least significant bit within the byte
+  std::uint8_t byte_shift;
+  std::uint8_t width;
+  /// Position of the segment's least significant bit within the raw value
+  std::uint8_t value_shift;
+};
+
+consteval std::size_t can_signal_segment_count(
+  can_signal_definition p_definition)
+{
+  auto const first_bit = p_definition.byte_order == can_byte_order::big_endian
+                           ? 7U - p_definition.start_bit % 8U
+                           : p_definition.start_bit % 8U;
+  return (first_bit + p_definition.length + 7U) / 8U;
+}
+
+template<can_signal_definition definition>
+consteval auto make_can_signal_segments()
+{
+  constexpr auto count = can_signal_segment_count(definition);
+  std::array<can_signal_segment, count> segments{};
+
+  unsigned byte = definition.start_bit / 8U;
+  unsigned remaining = definition.length;
+  if constexpr (definition.byte_order == can_byte_order::little_endian) {
+    // Walk from the least significant bit toward higher bytes
+    unsigned bit = definition.start_bit % 8U;
+    for (auto& segment : segments) {
+      auto const width = std::min(8U - bit, remaining);
+      segment = { .byte = static_cast<std::uint8_t>(byte),
+                  .byte_shift = static_cast<std::uint8_t>(bit),
+                  .width = static_cast<std::uint8_t>(width),
+                  .value_shift = static_cast<std::uint8_t>(
+                    definition.length - remaining) };
+      remaining -= width;
+      bit = 0;
+      byte++;
+    }
+  } else {
+    // Walk from the most significant bit toward higher bytes, the "sawtooth"
+    // numbering of Motorola signals
+    unsigned top_bit = definition.start_bit % 8U;
+    for (auto& segment : segments) {
+      auto const width = std::min(top_bit + 1U, remaining);
+      remaining -= width;
+      segment = { .byte = static_cast<std::uint8_t>(byte),
+                  .byte_shift = static_cast<std::uint8_t>(top_bit + 1U - width),
+                  .width = static_cast<std::uint8_t>(width),
+                  .value_shift = static_cast<std::uint8_t>(remaining) };
+      top_bit = 7;
+      byte++;
+    }
+  }
+  return segments;
+}
+
+template<std::size_t length, bool is_signed>
+using can_signal_raw_t = std::conditional_t<
+  (length <= 8),
+  std::conditional_t<is_signed, std::int8_t, std::uint8_t>,
+  std::conditional_t<
+    (length <= 16),
+    std::conditional_t<is_signed, std::int16_t, std::uint16_t>,
+    std::conditional_t<
+      (length <= 32),
+      std::conditional_t<is_signed, std::int32_t, std::uint32_t>,
+      std::conditional_t<is_signed, std::int64_t, std::uint64_t>>>>;
+
+inline void dbc_parse_error()
+{
+  // Not constexpr, reaching this from the parser is a compile error
+  hal::safe_throw(hal::argument_out_of_domain(nullptr));
+}
+
+struct dbc_cursor
+{
+  std::string_view text;
+
+  consteval void skip_spaces()
+  {
+    while (not text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+      text.remove_prefix(1);
+    }
+  }
+
+  consteval void expect(char p_character)
+  {
+    skip_spaces();
+    if (text.empty() || text.front() != p_character) {
+      dbc_parse_error();
+    }
+    text.remove_prefix(1);
+  }
+
+  consteval std::string_view word()
+  {
+    skip_spaces();
+    std::size_t length = 0;
+    while (length < text.size() && text[length] != ' ' &&
+           text[length] != '\t' && text[length] != ':') {
+      length++;
+    }
+    auto const result = text.substr(0, length);
+    text.remove_prefix(length);
+    return result;
+  }
+
+  consteval unsigned integer()
+  {
+    skip_spaces();
+    if (text.empty() || text.front() < '0' || text.front() > '9') {
+      dbc_parse_error();
+    }
+    unsigned result = 0;
+    while (not text.empty() && text.front() >= '0' && text.front() <= '9') {
+      result = result * 10U + static_cast<unsigned>(text.front() - '0');
+      text.remove_prefix(1);
+    }
+    return result;
+  }
+
+  consteval long double number()
+  {
+    skip_spaces();
+    long double sign = 1.0L;
+    if (not text.empty() && (text.front() == '-' || text.front() == '+')) {
+      sign = text.front() == '-' ? -1.0L : 1.0L;
+      text.remove_prefix(1);
+    }
+
+    long double result = 0.0L;
+    bool has_digits = false;
+    while (not text.empty() && text.front() >= '0' && text.front() <= '9') {
+      result = result * 10.0L + (text.front() - '0');
+      text.remove_prefix(1);
+      has_digits = true;
+    }
+    if (not text.empty() && text.front() == '.') {
+      text.remove_prefix(1);
+      long double place = 0.1L;
+      while (not text.empty() && text.front() >= '0' && text.front() <= '9') {
+        result += place * (text.front() - '0');
+        place /= 10.0L;
+        text.remove_prefix(1);
+        has_digits = true;
+      }
+    }
+    if (not has_digits) {
+      dbc_parse_error();
+    }
+    if (not text.empty() && (text.front() == 'e' || text.front() == 'E')) {
+      text.remove_prefix(1);
+      bool negative_exponent = false;
+      if (not text.empty() && (text.front() == '-' || text.front() == '+')) {
+        negative_exponent = text.front() == '-';
+        text.remove_prefix(1);
+      }
+      auto exponent = integer();
+      while (exponent-- != 0) {
+        result = negative_exponent ? result / 10.0L : result * 10.0L;
+      }
+    }
+    return sign * result;
+  }
+};
+}  // namespace detail
+
+/**
+ * @brief Parse a signal line of a DBC file at compile time
+ *
+ * Lets signal definitions be pasted verbatim from the DBC file describing the
+ * network, so there is no generated code to keep in sync:
+ *
+ *      constexpr auto engine_speed = hal::parse_dbc_signal(
+ *        R"(SG_ EngineSpeed : 24|16@1+ (0.125,0) [0|8031.875] "rpm" ECU)");
+ *
+ * The name, range, unit and receivers are checked for presence but not kept.
+ * A multiplexer indicator (`M` or `mN`) after the name is accepted;
+ * selecting the signals of the current multiplex value is left to the
+ * caller. A malformed line is a compile error.
+ *
+ * @param p_line - one `SG_` line of a DBC file
+ * @return can_signal_definition - location and scaling of the signal
+ */
+consteval can_signal_definition parse_dbc_signal(std::string_view p_line)
+{
+  detail::dbc_cursor cursor{ p_line };
+  if (cursor.word() != "SG_" || cursor.word().empty()) {
+    detail::dbc_parse_error();
+  }
+  cursor.skip_spaces();
+  if (not cursor.text.empty() && cursor.text.front() != ':') {
+    // Multiplexer indicator
+    cursor.word();
+  }
+  cursor.expect(':');
+
+  can_signal_definition definition{};
+  auto const start_bit = cursor.integer();
+  cursor.expect('|');
+  auto const length = cursor.integer();
+  cursor.expect('@');
+  auto const order = cursor.integer();
+  if (start_bit > 63 || length < 1 || length > 64 || order > 1 ||
+      cursor.text.empty()) {
+    detail::dbc_parse_error();
+  }
+  definition.start_bit = static_cast<std::uint8_t>(start_bit);
+  definition.length = static_cast<std::uint8_t>(length);
+  definition.byte_order = order == 1 ? can_byte_order::little_endian
+                                     : can_byte_order::big_endian;
+  if (cursor.text.front() != '+' && cursor.text.front() != '-') {
+    detail::dbc_parse_error();
+  }
+  definition.is_signed = cursor.text.front() == '-';
+  cursor.text.remove_prefix(1);
+
+  cursor.expect('(');
+  definition.scale = static_cast<float>(cursor.number());
+  cursor.expect(',');
+  definition.offset = static_cast<float>(cursor.number());
+  cursor.expect(')');
+  cursor.expect('[');
+  cursor.number();
+  cursor.expect('|');
+  cursor.number();
+  cursor.expect(']');
+  cursor.expect('"');
+  while (not cursor.text.empty() && cursor.text.front() != '"') {
+    cursor.text.remove_prefix(1);
+  }
+  cursor.expect('"');
+  if (cursor.word().empty()) {
+    detail::dbc_parse_error();
+  }
+  return definition;
+}
+
+/**
+ * @brief Pack and unpack one signal of a CAN payload
+ *
+ * The signal's location, byte order and sign are template parameters, so
+ * the bytes it spans and the shift and mask for each are computed at compile
+ * time. Unpacking compiles to one load, shift and mask per byte spanned by
+ * the signal, with no loops or runtime bit numbering, unlike a generic
+ * decoder interpreting a signal table.
+ *
+ *      using engine_speed = hal::can_signal<hal::parse_dbc_signal(
+ *        R"(SG_ EngineSpeed : 24|16@1+ (0.125,0) [0|8031.875] "rpm" ECU)")>;
+ *
+ *      float const rpm = engine_speed::decode(message.payload);
+ *      engine_speed::encode(reply.payload, 900.0f);
+ *
+ * @tparam definition - location and scaling of the signal
+ */
+template<can_signal_definition definition>
+class can_signal
+{
+public:
+  static_assert(definition.length >= 1 && definition.length <= 64,
+                "signal length must be 1 to 64 bits");
+  static_assert(definition.start_bit <= 63, "start bit must be 0 to 63");
+  static_assert(definition.scale != 0.0f, "scale must not be zero");
+
+  /// Smallest integer type holding the raw value
+  using raw_t = detail::can_signal_raw_t<definition.length,
+                                         definition.is_signed>;
+  using payload_t = std::span<hal::byte const, 8>;
+  using mutable_payload_t = std::span<hal::byte, 8>;
+
+  static constexpr auto segments =
+    detail::make_can_signal_segments<definition>();
+
+  static_assert(segments.back().byte < 8, "signal extends past the payload");
+
+  /**
+   * @brief Extract the raw value of the signal
+   *
+   * @param p_payload - payload of the message
+   * @return raw_t - raw value, sign extended if the signal is signed
+   */
+  [[nodiscard]] static constexpr raw_t unpack(payload_t p_payload)
+  {
+    auto const bits = gather(p_payload, std::make_index_sequence<count>{});
+    if constexpr (definition.is_signed && definition.length < 64) {
+      constexpr std::uint64_t sign_bit = std::uint64_t{ 1 }
+                                         << (definition.length - 1);
+      return static_cast<raw_t>(static_cast<std::int64_t>(bits ^ sign_bit) -
+                                static_cast<std::int64_t>(sign_bit));
+    } else {
+      return static_cast<raw_t>(bits);
+    }
+  }
+
+  /**
+   * @brief Store the raw value of the signal
+   *
+   * Bits of the payload outside of the signal are left unchanged. Bits of
+   * p_raw that do not fit in the signal are discarded.
+   *
+   * @param p_payload - payload of the message
+   * @param p_raw - raw value
+   */
+  static constexpr void pack(mutable_payload_t p_payload, raw_t p_raw)
+  {
+    scatter(p_payload,
+            static_cast<std::uint64_t>(p_raw),
+            std::make_index_sequence<count>{});
+  }
+
+  /**
+   * @brief Extract the physical value of the signal
+   *
+   * @param p_payload - payload of the message
+   * @return float - `raw * scale + offset`
+   */
+  [[nodiscard]] static constexpr float decode(payload_t p_payload)
+  {
+    auto const raw = static_cast<float>(unpack(p_payload));
+    if constexpr (definition.scale == 1.0f && definition.offset == 0.0f) {
+      return raw;
+    } else {
+      return raw * definition.scale + definition.offset;
+    }
+  }
+
+  /**
+   * @brief Store the physical value of the signal
+   *
+   * The value is rounded to the nearest raw value and saturates at the
+   * limits of the raw value.
+   *
+   * @param p_payload - payload of the message
+   * @param p_value - physical value
+   */
+  static constexpr void encode(mutable_payload_t p_payload, float p_value)
+  {
+    auto const scaled = (static_cast<double>(p_value) - definition.offset) /
+                        static_cast<double>(definition.scale);
+    pack(p_payload, to_raw(scaled));
+  }
+
+  /**
+   * @brief The definition the signal was generated from
+   *
+   * @return can_signal_definition - location and scaling of the signal
+   */
+  [[nodiscard]] static constexpr can_signal_definition get_definition()
+  {
+    return definition;
+  }
+
+private:
+  static constexpr std::size_t count = segments.size();
+
+  static constexpr std::uint64_t mask(std::size_t p_width)
+  {
+    return p_width == 64 ? ~std::uint64_t{ 0 }
+                         : (std::uint64_t{ 1 } << p_width) - 1;
+  }
+
+  template<std::size_t... index>
+  static constexpr std::uint64_t gather(payload_t p_payload,
+                                        std::index_sequence<index...>)
+  {
+    return ((((static_cast<std::uint64_t>(p_payload[segments[index].byte]) >>
+               segments[index].byte_shift) &
+              mask(segments[index].width))
+             << segments[index].value_shift) |
+            ...);
+  }
+
+  template<std::size_t... index>
+  static constexpr void scatter(mutable_payload_t p_payload,
+                                std::uint64_t p_bits,
+                                std::index_sequence<index...>)
+  {
+    ((p_payload[segments[index].byte] = static_cast<hal::byte>(
+        (p_payload[segments[index].byte] &
+         ~(mask(segments[index].width) << segments[index].byte_shift)) |
+        ((p_bits >> segments[index].value_shift) &
+         mask(segments[index].width))
+          << segments[index].byte_shift)),
+     ...);
+  }
+
+  static constexpr raw_t to_raw(double p_scaled)
+  {
+    constexpr auto minimum =
+      definition.is_signed
+        ? -static_cast<double>(std::uint64_t{ 1 } << (definition.length - 1))
+        : 0.0;
+    constexpr auto maximum =
+      definition.is_signed
+        ? static_cast<double>(mask(definition.length - 1U))
+        : static_cast<double>(mask(definition.length));
+    constexpr auto top = static_cast<raw_t>(
+      definition.is_signed ? mask(definition.length - 1U)
+                           : mask(definition.length));
+
+    if (not(p_scaled > minimum)) {
+      return static_cast<raw_t>(minimum);
+    }
+    // Compare before converting, maximum can round up past the raw type
+    if (p_scaled >= maximum) {
+      return top;
+    }
+    auto const rounded = p_scaled < 0.0 ? p_scaled - 0.5 : p_scaled + 0.5;
+    if (rounded < 0.0) {
+      return static_cast<raw_t>(static_cast<std::int64_t>(rounded));
+    }
+    auto const result = static_cast<std::uint64_t>(rounded);
+    return static_cast<raw_t>(
+      std::min(result, static_cast<std::uint64_t>(top)));
+  }
+};
+}  // namespace hal
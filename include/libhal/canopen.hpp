@@ -0,0 +1,749 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <type_traits>
+
+#include "can.hpp"
+#include "error.hpp"
+#include "units.hpp"
+
+namespace hal::canopen {
+/// SYNC message, triggers synchronous PDOs
+constexpr hal::can::id_t sync_id = 0x080;
+/// Base of the id of SDO responses, plus the node id
+constexpr hal::can::id_t sdo_response_base = 0x580;
+/// Base of the id of SDO requests, plus the node id
+constexpr hal::can::id_t sdo_request_base = 0x600;
+
+/**
+ * @brief Default id of a transmit PDO
+ *
+ * @param p_number - PDO number, 1 to 4
+ * @param p_node_id - id of the transmitting node
+ * @return hal::can::id_t - 0x180, 0x280, 0x380 or 0x480 plus the node id
+ */
+constexpr hal::can::id_t tpdo_id(std::uint32_t p_number, std::uint8_t p_node_id)
+{
+  return 0x080 + 0x100 * p_number + p_node_id;
+}
+
+/**
+ * @brief Default id of a receive PDO
+ *
+ * @param p_number - PDO number, 1 to 4
+ * @param p_node_id - id of the receiving node
+ * @return hal::can::id_t - 0x200, 0x300, 0x400 or 0x500 plus the node id
+ */
+constexpr hal::can::id_t rpdo_id(std::uint32_t p_number, std::uint8_t p_node_id)
+{
+  return 0x100 + 0x100 * p_number + p_node_id;
+}
+
+/// Access an SDO client has to an object
+enum class access : std::uint8_t
+{
+  read_only,
+  write_only,
+  read_write,
+};
+
+/// Reason given in an SDO abort
+enum class sdo_abort : std::uint32_t
+{
+  toggle_bit_not_alternated = 0x0503'0000,
+  invalid_command = 0x0504'0001,
+  write_only_object = 0x0601'0001,
+  read_only_object = 0x0601'0002,
+  no_object = 0x0602'0000,
+  length_mismatch = 0x0607'0010,
+  length_too_high = 0x0607'0012,
+  length_too_low = 0x0607'0013,
+  no_subindex = 0x0609'0011,
+};
+
+/**
+ * @brief Object dictionary entry, an application variable and its address
+ *
+ * Create with `hal::canopen::entry()`.
+ */
+struct object
+{
+  std::uint16_t index;
+  std::uint8_t subindex;
+  access mode;
+  std::uint32_t size;
+  /// Variable holding the value, never written if the mode is read_only
+  void* data;
+
+  /// Sort key, the index followed by the subindex
+  [[nodiscard]] constexpr std::uint32_t key() const
+  {
+    return static_cast<std::uint32_t>(index) << 8 | subindex;
+  }
+};
+
+/**
+ * @brief Make a dictionary entry for an application variable
+ *
+ * @tparam value_t - type of the variable, an integer, float or byte array.
+ * Values are copied byte for byte, so multi-byte values have the little
+ * endian order CANopen requires on little endian targets.
+ * @param p_index - index of the object
+ * @param p_subindex - subindex of the object
+ * @param p_variable - variable holding the value, with static storage
+ * duration for the entry to be a constant expression
+ * @param p_mode - access given to SDO clients
+ * @return object - the dictionary entry
+ */
+template<class value_t>
+constexpr object entry(std::uint16_t p_index,
+                       std::uint8_t p_subindex,
+                       value_t& p_variable,
+                       access p_mode = access::read_write)
+{
+  static_assert(std::is_trivially_copyable_v<value_t>,
+                "objects are copied byte for byte");
+  return { .index = p_index,
+           .subindex = p_subindex,
+           .mode = p_mode,
+           .size = sizeof(value_t),
+           .data = static_cast<void*>(&p_variable) };
+}
+
+/**
+ * @brief Make a read only dictionary entry for a constant
+ *
+ * @tparam value_t - type of the constant
+ * @param p_index - index of the object
+ * @param p_subindex - subindex of the object
+ * @param p_constant - constant holding the value
+ * @return object - the dictionary entry
+ */
+template<class value_t>
+constexpr object entry(std::uint16_t p_index,
+                       std::uint8_t p_subindex,
+                       value_t const& p_constant)
+{
+  static_assert(std::is_trivially_copyable_v<value_t>,
+                "objects are copied byte for byte");
+  return { .index = p_index,
+           .subindex = p_subindex,
+           .mode = access::read_only,
+           .size = sizeof(value_t),
+           // Never written, its mode is read_only
+           .data = const_cast<void*>(static_cast<void const*>(&p_constant)) };
+}
+
+namespace detail {
+inline void dictionary_error()
+{
+  // Not constexpr, reaching this from a consteval function is a compile error
+  hal::safe_throw(hal::argument_out_of_domain(nullptr));
+}
+}  // namespace detail
+
+/**
+ * @brief Sort an object dictionary at compile time
+ *
+ * The result can be searched with `hal::canopen::find()` and given to
+ * hal::canopen::node. Duplicate entries are a compile error.
+ *
+ *      using namespace hal::canopen;
+ *      constexpr auto dictionary = make_dictionary(std::array{
+ *        entry(0x1000, 0, device_type),
+ *        entry(0x6000, 1, inputs, access::read_only),
+ *        entry(0x6200, 1, outputs),
+ *      });
+ *
+ * @param p_objects - entries in any order
+ * @return std::array<object, count> - entries sorted by index and subindex
+ */
+template<std::size_t count>
+consteval std::array<object, count> make_dictionary(
+  std::array<object, count> p_objects)
+{
+  std::ranges::sort(p_objects, {}, &object::key);
+  if (std::ranges::adjacent_find(p_objects, {}, &object::key) !=
+      p_objects.end()) {
+    detail::dictionary_error();
+  }
+  return p_objects;
+}
+
+/**
+ * @brief Find an object in a sorted dictionary by binary search
+ *
+ * @param p_dictionary - dictionary sorted by `make_dictionary()`
+ * @param p_index - index of the object
+ * @param p_subindex - subindex of the object
+ * @return object const* - the object or nullptr if it is not in the
+ * dictionary
+ */
+constexpr object const* find(std::span<object const> p_dictionary,
+                             std::uint16_t p_index,
+                             std::uint8_t p_subindex)
+{
+  auto const key = static_cast<std::uint32_t>(p_index) << 8 | p_subindex;
+  auto const found =
+    std::ranges::lower_bound(p_dictionary, key, {}, &object::key);
+  if (found == p_dictionary.end() || found->key() != key) {
+    return nullptr;
+  }
+  return &*found;
+}
+
+/// Object mapped into a PDO
+struct pdo_entry
+{
+  std::uint16_t index;
+  std::uint8_t subindex;
+};
+
+/// Copy of one object to or from the payload of a PDO
+struct pdo_copy
+{
+  void* data;
+  std::uint8_t offset;
+  std::uint8_t size;
+};
+
+/// Whether a PDO is sent or received by the node
+enum class pdo_direction : std::uint8_t
+{
+  transmit,
+  receive,
+};
+
+/**
+ * @brief PDO mapping resolved against a dictionary
+ *
+ * Create with `hal::canopen::make_pdo_mapping()`.
+ *
+ * @tparam count - number of mapped objects
+ */
+template<std::size_t count>
+struct pdo_mapping
+{
+  std::array<pdo_copy, count> copies;
+  /// Payload length of the PDO
+  std::uint8_t length;
+};
+
+/**
+ * @brief Compile a PDO mapping into a list of copies
+ *
+ * Each mapped object is looked up once, at compile time, leaving a copy of
+ * a fixed size to or from a fixed payload offset per object. Objects are
+ * placed in the payload in the order given. Mapping an object that is
+ * missing, an object an SDO client could not read (transmit) or write
+ * (receive), or more than 8 bytes in total is a compile error.
+ *
+ * Mappings are fixed at compile time, so the PDO mapping parameter objects
+ * (0x1600 and 0x1A00 onwards) cannot be written.
+ *
+ * @param p_dictionary - dictionary sorted by `make_dictionary()`
+ * @param p_direction - direction of the PDO
+ * @param p_entries - objects to map
+ * @return pdo_mapping<count> - the compiled mapping
+ */
+template<std::size_t count>
+consteval pdo_mapping<count> make_pdo_mapping(
+  std::span<object const> p_dictionary,
+  pdo_direction p_direction,
+  std::array<pdo_entry, count> p_entries)
+{
+  pdo_mapping<count> result{};
+  std::uint32_t offset = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    auto const* found =
+      find(p_dictionary, p_entries[i].index, p_entries[i].subindex);
+    if (found == nullptr) {
+      detail::dictionary_error();
+    }
+    auto const forbidden = p_direction == pdo_direction::transmit
+                             ? access::write_only
+                             : access::read_only;
+    if (found->mode == forbidden || offset + found->size > 8) {
+      detail::dictionary_error();
+    }
+    result.copies[i] = { .data = found->data,
+                         .offset = static_cast<std::uint8_t>(offset),
+                         .size = static_cast<std::uint8_t>(found->size) };
+    offset += found->size;
+  }
+  result.length = static_cast<std::uint8_t>(offset);
+  return result;
+}
+
+/// What causes a transmit PDO to be sent
+enum class pdo_trigger : std::uint8_t
+{
+  /// Only `node::send_tpdo()`
+  application,
+  /// Every SYNC message as well as `node::send_tpdo()`
+  sync,
+};
+
+/**
+ * @brief A PDO, its id and compiled mapping
+ *
+ */
+class pdo
+{
+public:
+  /**
+   * @brief Construct a new pdo object
+   *
+   * @param p_id - id of the PDO's messages
+   * @param p_mapping - compiled mapping, must outlive this object
+   * @param p_trigger - what sends a transmit PDO, ignored when receiving
+   */
+  template<std::size_t count>
+  constexpr pdo(hal::can::id_t p_id,
+                pdo_mapping<count> const& p_mapping,
+                pdo_trigger p_trigger = pdo_trigger::application)
+    : m_copies(p_mapping.copies)
+    , m_id(p_id)
+    , m_length(p_mapping.length)
+    , m_trigger(p_trigger)
+  {
+  }
+
+  /**
+   * @brief Copy the mapped objects into a message
+   *
+   * @param p_message - message to fill, its length is set to the PDO's
+   */
+  void pack(hal::can::message_t& p_message) const
+  {
+    p_message.id = m_id;
+    p_message.length = m_length;
+    for (auto const& copy : m_copies) {
+      std::memcpy(&p_message.payload[copy.offset], copy.data, copy.size);
+    }
+  }
+
+  /**
+   * @brief Copy a message into the mapped objects
+   *
+   * @param p_message - received message
+   * @return true - the objects were updated
+   * @return false - the message is shorter than the PDO and was ignored
+   */
+  bool unpack(hal::can::message_t const& p_message) const
+  {
+    if (p_message.length < m_length) {
+      return false;
+    }
+    for (auto const& copy : m_copies) {
+      std::memcpy(copy.data, &p_message.payload[copy.offset], copy.size);
+    }
+    return true;
+  }
+
+  [[nodiscard]] constexpr hal::can::id_t id() const
+  {
+    return m_id;
+  }
+
+  [[nodiscard]] constexpr std::uint8_t length() const
+  {
+    return m_length;
+  }
+
+  [[nodiscard]] constexpr pdo_trigger trigger() const
+  {
+    return m_trigger;
+  }
+
+private:
+  std::span<pdo_copy const> m_copies;
+  hal::can::id_t m_id;
+  std::uint8_t m_length;
+  pdo_trigger m_trigger;
+};
+
+/**
+ * @brief CANopen node serving SDO transfers and PDOs on a can port
+ *
+ * The SDO server gives clients access to the object dictionary with
+ * expedited transfers (objects of up to 4 bytes) and segmented transfers
+ * (larger objects). Block transfers are answered with an abort. A download
+ * must be exactly the size of the object. Segments are written into the
+ * object as they arrive, so an aborted segmented download leaves it partly
+ * written. A new request replaces any transfer in progress, which is
+ * how transfers abandoned by a client end, as the server keeps no timeouts.
+ *
+ * Received PDOs with a mapped id are copied into their objects. Transmit
+ * PDOs are sent by `send_tpdo()` and, if triggered by SYNC, on every SYNC
+ * message.
+ *
+ * Messages are received from the can's receive handler, which this node
+ * installs, so RPDO objects and SDO downloads are written in that context.
+ * Network management (NMT), heartbeats and emergency messages are left to the
+ * application.
+ */
+class node
+{
+public:
+  /**
+   * @brief Construct a new node object and install its can receive handler
+   *
+   * @param p_can - CAN bus port
+   * @param p_node_id - id of this node, 1 to 127
+   * @param p_dictionary - dictionary sorted by `make_dictionary()`
+   * @param p_rpdos - PDOs received by this node
+   * @param p_tpdos - PDOs sent by this node
+   * @throws hal::argument_out_of_domain - if p_node_id is out of range or
+   * p_dictionary is not sorted
+   */
+  node(hal::can& p_can,
+       std::uint8_t p_node_id,
+       std::span<object const> p_dictionary,
+       std::span<pdo const> p_rpdos,
+       std::span<pdo const> p_tpdos)
+    : m_can(&p_can)
+    , m_dictionary(p_dictionary)
+    , m_rpdos(p_rpdos)
+    , m_tpdos(p_tpdos)
+    , m_node_id(p_node_id)
+  {
+    if (p_node_id < 1 || p_node_id > 127 ||
+        not std::ranges::is_sorted(p_dictionary, {}, &object::key)) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    m_can->on_receive(
+      [this](hal::can::message_t const& p_message) { receive(p_message); });
+  }
+
+  node(node const&) = delete;
+  node& operator=(node const&) = delete;
+  node(node&&) = delete;
+  node& operator=(node&&) = delete;
+
+  /**
+   * @brief Send a transmit PDO with the current values of its objects
+   *
+   * @param p_tpdo - position of the PDO in the list given on construction
+   * @throws hal::argument_out_of_domain - if there is no such PDO
+   */
+  void send_tpdo(std::size_t p_tpdo)
+  {
+    if (p_tpdo >= m_tpdos.size()) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    hal::can::message_t message{};
+    m_tpdos[p_tpdo].pack(message);
+    m_can->send(message);
+  }
+
+  [[nodiscard]] std::uint8_t node_id() const
+  {
+    return m_node_id;
+  }
+
+private:
+  enum class transfer : std::uint8_t
+  {
+    none,
+    download,
+    upload,
+  };
+
+  void receive(hal::can::message_t const& p_message)
+  {
+    if (p_message.is_remote_request) {
+      return;
+    }
+    if (p_message.id == sdo_request_base + m_node_id) {
+      if (p_message.length == 8) {
+        serve_sdo(p_message.payload);
+      }
+      return;
+    }
+    if (p_message.id == sync_id) {
+      for (std::size_t i = 0; i < m_tpdos.size(); i++) {
+        if (m_tpdos[i].trigger() == pdo_trigger::sync) {
+          send_tpdo(i);
+        }
+      }
+      return;
+    }
+    for (auto const& rpdo : m_rpdos) {
+      if (rpdo.id() == p_message.id) {
+        rpdo.unpack(p_message);
+      }
+    }
+  }
+
+  void serve_sdo(std::array<hal::byte, 8> const& p_request)
+  {
+    auto const command = p_request[0];
+    switch (command >> 5) {
+      case 0:
+        download_segment(command, p_request);
+        break;
+      case 1:
+        initiate_download(command, p_request);
+        break;
+      case 2:
+        initiate_upload(p_request);
+        break;
+      case 3:
+        upload_segment(command);
+        break;
+      case 4:
+        // Abort from the client, no response
+        m_transfer = transfer::none;
+        break;
+      default:
+        abort(p_request[1] | p_request[2] << 8,
+              p_request[3],
+              sdo_abort::invalid_command);
+        break;
+    }
+  }
+
+  /// Look up the object of an initiate request, aborting if it is missing
+  object const* lookup(std::array<hal::byte, 8> const& p_request)
+  {
+    auto const index = static_cast<std::uint16_t>(p_request[1] |
+                                                  p_request[2] << 8);
+    auto const subindex = p_request[3];
+    auto const* found = find(m_dictionary, index, subindex);
+    if (found == nullptr) {
+      auto const has_index = find_index(index);
+      abort(index,
+            subindex,
+            has_index ? sdo_abort::no_subindex : sdo_abort::no_object);
+    }
+    return found;
+  }
+
+  [[nodiscard]] bool find_index(std::uint16_t p_index) const
+  {
+    auto const found = std::ranges::lower_bound(
+      m_dictionary, static_cast<std::uint32_t>(p_index) << 8, {}, &object::key);
+    return found != m_dictionary.end() && found->index == p_index;
+  }
+
+  void initiate_download(hal::byte p_command,
+                         std::array<hal::byte, 8> const& p_request)
+  {
+    m_transfer = transfer::none;
+    auto const* found = lookup(p_request);
+    if (found == nullptr) {
+      return;
+    }
+    if (found->mode == access::read_only) {
+      abort(*found, sdo_abort::read_only_object);
+      return;
+    }
+
+    bool const expedited = p_command & 0b10;
+    bool const size_indicated = p_command & 0b01;
+    std::uint32_t size = found->size;
+    if (expedited && size_indicated) {
+      size = 4 - ((p_command >> 2) & 0b11);
+    } else if (size_indicated) {
+      size = read_u32(p_request);
+    }
+    if (size != found->size || (expedited && size > 4)) {
+      abort(*found, sdo_abort::length_mismatch);
+      return;
+    }
+
+    if (expedited) {
+      std::memcpy(found->data, &p_request[4], size);
+    } else {
+      m_transfer = transfer::download;
+      m_object = found;
+      m_offset = 0;
+      m_toggle = false;
+    }
+    respond(0x60, *found, {});
+  }
+
+  void download_segment(hal::byte p_command,
+                        std::array<hal::byte, 8> const& p_request)
+  {
+    if (m_transfer != transfer::download) {
+      abort(0, 0, sdo_abort::invalid_command);
+      return;
+    }
+    auto const& target = *m_object;
+    bool const toggle = p_command & 0b1'0000;
+    if (toggle != m_toggle) {
+      m_transfer = transfer::none;
+      abort(target, sdo_abort::toggle_bit_not_alternated);
+      return;
+    }
+    auto const count = 7U - ((p_command >> 1) & 0b111);
+    bool const last = p_command & 0b1;
+    if (m_offset + count > target.size) {
+      m_transfer = transfer::none;
+      abort(target, sdo_abort::length_too_high);
+      return;
+    }
+    if (last && m_offset + count != target.size) {
+      m_transfer = transfer::none;
+      abort(target, sdo_abort::length_too_low);
+      return;
+    }
+
+    std::memcpy(static_cast<hal::byte*>(target.data) + m_offset,
+                &p_request[1],
+                count);
+    m_offset += count;
+    m_toggle = not m_toggle;
+    if (last) {
+      m_transfer = transfer::none;
+    }
+    send_response({ static_cast<hal::byte>(0x20 | (toggle ? 0x10 : 0)) });
+  }
+
+  void initiate_upload(std::array<hal::byte, 8> const& p_request)
+  {
+    m_transfer = transfer::none;
+    auto const* found = lookup(p_request);
+    if (found == nullptr) {
+      return;
+    }
+    if (found->mode == access::write_only) {
+      abort(*found, sdo_abort::write_only_object);
+      return;
+    }
+
+    std::array<hal::byte, 4> data{};
+    if (found->size <= 4) {
+      std::memcpy(data.data(), found->data, found->size);
+      respond(static_cast<hal::byte>(0x43 | (4 - found->size) << 2),
+              *found,
+              data);
+      return;
+    }
+
+    m_transfer = transfer::upload;
+    m_object = found;
+    m_offset = 0;
+    m_toggle = false;
+    write_u32(data, found->size);
+    respond(0x41, *found, data);
+  }
+
+  void upload_segment(hal::byte p_command)
+  {
+    if (m_transfer != transfer::upload) {
+      abort(0, 0, sdo_abort::invalid_command);
+      return;
+    }
+    auto const& source = *m_object;
+    bool const toggle = p_command & 0b1'0000;
+    if (toggle != m_toggle) {
+      m_transfer = transfer::none;
+      abort(source, sdo_abort::toggle_bit_not_alternated);
+      return;
+    }
+
+    auto const count = std::min(7U, source.size - m_offset);
+    bool const last = m_offset + count == source.size;
+    std::array<hal::byte, 8> response{};
+    response[0] = static_cast<hal::byte>((toggle ? 0x10 : 0) |
+                                         (7 - count) << 1 | (last ? 1 : 0));
+    std::memcpy(&response[1],
+                static_cast<hal::byte const*>(source.data) + m_offset,
+                count);
+    m_offset += count;
+    m_toggle = not m_toggle;
+    if (last) {
+      m_transfer = transfer::none;
+    }
+    send_response(response);
+  }
+
+  void respond(hal::byte p_command,
+               object const& p_object,
+               std::array<hal::byte, 4> const& p_data)
+  {
+    send_response({ p_command,
+                    static_cast<hal::byte>(p_object.index),
+                    static_cast<hal::byte>(p_object.index >> 8),
+                    p_object.subindex,
+                    p_data[0],
+                    p_data[1],
+                    p_data[2],
+                    p_data[3] });
+  }
+
+  void abort(object const& p_object, sdo_abort p_reason)
+  {
+    abort(p_object.index, p_object.subindex, p_reason);
+  }
+
+  void abort(std::uint32_t p_index, hal::byte p_subindex, sdo_abort p_reason)
+  {
+    std::array<hal::byte, 4> code{};
+    write_u32(code, static_cast<std::uint32_t>(p_reason));
+    send_response({ 0x80,
+                    static_cast<hal::byte>(p_index),
+                    static_cast<hal::byte>(p_index >> 8),
+                    p_subindex,
+                    code[0],
+                    code[1],
+                    code[2],
+                    code[3] });
+  }
+
+  void send_response(std::array<hal::byte, 8> const& p_payload)
+  {
+    m_can->send({ .id = sdo_response_base + m_node_id,
+                  .payload = p_payload,
+                  .length = 8 });
+  }
+
+  static std::uint32_t read_u32(std::array<hal::byte, 8> const& p_request)
+  {
+    return static_cast<std::uint32_t>(p_request[4]) |
+           static_cast<std::uint32_t>(p_request[5]) << 8 |
+           static_cast<std::uint32_t>(p_request[6]) << 16 |
+           static_cast<std::uint32_t>(p_request[7]) << 24;
+  }
+
+  static void write_u32(std::array<hal::byte, 4>& p_data, std::uint32_t p_value)
+  {
+    for (std::size_t i = 0; i < p_data.size(); i++) {
+      p_data[i] = static_cast<hal::byte>(p_value >> (i * 8));
+    }
+  }
+
+  hal::can* m_can;
+  std::span<object const> m_dictionary;
+  std::span<pdo const> m_rpdos;
+  std::span<pdo const> m_tpdos;
+  object const* m_object = nullptr;
+  std::uint32_t m_offset = 0;
+  std::uint8_t m_node_id;
+  transfer m_transfer = transfer::none;
+  bool m_toggle = false;
+};
+}  // namespace hal::canopen
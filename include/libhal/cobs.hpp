@@ -0,0 +1,91 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+
+#include <optional>
+#include <span>
+
+#include "units.hpp"
+
+namespace hal::detail {
+/**
+ * @brief Consistent overhead byte stuffing encode
+ *
+ * @param p_input - bytes to encode
+ * @param p_output - encoded bytes, must hold at least
+ * `p_input.size() + p_input.size() / 254 + 1` bytes
+ * @return std::size_t - number of encoded bytes, none of which are zero
+ */
+constexpr std::size_t cobs_encode(std::span<hal::byte const> p_input,
+                                  std::span<hal::byte> p_output)
+{
+  std::size_t code_index = 0;
+  std::size_t output = 1;
+  hal::byte code = 1;
+  for (auto const value : p_input) {
+    if (value == 0) {
+      p_output[code_index] = code;
+      code_index = output++;
+      code = 1;
+      continue;
+    }
+    p_output[output++] = value;
+    code++;
+    if (code == 0xFF) {
+      p_output[code_index] = code;
+      code_index = output++;
+      code = 1;
+    }
+  }
+  p_output[code_index] = code;
+  return output;
+}
+
+/**
+ * @brief Consistent overhead byte stuffing decode
+ *
+ * p_input and p_output may be the same buffer.
+ *
+ * @param p_input - encoded bytes without the zero delimiter
+ * @param p_output - decoded bytes, at least as large as p_input
+ * @return std::optional<std::size_t> - number of decoded bytes, or
+ * std::nullopt if p_input is not a valid encoding
+ */
+constexpr std::optional<std::size_t> cobs_decode(
+  std::span<hal::byte const> p_input,
+  std::span<hal::byte> p_output)
+{
+  std::size_t input = 0;
+  std::size_t output = 0;
+  while (input < p_input.size()) {
+    auto const code = p_input[input++];
+    if (code == 0) {
+      return std::nullopt;
+    }
+    for (std::size_t i = 1; i < code; i++) {
+      if (input >= p_input.size() || p_input[input] == 0) {
+        return std::nullopt;
+      }
+      p_output[output++] = p_input[input++];
+    }
+    if (code != 0xFF && input < p_input.size()) {
+      p_output[output++] = 0;
+    }
+  }
+  return output;
+}
+}  // namespace hal::detail
@@ -0,0 +1,452 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+#include "units.hpp"
+
+#if defined(__PCLMUL__)
+#include <immintrin.h>
+#endif
+
+namespace hal {
+namespace detail {
+template<std::unsigned_integral value_t>
+constexpr value_t crc_reflect(value_t p_value)
+{
+  value_t result = 0;
+  for (std::size_t i = 0; i < std::numeric_limits<value_t>::digits; i++) {
+    result = static_cast<value_t>((result << 1) | ((p_value >> i) & 1));
+  }
+  return result;
+}
+
+/// Constants for folding a reflected 32-bit CRC with carry-less multiply
+struct crc32_fold_constants
+{
+  std::uint64_t r1;
+  std::uint64_t r2;
+  std::uint64_t r3;
+  std::uint64_t r4;
+  std::uint64_t r5;
+  std::uint64_t polynomial;
+  std::uint64_t mu;
+};
+
+/// x^n mod P for a 32-bit polynomial P in normal form
+constexpr std::uint32_t crc32_x_power_mod(std::uint32_t p_polynomial,
+                                         std::size_t p_power)
+{
+  std::uint64_t remainder = 1;
+  for (std::size_t i = 0; i < p_power; i++) {
+    remainder <<= 1;
+    if ((remainder >> 32) & 1) {
+      remainder ^= (std::uint64_t{ 1 } << 32) | p_polynomial;
+    }
+  }
+  return static_cast<std::uint32_t>(remainder);
+}
+
+constexpr std::uint64_t crc_reflect_33(std::uint64_t p_value)
+{
+  std::uint64_t result = 0;
+  for (std::size_t i = 0; i < 33; i++) {
+    result = (result << 1) | ((p_value >> i) & 1);
+  }
+  return result;
+}
+
+consteval crc32_fold_constants make_crc32_fold_constants(
+  std::uint32_t p_polynomial)
+{
+  auto const fold = [p_polynomial](std::size_t p_power) {
+    return std::uint64_t{ crc_reflect(
+             crc32_x_power_mod(p_polynomial, p_power)) }
+           << 1;
+  };
+  // floor(x^64 / P) by long division, feeding the 65 bits of x^64 MSB first
+  std::uint64_t const full = (std::uint64_t{ 1 } << 32) | p_polynomial;
+  std::uint64_t quotient = 0;
+  std::uint64_t remainder = 0;
+  for (std::size_t bit = 0; bit <= 64; bit++) {
+    remainder = (remainder << 1) | (bit == 0 ? 1 : 0);
+    quotient <<= 1;
+    if ((remainder >> 32) & 1) {
+      remainder ^= full;
+      quotient |= 1;
+    }
+  }
+  return {
+    .r1 = fold(4 * 128 + 32),
+    .r2 = fold(4 * 128 - 32),
+    .r3 = fold(128 + 32),
+    .r4 = fold(128 - 32),
+    .r5 = fold(64),
+    .polynomial = crc_reflect_33(full),
+    .mu = crc_reflect_33(quotient),
+  };
+}
+
+#if defined(__PCLMUL__)
+/**
+ * @brief Fold a reflected 32-bit CRC over whole 16 byte blocks
+ *
+ * Follows "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+ * Instruction" (Intel, 2009): four 128-bit lanes are folded 64 bytes at a
+ * time, reduced to one lane, then reduced to 32 bits with Barrett reduction.
+ *
+ * @param p_register - current CRC register
+ * @param p_data - data, at least 64 bytes
+ * @param p_constants - constants for the polynomial
+ * @return std::uint32_t - CRC register after every whole 16 byte block of
+ * p_data. The remaining `p_data.size() % 16` bytes are not processed.
+ */
+inline std::uint32_t crc32_fold_pclmul(std::uint32_t p_register,
+                                       std::span<hal::byte const> p_data,
+                                       crc32_fold_constants const& p_constants)
+{
+  auto const load = [&p_data](std::size_t p_offset) {
+    return _mm_loadu_si128(
+      reinterpret_cast<__m128i const*>(p_data.data() + p_offset));
+  };
+  auto const fold = [](__m128i p_lane, __m128i p_constant, __m128i p_next) {
+    auto const low = _mm_clmulepi64_si128(p_lane, p_constant, 0x00);
+    auto const high = _mm_clmulepi64_si128(p_lane, p_constant, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(low, high), p_next);
+  };
+
+  auto x1 = _mm_xor_si128(load(0),
+                          _mm_cvtsi32_si128(static_cast<int>(p_register)));
+  auto x2 = load(16);
+  auto x3 = load(32);
+  auto x4 = load(48);
+  std::size_t offset = 64;
+
+  auto const r2r1 = _mm_set_epi64x(static_cast<long long>(p_constants.r2),
+                                   static_cast<long long>(p_constants.r1));
+  for (; offset + 64 <= p_data.size(); offset += 64) {
+    x1 = fold(x1, r2r1, load(offset));
+    x2 = fold(x2, r2r1, load(offset + 16));
+    x3 = fold(x3, r2r1, load(offset + 32));
+    x4 = fold(x4, r2r1, load(offset + 48));
+  }
+
+  auto const r4r3 = _mm_set_epi64x(static_cast<long long>(p_constants.r4),
+                                   static_cast<long long>(p_constants.r3));
+  x1 = fold(x1, r4r3, x2);
+  x1 = fold(x1, r4r3, x3);
+  x1 = fold(x1, r4r3, x4);
+  for (; offset + 16 <= p_data.size(); offset += 16) {
+    x1 = fold(x1, r4r3, load(offset));
+  }
+
+  // Fold 128 bits to 64 bits, appending 32 zero bits
+  auto const mask32 = _mm_set_epi32(0, 0, 0, -1);
+  auto const r4_product = _mm_clmulepi64_si128(r4r3, x1, 0x01);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), r4_product);
+
+  // Fold 64 bits to 32 bits
+  auto const r5 = _mm_set_epi64x(0, static_cast<long long>(p_constants.r5));
+  auto const r5_product =
+    _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), r5, 0x00);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 4), r5_product);
+
+  // Bit reflected Barrett reduction
+  auto const poly_mu =
+    _mm_set_epi64x(static_cast<long long>(p_constants.mu),
+                   static_cast<long long>(p_constants.polynomial));
+  auto x2_reduce =
+    _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly_mu, 0x10);
+  x2_reduce =
+    _mm_clmulepi64_si128(_mm_and_si128(x2_reduce, mask32), poly_mu, 0x00);
+  x1 = _mm_xor_si128(x1, x2_reduce);
+  return static_cast<std::uint32_t>(
+    _mm_cvtsi128_si32(_mm_srli_si128(x1, 4)));
+}
+#endif
+}  // namespace detail
+
+/**
+ * @brief Cyclic redundancy check parameterized at compile time
+ *
+ * Parameters follow the Rocksoft model used by CRC catalogues: the polynomial
+ * in normal (MSB first) form without its top bit, the initial register value,
+ * whether input and output are bit reflected and the value XORed with the
+ * final register. The width of the CRC is the width of value_t.
+ *
+ * Lookup tables are generated at compile time. At runtime, `slices` bytes are
+ * processed per step using one table per byte (slicing-by-N). More slices are
+ * faster, at the cost of `slices * 256 * sizeof(value_t)` bytes of tables.
+ * Reflected 32-bit CRCs additionally use carry-less multiply folding for
+ * large buffers when compiled for x86 with PCLMUL support (`-mpclmul`).
+ *
+ * USAGE:
+ *
+ *      auto const checksum = hal::crc32<>::compute(data);
+ *
+ *      hal::crc16_modbus<> crc;
+ *      crc.update(header).update(payload);
+ *      auto const checksum = crc.value();
+ *
+ * @tparam value_t - unsigned integer with the width of the CRC, 8 to 64 bits
+ * @tparam polynomial - generator polynomial in normal form
+ * @tparam initial - initial register value
+ * @tparam reflected - true if input and output are bit reflected
+ * @tparam xor_out - value XORed with the register to produce the CRC
+ * @tparam slices - bytes processed per step, 1, 2, 4 or 8
+ */
+template<std::unsigned_integral value_t,
+         value_t polynomial,
+         value_t initial,
+         bool reflected,
+         value_t xor_out,
+         std::size_t slices = 8>
+class crc
+{
+public:
+  static_assert(slices == 1 || slices == 2 || slices == 4 || slices == 8,
+                "slices must be 1, 2, 4 or 8");
+
+  using value_type = value_t;
+  /// Width of the CRC in bits
+  static constexpr std::size_t width = std::numeric_limits<value_t>::digits;
+
+  /**
+   * @brief Compute the CRC of a buffer
+   *
+   * @param p_data - bytes to compute the CRC over
+   * @return constexpr value_t - the CRC
+   */
+  [[nodiscard]] static constexpr value_t compute(
+    std::span<hal::byte const> p_data)
+  {
+    return crc().update(p_data).value();
+  }
+
+  /**
+   * @brief Add bytes to the CRC
+   *
+   * @param p_data - bytes following those previously added
+   * @return constexpr crc& - this object, for chaining
+   */
+  constexpr crc& update(std::span<hal::byte const> p_data)
+  {
+    if (std::is_constant_evaluated()) {
+      m_register = process<1>(m_register, p_data);
+      return *this;
+    }
+
+#if defined(__PCLMUL__)
+    if constexpr (reflected && width == 32) {
+      if (p_data.size() >= 64) {
+        constexpr auto constants = detail::make_crc32_fold_constants(
+          static_cast<std::uint32_t>(polynomial));
+        m_register = detail::crc32_fold_pclmul(m_register, p_data, constants);
+        p_data = p_data.last(p_data.size() % 16);
+      }
+    }
+#endif
+
+    m_register = process<slices>(m_register, p_data);
+    return *this;
+  }
+
+  /**
+   * @brief CRC of every byte added since construction or `reset()`
+   *
+   * @return constexpr value_t - the CRC
+   */
+  [[nodiscard]] constexpr value_t value() const
+  {
+    return static_cast<value_t>(m_register ^ xor_out);
+  }
+
+  /**
+   * @brief Restart the CRC as if no bytes have been added
+   *
+   */
+  constexpr void reset()
+  {
+    m_register = start;
+  }
+
+private:
+  using table_t = std::array<std::array<value_t, 256>, slices>;
+
+  static constexpr value_t start =
+    reflected ? detail::crc_reflect(initial) : initial;
+
+  static consteval table_t make_tables()
+  {
+    table_t tables{};
+    for (std::size_t i = 0; i < 256; i++) {
+      if constexpr (reflected) {
+        auto value = static_cast<value_t>(i);
+        auto const reversed = detail::crc_reflect(polynomial);
+        for (int bit = 0; bit < 8; bit++) {
+          value = static_cast<value_t>((value & 1) ? (value >> 1) ^ reversed
+                                                   : value >> 1);
+        }
+        tables[0][i] = value;
+      } else {
+        auto value = static_cast<value_t>(i << (width - 8));
+        for (int bit = 0; bit < 8; bit++) {
+          auto const top = (value >> (width - 1)) & 1;
+          value = static_cast<value_t>(top ? (value << 1) ^ polynomial
+                                           : value << 1);
+        }
+        tables[0][i] = value;
+      }
+    }
+    // Each further table advances the previous one by a zero byte
+    for (std::size_t k = 1; k < slices; k++) {
+      for (std::size_t i = 0; i < 256; i++) {
+        auto const previous = tables[k - 1][i];
+        if constexpr (reflected) {
+          tables[k][i] = static_cast<value_t>(shift_right(previous, 8) ^
+                                              tables[0][previous & 0xFF]);
+        } else {
+          tables[k][i] = static_cast<value_t>(
+            shift_left(previous, 8) ^
+            tables[0][(previous >> (width - 8)) & 0xFF]);
+        }
+      }
+    }
+    return tables;
+  }
+
+  static constexpr table_t tables = make_tables();
+
+  static constexpr value_t shift_right(value_t p_value, std::size_t p_bits)
+  {
+    return p_bits >= width ? 0 : static_cast<value_t>(p_value >> p_bits);
+  }
+
+  static constexpr value_t shift_left(value_t p_value, std::size_t p_bits)
+  {
+    return p_bits >= width ? 0 : static_cast<value_t>(p_value << p_bits);
+  }
+
+  template<std::size_t step>
+  static constexpr value_t process(value_t p_register,
+                                   std::span<hal::byte const> p_data)
+  {
+    constexpr std::size_t chunk_bits = step * 8;
+    std::size_t offset = 0;
+    if constexpr (step > 1) {
+      for (; offset + step <= p_data.size(); offset += step) {
+        auto const chunk = p_data.subspan(offset, step);
+        value_t next = 0;
+        if constexpr (reflected) {
+          std::uint64_t input = 0;
+          for (std::size_t j = 0; j < step; j++) {
+            input |= std::uint64_t{ chunk[j] } << (j * 8);
+          }
+          input ^= p_register;
+          next = shift_right(p_register, chunk_bits);
+          for (std::size_t j = 0; j < step; j++) {
+            next ^= tables[step - 1 - j][(input >> (j * 8)) & 0xFF];
+          }
+        } else {
+          std::uint64_t input = 0;
+          for (std::size_t j = 0; j < step; j++) {
+            input = (input << 8) | chunk[j];
+          }
+          if constexpr (width >= chunk_bits) {
+            input ^= p_register >> (width - chunk_bits);
+          } else {
+            input ^= std::uint64_t{ p_register } << (chunk_bits - width);
+          }
+          next = shift_left(p_register, chunk_bits);
+          for (std::size_t j = 0; j < step; j++) {
+            auto const index = (input >> ((step - 1 - j) * 8)) & 0xFF;
+            next ^= tables[step - 1 - j][index];
+          }
+        }
+        p_register = next;
+      }
+    }
+    for (; offset < p_data.size(); offset++) {
+      if constexpr (reflected) {
+        p_register = static_cast<value_t>(
+          shift_right(p_register, 8) ^
+          tables[0][(p_register ^ p_data[offset]) & 0xFF]);
+      } else {
+        auto const index =
+          ((p_register >> (width - 8)) ^ p_data[offset]) & 0xFF;
+        p_register =
+          static_cast<value_t>(shift_left(p_register, 8) ^ tables[0][index]);
+      }
+    }
+    return p_register;
+  }
+
+  value_t m_register = start;
+};
+
+/// CRC-8/SMBUS, used for the SMBus packet error code (PEC)
+template<std::size_t slices = 8>
+using crc8_smbus = crc<std::uint8_t, 0x07, 0x00, false, 0x00, slices>;
+
+/// CRC-8/SAE-J1850, used by AUTOSAR end to end protection of CAN signals
+template<std::size_t slices = 8>
+using crc8_sae_j1850 = crc<std::uint8_t, 0x1D, 0xFF, false, 0xFF, slices>;
+
+/// CRC-16/MODBUS
+template<std::size_t slices = 8>
+using crc16_modbus = crc<std::uint16_t, 0x8005, 0xFFFF, true, 0x0000, slices>;
+
+/// CRC-16/IBM-3740, also known as CRC-16/CCITT-FALSE
+template<std::size_t slices = 8>
+using crc16_ccitt_false =
+  crc<std::uint16_t, 0x1021, 0xFFFF, false, 0x0000, slices>;
+
+/// CRC-16/XMODEM
+template<std::size_t slices = 8>
+using crc16_xmodem = crc<std::uint16_t, 0x1021, 0x0000, false, 0x0000, slices>;
+
+/// CRC-32/ISO-HDLC, as used by Ethernet, zlib and PNG
+template<std::size_t slices = 8>
+using crc32 =
+  crc<std::uint32_t, 0x04C11DB7, 0xFFFFFFFF, true, 0xFFFFFFFF, slices>;
+
+/// CRC-32/ISCSI, also known as CRC-32C (Castagnoli)
+template<std::size_t slices = 8>
+using crc32c =
+  crc<std::uint32_t, 0x1EDC6F41, 0xFFFFFFFF, true, 0xFFFFFFFF, slices>;
+
+/// CRC-32/MPEG-2, as computed by the CRC peripheral of STM32 devices
+template<std::size_t slices = 8>
+using crc32_mpeg2 =
+  crc<std::uint32_t, 0x04C11DB7, 0xFFFFFFFF, false, 0x00000000, slices>;
+
+/// CRC-64/XZ
+template<std::size_t slices = 8>
+using crc64_xz = crc<std::uint64_t,
+                     0x42F0E1EBA9EA3693,
+                     0xFFFFFFFFFFFFFFFF,
+                     true,
+                     0xFFFFFFFFFFFFFFFF,
+                     slices>;
+}  // namespace hal
@@ -0,0 +1,399 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <limits>
+#include <numbers>
+#include <span>
+
+#include "dac.hpp"
+#include "error.hpp"
+#include "steady_clock.hpp"
+#include "timer.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Direct digital synthesis (DDS) waveform generator
+ *
+ * Generates periodic waveforms using a 32-bit phase accumulator and a lookup
+ * table of one waveform period. On each sample, the tuning word is added to the
+ * phase accumulator, the upper `table_bits` of the phase select a table entry
+ * and the remaining lower bits linearly interpolate to the next entry. The
+ * frequency resolution is `sample_rate / 2^32`.
+ *
+ * Rendering whole blocks with `render()` keeps the accumulator and table in
+ * registers and cache across samples, which is far cheaper than producing one
+ * sample per call through a virtual interface. Rendered blocks can be passed
+ * directly to a `hal::stream_dac` with the same sample rate used to configure
+ * the frequency.
+ *
+ * Table values are in the range of -1.0f to +1.0f. Rendered outputs are mapped
+ * to the unipolar range used by `hal::dac` and `hal::stream_dac` using:
+ *
+ *      output = 0.5 + 0.5 * amplitude * table_value
+ *
+ * @tparam table_bits - log2 of the number of entries in the waveform table.
+ */
+template<std::size_t table_bits = 10>
+class dds
+{
+public:
+  static_assert(0 < table_bits && table_bits < 16,
+                "table_bits must be between 1 and 15");
+
+  /// Number of entries in one period of the waveform table
+  static constexpr std::size_t table_size = std::size_t{ 1 } << table_bits;
+
+  /// Built in waveforms
+  enum class waveform : std::uint8_t
+  {
+    /// Sine wave starting at zero and rising
+    sine = 0,
+    /// Triangle wave starting at zero and rising
+    triangle,
+    /// Sawtooth ramping from -1.0 to +1.0
+    sawtooth,
+    /// Square wave, +1.0 for the first half of the period
+    square,
+  };
+
+  /**
+   * @brief Construct a dds with a built in waveform
+   *
+   * @param p_waveform - the waveform to generate
+   */
+  dds(waveform p_waveform = waveform::sine)
+  {
+    load(p_waveform);
+  }
+
+  /**
+   * @brief Construct a dds with an arbitrary waveform table
+   *
+   * @param p_table - one period of the waveform, see `load()`
+   * @throws hal::argument_out_of_domain - see `load()`
+   */
+  dds(std::span<float const> p_table)
+  {
+    load(p_table);
+  }
+
+  /**
+   * @brief Replace the waveform table with a built in waveform
+   *
+   * The phase accumulator is not modified, allowing phase continuous switching
+   * between waveforms.
+   *
+   * @param p_waveform - the waveform to generate
+   */
+  void load(waveform p_waveform)
+  {
+    for (std::size_t i = 0; i < table_size; i++) {
+      auto const position =
+        static_cast<float>(i) / static_cast<float>(table_size);
+      m_table[i] = evaluate(p_waveform, position);
+    }
+    m_table[table_size] = m_table[0];
+  }
+
+  /**
+   * @brief Replace the waveform table with an arbitrary waveform
+   *
+   * @param p_table - one period of the waveform with values between -1.0f and
+   * +1.0f. Must contain exactly `table_size` entries.
+   * @throws hal::argument_out_of_domain - if p_table.size() != table_size
+   */
+  void load(std::span<float const> p_table)
+  {
+    if (p_table.size() != table_size) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    std::copy(p_table.begin(), p_table.end(), m_table.begin());
+    m_table[table_size] = m_table[0];
+  }
+
+  /**
+   * @brief Set the output frequency
+   *
+   * @param p_frequency - frequency of the generated waveform
+   * @param p_sample_rate - rate at which samples will be consumed
+   * @throws hal::argument_out_of_domain - if the sample rate is not positive or
+   * if the frequency is negative or above the Nyquist frequency
+   * (p_sample_rate / 2).
+   */
+  void frequency(hertz p_frequency, hertz p_sample_rate)
+  {
+    if (p_sample_rate <= 0.0f || p_frequency < 0.0f ||
+        p_frequency > p_sample_rate / 2.0f) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    constexpr double phase_states = 4294967296.0;  // 2^32
+    auto const ratio = static_cast<double>(p_frequency) / p_sample_rate;
+    m_tuning_word =
+      static_cast<std::uint32_t>(std::llround(ratio * phase_states));
+    m_sample_rate = p_sample_rate;
+  }
+
+  /**
+   * @brief Set the output amplitude
+   *
+   * @param p_amplitude - scale factor applied to the waveform, clamped between
+   * 0.0f and 1.0f, where 1.0f uses the full output range.
+   */
+  void amplitude(float p_amplitude)
+  {
+    m_amplitude = std::clamp(p_amplitude, 0.0f, 1.0f);
+  }
+
+  /**
+   * @brief Set the phase of the accumulator
+   *
+   * @param p_turns - phase in turns of the waveform, where 0.25f is a quarter
+   * period. Only the fractional portion is used.
+   */
+  void phase(float p_turns)
+  {
+    auto const fraction = p_turns - std::floor(p_turns);
+    constexpr double phase_states = 4294967296.0;  // 2^32
+    m_phase = static_cast<std::uint32_t>(
+      static_cast<std::uint64_t>(fraction * phase_states));
+  }
+
+  /**
+   * @brief Get the sample rate used to compute the current frequency
+   *
+   * @return hertz - sample rate passed to the last call of `frequency()`
+   */
+  [[nodiscard]] hertz sample_rate() const
+  {
+    return m_sample_rate;
+  }
+
+  /**
+   * @brief Generate the next sample and advance the phase
+   *
+   * @return float - output sample from 0.0f to 1.0f
+   */
+  [[nodiscard]] float next()
+  {
+    auto const value = interpolate(m_phase);
+    m_phase += m_tuning_word;
+    return 0.5f + 0.5f * m_amplitude * value;
+  }
+
+  /**
+   * @brief Render a block of samples for a dac
+   *
+   * @param p_output - buffer to fill with samples from 0.0f to 1.0f
+   */
+  void render(std::span<float> p_output)
+  {
+    auto accumulator = m_phase;
+    auto const scale = 0.5f * m_amplitude;
+    for (auto& sample : p_output) {
+      sample = 0.5f + scale * interpolate(accumulator);
+      accumulator += m_tuning_word;
+    }
+    m_phase = accumulator;
+  }
+
+  /**
+   * @brief Render a block of unsigned PCM samples for a stream_dac
+   *
+   * @tparam data_t - container size for the sample data
+   * @param p_output - buffer to fill with samples using the full range of
+   * data_t.
+   */
+  template<std::unsigned_integral data_t>
+  void render(std::span<data_t> p_output)
+  {
+    constexpr auto full_scale =
+      static_cast<float>(std::numeric_limits<data_t>::max());
+    auto accumulator = m_phase;
+    auto const scale = 0.5f * m_amplitude * full_scale;
+    auto const offset = 0.5f * full_scale + 0.5f;
+    for (auto& sample : p_output) {
+      auto const value = offset + scale * interpolate(accumulator);
+      sample = static_cast<data_t>(std::clamp(value, 0.0f, full_scale));
+      accumulator += m_tuning_word;
+    }
+    m_phase = accumulator;
+  }
+
+private:
+  static constexpr std::uint32_t fraction_shift = 32 - table_bits;
+  static constexpr std::uint32_t fraction_mask =
+    (std::uint32_t{ 1 } << fraction_shift) - 1;
+  static constexpr float fraction_scale =
+    1.0f / static_cast<float>(std::uint64_t{ 1 } << fraction_shift);
+
+  [[nodiscard]] float interpolate(std::uint32_t p_phase) const
+  {
+    auto const index = p_phase >> fraction_shift;
+    auto const fraction =
+      static_cast<float>(p_phase & fraction_mask) * fraction_scale;
+    auto const first = m_table[index];
+    return first + (m_table[index + 1] - first) * fraction;
+  }
+
+  static float evaluate(waveform p_waveform, float p_position)
+  {
+    switch (p_waveform) {
+      case waveform::triangle:
+        if (p_position < 0.25f) {
+          return 4.0f * p_position;
+        }
+        if (p_position < 0.75f) {
+          return 2.0f - 4.0f * p_position;
+        }
+        return 4.0f * p_position - 4.0f;
+      case waveform::sawtooth:
+        return 2.0f * p_position - 1.0f;
+      case waveform::square:
+        return p_position < 0.5f ? 1.0f : -1.0f;
+      case waveform::sine:
+      default:
+        return std::sin(2.0f * std::numbers::pi_v<float> * p_position);
+    }
+  }
+
+  /// One period of the waveform plus a guard entry equal to the first entry,
+  /// which removes the wrap around check from the interpolation.
+  std::array<float, table_size + 1> m_table{};
+  std::uint32_t m_phase = 0;
+  std::uint32_t m_tuning_word = 0;
+  float m_amplitude = 1.0f;
+  hertz m_sample_rate = 0.0f;
+};
+
+/**
+ * @brief Drives a hal::dac with samples from a dds at a fixed rate using a
+ * hal::timer.
+ *
+ * Each timer event writes a single sample to the dac and schedules the next
+ * event. This is meant for dacs that do not have a stream_dac driver. When a
+ * stream_dac is available, render blocks with `dds::render()` instead, as the
+ * per sample cost of a timer event is far greater.
+ *
+ * The sample period is derived from the sample rate last passed to
+ * `dds::frequency()`. Each event is scheduled for an absolute deadline
+ * measured on a steady clock from the start, using the exact ratio of the
+ * sample period to the clock period, so neither a late event nor a period
+ * that is not a whole number of clock ticks makes the output drift.
+ *
+ * @tparam table_bits - see hal::dds
+ */
+template<std::size_t table_bits>
+class dds_dac_player
+{
+public:
+  /**
+   * @brief Construct a new dds dac player object
+   *
+   * @param p_dds - waveform generator, must outlive this object
+   * @param p_dac - dac to write samples to
+   * @param p_timer - timer used to pace the samples
+   * @param p_clock - clock used to place the sample deadlines
+   */
+  dds_dac_player(dds<table_bits>& p_dds,
+                 hal::dac& p_dac,
+                 hal::timer& p_timer,
+                 hal::steady_clock& p_clock)
+    : m_dds(&p_dds)
+    , m_dac(&p_dac)
+    , m_timer(&p_timer)
+    , m_clock(&p_clock)
+  {
+  }
+
+  dds_dac_player(dds_dac_player const&) = delete;
+  dds_dac_player& operator=(dds_dac_player const&) = delete;
+  dds_dac_player(dds_dac_player&&) = delete;
+  dds_dac_player& operator=(dds_dac_player&&) = delete;
+
+  /**
+   * @brief Begin writing samples to the dac
+   *
+   * @throws hal::argument_out_of_domain - if the dds has no sample rate, if
+   * the sample period is shorter than a tick of the clock or a nanosecond,
+   * or if the timer rejects the sample period as too long.
+   */
+  void start()
+  {
+    stop();
+    auto const rate = static_cast<double>(m_dds->sample_rate());
+    if (rate <= 0.0) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    m_clock_rate = static_cast<double>(m_clock->frequency());
+    m_clocks_per_sample = m_clock_rate / rate;
+    if (m_clocks_per_sample < 1.0 || rate > 1e9) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    m_start = m_clock->uptime();
+    m_samples = 0;
+    tick();
+  }
+
+  /**
+   * @brief Stop writing samples to the dac
+   *
+   */
+  void stop()
+  {
+    m_timer->cancel();
+  }
+
+  ~dds_dac_player()
+  {
+    stop();
+  }
+
+private:
+  void tick()
+  {
+    // Reschedule first, against the next absolute deadline
+    m_samples++;
+    auto const deadline =
+      m_start + static_cast<std::uint64_t>(std::llround(
+                  static_cast<double>(m_samples) * m_clocks_per_sample));
+    auto const now = m_clock->uptime();
+    auto const remaining = deadline > now ? deadline - now : 0;
+    auto const delay = std::chrono::ceil<hal::time_duration>(
+      std::chrono::duration<double>(static_cast<double>(remaining) /
+                                    m_clock_rate));
+    m_timer->schedule([this]() { tick(); }, delay);
+    m_dac->write(m_dds->next());
+  }
+
+  dds<table_bits>* m_dds;
+  hal::dac* m_dac;
+  hal::timer* m_timer;
+  hal::steady_clock* m_clock;
+  double m_clock_rate = 1.0;
+  double m_clocks_per_sample = 1.0;
+  std::uint64_t m_start = 0;
+  std::uint64_t m_samples = 0;
+};
+}  // namespace hal
@@ -0,0 +1,349 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <numbers>
+#include <span>
+#include <utility>
+
+#include "adc.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Fast fourier transform of real valued input of a fixed size
+ *
+ * Computes the N point DFT of real input using an N/2 point complex radix-2
+ * FFT followed by a split step that separates the spectra of the even and odd
+ * samples. This halves the work and memory of a complex FFT of the same
+ * length.
+ *
+ * All twiddle factors are computed once at construction and all working memory
+ * is held within the object, so no allocations occur at runtime. Instances are
+ * large for large N and are best placed in static storage.
+ *
+ * @tparam N - number of real input samples. Must be a power of 2 and at least
+ * 4.
+ */
+template<std::size_t N>
+class real_fft
+{
+public:
+  static_assert(N >= 4 && (N & (N - 1)) == 0,
+                "N must be a power of 2 and at least 4");
+
+  /// Number of complex output bins, DC through Nyquist
+  static constexpr std::size_t bins = N / 2 + 1;
+
+  real_fft()
+  {
+    for (std::size_t k = 0; k < m_twiddle.size(); k++) {
+      auto const angle = -2.0 * std::numbers::pi * static_cast<double>(k) /
+                         static_cast<double>(N);
+      m_twiddle[k] = { static_cast<float>(std::cos(angle)),
+                       static_cast<float>(std::sin(angle)) };
+    }
+  }
+
+  /**
+   * @brief Compute the one sided spectrum of p_input
+   *
+   * @param p_input - N real samples
+   * @param p_output - DC through Nyquist bins of the DFT of p_input
+   */
+  void transform(std::span<float const, N> p_input,
+                 std::span<std::complex<float>, bins> p_output)
+  {
+    constexpr std::size_t half = N / 2;
+
+    // Pack even samples into the real part and odd samples into the imaginary
+    // part of a half length complex sequence.
+    for (std::size_t i = 0; i < half; i++) {
+      m_work[i] = { p_input[2 * i], p_input[2 * i + 1] };
+    }
+
+    complex_transform();
+
+    // Split the interleaved spectrum into the spectrum of the real input
+    auto const first = m_work[0];
+    p_output[0] = { first.real() + first.imag(), 0.0f };
+    p_output[half] = { first.real() - first.imag(), 0.0f };
+    for (std::size_t k = 1; k < half; k++) {
+      auto const a = m_work[k];
+      auto const b = std::conj(m_work[half - k]);
+      auto const even = (a + b) * 0.5f;
+      auto const odd = (a - b) * std::complex<float>(0.0f, -0.5f);
+      p_output[k] = even + m_twiddle[k] * odd;
+    }
+  }
+
+private:
+  void complex_transform()
+  {
+    constexpr std::size_t size = N / 2;
+
+    // Bit reversal permutation
+    for (std::size_t i = 1, j = 0; i < size; i++) {
+      auto bit = size >> 1;
+      for (; j & bit; bit >>= 1) {
+        j ^= bit;
+      }
+      j ^= bit;
+      if (i < j) {
+        std::swap(m_work[i], m_work[j]);
+      }
+    }
+
+    // Iterative radix-2 decimation in time butterflies
+    for (std::size_t length = 2; length <= size; length <<= 1) {
+      auto const half_length = length / 2;
+      auto const stride = N / length;
+      for (std::size_t start = 0; start < size; start += length) {
+        for (std::size_t j = 0; j < half_length; j++) {
+          auto const product =
+            m_twiddle[j * stride] * m_work[start + j + half_length];
+          auto const value = m_work[start + j];
+          m_work[start + j] = value + product;
+          m_work[start + j + half_length] = value - product;
+        }
+      }
+    }
+  }
+
+  /// W_N^k for k in [0, N/2)
+  std::array<std::complex<float>, N / 2> m_twiddle{};
+  std::array<std::complex<float>, N / 2> m_work{};
+};
+
+/**
+ * @brief Window functions applied to blocks before transformation
+ *
+ */
+enum class fft_window : std::uint8_t
+{
+  /// No windowing, best for signals that are periodic within the block
+  rectangular = 0,
+  /// Good general purpose window with low spectral leakage
+  hann,
+  /// Narrower main lobe than hann with higher far side lobes
+  hamming,
+  /// Lowest side lobes of the available windows, widest main lobe
+  blackman,
+};
+
+/**
+ * @brief Averaging power spectrum analyzer over continuous sample blocks
+ *
+ * Windows blocks of N samples, transforms them and accumulates the power of
+ * each bin. The averaged power spectrum can be read out at any point.
+ *
+ * Samples may be supplied as whole blocks via `add_block()`, as chunks of any
+ * size from a sample stream via `push()`, or read directly from a hal::adc via
+ * `acquire()`.
+ *
+ * Power is normalized by the coherent gain of the window such that a sine wave
+ * with amplitude A, centered on bin k, results in a power of (A/2)^2 at bin k.
+ *
+ * @tparam N - block size, see hal::real_fft
+ */
+template<std::size_t N>
+class spectrum_analyzer
+{
+public:
+  /// Number of power bins, DC through Nyquist
+  static constexpr std::size_t bins = real_fft<N>::bins;
+
+  /**
+   * @brief Construct a new spectrum analyzer object
+   *
+   * @param p_sample_rate - rate at which the samples were captured, used to
+   * determine bin frequencies.
+   * @param p_window - window applied to each block
+   */
+  spectrum_analyzer(hertz p_sample_rate,
+                    fft_window p_window = fft_window::hann)
+    : m_sample_rate(p_sample_rate)
+  {
+    constexpr double pi = std::numbers::pi;
+    double sum = 0.0;
+    for (std::size_t i = 0; i < N; i++) {
+      auto const ratio = static_cast<double>(i) / static_cast<double>(N);
+      double value = 1.0;
+      switch (p_window) {
+        case fft_window::hann:
+          value = 0.5 - 0.5 * std::cos(2.0 * pi * ratio);
+          break;
+        case fft_window::hamming:
+          value = 0.54 - 0.46 * std::cos(2.0 * pi * ratio);
+          break;
+        case fft_window::blackman:
+          value = 0.42 - 0.5 * std::cos(2.0 * pi * ratio) +
+                  0.08 * std::cos(4.0 * pi * ratio);
+          break;
+        case fft_window::rectangular:
+        default:
+          break;
+      }
+      m_window[i] = static_cast<float>(value);
+      sum += value;
+    }
+    m_normalization = static_cast<float>(1.0 / (sum * sum));
+  }
+
+  /**
+   * @brief Window, transform and accumulate a whole block of samples
+   *
+   * Any partial block collected by `push()` is unaffected.
+   *
+   * @param p_block - N samples
+   */
+  void add_block(std::span<float const, N> p_block)
+  {
+    for (std::size_t i = 0; i < N; i++) {
+      m_windowed[i] = p_block[i] * m_window[i];
+    }
+    accumulate(m_windowed);
+  }
+
+  /**
+   * @brief Append samples from a stream, processing each completed block
+   *
+   * @param p_samples - any number of samples
+   */
+  void push(std::span<float const> p_samples)
+  {
+    while (not p_samples.empty()) {
+      auto const count = std::min(p_samples.size(), N - m_pending);
+      for (std::size_t i = 0; i < count; i++) {
+        m_stream[m_pending + i] = p_samples[i] * m_window[m_pending + i];
+      }
+      m_pending += count;
+      p_samples = p_samples.subspan(count);
+      if (m_pending == N) {
+        m_pending = 0;
+        accumulate(m_stream);
+      }
+    }
+  }
+
+  /**
+   * @brief Read and accumulate a block of N samples from an adc
+   *
+   * The samples are read back to back without any pacing, the adc driver is
+   * expected to provide samples at the sample rate.
+   *
+   * @param p_adc - adc to read from
+   * @throws any exception thrown by hal::adc::read()
+   */
+  void acquire(hal::adc& p_adc)
+  {
+    for (std::size_t i = 0; i < N; i++) {
+      m_windowed[i] = p_adc.read() * m_window[i];
+    }
+    accumulate(m_windowed);
+  }
+
+  /**
+   * @brief Averaged power spectrum of all accumulated blocks
+   *
+   * @return std::span<float const, bins> - power of each bin. All zeros if no
+   * blocks have been accumulated.
+   */
+  [[nodiscard]] std::span<float const, bins> power()
+  {
+    float const scale =
+      m_blocks == 0 ? 0.0f : m_normalization / static_cast<float>(m_blocks);
+    for (std::size_t k = 0; k < bins; k++) {
+      m_average[k] = m_accumulator[k] * scale;
+    }
+    return m_average;
+  }
+
+  /**
+   * @brief Index of the bin with the greatest accumulated power
+   *
+   * @param p_skip_dc - ignore bin 0 when searching
+   * @return std::size_t - bin index
+   */
+  [[nodiscard]] std::size_t peak_bin(bool p_skip_dc = true) const
+  {
+    auto const start = m_accumulator.begin() + (p_skip_dc ? 1 : 0);
+    return static_cast<std::size_t>(
+      std::max_element(start, m_accumulator.end()) - m_accumulator.begin());
+  }
+
+  /**
+   * @brief Center frequency of a bin
+   *
+   * @param p_bin - bin index
+   * @return hertz - frequency of the bin
+   */
+  [[nodiscard]] hertz bin_frequency(std::size_t p_bin) const
+  {
+    return static_cast<float>(p_bin) * m_sample_rate / static_cast<float>(N);
+  }
+
+  /**
+   * @brief Number of blocks accumulated since the last reset
+   *
+   * @return std::uint32_t - accumulated block count
+   */
+  [[nodiscard]] std::uint32_t blocks() const
+  {
+    return m_blocks;
+  }
+
+  /**
+   * @brief Clear the accumulated power and any partially pushed block
+   *
+   */
+  void reset()
+  {
+    m_accumulator.fill(0.0f);
+    m_blocks = 0;
+    m_pending = 0;
+  }
+
+private:
+  void accumulate(std::span<float const, N> p_windowed)
+  {
+    m_fft.transform(p_windowed, m_spectrum);
+    for (std::size_t k = 0; k < bins; k++) {
+      m_accumulator[k] += std::norm(m_spectrum[k]);
+    }
+    m_blocks++;
+  }
+
+  real_fft<N> m_fft{};
+  std::array<float, N> m_window{};
+  std::array<float, N> m_windowed{};
+  /// Holds the partial block collected by push()
+  std::array<float, N> m_stream{};
+  std::array<std::complex<float>, bins> m_spectrum{};
+  std::array<float, bins> m_accumulator{};
+  std::array<float, bins> m_average{};
+  hertz m_sample_rate;
+  float m_normalization = 1.0f;
+  std::uint32_t m_blocks = 0;
+  std::size_t m_pending = 0;
+};
+}  // namespace hal
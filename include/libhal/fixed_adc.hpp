@@ -0,0 +1,50 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "fixed_point.hpp"
+
+namespace hal {
+/**
+ * @brief Analog to Digital Converter (ADC) hardware abstraction interface
+ * using fixed point results.
+ *
+ * The fixed point counterpart to hal::adc for targets without a floating point
+ * unit. Drivers typically produce the result directly from the raw conversion
+ * count with `hal::fixed_proportion::from_ratio(count, full_scale)`.
+ */
+class fixed_adc
+{
+public:
+  /**
+   * @brief Sample the analog to digital converter and return the result
+   *
+   * Is guaranteed by the implementing driver to be between 0.0 and +1.0. The
+   * value represents the voltage measured by the ADC from Vss (negative
+   * reference) to Vcc (positive reference), see hal::adc::read().
+   *
+   * @return fixed_proportion - the sampled adc value
+   */
+  [[nodiscard]] fixed_proportion read()
+  {
+    return driver_read();
+  }
+
+  virtual ~fixed_adc() = default;
+
+private:
+  virtual fixed_proportion driver_read() = 0;
+};
+}  // namespace hal
@@ -0,0 +1,57 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+
+#include "fixed_point.hpp"
+
+namespace hal {
+/**
+ * @brief Digital to Analog Converter (DAC) hardware abstraction interface
+ * using fixed point values.
+ *
+ * The fixed point counterpart to hal::dac for targets without a floating point
+ * unit.
+ *
+ */
+class fixed_dac
+{
+public:
+  /**
+   * @brief Set the output voltage of the DAC.
+   *
+   * The input value is linearly proportional to the output voltage relative to
+   * the Vss and Vcc, see hal::dac::write().
+   *
+   * This function clamps the input value between 0.0 and 1.0 and thus values
+   * passed to driver implementations are guaranteed to be within this range.
+   *
+   * @param p_percentage - value from 0.0 to +1.0 representing the proportion
+   * of the output voltage from the Vss to Vcc.
+   */
+  void write(fixed_proportion p_percentage)
+  {
+    auto clamped_percentage =
+      std::clamp(p_percentage, fixed_proportion(0.0f), fixed_proportion(1.0f));
+    driver_write(clamped_percentage);
+  }
+
+  virtual ~fixed_dac() = default;
+
+private:
+  virtual void driver_write(fixed_proportion p_percentage) = 0;
+};
+}  // namespace hal
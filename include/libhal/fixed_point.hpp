@@ -0,0 +1,358 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <compare>
+#include <concepts>
+#include <limits>
+#include <type_traits>
+
+#include "error.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Q-format fixed point number
+ *
+ * Stores a value as an integer count of 1 / 2^fractional_bits. Arithmetic is
+ * performed entirely with integer instructions, making this type suitable for
+ * targets without a floating point unit, where every float operation is a
+ * software library call.
+ *
+ * Values can be created from the existing float unit literals at compile time
+ * through the consteval constructor, which rounds to the nearest representable
+ * value and rejects values out of range with a compile error. No floating
+ * point code is emitted for these conversions:
+ *
+ * ```C++
+ * hal::fixed_volts reference = 3.3_V;
+ * ```
+ *
+ * Addition and subtraction wrap on overflow like the underlying integer.
+ * Multiplication and division use a 64-bit intermediate and round to nearest.
+ *
+ * @tparam fractional_bits - number of bits after the binary point
+ * @tparam rep_t - integer type holding the raw value
+ */
+template<std::size_t fractional_bits, class rep_t = std::int32_t>
+class fixed_point
+{
+public:
+  static_assert(std::is_integral_v<rep_t>, "rep_t must be an integer type");
+  static_assert(fractional_bits < sizeof(rep_t) * 8,
+                "fractional_bits must leave at least one integer bit");
+  static_assert(sizeof(rep_t) <= 4, "rep_t must be 32-bits or less");
+
+  using rep = rep_t;
+  /// Intermediate type used for multiplication and division
+  using wide = std::conditional_t<std::is_signed_v<rep_t>,
+                                  std::int64_t,
+                                  std::uint64_t>;
+  /// Raw value representing 1.0
+  static constexpr wide one = wide{ 1 } << fractional_bits;
+  static constexpr std::size_t fraction_bits = fractional_bits;
+
+  constexpr fixed_point() = default;
+
+  /**
+   * @brief Convert a constant float, such as a unit literal, at compile time
+   *
+   * @param p_value - value to convert, rounded to the nearest representable
+   * value.
+   */
+  consteval fixed_point(float p_value)  // NOLINT(google-explicit-constructor)
+    : m_raw(from_constant(static_cast<long double>(p_value)))
+  {
+  }
+
+  /**
+   * @brief Convert between Q formats
+   *
+   * Converting to fewer fractional bits truncates toward negative infinity.
+   *
+   * @param p_other - value to convert
+   */
+  template<std::size_t other_bits, class other_rep_t>
+  constexpr explicit fixed_point(
+    fixed_point<other_bits, other_rep_t> const& p_other)
+  {
+    auto const raw = static_cast<wide>(p_other.raw());
+    if constexpr (other_bits > fractional_bits) {
+      m_raw = static_cast<rep_t>(raw >> (other_bits - fractional_bits));
+    } else {
+      m_raw = static_cast<rep_t>(raw << (fractional_bits - other_bits));
+    }
+  }
+
+  /**
+   * @brief Construct from a raw value
+   *
+   * @param p_raw - value in units of 1 / 2^fractional_bits
+   * @return constexpr fixed_point - the fixed point value
+   */
+  [[nodiscard]] static constexpr fixed_point from_raw(rep_t p_raw)
+  {
+    fixed_point result;
+    result.m_raw = p_raw;
+    return result;
+  }
+
+  /**
+   * @brief Construct from an integer
+   *
+   * @param p_value - whole number value
+   * @return constexpr fixed_point - the fixed point value
+   */
+  template<std::integral integer_t>
+  [[nodiscard]] static constexpr fixed_point from_integer(integer_t p_value)
+  {
+    return from_raw(static_cast<rep_t>(static_cast<wide>(p_value) * one));
+  }
+
+  /**
+   * @brief Construct from the ratio of two integers, such as an adc count
+   * over its full scale count.
+   *
+   * @param p_numerator - numerator
+   * @param p_denominator - denominator, must not be zero
+   * @return constexpr fixed_point - p_numerator / p_denominator, rounded to
+   * nearest
+   */
+  template<std::integral integer_t>
+  [[nodiscard]] static constexpr fixed_point from_ratio(integer_t p_numerator,
+                                                        integer_t p_denominator)
+  {
+    return from_raw(static_cast<rep_t>(
+      divide_rounded(static_cast<wide>(p_numerator) * one,
+                     static_cast<wide>(p_denominator))));
+  }
+
+  /**
+   * @brief Convert a float at runtime, saturating to the representable range
+   *
+   * This performs floating point operations and is intended for boundaries
+   * with float based code, not for use in fixed point hot paths.
+   *
+   * @param p_value - value to convert
+   * @return constexpr fixed_point - nearest representable value
+   */
+  [[nodiscard]] static constexpr fixed_point from_float(float p_value)
+  {
+    auto const scaled = static_cast<double>(p_value) * static_cast<double>(one);
+    constexpr auto lowest =
+      static_cast<double>(std::numeric_limits<rep_t>::min());
+    constexpr auto highest =
+      static_cast<double>(std::numeric_limits<rep_t>::max());
+    if (not(scaled >= lowest)) {
+      return from_raw(std::numeric_limits<rep_t>::min());
+    }
+    if (scaled >= highest) {
+      return from_raw(std::numeric_limits<rep_t>::max());
+    }
+    auto const rounded = scaled < 0.0 ? scaled - 0.5 : scaled + 0.5;
+    return from_raw(static_cast<rep_t>(rounded));
+  }
+
+  /**
+   * @brief Smallest representable value
+   *
+   * @return constexpr fixed_point - the lowest value
+   */
+  [[nodiscard]] static constexpr fixed_point lowest()
+  {
+    return from_raw(std::numeric_limits<rep_t>::min());
+  }
+
+  /**
+   * @brief Largest representable value
+   *
+   * @return constexpr fixed_point - the highest value
+   */
+  [[nodiscard]] static constexpr fixed_point highest()
+  {
+    return from_raw(std::numeric_limits<rep_t>::max());
+  }
+
+  /**
+   * @brief Raw integer representation
+   *
+   * @return constexpr rep_t - value in units of 1 / 2^fractional_bits
+   */
+  [[nodiscard]] constexpr rep_t raw() const
+  {
+    return m_raw;
+  }
+
+  /**
+   * @brief Integer part of the value, truncated toward negative infinity
+   *
+   * @return constexpr rep_t - whole number part
+   */
+  [[nodiscard]] constexpr rep_t to_integer() const
+  {
+    return static_cast<rep_t>(m_raw >> fractional_bits);
+  }
+
+  /**
+   * @brief Convert to float for boundaries with float based code
+   *
+   * @return constexpr float - the value as a float
+   */
+  [[nodiscard]] constexpr float to_float() const
+  {
+    return static_cast<float>(m_raw) / static_cast<float>(one);
+  }
+
+  constexpr fixed_point& operator+=(fixed_point p_other)
+  {
+    m_raw = static_cast<rep_t>(m_raw + p_other.m_raw);
+    return *this;
+  }
+
+  constexpr fixed_point& operator-=(fixed_point p_other)
+  {
+    m_raw = static_cast<rep_t>(m_raw - p_other.m_raw);
+    return *this;
+  }
+
+  constexpr fixed_point& operator*=(fixed_point p_other)
+  {
+    auto const product = static_cast<wide>(m_raw) * p_other.m_raw;
+    m_raw = static_cast<rep_t>(divide_rounded(product, one));
+    return *this;
+  }
+
+  constexpr fixed_point& operator/=(fixed_point p_other)
+  {
+    auto const numerator = static_cast<wide>(m_raw) * one;
+    m_raw = static_cast<rep_t>(divide_rounded(numerator, p_other.m_raw));
+    return *this;
+  }
+
+  [[nodiscard]] friend constexpr fixed_point operator+(fixed_point p_left,
+                                                       fixed_point p_right)
+  {
+    return p_left += p_right;
+  }
+
+  [[nodiscard]] friend constexpr fixed_point operator-(fixed_point p_left,
+                                                       fixed_point p_right)
+  {
+    return p_left -= p_right;
+  }
+
+  [[nodiscard]] friend constexpr fixed_point operator*(fixed_point p_left,
+                                                       fixed_point p_right)
+  {
+    return p_left *= p_right;
+  }
+
+  [[nodiscard]] friend constexpr fixed_point operator/(fixed_point p_left,
+                                                       fixed_point p_right)
+  {
+    return p_left /= p_right;
+  }
+
+  template<std::integral integer_t>
+  [[nodiscard]] friend constexpr fixed_point operator*(fixed_point p_left,
+                                                       integer_t p_right)
+  {
+    return from_raw(
+      static_cast<rep_t>(static_cast<wide>(p_left.m_raw) * p_right));
+  }
+
+  template<std::integral integer_t>
+  [[nodiscard]] friend constexpr fixed_point operator/(fixed_point p_left,
+                                                       integer_t p_right)
+  {
+    return from_raw(static_cast<rep_t>(
+      divide_rounded(static_cast<wide>(p_left.m_raw), p_right)));
+  }
+
+  [[nodiscard]] constexpr fixed_point operator-() const
+  {
+    return from_raw(static_cast<rep_t>(-m_raw));
+  }
+
+  [[nodiscard]] friend constexpr bool operator==(fixed_point,
+                                                 fixed_point) = default;
+  [[nodiscard]] friend constexpr auto operator<=>(fixed_point,
+                                                  fixed_point) = default;
+
+private:
+  static consteval rep_t from_constant(long double p_value)
+  {
+    auto const scaled = p_value * static_cast<long double>(one);
+    auto const rounded = scaled < 0.0L ? scaled - 0.5L : scaled + 0.5L;
+    if (rounded < static_cast<long double>(std::numeric_limits<rep_t>::min()) ||
+        rounded >=
+          static_cast<long double>(std::numeric_limits<rep_t>::max()) + 1.0L) {
+      // Not a constant expression, making an out of range literal a compile
+      // error.
+      hal::safe_throw(hal::argument_out_of_domain(nullptr));
+    }
+    return static_cast<rep_t>(rounded);
+  }
+
+  static constexpr wide divide_rounded(wide p_numerator, wide p_denominator)
+  {
+    // Round half away from zero
+    auto const half = p_denominator / 2;
+    if constexpr (std::is_signed_v<wide>) {
+      if ((p_numerator < 0) != (p_denominator < 0)) {
+        return (p_numerator - half) / p_denominator;
+      }
+    }
+    return (p_numerator + half) / p_denominator;
+  }
+
+  rep_t m_raw = 0;
+};
+
+/// Q16.16 proportion from 0.0 to 1.0, used by the fixed point interfaces in
+/// place of the float proportion of hal::adc, hal::dac and hal::pwm.
+using fixed_proportion = fixed_point<16>;
+
+/// Q28.4 frequency in hertz, covering up to 268MHz with 1/16Hz resolution.
+using fixed_hertz = fixed_point<4, std::uint32_t>;
+
+/// Q16.16 acceleration represented in the force applied by gravity at sea
+/// level.
+using fixed_g_force = fixed_point<16>;
+
+/// Q16.16 current in amps.
+using fixed_ampere = fixed_point<16>;
+
+/// Q16.16 voltage in volts.
+using fixed_volts = fixed_point<16>;
+
+/// Q16.16 temperature in celsius.
+using fixed_celsius = fixed_point<16>;
+
+/// Q16.16 rotational velocity in RPMs.
+using fixed_rpm = fixed_point<16>;
+
+/// Q16.16 length in meters.
+using fixed_meters = fixed_point<16>;
+
+/// Q16.16 angle in degrees.
+using fixed_degrees = fixed_point<16>;
+
+/// Q16.16 magnetic field in gauss.
+using fixed_gauss = fixed_point<16>;
+}  // namespace hal
@@ -0,0 +1,75 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+
+#include "fixed_point.hpp"
+
+namespace hal {
+/**
+ * @brief Pulse Width Modulation (PWM) channel hardware abstraction using fixed
+ * point values.
+ *
+ * The fixed point counterpart to hal::pwm for targets without a floating point
+ * unit. See hal::pwm for a description of frequency and duty cycle.
+ *
+ */
+class fixed_pwm
+{
+public:
+  /**
+   * @brief Set the pwm waveform frequency
+   *
+   * This function clamps the input value between 1.0_Hz and the largest value
+   * of hal::fixed_hertz (~268MHz) and thus values passed to driver
+   * implementations are guaranteed to be within this range.
+   *
+   * @param p_frequency - settings to apply to pwm driver
+   * @throws hal::argument_out_of_domain - if the frequency is beyond what
+   * the pwm generator is capable of achieving.
+   */
+  void frequency(fixed_hertz p_frequency)
+  {
+    auto clamped_frequency = std::max(p_frequency, fixed_hertz(1.0_Hz));
+    driver_frequency(clamped_frequency);
+  }
+
+  /**
+   * @brief Set the pwm waveform duty cycle
+   *
+   * The value is directly proportional to the duty cycle percentage, such that
+   * 0.0 is 0%, 0.25 is 25% and 1.0 is 100%.
+   *
+   * This function clamps the input value between 0.0 and 1.0 and thus values
+   * passed to driver implementations are guaranteed to be within this range.
+   *
+   * @param p_duty_cycle - a value from 0.0 to +1.0 representing the duty
+   * cycle percentage.
+   */
+  void duty_cycle(fixed_proportion p_duty_cycle)
+  {
+    auto clamped_duty_cycle =
+      std::clamp(p_duty_cycle, fixed_proportion(0.0f), fixed_proportion(1.0f));
+    driver_duty_cycle(clamped_duty_cycle);
+  }
+
+  virtual ~fixed_pwm() = default;
+
+private:
+  virtual void driver_frequency(fixed_hertz p_frequency) = 0;
+  virtual void driver_duty_cycle(fixed_proportion p_duty_cycle) = 0;
+};
+}  // namespace hal
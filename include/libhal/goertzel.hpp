@@ -0,0 +1,222 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <span>
+
+#include "adc.hpp"
+#include "error.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Bank of Goertzel filters detecting a fixed set of frequencies
+ *
+ * Computes the power of `tone_count` target frequencies over blocks of samples.
+ * Each tone costs one multiply and two adds per sample, which is far cheaper
+ * than an FFT when only a handful of frequencies are of interest, such as DTMF
+ * decoding or monitoring known machine harmonics.
+ *
+ * Filter states are stored as a structure of arrays and the inner loop runs
+ * across all tones for each sample, allowing the compiler to vectorize the
+ * per-sample update across tones.
+ *
+ * Target frequencies do not need to be centered on an FFT bin; the exact
+ * frequency is used for each filter coefficient.
+ *
+ * Power is normalized such that a sine wave of amplitude A at a target
+ * frequency results in a power of (A/2)^2 for that tone, the same convention
+ * used by hal::spectrum_analyzer.
+ *
+ * @tparam tone_count - number of target frequencies
+ */
+template<std::size_t tone_count>
+class goertzel_bank
+{
+public:
+  static_assert(tone_count > 0, "tone_count must be at least 1");
+
+  /**
+   * @brief Construct a new goertzel bank object
+   *
+   * @param p_sample_rate - rate the samples were captured at
+   * @param p_frequencies - target frequencies
+   * @param p_block_size - number of samples per detection block. Frequency
+   * resolution is approximately p_sample_rate / p_block_size.
+   * @throws hal::argument_out_of_domain - if the block size is zero, the
+   * sample rate is not positive, or any frequency is negative or above the
+   * Nyquist frequency.
+   */
+  goertzel_bank(hertz p_sample_rate,
+                std::span<hertz const, tone_count> p_frequencies,
+                std::size_t p_block_size)
+    : m_block_size(p_block_size)
+  {
+    if (p_block_size == 0 || p_sample_rate <= 0.0f) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    for (std::size_t i = 0; i < tone_count; i++) {
+      auto const frequency = p_frequencies[i];
+      if (frequency < 0.0f || frequency > p_sample_rate / 2.0f) {
+        hal::safe_throw(hal::argument_out_of_domain(this));
+      }
+      auto const omega =
+        2.0 * std::numbers::pi * frequency / static_cast<double>(p_sample_rate);
+      m_coefficient[i] = static_cast<float>(2.0 * std::cos(omega));
+    }
+    auto const block = static_cast<float>(p_block_size);
+    m_normalization = 1.0f / (block * block);
+    reset();
+  }
+
+  /**
+   * @brief Feed samples into the filters
+   *
+   * Samples may be supplied in chunks of any size. Each time a block
+   * completes, the power of every tone is latched, becoming available through
+   * `power()`, and the filters restart for the next block.
+   *
+   * @param p_samples - samples in capture order
+   */
+  void process(std::span<float const> p_samples)
+  {
+    while (not p_samples.empty()) {
+      auto const count =
+        std::min(p_samples.size(), m_block_size - m_sample_count);
+      run(p_samples.first(count));
+      m_sample_count += count;
+      p_samples = p_samples.subspan(count);
+      if (m_sample_count == m_block_size) {
+        latch();
+      }
+    }
+  }
+
+  /**
+   * @brief Read and process one block of samples from an adc
+   *
+   * Samples are read in batches on the stack and then processed, keeping the
+   * filter loop free of virtual calls.
+   *
+   * @param p_adc - adc to read samples from
+   * @throws any exception thrown by hal::adc::read()
+   */
+  void acquire(hal::adc& p_adc)
+  {
+    std::array<float, 32> batch{};
+    auto remaining = m_block_size - m_sample_count;
+    while (remaining != 0) {
+      auto const count = std::min(remaining, batch.size());
+      for (std::size_t i = 0; i < count; i++) {
+        batch[i] = p_adc.read();
+      }
+      process(std::span<float const>(batch.data(), count));
+      remaining -= count;
+    }
+  }
+
+  /**
+   * @brief Power of each tone from the most recently completed block
+   *
+   * @return std::span<float const, tone_count> - power per tone, in the order
+   * the frequencies were passed to the constructor. All zero until the first
+   * block completes.
+   */
+  [[nodiscard]] std::span<float const, tone_count> power() const
+  {
+    return m_power;
+  }
+
+  /**
+   * @brief Index of the tone with the greatest power in the last block
+   *
+   * @return std::size_t - tone index
+   */
+  [[nodiscard]] std::size_t strongest() const
+  {
+    return static_cast<std::size_t>(
+      std::max_element(m_power.begin(), m_power.end()) - m_power.begin());
+  }
+
+  /**
+   * @brief Number of blocks completed since construction or reset
+   *
+   * @return std::uint32_t - completed block count
+   */
+  [[nodiscard]] std::uint32_t blocks() const
+  {
+    return m_blocks;
+  }
+
+  /**
+   * @brief Discard the current partial block, latched powers and block count
+   *
+   */
+  void reset()
+  {
+    m_s1.fill(0.0f);
+    m_s2.fill(0.0f);
+    m_power.fill(0.0f);
+    m_sample_count = 0;
+    m_blocks = 0;
+  }
+
+private:
+  void run(std::span<float const> p_samples)
+  {
+    auto s1 = m_s1;
+    auto s2 = m_s2;
+    for (auto const sample : p_samples) {
+      for (std::size_t i = 0; i < tone_count; i++) {
+        auto const s0 = sample + m_coefficient[i] * s1[i] - s2[i];
+        s2[i] = s1[i];
+        s1[i] = s0;
+      }
+    }
+    m_s1 = s1;
+    m_s2 = s2;
+  }
+
+  void latch()
+  {
+    for (std::size_t i = 0; i < tone_count; i++) {
+      auto const s1 = m_s1[i];
+      auto const s2 = m_s2[i];
+      auto const power = s1 * s1 + s2 * s2 - m_coefficient[i] * s1 * s2;
+      m_power[i] = power * m_normalization;
+    }
+    m_s1.fill(0.0f);
+    m_s2.fill(0.0f);
+    m_sample_count = 0;
+    m_blocks++;
+  }
+
+  std::array<float, tone_count> m_coefficient{};
+  std::array<float, tone_count> m_s1{};
+  std::array<float, tone_count> m_s2{};
+  std::array<float, tone_count> m_power{};
+  std::size_t m_block_size;
+  std::size_t m_sample_count = 0;
+  std::uint32_t m_blocks = 0;
+  float m_normalization = 1.0f;
+};
+}  // namespace hal
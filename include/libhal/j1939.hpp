@@ -0,0 +1,901 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <span>
+
+#include "can.hpp"
+#include "error.hpp"
+#include "functional.hpp"
+#include "timer_wheel.hpp"
+#include "units.hpp"
+
+namespace hal::j1939 {
+/// Request PGN, asks a node to send the PGN in its first 3 data bytes
+constexpr std::uint32_t pgn_request = 0xEA00;
+/// Address claimed PGN, carries the 64-bit NAME of the claiming node
+constexpr std::uint32_t pgn_address_claimed = 0xEE00;
+/// Transport protocol connection management (TP.CM)
+constexpr std::uint32_t pgn_transport_connection = 0xEC00;
+/// Transport protocol data transfer (TP.DT)
+constexpr std::uint32_t pgn_transport_data = 0xEB00;
+/// Destination address of messages for every node
+constexpr hal::byte global_address = 0xFF;
+/// Source address of a node without an address
+constexpr hal::byte null_address = 0xFE;
+/// Largest message the transport protocol can carry
+constexpr std::size_t max_transport_size = 1785;
+
+/// Reason given in a transport protocol connection abort
+enum class abort_reason : hal::byte
+{
+  already_in_session = 1,
+  resources_needed = 2,
+  timeout = 3,
+  cts_during_transfer = 4,
+  retransmit_limit = 5,
+  unexpected_data = 6,
+  bad_sequence = 7,
+  duplicate_sequence = 8,
+  message_too_large = 9,
+};
+
+/// Fields of a 29-bit J1939 identifier
+struct identifier
+{
+  /// Priority from 0 (highest) to 7
+  std::uint8_t priority = 6;
+  /// Parameter group number, without the destination of PDU1 formats
+  std::uint32_t pgn = 0;
+  /// Destination address, global_address for PDU2 formats
+  hal::byte destination = global_address;
+  /// Source address
+  hal::byte source = null_address;
+};
+
+/**
+ * @brief Build a 29-bit CAN identifier
+ *
+ * hal::can::message_t has no extended frame flag, so J1939 identifiers are
+ * carried as 29-bit values in `message_t::id`.
+ *
+ * @param p_identifier - identifier fields
+ * @return constexpr hal::can::id_t - CAN identifier
+ */
+constexpr hal::can::id_t make_id(identifier const& p_identifier)
+{
+  auto const pdu_format = (p_identifier.pgn >> 8) & 0xFF;
+  auto const pdu_specific =
+    pdu_format < 240 ? p_identifier.destination : p_identifier.pgn & 0xFF;
+  return (hal::can::id_t{ p_identifier.priority } & 0x7) << 26 |
+         ((p_identifier.pgn & 0x3FF00) | pdu_specific) << 8 |
+         p_identifier.source;
+}
+
+/**
+ * @brief Split a 29-bit CAN identifier into its J1939 fields
+ *
+ * @param p_id - CAN identifier
+ * @return constexpr identifier - identifier fields
+ */
+constexpr identifier parse_id(hal::can::id_t p_id)
+{
+  auto const pdu_format = (p_id >> 16) & 0xFF;
+  auto const pdu_specific = static_cast<hal::byte>(p_id >> 8);
+  auto const pdu1 = pdu_format < 240;
+  return {
+    .priority = static_cast<std::uint8_t>((p_id >> 26) & 0x7),
+    .pgn = ((p_id >> 8) & 0x3FF00) | (pdu1 ? 0 : pdu_specific),
+    .destination = pdu1 ? pdu_specific : global_address,
+    .source = static_cast<hal::byte>(p_id),
+  };
+}
+
+/// A received message, single frame or reassembled from the transport
+struct message
+{
+  /// Parameter group number
+  std::uint32_t pgn;
+  /// Priority of the frame (of the final data frame for transport messages)
+  std::uint8_t priority;
+  /// Source address
+  hal::byte source;
+  /// Destination address, global_address for broadcasts
+  hal::byte destination;
+  /// Message data, only valid during the handler call
+  std::span<hal::byte const> data;
+};
+
+/// Signature of a message handler
+using handler = void(message const& p_message);
+
+/// Handler registered for one PGN
+struct subscription
+{
+  /// PGN to deliver to the handler
+  std::uint32_t pgn = 0;
+  /// Called with each message carrying the PGN
+  hal::callback<handler> on_message = [](message const&) {};
+};
+
+/// State of this node's address
+enum class address_state : std::uint8_t
+{
+  /// No claim has been made, `start()` has not been called
+  idle,
+  /// Claim sent, waiting for contention
+  claiming,
+  /// Address claimed, messages may be sent
+  claimed,
+  /// No address could be claimed
+  cannot_claim,
+};
+
+/// State of the most recent multi-packet transmission
+enum class transfer_state : std::uint8_t
+{
+  idle,
+  in_progress,
+  complete,
+  aborted,
+};
+
+class stack;
+
+/**
+ * @brief Static storage for reassembling one multi-packet message
+ *
+ * Each concurrent incoming transport session, broadcast or connection mode,
+ * occupies one receive session.
+ */
+class receive_session
+{
+public:
+  receive_session() = default;
+
+  receive_session(receive_session const&) = delete;
+  receive_session& operator=(receive_session const&) = delete;
+  receive_session(receive_session&&) = delete;
+  receive_session& operator=(receive_session&&) = delete;
+
+private:
+  friend class stack;
+
+  std::array<hal::byte, max_transport_size> m_buffer{};
+  timer_wheel_entry m_timeout{};
+  std::uint32_t m_pgn = 0;
+  std::uint16_t m_size = 0;
+  std::uint8_t m_packets = 0;
+  std::uint16_t m_next_sequence = 1;
+  std::uint16_t m_window_end = 0;
+  std::uint8_t m_window = 0;
+  hal::byte m_source = null_address;
+  hal::byte m_destination = global_address;
+  bool m_active = false;
+};
+
+/**
+ * @brief SAE J1939 network layer on a hal::can
+ *
+ * Provides:
+ *
+ * - Address claim (J1939-81). `start()` claims the preferred address. On
+ *   contention the node with the lower NAME keeps the address; the loser
+ *   moves to the next address in 128 to 247 if its NAME has the arbitrary
+ *   address capable bit (bit 63) set, otherwise it reports cannot claim.
+ * - PGN based dispatch of received messages to subscriptions.
+ * - The transport protocol (J1939-21) for messages of 9 to 1785 bytes: BAM
+ *   for broadcasts and RTS/CTS for messages to one node, in both
+ *   directions. Incoming messages are reassembled in caller supplied
+ *   receive sessions; nothing is allocated.
+ *
+ * All protocol timing runs on a hal::timer_wheel: the spacing between BAM
+ * data packets and the T1 to T4 timeouts are wheel entries, so nothing ever
+ * blocks. Packets granted by a CTS are sent back to back on the next tick.
+ * The wheel's tick period sets the timing resolution; 1ms to 10ms suits the
+ * 50ms BAM spacing.
+ *
+ * The can's receive handler, which this stack installs, only copies frames
+ * into a fixed queue of receive_queue_size frames and is safe to run in an
+ * interrupt. Queued frames are processed on every tick of the wheel, so
+ * address claim, the transport protocol and subscription handlers all run
+ * in the context that calls `tick()`. Frames arriving while the queue is
+ * full are dropped and counted by `dropped_frames()`. Every other member
+ * function schedules on the wheel and must be called from that same
+ * context, or with the wheel's tick masked.
+ */
+class stack
+{
+public:
+  /// Spacing between BAM data packets
+  static constexpr auto bam_packet_interval = std::chrono::milliseconds(50);
+  /// Time to wait for contention after claiming an address
+  static constexpr auto claim_timeout = std::chrono::milliseconds(250);
+  /// T1, maximum gap between BAM data packets when receiving
+  static constexpr auto t1 = std::chrono::milliseconds(750);
+  /// T2, maximum wait for data after sending a CTS
+  static constexpr auto t2 = std::chrono::milliseconds(1250);
+  /// T3, maximum wait for a CTS or acknowledgement after sending data
+  static constexpr auto t3 = std::chrono::milliseconds(1250);
+  /// T4, maximum wait for a CTS after a CTS holding the connection open
+  static constexpr auto t4 = std::chrono::milliseconds(1050);
+  /// Frames held between the receive handler and the next tick
+  static constexpr std::size_t receive_queue_size = 16;
+
+  /**
+   * @brief Construct a new stack object and install its can receive handler
+   *
+   * Starts draining the receive queue on every tick of p_wheel.
+   *
+   * @param p_can - CAN bus port
+   * @param p_wheel - timer wheel driving protocol timing
+   * @param p_name - 64-bit NAME of this node
+   * @param p_preferred_address - address to claim first
+   * @param p_sessions - storage for concurrent incoming transport sessions
+   * @param p_subscriptions - storage for subscriptions
+   */
+  stack(hal::can& p_can,
+        hal::timer_wheel& p_wheel,
+        std::uint64_t p_name,
+        hal::byte p_preferred_address,
+        std::span<receive_session> p_sessions,
+        std::span<subscription> p_subscriptions)
+    : m_can(&p_can)
+    , m_wheel(&p_wheel)
+    , m_sessions(p_sessions)
+    , m_subscriptions(p_subscriptions)
+    , m_name(p_name)
+    , m_preferred_address(p_preferred_address)
+    , m_address(p_preferred_address)
+  {
+    m_can->on_receive(
+      [this](hal::can::message_t const& p_message) { enqueue(p_message); });
+    process_queue();
+  }
+
+  stack(stack const&) = delete;
+  stack& operator=(stack const&) = delete;
+  stack(stack&&) = delete;
+  stack& operator=(stack&&) = delete;
+
+  /**
+   * @brief Claim the preferred address
+   *
+   */
+  void start()
+  {
+    m_address = m_preferred_address;
+    claim();
+  }
+
+  /**
+   * @brief Deliver messages with a PGN to a handler
+   *
+   * @param p_pgn - PGN to subscribe to
+   * @param p_handler - handler for each message
+   * @throws hal::resource_unavailable_try_again - if every subscription is
+   * in use
+   */
+  void subscribe(std::uint32_t p_pgn, hal::callback<handler> p_handler)
+  {
+    if (m_subscription_count == m_subscriptions.size()) {
+      hal::safe_throw(hal::resource_unavailable_try_again(this));
+    }
+    m_subscriptions[m_subscription_count++] = {
+      .pgn = p_pgn,
+      .on_message = p_handler,
+    };
+  }
+
+  /**
+   * @brief Send a message
+   *
+   * Messages of up to 8 bytes are sent immediately in a single frame. Longer
+   * messages are copied and sent with the transport protocol, BAM when
+   * p_destination is global_address and RTS/CTS otherwise; progress is
+   * reported by `transfer()`. Only one multi-packet transmission runs at a
+   * time.
+   *
+   * @param p_pgn - parameter group number
+   * @param p_data - message data
+   * @param p_destination - destination address
+   * @param p_priority - priority of single frame messages, transport frames
+   * always use priority 7
+   * @return true - the message was sent or its transfer started
+   * @return false - a multi-packet transmission is already in progress
+   * @throws hal::operation_not_permitted - if this node has not claimed an
+   * address
+   * @throws hal::message_size - if p_data exceeds max_transport_size
+   */
+  bool send(std::uint32_t p_pgn,
+            std::span<hal::byte const> p_data,
+            hal::byte p_destination = global_address,
+            std::uint8_t p_priority = 6)
+  {
+    if (m_state != address_state::claimed) {
+      hal::safe_throw(hal::operation_not_permitted(this));
+    }
+    if (p_data.size() > max_transport_size) {
+      hal::safe_throw(hal::message_size(max_transport_size, this));
+    }
+
+    if (p_data.size() <= 8) {
+      send_frame(p_priority, p_pgn, p_destination, p_data);
+      return true;
+    }
+    if (m_transfer == transfer_state::in_progress) {
+      return false;
+    }
+
+    std::ranges::copy(p_data, m_transmit.begin());
+    m_transmit_pgn = p_pgn;
+    m_transmit_size = static_cast<std::uint16_t>(p_data.size());
+    m_transmit_destination = p_destination;
+    m_transmit_next = 1;
+    m_transmit_window_end = 0;
+    m_transfer = transfer_state::in_progress;
+
+    // Schedule first, the receiver may respond from within send_connection()
+    auto const broadcast = p_destination == global_address;
+    if (broadcast) {
+      m_wheel->schedule(
+        m_transmit_timer, bam_packet_interval, [this]() { send_bam_packet(); });
+    } else {
+      expect_response(t3);
+    }
+    send_connection(p_destination,
+                    { broadcast ? bam : request_to_send,
+                      static_cast<hal::byte>(p_data.size()),
+                      static_cast<hal::byte>(p_data.size() >> 8),
+                      transmit_packets(),
+                      0xFF });
+    return true;
+  }
+
+  /**
+   * @brief Current address of this node
+   *
+   * @return hal::byte - claimed address, null_address if none could be
+   * claimed
+   */
+  [[nodiscard]] hal::byte address() const
+  {
+    return m_address;
+  }
+
+  /**
+   * @brief State of this node's address claim
+   *
+   * @return address_state - current state
+   */
+  [[nodiscard]] address_state state() const
+  {
+    return m_state;
+  }
+
+  /**
+   * @brief State of the most recent multi-packet transmission
+   *
+   * @return transfer_state - current state
+   */
+  [[nodiscard]] transfer_state transfer() const
+  {
+    return m_transfer;
+  }
+
+  /**
+   * @brief Number of received frames dropped because the queue was full
+   *
+   * @return std::uint32_t - frames dropped since construction
+   */
+  [[nodiscard]] std::uint32_t dropped_frames() const
+  {
+    return m_dropped_frames.load(std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr hal::byte request_to_send = 16;
+  static constexpr hal::byte clear_to_send = 17;
+  static constexpr hal::byte end_of_message_ack = 19;
+  static constexpr hal::byte bam = 32;
+  static constexpr hal::byte connection_abort = 255;
+  static constexpr std::uint8_t transport_priority = 7;
+  static constexpr hal::byte first_arbitrary_address = 128;
+  static constexpr hal::byte last_arbitrary_address = 247;
+
+  static constexpr std::uint8_t packets_for(std::size_t p_size)
+  {
+    return static_cast<std::uint8_t>((p_size + 6) / 7);
+  }
+
+  [[nodiscard]] std::uint8_t transmit_packets() const
+  {
+    return packets_for(m_transmit_size);
+  }
+
+  void send_frame(std::uint8_t p_priority,
+                  std::uint32_t p_pgn,
+                  hal::byte p_destination,
+                  std::span<hal::byte const> p_data)
+  {
+    hal::can::message_t frame{
+      .id = make_id({ .priority = p_priority,
+                      .pgn = p_pgn,
+                      .destination = p_destination,
+                      .source = m_address }),
+      .length = static_cast<std::uint8_t>(p_data.size()),
+    };
+    std::ranges::copy(p_data, frame.payload.begin());
+    m_can->send(frame);
+  }
+
+  /// Send a TP.CM frame, the PGN bytes come from the active session
+  void send_connection(hal::byte p_destination,
+                       std::array<hal::byte, 5> p_head,
+                       std::uint32_t p_pgn)
+  {
+    std::array<hal::byte, 8> const data{ p_head[0],
+                                         p_head[1],
+                                         p_head[2],
+                                         p_head[3],
+                                         p_head[4],
+                                         static_cast<hal::byte>(p_pgn),
+                                         static_cast<hal::byte>(p_pgn >> 8),
+                                         static_cast<hal::byte>(p_pgn >> 16) };
+    send_frame(
+      transport_priority, pgn_transport_connection, p_destination, data);
+  }
+
+  void send_connection(hal::byte p_destination, std::array<hal::byte, 5> p_head)
+  {
+    send_connection(p_destination, p_head, m_transmit_pgn);
+  }
+
+  void send_abort(hal::byte p_destination,
+                  abort_reason p_reason,
+                  std::uint32_t p_pgn)
+  {
+    send_connection(p_destination,
+                    { connection_abort,
+                      static_cast<hal::byte>(p_reason),
+                      0xFF,
+                      0xFF,
+                      0xFF },
+                    p_pgn);
+  }
+
+  void send_data_packet(std::uint16_t p_sequence)
+  {
+    std::array<hal::byte, 8> data{};
+    data.fill(0xFF);
+    data[0] = static_cast<hal::byte>(p_sequence);
+    auto const offset = std::size_t{ p_sequence - 1U } * 7;
+    auto const count = std::min<std::size_t>(7, m_transmit_size - offset);
+    std::copy_n(m_transmit.begin() + offset, count, data.begin() + 1);
+    send_frame(
+      transport_priority, pgn_transport_data, m_transmit_destination, data);
+  }
+
+  void claim()
+  {
+    m_state = address_state::claiming;
+    send_claim();
+    m_wheel->schedule(m_claim_timer, claim_timeout, [this]() {
+      if (m_state == address_state::claiming) {
+        m_state = address_state::claimed;
+      }
+    });
+  }
+
+  void send_claim()
+  {
+    std::array<hal::byte, 8> name{};
+    for (std::size_t i = 0; i < name.size(); i++) {
+      name[i] = static_cast<hal::byte>(m_name >> (8 * i));
+    }
+    send_frame(6, pgn_address_claimed, global_address, name);
+  }
+
+  void handle_claim(hal::byte p_source, std::span<hal::byte const> p_data)
+  {
+    if (p_data.size() < 8 || p_source != m_address ||
+        m_state == address_state::idle ||
+        m_state == address_state::cannot_claim) {
+      return;
+    }
+    std::uint64_t other_name = 0;
+    for (std::size_t i = 0; i < 8; i++) {
+      other_name |= std::uint64_t{ p_data[i] } << (8 * i);
+    }
+    if (m_name < other_name) {
+      send_claim();
+      return;
+    }
+
+    m_wheel->cancel(m_claim_timer);
+    auto const arbitrary_address_capable = (m_name >> 63) != 0;
+    if (arbitrary_address_capable) {
+      auto next = m_address < first_arbitrary_address ||
+                      m_address >= last_arbitrary_address
+                    ? first_arbitrary_address
+                    : static_cast<hal::byte>(m_address + 1);
+      if (next != m_preferred_address) {
+        m_address = next;
+        claim();
+        return;
+      }
+    }
+    m_state = address_state::cannot_claim;
+    m_address = null_address;
+    send_claim();
+  }
+
+  /// Called from the receive handler, possibly an interrupt
+  void enqueue(hal::can::message_t const& p_message)
+  {
+    auto const tail = m_queue_tail.load(std::memory_order_relaxed);
+    auto const head = m_queue_head.load(std::memory_order_acquire);
+    if (tail - head == receive_queue_size) {
+      m_dropped_frames.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    m_queue[tail % receive_queue_size] = p_message;
+    m_queue_tail.store(tail + 1, std::memory_order_release);
+  }
+
+  /// Called from `tick()`, processes every queued frame
+  void process_queue()
+  {
+    // Reschedule first so a throwing handler does not stop the queue
+    m_wheel->schedule(m_queue_timer, 1U, [this]() { process_queue(); });
+    auto head = m_queue_head.load(std::memory_order_relaxed);
+    while (head != m_queue_tail.load(std::memory_order_acquire)) {
+      auto const message = m_queue[head % receive_queue_size];
+      m_queue_head.store(++head, std::memory_order_release);
+      receive(message);
+    }
+  }
+
+  void receive(hal::can::message_t const& p_message)
+  {
+    if (p_message.is_remote_request || p_message.length > 8) {
+      return;
+    }
+    auto const id = parse_id(p_message.id);
+    auto const data = std::span(p_message.payload).first(p_message.length);
+    if (id.destination != global_address && id.destination != m_address) {
+      return;
+    }
+
+    switch (id.pgn) {
+      case pgn_address_claimed:
+        handle_claim(id.source, data);
+        break;
+      case pgn_transport_connection:
+        handle_connection(id, data);
+        break;
+      case pgn_transport_data:
+        handle_data(id, data);
+        break;
+      case pgn_request:
+        if (data.size() >= 3 && read_pgn(data) == pgn_address_claimed &&
+            m_state != address_state::idle) {
+          send_claim();
+        }
+        dispatch(id, data);
+        break;
+      default:
+        dispatch(id, data);
+        break;
+    }
+  }
+
+  static std::uint32_t read_pgn(std::span<hal::byte const> p_bytes)
+  {
+    return p_bytes[0] | (std::uint32_t{ p_bytes[1] } << 8) |
+           (std::uint32_t{ p_bytes[2] } << 16);
+  }
+
+  void dispatch(identifier const& p_id, std::span<hal::byte const> p_data)
+  {
+    message const received{
+      .pgn = p_id.pgn,
+      .priority = p_id.priority,
+      .source = p_id.source,
+      .destination = p_id.destination,
+      .data = p_data,
+    };
+    for (auto& entry : m_subscriptions.first(m_subscription_count)) {
+      if (entry.pgn == p_id.pgn) {
+        entry.on_message(received);
+      }
+    }
+  }
+
+  void handle_connection(identifier const& p_id,
+                         std::span<hal::byte const> p_data)
+  {
+    if (p_data.size() < 8) {
+      return;
+    }
+    auto const pgn = read_pgn(p_data.subspan(5));
+    auto const size = static_cast<std::uint16_t>(p_data[1] | p_data[2] << 8);
+
+    switch (p_data[0]) {
+      case bam:
+        if (p_id.destination == global_address) {
+          start_session(p_id, pgn, size, p_data[3], 0xFF);
+        }
+        break;
+      case request_to_send:
+        if (p_id.destination != global_address) {
+          start_session(p_id, pgn, size, p_data[3], p_data[4]);
+        }
+        break;
+      case clear_to_send:
+        if (transmitting_to(p_id.source, pgn)) {
+          handle_clear_to_send(p_data[1], p_data[2]);
+        }
+        break;
+      case end_of_message_ack:
+        if (transmitting_to(p_id.source, pgn)) {
+          m_wheel->cancel(m_transmit_timer);
+          m_transfer = transfer_state::complete;
+        }
+        break;
+      case connection_abort:
+        if (transmitting_to(p_id.source, pgn)) {
+          m_wheel->cancel(m_transmit_timer);
+          m_transfer = transfer_state::aborted;
+        }
+        if (auto* session = find_session(p_id.source, m_address)) {
+          release(*session);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  [[nodiscard]] bool transmitting_to(hal::byte p_source,
+                                     std::uint32_t p_pgn) const
+  {
+    return m_transfer == transfer_state::in_progress &&
+           m_transmit_destination != global_address &&
+           m_transmit_destination == p_source && m_transmit_pgn == p_pgn;
+  }
+
+  void handle_clear_to_send(std::uint8_t p_count, std::uint8_t p_next)
+  {
+    if (p_count == 0) {
+      // The receiver is holding the connection open
+      expect_response(t4);
+      return;
+    }
+    if (p_next == 0 || p_next > transmit_packets()) {
+      abort_transmit(abort_reason::bad_sequence);
+      return;
+    }
+    m_transmit_next = p_next;
+    m_transmit_window_end = static_cast<std::uint16_t>(
+      std::min<unsigned>(p_next + p_count - 1U, transmit_packets()));
+    m_wheel->schedule(m_transmit_timer, 1U, [this]() {
+      while (m_transmit_next <= m_transmit_window_end) {
+        send_data_packet(m_transmit_next++);
+      }
+      // The acknowledgement may already have arrived
+      if (m_transfer == transfer_state::in_progress) {
+        expect_response(t3);
+      }
+    });
+  }
+
+  void send_bam_packet()
+  {
+    send_data_packet(m_transmit_next++);
+    if (m_transmit_next > transmit_packets()) {
+      m_transfer = transfer_state::complete;
+      return;
+    }
+    m_wheel->schedule(
+      m_transmit_timer, bam_packet_interval, [this]() { send_bam_packet(); });
+  }
+
+  void expect_response(hal::time_duration p_timeout)
+  {
+    m_wheel->schedule(m_transmit_timer, p_timeout, [this]() {
+      abort_transmit(abort_reason::timeout);
+    });
+  }
+
+  void abort_transmit(abort_reason p_reason)
+  {
+    m_wheel->cancel(m_transmit_timer);
+    send_abort(m_transmit_destination, p_reason, m_transmit_pgn);
+    m_transfer = transfer_state::aborted;
+  }
+
+  receive_session* find_session(hal::byte p_source, hal::byte p_destination)
+  {
+    for (auto& session : m_sessions) {
+      if (session.m_active && session.m_source == p_source &&
+          session.m_destination == p_destination) {
+        return &session;
+      }
+    }
+    return nullptr;
+  }
+
+  void start_session(identifier const& p_id,
+                     std::uint32_t p_pgn,
+                     std::uint16_t p_size,
+                     std::uint8_t p_packets,
+                     std::uint8_t p_window)
+  {
+    auto const broadcast = p_id.destination == global_address;
+    if (p_size <= 8 || p_size > max_transport_size ||
+        p_packets != packets_for(p_size)) {
+      if (not broadcast) {
+        send_abort(p_id.source, abort_reason::message_too_large, p_pgn);
+      }
+      return;
+    }
+
+    auto* session = find_session(p_id.source, p_id.destination);
+    if (session == nullptr) {
+      auto const free = std::ranges::find_if(
+        m_sessions, [](receive_session const& p_session) {
+          return not p_session.m_active;
+        });
+      if (free == m_sessions.end()) {
+        if (not broadcast) {
+          send_abort(p_id.source, abort_reason::already_in_session, p_pgn);
+        }
+        return;
+      }
+      session = &*free;
+    }
+
+    session->m_active = true;
+    session->m_pgn = p_pgn;
+    session->m_size = p_size;
+    session->m_packets = p_packets;
+    session->m_next_sequence = 1;
+    session->m_source = p_id.source;
+    session->m_destination = p_id.destination;
+    session->m_window = p_window;
+
+    if (broadcast) {
+      expect_data(*session, t1);
+    } else {
+      send_clear_to_send(*session);
+    }
+  }
+
+  void send_clear_to_send(receive_session& p_session)
+  {
+    auto const remaining = p_session.m_packets - p_session.m_next_sequence + 1;
+    // Never grant more packets than the receive queue holds between ticks
+    auto const count = static_cast<std::uint8_t>(std::min<int>(
+      { remaining, p_session.m_window, int{ receive_queue_size } }));
+    p_session.m_window_end =
+      static_cast<std::uint16_t>(p_session.m_next_sequence + count - 1);
+    send_connection(
+      p_session.m_source,
+      { clear_to_send,
+        count,
+        static_cast<hal::byte>(p_session.m_next_sequence),
+        0xFF,
+        0xFF },
+      p_session.m_pgn);
+    expect_data(p_session, t2);
+  }
+
+  void expect_data(receive_session& p_session, hal::time_duration p_timeout)
+  {
+    m_wheel->schedule(p_session.m_timeout, p_timeout, [this, &p_session]() {
+      if (p_session.m_destination != global_address) {
+        send_abort(
+          p_session.m_source, abort_reason::timeout, p_session.m_pgn);
+      }
+      release(p_session);
+    });
+  }
+
+  void release(receive_session& p_session)
+  {
+    m_wheel->cancel(p_session.m_timeout);
+    p_session.m_active = false;
+  }
+
+  void handle_data(identifier const& p_id, std::span<hal::byte const> p_data)
+  {
+    auto* session = find_session(p_id.source, p_id.destination);
+    if (session == nullptr || p_data.empty()) {
+      return;
+    }
+    auto const broadcast = p_id.destination == global_address;
+    if (p_data[0] != session->m_next_sequence) {
+      if (not broadcast) {
+        send_abort(p_id.source, abort_reason::bad_sequence, session->m_pgn);
+      }
+      release(*session);
+      return;
+    }
+
+    auto const offset = std::size_t{ p_data[0] - 1U } * 7;
+    auto const count = std::min<std::size_t>(
+      { 7, p_data.size() - 1, session->m_size - offset });
+    std::copy_n(
+      p_data.begin() + 1, count, session->m_buffer.begin() + offset);
+    session->m_next_sequence++;
+
+    if (session->m_next_sequence > session->m_packets) {
+      if (not broadcast) {
+        send_connection(p_id.source,
+                        { end_of_message_ack,
+                          static_cast<hal::byte>(session->m_size),
+                          static_cast<hal::byte>(session->m_size >> 8),
+                          session->m_packets,
+                          0xFF },
+                        session->m_pgn);
+      }
+      release(*session);
+      dispatch({ .priority = p_id.priority,
+                 .pgn = session->m_pgn,
+                 .destination = p_id.destination,
+                 .source = p_id.source },
+               std::span(session->m_buffer).first(session->m_size));
+    } else if (broadcast) {
+      expect_data(*session, t1);
+    } else if (session->m_next_sequence > session->m_window_end) {
+      send_clear_to_send(*session);
+    } else {
+      expect_data(*session, t2);
+    }
+  }
+
+  hal::can* m_can;
+  hal::timer_wheel* m_wheel;
+  std::span<receive_session> m_sessions;
+  std::span<subscription> m_subscriptions;
+  std::size_t m_subscription_count = 0;
+  std::uint64_t m_name;
+  hal::byte m_preferred_address;
+  hal::byte m_address;
+  address_state m_state = address_state::idle;
+  timer_wheel_entry m_claim_timer{};
+  timer_wheel_entry m_transmit_timer{};
+  std::array<hal::byte, max_transport_size> m_transmit{};
+  std::uint32_t m_transmit_pgn = 0;
+  std::uint16_t m_transmit_size = 0;
+  hal::byte m_transmit_destination = global_address;
+  std::uint16_t m_transmit_next = 1;
+  std::uint16_t m_transmit_window_end = 0;
+  transfer_state m_transfer = transfer_state::idle;
+  timer_wheel_entry m_queue_timer{};
+  std::array<hal::can::message_t, receive_queue_size> m_queue{};
+  std::atomic<std::uint32_t> m_queue_head = 0;
+  std::atomic<std::uint32_t> m_queue_tail = 0;
+  std::atomic<std::uint32_t> m_dropped_frames = 0;
+};
+}  // namespace hal::j1939
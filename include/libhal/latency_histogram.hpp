@@ -0,0 +1,495 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <span>
+
+#include "error.hpp"
+#include "i2c.hpp"
+#include "spi.hpp"
+#include "steady_clock.hpp"
+
+namespace hal {
+/**
+ * @brief Fixed memory log-linear histogram of latencies in steady_clock ticks
+ *
+ * Values below 2^precision_bits are counted exactly. Above that, each power of
+ * 2 range is split into 2^precision_bits equal buckets, bounding the relative
+ * error of any reported value to 1 / 2^precision_bits (6.25% for the default
+ * of 4) while covering the full 32-bit range of ticks in a few hundred
+ * buckets. Durations beyond 32-bits are clamped.
+ *
+ * Recording is lock-free and wait-free apart from the min/max updates, and may
+ * be done from interrupt service routines and multiple threads concurrently.
+ * Queries may run concurrently with recording and observe a consistent enough
+ * snapshot for monitoring purposes.
+ *
+ * @tparam precision_bits - number of bits of each value that are preserved
+ */
+template<std::size_t precision_bits = 4>
+class latency_histogram
+{
+public:
+  static_assert(precision_bits >= 1 && precision_bits <= 8,
+                "precision_bits must be between 1 and 8");
+
+  /// Buckets per power of 2 range
+  static constexpr std::size_t sub_buckets = std::size_t{ 1 } << precision_bits;
+  /// Total number of buckets
+  static constexpr std::size_t bucket_count =
+    sub_buckets + (32 - precision_bits) * sub_buckets;
+  /// Upper bound on the number of bytes written by `serialize()`
+  static constexpr std::size_t max_serialized_size =
+    2 + 5 * 2 + bucket_count * (2 + 5) + 2;
+
+  latency_histogram() = default;
+  latency_histogram(latency_histogram const&) = delete;
+  latency_histogram& operator=(latency_histogram const&) = delete;
+  latency_histogram(latency_histogram&&) = delete;
+  latency_histogram& operator=(latency_histogram&&) = delete;
+
+  /**
+   * @brief Count a single latency
+   *
+   * @param p_ticks - latency in steady_clock ticks
+   */
+  void record(std::uint64_t p_ticks)
+  {
+    constexpr std::uint64_t limit = std::numeric_limits<std::uint32_t>::max();
+    auto const value = static_cast<std::uint32_t>(std::min(p_ticks, limit));
+    m_buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    update_min(value);
+    update_max(value);
+  }
+
+  /**
+   * @brief Total number of recorded values
+   *
+   * @return std::uint64_t - count of values
+   */
+  [[nodiscard]] std::uint64_t count() const
+  {
+    std::uint64_t total = 0;
+    for (auto const& bucket : m_buckets) {
+      total += bucket.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  /**
+   * @brief Smallest recorded value
+   *
+   * @return std::uint32_t - exact smallest value, 0 if empty
+   */
+  [[nodiscard]] std::uint32_t min() const
+  {
+    auto const value = m_min.load(std::memory_order_relaxed);
+    return value == std::numeric_limits<std::uint32_t>::max() &&
+               m_max.load(std::memory_order_relaxed) == 0
+             ? 0
+             : value;
+  }
+
+  /**
+   * @brief Largest recorded value
+   *
+   * @return std::uint32_t - exact largest value, 0 if empty
+   */
+  [[nodiscard]] std::uint32_t max() const
+  {
+    return m_max.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Value at or below which a percentage of recorded values fall
+   *
+   * The upper bound of the bucket is returned, so the result never under
+   * reports a latency. The result is clamped to the recorded min and max.
+   *
+   * @param p_percentile - percentage between 0.0 and 100.0, such as 99.9
+   * @return std::uint32_t - latency in ticks, 0 if empty
+   * @throws hal::argument_out_of_domain - if p_percentile is not within 0.0
+   * and 100.0
+   */
+  [[nodiscard]] std::uint32_t percentile(float p_percentile)
+  {
+    if (not(p_percentile >= 0.0f && p_percentile <= 100.0f)) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    auto const total = count();
+    if (total == 0) {
+      return 0;
+    }
+    auto const exact = static_cast<double>(p_percentile) / 100.0 *
+                       static_cast<double>(total);
+    auto const target = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(std::ceil(exact)));
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < bucket_count; i++) {
+      cumulative += m_buckets[i].load(std::memory_order_relaxed);
+      if (cumulative >= target) {
+        return std::clamp(highest_equivalent(i), min(), max());
+      }
+    }
+    return max();
+  }
+
+  /**
+   * @brief Add all values of another histogram into this one
+   *
+   * @param p_other - histogram to merge from
+   */
+  void merge(latency_histogram const& p_other)
+  {
+    for (std::size_t i = 0; i < bucket_count; i++) {
+      auto const other = p_other.m_buckets[i].load(std::memory_order_relaxed);
+      if (other != 0) {
+        m_buckets[i].fetch_add(other, std::memory_order_relaxed);
+      }
+    }
+    if (p_other.count() != 0) {
+      update_min(p_other.m_min.load(std::memory_order_relaxed));
+      update_max(p_other.m_max.load(std::memory_order_relaxed));
+    }
+  }
+
+  /**
+   * @brief Discard all recorded values
+   *
+   */
+  void reset()
+  {
+    for (auto& bucket : m_buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    m_min.store(std::numeric_limits<std::uint32_t>::max(),
+                std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Encode the histogram into a compact binary form
+   *
+   * The encoding is a sequence of varints (unsigned LEB128): the format
+   * version, precision_bits, the min and the max, followed by a pair per
+   * non-empty bucket of the distance from the previous non-empty bucket and
+   * its count. A pair with a count of zero ends the list.
+   *
+   * @param p_buffer - destination, max_serialized_size always suffices
+   * @return std::span<hal::byte> - the portion of p_buffer written
+   * @throws hal::argument_out_of_domain - if p_buffer is too small
+   */
+  std::span<hal::byte> serialize(std::span<hal::byte> p_buffer)
+  {
+    std::size_t position = 0;
+    auto put = [&](std::uint64_t p_value) {
+      do {
+        if (position == p_buffer.size()) {
+          hal::safe_throw(hal::argument_out_of_domain(this));
+        }
+        auto encoded = static_cast<hal::byte>(p_value & 0x7F);
+        p_value >>= 7;
+        if (p_value != 0) {
+          encoded |= 0x80;
+        }
+        p_buffer[position++] = encoded;
+      } while (p_value != 0);
+    };
+
+    put(format_version);
+    put(precision_bits);
+    put(min());
+    put(max());
+    std::size_t previous = 0;
+    for (std::size_t i = 0; i < bucket_count; i++) {
+      auto const bucket_value = m_buckets[i].load(std::memory_order_relaxed);
+      if (bucket_value != 0) {
+        put(i - previous);
+        put(bucket_value);
+        previous = i;
+      }
+    }
+    // An empty bucket terminates the list
+    put(0);
+    put(0);
+    return p_buffer.first(position);
+  }
+
+  /**
+   * @brief Merge a histogram encoded by `serialize()` into this one
+   *
+   * @param p_data - encoded histogram
+   * @throws hal::io_error - if the data is malformed, truncated or was
+   * serialized with a different precision_bits.
+   */
+  void deserialize(std::span<hal::byte const> p_data)
+  {
+    std::size_t position = 0;
+    auto get = [&]() -> std::uint64_t {
+      std::uint64_t value = 0;
+      for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (position == p_data.size()) {
+          hal::safe_throw(hal::io_error(this));
+        }
+        auto const encoded = p_data[position++];
+        value |= static_cast<std::uint64_t>(encoded & 0x7F) << shift;
+        if ((encoded & 0x80) == 0) {
+          return value;
+        }
+      }
+      hal::safe_throw(hal::io_error(this));
+    };
+
+    if (get() != format_version || get() != precision_bits) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    auto const minimum = get();
+    auto const maximum = get();
+    bool empty = true;
+    std::size_t index = 0;
+    while (true) {
+      index += get();
+      auto const bucket_value = get();
+      if (bucket_value == 0) {
+        break;
+      }
+      if (index >= bucket_count) {
+        hal::safe_throw(hal::io_error(this));
+      }
+      m_buckets[index].fetch_add(static_cast<std::uint32_t>(bucket_value),
+                                 std::memory_order_relaxed);
+      empty = false;
+    }
+    if (not empty) {
+      update_min(static_cast<std::uint32_t>(minimum));
+      update_max(static_cast<std::uint32_t>(maximum));
+    }
+  }
+
+  /**
+   * @brief Bucket a value is counted in
+   *
+   * @param p_value - value in ticks
+   * @return std::size_t - bucket index
+   */
+  [[nodiscard]] static constexpr std::size_t bucket_index(
+    std::uint32_t p_value)
+  {
+    if (p_value < sub_buckets) {
+      return p_value;
+    }
+    auto const magnitude =
+      static_cast<std::size_t>(std::bit_width(p_value) - 1);
+    auto const shift = magnitude - precision_bits;
+    auto const sub_bucket = (p_value >> shift) - sub_buckets;
+    return sub_buckets + shift * sub_buckets + sub_bucket;
+  }
+
+  /**
+   * @brief Largest value that is counted in a bucket
+   *
+   * @param p_index - bucket index
+   * @return std::uint32_t - largest value of the bucket
+   */
+  [[nodiscard]] static constexpr std::uint32_t highest_equivalent(
+    std::size_t p_index)
+  {
+    if (p_index < sub_buckets) {
+      return static_cast<std::uint32_t>(p_index);
+    }
+    auto const shift = (p_index - sub_buckets) / sub_buckets;
+    auto const sub_bucket = (p_index - sub_buckets) % sub_buckets;
+    auto const lowest = static_cast<std::uint64_t>(sub_buckets + sub_bucket)
+                        << shift;
+    return static_cast<std::uint32_t>(lowest + (std::uint64_t{ 1 } << shift) -
+                                      1);
+  }
+
+private:
+  static constexpr std::uint8_t format_version = 1;
+
+  void update_min(std::uint32_t p_value)
+  {
+    auto current = m_min.load(std::memory_order_relaxed);
+    while (p_value < current &&
+           not m_min.compare_exchange_weak(
+             current, p_value, std::memory_order_relaxed)) {
+    }
+  }
+
+  void update_max(std::uint32_t p_value)
+  {
+    auto current = m_max.load(std::memory_order_relaxed);
+    while (p_value > current &&
+           not m_max.compare_exchange_weak(
+             current, p_value, std::memory_order_relaxed)) {
+    }
+  }
+
+  std::array<std::atomic<std::uint32_t>, bucket_count> m_buckets{};
+  std::atomic<std::uint32_t> m_min = std::numeric_limits<std::uint32_t>::max();
+  std::atomic<std::uint32_t> m_max = 0;
+};
+
+/**
+ * @brief Records the ticks elapsed during its lifetime into a histogram
+ *
+ * Useful for measuring ISR handlers and control loop iterations:
+ *
+ * ```C++
+ * void control_loop() {
+ *   hal::latency_scope scope(clock, loop_histogram);
+ *   // ...
+ * }
+ * ```
+ *
+ * @tparam precision_bits - precision of the histogram
+ */
+template<std::size_t precision_bits>
+class latency_scope
+{
+public:
+  /**
+   * @brief Start measuring
+   *
+   * @param p_clock - clock to measure with
+   * @param p_histogram - histogram to record into when destroyed
+   */
+  latency_scope(hal::steady_clock& p_clock,
+                latency_histogram<precision_bits>& p_histogram)
+    : m_clock(&p_clock)
+    , m_histogram(&p_histogram)
+    , m_start(p_clock.uptime())
+  {
+  }
+
+  latency_scope(latency_scope const&) = delete;
+  latency_scope& operator=(latency_scope const&) = delete;
+  latency_scope(latency_scope&&) = delete;
+  latency_scope& operator=(latency_scope&&) = delete;
+
+  ~latency_scope()
+  {
+    m_histogram->record(m_clock->uptime() - m_start);
+  }
+
+private:
+  hal::steady_clock* m_clock;
+  latency_histogram<precision_bits>* m_histogram;
+  std::uint64_t m_start;
+};
+
+/**
+ * @brief i2c decorator that records the latency of every transaction
+ *
+ * Failed transactions are recorded as well, as their latency is as relevant
+ * to the caller as that of successful ones.
+ *
+ * @tparam precision_bits - precision of the histogram
+ */
+template<std::size_t precision_bits>
+class timed_i2c : public hal::i2c
+{
+public:
+  /**
+   * @brief Construct a new timed i2c object
+   *
+   * @param p_i2c - i2c to forward calls to
+   * @param p_clock - clock to measure with
+   * @param p_histogram - histogram to record transaction latencies into
+   */
+  timed_i2c(hal::i2c& p_i2c,
+            hal::steady_clock& p_clock,
+            latency_histogram<precision_bits>& p_histogram)
+    : m_i2c(&p_i2c)
+    , m_clock(&p_clock)
+    , m_histogram(&p_histogram)
+  {
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    m_i2c->configure(p_settings);
+  }
+
+  void driver_transaction(
+    hal::byte p_address,
+    std::span<hal::byte const> p_data_out,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    latency_scope scope(*m_clock, *m_histogram);
+    m_i2c->transaction(p_address, p_data_out, p_data_in, p_timeout);
+  }
+
+  hal::i2c* m_i2c;
+  hal::steady_clock* m_clock;
+  latency_histogram<precision_bits>* m_histogram;
+};
+
+/**
+ * @brief spi decorator that records the latency of every transfer
+ *
+ * @tparam precision_bits - precision of the histogram
+ */
+template<std::size_t precision_bits>
+class timed_spi : public hal::spi
+{
+public:
+  /**
+   * @brief Construct a new timed spi object
+   *
+   * @param p_spi - spi to forward calls to
+   * @param p_clock - clock to measure with
+   * @param p_histogram - histogram to record transfer latencies into
+   */
+  timed_spi(hal::spi& p_spi,
+            hal::steady_clock& p_clock,
+            latency_histogram<precision_bits>& p_histogram)
+    : m_spi(&p_spi)
+    , m_clock(&p_clock)
+    , m_histogram(&p_histogram)
+  {
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    m_spi->configure(p_settings);
+  }
+
+  void driver_transfer(std::span<hal::byte const> p_data_out,
+                       std::span<hal::byte> p_data_in,
+                       hal::byte p_filler) override
+  {
+    latency_scope scope(*m_clock, *m_histogram);
+    m_spi->transfer(p_data_out, p_data_in, p_filler);
+  }
+
+  hal::spi* m_spi;
+  hal::steady_clock* m_clock;
+  latency_histogram<precision_bits>* m_histogram;
+};
+}  // namespace hal
@@ -0,0 +1,470 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <span>
+
+#include "serial.hpp"
+#include "units.hpp"
+
+namespace hal {
+/// Result of passing bytes through an LZSS encoder or decoder
+struct lzss_result
+{
+  /// Number of input bytes consumed
+  std::size_t consumed = 0;
+  /// The filled portion of the output buffer
+  std::span<hal::byte> output;
+};
+
+/**
+ * @brief Streaming LZSS compressor with a static window
+ *
+ * Produces the bit stream used by heatshrink: a 1 bit followed by 8 bits for a
+ * literal byte, or a 0 bit followed by `window_bits` of (offset - 1) and
+ * `lookahead_bits` of (count - 1) for a repeat of earlier bytes. Bits are
+ * packed most significant first.
+ *
+ * Unlike heatshrink, a stream never has to end to deliver its last bytes.
+ * `flush()` encodes every byte given so far and, if needed, pads to a byte
+ * boundary after a back reference with a count of 1, which the encoder never
+ * otherwise produces. The history is kept across flushes, so small messages
+ * flushed one at a time still compress against each other.
+ *
+ * All state, including the `2 * window_size` byte buffer, lives within the
+ * object. Matches are found by searching the whole window, so the time spent
+ * per input byte grows with the window size.
+ *
+ * @tparam window_bits - log2 of the window size, 4 to 15
+ * @tparam lookahead_bits - log2 of the longest repeat, 3 to 8 and less than
+ * window_bits
+ */
+template<std::size_t window_bits = 8, std::size_t lookahead_bits = 4>
+class lzss_encoder
+{
+public:
+  static_assert(window_bits >= 4 && window_bits <= 15);
+  static_assert(lookahead_bits >= 3 && lookahead_bits <= 8 &&
+                lookahead_bits < window_bits);
+
+  /// Number of earlier bytes a repeat can refer to
+  static constexpr std::size_t window_size = std::size_t{ 1 } << window_bits;
+  /// Longest repeat a single back reference can encode
+  static constexpr std::size_t lookahead_size = std::size_t{ 1 }
+                                                << lookahead_bits;
+
+  /**
+   * @brief Compress bytes
+   *
+   * Input is buffered internally. Output is produced once enough input has
+   * been buffered to search for the longest repeat, so fewer than
+   * `lookahead_size` of the most recent bytes may remain unencoded until more
+   * input arrives or `flush()` is called.
+   *
+   * @param p_input - bytes to compress
+   * @param p_output - buffer for compressed bytes
+   * @return lzss_result - input consumed and output produced. Call again with
+   * the unconsumed input once the output has been used.
+   */
+  lzss_result encode(std::span<hal::byte const> p_input,
+                     std::span<hal::byte> p_output)
+  {
+    std::size_t consumed = 0;
+    std::size_t produced = 0;
+    while (true) {
+      produced += drain(p_output.subspan(produced));
+      if (m_bit_count >= 8) {
+        break;
+      }
+      if (ready()) {
+        step();
+        continue;
+      }
+      slide();
+      auto const count =
+        std::min(p_input.size() - consumed, m_buffer.size() - m_end);
+      if (count == 0) {
+        break;
+      }
+      std::copy_n(p_input.begin() + consumed, count, m_buffer.begin() + m_end);
+      m_end += count;
+      consumed += count;
+    }
+    return { .consumed = consumed, .output = p_output.first(produced) };
+  }
+
+  /**
+   * @brief Compress every buffered byte and align the stream to a byte
+   *
+   * Call until it returns an empty span.
+   *
+   * @param p_output - buffer for compressed bytes
+   * @return std::span<hal::byte> - the filled portion of p_output
+   */
+  std::span<hal::byte> flush(std::span<hal::byte> p_output)
+  {
+    m_flushing = true;
+    std::size_t produced = 0;
+    while (true) {
+      produced += drain(p_output.subspan(produced));
+      if (m_bit_count >= 8) {
+        return p_output.first(produced);
+      }
+      if (not ready()) {
+        break;
+      }
+      step();
+    }
+
+    if (m_bit_count != 0) {
+      put_bits(0, 1 + window_bits + lookahead_bits);
+      auto const padding = (8 - m_bit_count % 8) % 8;
+      put_bits(0, padding);
+      produced += drain(p_output.subspan(produced));
+    }
+    if (m_bit_count == 0) {
+      m_flushing = false;
+    }
+    return p_output.first(produced);
+  }
+
+  /**
+   * @brief Discard buffered input and history to start a new stream
+   *
+   */
+  void reset()
+  {
+    m_start = 0;
+    m_end = 0;
+    m_bits = 0;
+    m_bit_count = 0;
+    m_flushing = false;
+  }
+
+private:
+  [[nodiscard]] bool ready() const
+  {
+    auto const buffered = m_end - m_start;
+    return m_flushing ? buffered != 0 : buffered >= lookahead_size;
+  }
+
+  void slide()
+  {
+    if (m_end != m_buffer.size() || m_start <= window_size) {
+      return;
+    }
+    auto const shift = m_start - window_size;
+    std::copy(m_buffer.begin() + shift, m_buffer.end(), m_buffer.begin());
+    m_start -= shift;
+    m_end -= shift;
+  }
+
+  void step()
+  {
+    auto const longest = std::min(lookahead_size, m_end - m_start);
+    auto const first = m_start > window_size ? m_start - window_size : 0;
+    std::size_t best_length = 0;
+    std::size_t best_offset = 0;
+    // Nearest candidates first, repeats may overlap the bytes being encoded
+    for (auto candidate = m_start; candidate-- > first;) {
+      std::size_t length = 0;
+      while (length < longest &&
+             m_buffer[candidate + length] == m_buffer[m_start + length]) {
+        length++;
+      }
+      if (length > best_length) {
+        best_length = length;
+        best_offset = m_start - candidate;
+        if (length == longest) {
+          break;
+        }
+      }
+    }
+
+    if (best_length >= 2) {
+      put_bits(0, 1);
+      put_bits(static_cast<std::uint32_t>(best_offset - 1), window_bits);
+      put_bits(static_cast<std::uint32_t>(best_length - 1), lookahead_bits);
+      m_start += best_length;
+    } else {
+      put_bits(0x100 | m_buffer[m_start], 9);
+      m_start++;
+    }
+  }
+
+  void put_bits(std::uint32_t p_value, std::size_t p_count)
+  {
+    // A flush adds its marker and padding on top of a token that did not fit
+    // in the output, which can exceed 32 bits
+    m_bits = (m_bits << p_count) | p_value;
+    m_bit_count += p_count;
+  }
+
+  std::size_t drain(std::span<hal::byte> p_output)
+  {
+    std::size_t count = 0;
+    while (m_bit_count >= 8 && count < p_output.size()) {
+      m_bit_count -= 8;
+      p_output[count++] = static_cast<hal::byte>(m_bits >> m_bit_count);
+    }
+    m_bits &= (std::uint64_t{ 1 } << m_bit_count) - 1;
+    return count;
+  }
+
+  std::array<hal::byte, 2 * window_size> m_buffer{};
+  std::size_t m_start = 0;
+  std::size_t m_end = 0;
+  std::uint64_t m_bits = 0;
+  std::size_t m_bit_count = 0;
+  bool m_flushing = false;
+};
+
+/**
+ * @brief Streaming LZSS decompressor for the output of hal::lzss_encoder
+ *
+ * The window_bits and lookahead_bits parameters must match the encoder. Only
+ * the `window_size` byte window is kept within the object.
+ *
+ * @tparam window_bits - log2 of the window size, 4 to 15
+ * @tparam lookahead_bits - log2 of the longest repeat, 3 to 8 and less than
+ * window_bits
+ */
+template<std::size_t window_bits = 8, std::size_t lookahead_bits = 4>
+class lzss_decoder
+{
+public:
+  static_assert(window_bits >= 4 && window_bits <= 15);
+  static_assert(lookahead_bits >= 3 && lookahead_bits <= 8 &&
+                lookahead_bits < window_bits);
+
+  /// Number of earlier bytes a repeat can refer to
+  static constexpr std::size_t window_size = std::size_t{ 1 } << window_bits;
+
+  /**
+   * @brief Decompress bytes
+   *
+   * Stops when either the input is consumed or the output is full. Partial
+   * codes are kept until the rest of their bits arrive.
+   *
+   * @param p_input - compressed bytes
+   * @param p_output - buffer for decompressed bytes
+   * @return lzss_result - input consumed and output produced. Call again with
+   * the unconsumed input once the output has been used.
+   */
+  lzss_result decode(std::span<hal::byte const> p_input,
+                     std::span<hal::byte> p_output)
+  {
+    std::size_t consumed = 0;
+    std::size_t produced = 0;
+    while (produced < p_output.size()) {
+      if (m_remaining != 0) {
+        emit(m_window[(m_head - m_offset) & window_mask],
+             p_output[produced++]);
+        m_remaining--;
+        continue;
+      }
+
+      auto const literal =
+        m_bit_count != 0 && ((m_bits >> (m_bit_count - 1)) & 1);
+      auto const needed = literal ? 9 : 1 + window_bits + lookahead_bits;
+      if (m_bit_count == 0 || m_bit_count < needed) {
+        if (consumed == p_input.size()) {
+          break;
+        }
+        m_bits = (m_bits << 8) | p_input[consumed++];
+        m_bit_count += 8;
+        continue;
+      }
+
+      if (literal) {
+        emit(static_cast<hal::byte>(take_bits(9)), p_output[produced++]);
+        continue;
+      }
+
+      take_bits(1);
+      auto const offset = take_bits(window_bits) + 1;
+      auto const count = take_bits(lookahead_bits) + 1;
+      if (count == 1) {
+        // Flush marker, the rest of the current byte is padding
+        m_bits = 0;
+        m_bit_count = 0;
+        continue;
+      }
+      m_offset = offset;
+      m_remaining = count;
+    }
+    return { .consumed = consumed, .output = p_output.first(produced) };
+  }
+
+  /**
+   * @brief Discard partial codes and history to start a new stream
+   *
+   */
+  void reset()
+  {
+    m_window.fill(0);
+    m_head = 0;
+    m_bits = 0;
+    m_bit_count = 0;
+    m_offset = 0;
+    m_remaining = 0;
+  }
+
+private:
+  static constexpr std::size_t window_mask = window_size - 1;
+
+  void emit(hal::byte p_value, hal::byte& p_output)
+  {
+    p_output = p_value;
+    m_window[m_head] = p_value;
+    m_head = (m_head + 1) & window_mask;
+  }
+
+  std::size_t take_bits(std::size_t p_count)
+  {
+    m_bit_count -= p_count;
+    auto const value = (m_bits >> m_bit_count) & ((1U << p_count) - 1);
+    m_bits &= (std::uint32_t{ 1 } << m_bit_count) - 1;
+    return value;
+  }
+
+  std::array<hal::byte, window_size> m_window{};
+  std::size_t m_head = 0;
+  std::uint32_t m_bits = 0;
+  std::size_t m_bit_count = 0;
+  std::size_t m_offset = 0;
+  std::size_t m_remaining = 0;
+};
+
+/**
+ * @brief Serial port that compresses writes and decompresses reads
+ *
+ * Sits between the application and a serial link with a peer using the same
+ * window_bits and lookahead_bits. Each write is compressed and flushed to the
+ * link before returning, so every write arrives without waiting for the next
+ * one, while still compressing against the history of earlier writes. Writes
+ * to the link are repeated until the link has accepted every compressed byte,
+ * since a lost byte would desynchronize the peer's decoder for good.
+ *
+ * Reads decompress whatever the link has received. `read_t::available` is
+ * the number of bytes decompressed by that read and `read_t::capacity` is
+ * the capacity of the link. Configuring the port configures the link.
+ * Flushing decompresses and discards everything received so far, keeping
+ * the decoder in step with the peer's encoder.
+ *
+ * @tparam window_bits - log2 of the window size, 4 to 15
+ * @tparam lookahead_bits - log2 of the longest repeat, 3 to 8 and less than
+ * window_bits
+ */
+template<std::size_t window_bits = 8, std::size_t lookahead_bits = 4>
+class lzss_serial : public hal::serial
+{
+public:
+  /**
+   * @brief Construct a new lzss serial object
+   *
+   * @param p_link - serial port carrying the compressed stream
+   */
+  lzss_serial(hal::serial& p_link)
+    : m_link(&p_link)
+  {
+  }
+
+  lzss_serial(lzss_serial const&) = delete;
+  lzss_serial& operator=(lzss_serial const&) = delete;
+  lzss_serial(lzss_serial&&) = delete;
+  lzss_serial& operator=(lzss_serial&&) = delete;
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    m_link->configure(p_settings);
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    auto remaining = p_data;
+    while (not remaining.empty()) {
+      auto const result = m_encoder.encode(remaining, m_scratch);
+      remaining = remaining.subspan(result.consumed);
+      write_link(result.output);
+    }
+    while (true) {
+      auto const output = m_encoder.flush(m_scratch);
+      if (output.empty()) {
+        break;
+      }
+      write_link(output);
+    }
+    return { .data = p_data };
+  }
+
+  void write_link(std::span<hal::byte const> p_compressed)
+  {
+    while (not p_compressed.empty()) {
+      auto const written = m_link->write(p_compressed).data.size();
+      p_compressed = p_compressed.subspan(written);
+    }
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    std::size_t produced = 0;
+    while (produced < p_data.size()) {
+      if (m_input_offset == m_input_length) {
+        auto const received = m_link->read(m_input);
+        m_capacity = received.capacity;
+        m_input_offset = 0;
+        m_input_length = received.data.size();
+        if (m_input_length == 0) {
+          break;
+        }
+      }
+      auto const result = m_decoder.decode(
+        std::span(m_input).first(m_input_length).subspan(m_input_offset),
+        p_data.subspan(produced));
+      m_input_offset += result.consumed;
+      produced += result.output.size();
+    }
+    return {
+      .data = p_data.first(produced),
+      .available = produced,
+      .capacity = m_capacity,
+    };
+  }
+
+  void driver_flush() override
+  {
+    std::array<hal::byte, 32> discard{};
+    while (driver_read(discard).data.size() == discard.size()) {
+      continue;
+    }
+  }
+
+  hal::serial* m_link;
+  lzss_encoder<window_bits, lookahead_bits> m_encoder{};
+  lzss_decoder<window_bits, lookahead_bits> m_decoder{};
+  std::array<hal::byte, 32> m_scratch{};
+  std::array<hal::byte, 32> m_input{};
+  std::size_t m_input_offset = 0;
+  std::size_t m_input_length = 0;
+  std::size_t m_capacity = 0;
+};
+}  // namespace hal
@@ -0,0 +1,1038 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <optional>
+#include <span>
+
+#include "crc.hpp"
+#include "error.hpp"
+#include "functional.hpp"
+#include "serial.hpp"
+#include "steady_clock.hpp"
+#include "timeout.hpp"
+#include "units.hpp"
+
+namespace hal::modbus {
+/// Largest Modbus RTU frame in bytes, including address and CRC
+inline constexpr std::size_t max_frame_size = 256;
+/// Largest number of registers read by a single request
+inline constexpr std::size_t max_read_registers = 125;
+/// Largest number of registers written by a single request
+inline constexpr std::size_t max_write_registers = 123;
+/// Address used to send a request to every slave without a response
+inline constexpr hal::byte broadcast_address = 0;
+
+/// Function codes supported by the master and slave
+enum class function_code : hal::byte
+{
+  read_holding_registers = 0x03,
+  read_input_registers = 0x04,
+  write_single_register = 0x06,
+  write_multiple_registers = 0x10,
+};
+
+/// Exception codes returned by a slave in place of a normal response
+enum class exception_code : hal::byte
+{
+  none = 0x00,
+  illegal_function = 0x01,
+  illegal_data_address = 0x02,
+  illegal_data_value = 0x03,
+  server_device_failure = 0x04,
+};
+
+namespace detail {
+constexpr std::uint16_t read_u16(std::span<hal::byte const> p_bytes)
+{
+  return static_cast<std::uint16_t>((p_bytes[0] << 8) | p_bytes[1]);
+}
+
+constexpr void write_u16(std::span<hal::byte> p_bytes, std::uint16_t p_value)
+{
+  p_bytes[0] = static_cast<hal::byte>(p_value >> 8);
+  p_bytes[1] = static_cast<hal::byte>(p_value);
+}
+
+/// Write a whole frame, as a partly written frame would reach the bus with a
+/// bad CRC
+inline void write_frame(hal::serial& p_serial,
+                        std::span<hal::byte const> p_frame)
+{
+  while (not p_frame.empty()) {
+    p_frame = p_frame.subspan(p_serial.write(p_frame).data.size());
+  }
+}
+}  // namespace detail
+
+/**
+ * @brief Compute the Modbus CRC-16 of a sequence of bytes
+ *
+ * Uses a single 256 entry table, processing one byte per lookup. Modbus
+ * frames are at most 256 bytes, too short to benefit from larger tables.
+ *
+ * @param p_data - bytes to compute the CRC over
+ * @return constexpr std::uint16_t - CRC, transmitted low byte first
+ */
+constexpr std::uint16_t crc16(std::span<hal::byte const> p_data)
+{
+  return crc16_modbus<1>::compute(p_data);
+}
+
+/**
+ * @brief Silent interval marking the end of a frame
+ *
+ * 3.5 character times of 11 bits each, fixed at 1.75ms above 19200 baud as
+ * required by the Modbus serial line specification.
+ *
+ * @param p_baud_rate - baud rate of the serial port
+ * @return constexpr float - gap in seconds
+ */
+constexpr float frame_gap(hertz p_baud_rate)
+{
+  if (p_baud_rate > 19200.0f) {
+    return 0.00175f;
+  }
+  return 3.5f * 11.0f / p_baud_rate;
+}
+
+/**
+ * @brief Zero copy view of a received frame
+ *
+ * Refers directly to the bytes read from the serial port. Only valid until
+ * the receiver that produced it is polled again.
+ */
+class frame_view
+{
+public:
+  /**
+   * @brief Validate and view a frame
+   *
+   * @param p_frame - bytes from the address through to the CRC
+   * @return std::optional<frame_view> - the frame, or std::nullopt if the
+   * frame is too short or its CRC does not match
+   */
+  static std::optional<frame_view> parse(std::span<hal::byte const> p_frame)
+  {
+    if (p_frame.size() < 4) {
+      return std::nullopt;
+    }
+    auto const body = p_frame.first(p_frame.size() - 2);
+    auto const received = static_cast<std::uint16_t>(
+      p_frame[p_frame.size() - 2] | (p_frame[p_frame.size() - 1] << 8));
+    if (crc16(body) != received) {
+      return std::nullopt;
+    }
+    return frame_view(body);
+  }
+
+  /// Slave address of the frame
+  [[nodiscard]] hal::byte address() const
+  {
+    return m_body[0];
+  }
+
+  /// Function code of the frame, without the exception flag
+  [[nodiscard]] hal::byte function() const
+  {
+    return m_body[1] & 0x7F;
+  }
+
+  /// True if the frame is an exception response
+  [[nodiscard]] bool is_exception() const
+  {
+    return (m_body[1] & 0x80) != 0;
+  }
+
+  /// Exception code of an exception response
+  [[nodiscard]] exception_code exception() const
+  {
+    if (not is_exception() || m_body.size() < 3) {
+      return exception_code::none;
+    }
+    return static_cast<exception_code>(m_body[2]);
+  }
+
+  /// Bytes following the function code, excluding the CRC
+  [[nodiscard]] std::span<hal::byte const> data() const
+  {
+    return m_body.subspan(2);
+  }
+
+private:
+  explicit frame_view(std::span<hal::byte const> p_body)
+    : m_body(p_body)
+  {
+  }
+
+  std::span<hal::byte const> m_body;
+};
+
+/**
+ * @brief Splits bytes received from a serial port into frames by silence
+ *
+ * Bytes are read directly into the receive buffer and returned as a
+ * frame_view once the line has been silent for the frame gap, as measured by
+ * the steady clock. `poll()` must be called more often than the frame gap for
+ * back to back frames to be separated.
+ */
+class frame_receiver
+{
+public:
+  /**
+   * @brief Construct a new frame receiver object
+   *
+   * @param p_serial - serial port frames are received on
+   * @param p_clock - clock used to measure the silence between frames
+   * @param p_baud_rate - baud rate of p_serial
+   * @param p_buffer - receive buffer, at least max_frame_size bytes
+   * @throws hal::argument_out_of_domain - if p_buffer is too small
+   */
+  frame_receiver(hal::serial& p_serial,
+                 hal::steady_clock& p_clock,
+                 hertz p_baud_rate,
+                 std::span<hal::byte> p_buffer)
+    : m_serial(&p_serial)
+    , m_clock(&p_clock)
+    , m_buffer(p_buffer)
+    , m_gap_ticks(static_cast<std::uint64_t>(frame_gap(p_baud_rate) *
+                                             p_clock.frequency()) +
+                  1)
+  {
+    if (p_buffer.size() < max_frame_size) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+  }
+
+  /**
+   * @brief Read pending bytes and return a frame once it is complete
+   *
+   * Frames with an invalid CRC or that overflow the buffer are discarded and
+   * counted in `errors()`.
+   *
+   * @return std::optional<frame_view> - a complete frame, if one has ended
+   */
+  std::optional<frame_view> poll()
+  {
+    if (m_complete) {
+      m_length = 0;
+      m_complete = false;
+    }
+
+    auto const now = m_clock->uptime();
+    // Check for the end of the frame before reading so bytes of the next
+    // frame remain in the serial port's buffer.
+    if (m_length != 0 && now - m_last_byte >= m_gap_ticks) {
+      auto const frame = std::span<hal::byte const>(m_buffer).first(m_length);
+      auto const overflowed = m_overflowed;
+      m_complete = true;
+      m_overflowed = false;
+      auto view = frame_view::parse(frame);
+      if (overflowed || not view) {
+        m_errors++;
+        return std::nullopt;
+      }
+      return view;
+    }
+
+    auto const received = m_serial->read(m_buffer.subspan(m_length)).data;
+    if (not received.empty()) {
+      m_length += received.size();
+      m_last_byte = now;
+      if (m_length == m_buffer.size()) {
+        // Keep receiving into the last byte until the line goes quiet
+        m_length--;
+        m_overflowed = true;
+      }
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * @brief Discard received bytes and check that the line has gone quiet
+   *
+   * Bytes not yet returned as a frame, such as the start or the rest of a
+   * late response to an abandoned request, are read and discarded so they
+   * cannot run into the next frame.
+   *
+   * @param p_since - steady clock uptime of the end of the last transmission
+   * @return true - the line has been silent for the frame gap since p_since
+   * and since the last received byte
+   */
+  bool discard_until_idle(std::uint64_t p_since)
+  {
+    auto const now = m_clock->uptime();
+    while (true) {
+      auto const received = m_serial->read(m_buffer).data;
+      if (not received.empty()) {
+        m_last_byte = now;
+      }
+      if (received.size() < m_buffer.size()) {
+        break;
+      }
+    }
+    m_length = 0;
+    m_complete = false;
+    m_overflowed = false;
+    return now - std::max(p_since, m_last_byte) >= m_gap_ticks;
+  }
+
+  /**
+   * @brief Ticks of silence marking the end of a frame
+   *
+   * @return std::uint64_t - the frame gap in steady clock ticks
+   */
+  [[nodiscard]] std::uint64_t gap_ticks() const
+  {
+    return m_gap_ticks;
+  }
+
+  /**
+   * @brief Steady clock uptime when the most recent byte was read
+   *
+   * @return std::uint64_t - uptime in ticks
+   */
+  [[nodiscard]] std::uint64_t last_byte() const
+  {
+    return m_last_byte;
+  }
+
+  /**
+   * @brief Number of frames discarded due to CRC errors or overflow
+   *
+   * @return std::uint32_t - discarded frame count
+   */
+  [[nodiscard]] std::uint32_t errors() const
+  {
+    return m_errors;
+  }
+
+private:
+  hal::serial* m_serial;
+  hal::steady_clock* m_clock;
+  std::span<hal::byte> m_buffer;
+  std::uint64_t m_gap_ticks;
+  std::uint64_t m_last_byte = 0;
+  std::size_t m_length = 0;
+  std::uint32_t m_errors = 0;
+  bool m_complete = false;
+  bool m_overflowed = false;
+};
+
+/**
+ * @brief Encode a read registers request
+ *
+ * @param p_slave - slave address
+ * @param p_function - read_holding_registers or read_input_registers
+ * @param p_address - first register address
+ * @param p_count - number of registers, 1 to max_read_registers
+ * @return std::array<hal::byte, 8> - the complete request frame
+ */
+constexpr std::array<hal::byte, 8> make_read_request(hal::byte p_slave,
+                                                     function_code p_function,
+                                                     std::uint16_t p_address,
+                                                     std::uint16_t p_count)
+{
+  std::array<hal::byte, 8> frame{};
+  frame[0] = p_slave;
+  frame[1] = static_cast<hal::byte>(p_function);
+  detail::write_u16(std::span(frame).subspan(2, 2), p_address);
+  detail::write_u16(std::span(frame).subspan(4, 2), p_count);
+  auto const crc = crc16(std::span(frame).first(6));
+  frame[6] = static_cast<hal::byte>(crc);
+  frame[7] = static_cast<hal::byte>(crc >> 8);
+  return frame;
+}
+
+/**
+ * @brief Modbus RTU master
+ *
+ * Performs one request at a time, blocking until the response arrives or the
+ * timeout expires. Use hal::modbus::poller to cycle through many slaves
+ * without blocking.
+ *
+ * Exception responses are reported as exceptions:
+ *
+ * - illegal_function: hal::operation_not_supported
+ * - illegal_data_address and illegal_data_value: hal::argument_out_of_domain
+ * - anything else: hal::io_error
+ *
+ * The exception code itself is available from `last_exception()`.
+ */
+class master
+{
+public:
+  /**
+   * @brief Construct a new master object
+   *
+   * @param p_serial - serial port connected to the bus
+   * @param p_clock - clock used to measure frame gaps
+   * @param p_baud_rate - baud rate of p_serial
+   * @param p_buffer - receive buffer, at least max_frame_size bytes
+   * @throws hal::argument_out_of_domain - if p_buffer is too small
+   */
+  master(hal::serial& p_serial,
+         hal::steady_clock& p_clock,
+         hertz p_baud_rate,
+         std::span<hal::byte> p_buffer)
+    : m_serial(&p_serial)
+    , m_clock(&p_clock)
+    , m_receiver(p_serial, p_clock, p_baud_rate, p_buffer)
+  {
+  }
+
+  master(master const&) = delete;
+  master& operator=(master const&) = delete;
+  master(master&&) = delete;
+  master& operator=(master&&) = delete;
+
+  /**
+   * @brief Read holding registers from a slave
+   *
+   * @param p_slave - slave address
+   * @param p_address - first register address
+   * @param p_registers - destination, 1 to max_read_registers in length
+   * @param p_timeout - called while waiting for the response
+   * @throws hal::argument_out_of_domain - if p_registers has an invalid length
+   * @throws hal::io_error - if the response is malformed
+   */
+  void read_holding_registers(hal::byte p_slave,
+                              std::uint16_t p_address,
+                              std::span<std::uint16_t> p_registers,
+                              hal::timeout auto p_timeout)
+  {
+    read_registers(p_slave,
+                   function_code::read_holding_registers,
+                   p_address,
+                   p_registers,
+                   p_timeout);
+  }
+
+  /**
+   * @brief Read input registers from a slave
+   *
+   * @param p_slave - slave address
+   * @param p_address - first register address
+   * @param p_registers - destination, 1 to max_read_registers in length
+   * @param p_timeout - called while waiting for the response
+   * @throws hal::argument_out_of_domain - if p_registers has an invalid length
+   * @throws hal::io_error - if the response is malformed
+   */
+  void read_input_registers(hal::byte p_slave,
+                            std::uint16_t p_address,
+                            std::span<std::uint16_t> p_registers,
+                            hal::timeout auto p_timeout)
+  {
+    read_registers(p_slave,
+                   function_code::read_input_registers,
+                   p_address,
+                   p_registers,
+                   p_timeout);
+  }
+
+  /**
+   * @brief Write a single holding register
+   *
+   * Broadcast writes return once the request has been sent.
+   *
+   * @param p_slave - slave address, or broadcast_address
+   * @param p_address - register address
+   * @param p_value - value to write
+   * @param p_timeout - called while waiting for the response
+   * @throws hal::io_error - if the response is malformed
+   */
+  void write_single_register(hal::byte p_slave,
+                             std::uint16_t p_address,
+                             std::uint16_t p_value,
+                             hal::timeout auto p_timeout)
+  {
+    std::array<hal::byte, 8> request{};
+    request[0] = p_slave;
+    request[1] = static_cast<hal::byte>(function_code::write_single_register);
+    detail::write_u16(std::span(request).subspan(2, 2), p_address);
+    detail::write_u16(std::span(request).subspan(4, 2), p_value);
+    auto const response = transact(request, 4, p_timeout);
+    if (response && not std::ranges::equal(response->data(),
+                                           std::span(request).subspan(2, 4))) {
+      hal::safe_throw(hal::io_error(this));
+    }
+  }
+
+  /**
+   * @brief Write consecutive holding registers
+   *
+   * Broadcast writes return once the request has been sent.
+   *
+   * @param p_slave - slave address, or broadcast_address
+   * @param p_address - first register address
+   * @param p_registers - values, 1 to max_write_registers in length
+   * @param p_timeout - called while waiting for the response
+   * @throws hal::argument_out_of_domain - if p_registers has an invalid length
+   * @throws hal::io_error - if the response is malformed
+   */
+  void write_multiple_registers(hal::byte p_slave,
+                                std::uint16_t p_address,
+                                std::span<std::uint16_t const> p_registers,
+                                hal::timeout auto p_timeout)
+  {
+    if (p_registers.empty() || p_registers.size() > max_write_registers) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    std::array<hal::byte, max_frame_size> request{};
+    request[0] = p_slave;
+    request[1] =
+      static_cast<hal::byte>(function_code::write_multiple_registers);
+    detail::write_u16(std::span(request).subspan(2, 2), p_address);
+    detail::write_u16(std::span(request).subspan(4, 2),
+                      static_cast<std::uint16_t>(p_registers.size()));
+    request[6] = static_cast<hal::byte>(p_registers.size() * 2);
+    for (std::size_t i = 0; i < p_registers.size(); i++) {
+      detail::write_u16(std::span(request).subspan(7 + i * 2, 2),
+                        p_registers[i]);
+    }
+    auto const length = 7 + p_registers.size() * 2 + 2;
+    auto const response =
+      transact(std::span(request).first(length), 4, p_timeout);
+    if (response && not std::ranges::equal(response->data(),
+                                           std::span(request).subspan(2, 4))) {
+      hal::safe_throw(hal::io_error(this));
+    }
+  }
+
+  /**
+   * @brief Discard stray bytes and check whether a request may be sent
+   *
+   * Requests may only be sent once the line has been silent for the frame gap
+   * since both the previous request and the last received byte. Bytes
+   * received meanwhile, such as a late response to a request that timed out
+   * or to a broadcast, are discarded so they cannot corrupt the next
+   * response.
+   *
+   * @return true - the line is idle and `send()` may be called
+   */
+  bool line_idle()
+  {
+    return m_receiver.discard_until_idle(m_sent_at);
+  }
+
+  /**
+   * @brief Send a complete request frame without waiting for the response
+   *
+   * Must only be called once `line_idle()` returns true. Returns once the
+   * serial port has accepted the whole frame.
+   *
+   * @param p_frame - request including its CRC
+   */
+  void send(std::span<hal::byte const> p_frame)
+  {
+    detail::write_frame(*m_serial, p_frame);
+    m_sent_at = m_clock->uptime();
+  }
+
+  /**
+   * @brief Poll for the next received frame without blocking
+   *
+   * @return std::optional<frame_view> - a complete frame, if one has ended
+   */
+  std::optional<frame_view> receive()
+  {
+    return m_receiver.poll();
+  }
+
+  /**
+   * @brief Steady clock ticks since the most recent request was sent
+   *
+   * @return std::uint64_t - elapsed ticks
+   */
+  [[nodiscard]] std::uint64_t since_sent()
+  {
+    return m_clock->uptime() - m_sent_at;
+  }
+
+  /**
+   * @brief Frequency of the steady clock used by the master
+   *
+   * @return hertz - steady clock frequency
+   */
+  [[nodiscard]] hertz clock_frequency()
+  {
+    return m_clock->frequency();
+  }
+
+  /**
+   * @brief Exception code of the most recent exception response
+   *
+   * @return exception_code - the code, or none if the last request succeeded
+   */
+  [[nodiscard]] exception_code last_exception() const
+  {
+    return m_last_exception;
+  }
+
+  /**
+   * @brief Raise the hal exception for an exception response
+   *
+   * @param p_code - exception code of the response
+   */
+  void throw_exception(exception_code p_code)
+  {
+    m_last_exception = p_code;
+    switch (p_code) {
+      case exception_code::illegal_function:
+        hal::safe_throw(hal::operation_not_supported(this));
+        break;
+      case exception_code::illegal_data_address:
+      case exception_code::illegal_data_value:
+        hal::safe_throw(hal::argument_out_of_domain(this));
+        break;
+      default:
+        hal::safe_throw(hal::io_error(this));
+        break;
+    }
+  }
+
+private:
+  void read_registers(hal::byte p_slave,
+                      function_code p_function,
+                      std::uint16_t p_address,
+                      std::span<std::uint16_t> p_registers,
+                      hal::timeout auto p_timeout)
+  {
+    if (p_registers.empty() || p_registers.size() > max_read_registers) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    auto request = make_read_request(
+      p_slave,
+      p_function,
+      p_address,
+      static_cast<std::uint16_t>(p_registers.size()));
+    auto const response = transact(request, 0, p_timeout);
+    if (not response) {
+      return;
+    }
+    auto const data = response->data();
+    if (data.size() != 1 + p_registers.size() * 2 ||
+        data[0] != p_registers.size() * 2) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    for (std::size_t i = 0; i < p_registers.size(); i++) {
+      p_registers[i] = detail::read_u16(data.subspan(1 + i * 2, 2));
+    }
+  }
+
+  /// Append the CRC, send the request and wait for the matching response.
+  /// Returns nullopt for broadcasts.
+  std::optional<frame_view> transact(std::span<hal::byte> p_request,
+                                     std::size_t p_expected_data,
+                                     hal::timeout auto p_timeout)
+  {
+    auto const body = p_request.first(p_request.size() - 2);
+    auto const crc = crc16(body);
+    p_request[p_request.size() - 2] = static_cast<hal::byte>(crc);
+    p_request[p_request.size() - 1] = static_cast<hal::byte>(crc >> 8);
+    m_last_exception = exception_code::none;
+    while (not line_idle()) {
+      p_timeout();
+    }
+    send(p_request);
+    if (p_request[0] == broadcast_address) {
+      return std::nullopt;
+    }
+
+    while (true) {
+      auto const response = receive();
+      if (response && response->address() == p_request[0] &&
+          response->function() == p_request[1]) {
+        if (response->is_exception()) {
+          throw_exception(response->exception());
+        }
+        if (p_expected_data != 0 &&
+            response->data().size() != p_expected_data) {
+          hal::safe_throw(hal::io_error(this));
+        }
+        return response;
+      }
+      p_timeout();
+    }
+  }
+
+  hal::serial* m_serial;
+  hal::steady_clock* m_clock;
+  frame_receiver m_receiver;
+  std::uint64_t m_sent_at = 0;
+  exception_code m_last_exception = exception_code::none;
+};
+
+/// A read request cycled through by hal::modbus::poller
+struct poll_request
+{
+  /// Slave address to poll
+  hal::byte slave = 1;
+  /// read_holding_registers or read_input_registers
+  function_code function = function_code::read_holding_registers;
+  /// First register address
+  std::uint16_t address = 0;
+  /// Destination of the registers, 1 to max_read_registers in length
+  std::span<std::uint16_t> registers{};
+  /// Number of successful responses
+  std::uint32_t responses = 0;
+  /// Number of requests without a valid response before the timeout
+  std::uint32_t timeouts = 0;
+  /// Exception code of the most recent response
+  exception_code exception = exception_code::none;
+  /// Encoded request, filled in by the poller
+  std::array<hal::byte, 8> frame{};
+};
+
+/**
+ * @brief Non-blocking cyclic poller of many slaves
+ *
+ * Requests are encoded once at construction. Each call to `poll()` advances
+ * a state machine: as soon as a response is recognized, it is decoded
+ * directly into the destination registers and the next request is sent as
+ * soon as the line is idle, keeping the bus as busy as the protocol allows
+ * while the caller is free to do other work between polls. After a timeout,
+ * the next request waits until any late response has ended.
+ */
+class poller
+{
+public:
+  /**
+   * @brief Construct a new poller object
+   *
+   * @param p_master - master used to send and receive frames
+   * @param p_requests - requests to cycle through, in order
+   * @param p_timeout - time to wait for each response
+   * @throws hal::argument_out_of_domain - if p_requests is empty or a request
+   * has an invalid number of registers
+   */
+  poller(master& p_master,
+         std::span<poll_request> p_requests,
+         hal::time_duration p_timeout)
+    : m_master(&p_master)
+    , m_requests(p_requests)
+    , m_timeout_ticks(static_cast<std::uint64_t>(
+        std::chrono::duration<float>(p_timeout).count() *
+        p_master.clock_frequency()))
+  {
+    if (p_requests.empty()) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    for (auto& request : m_requests) {
+      if (request.registers.empty() ||
+          request.registers.size() > max_read_registers) {
+        hal::safe_throw(hal::argument_out_of_domain(this));
+      }
+      request.frame = make_read_request(
+        request.slave,
+        request.function,
+        request.address,
+        static_cast<std::uint16_t>(request.registers.size()));
+    }
+  }
+
+  /**
+   * @brief Advance the polling cycle without blocking
+   *
+   */
+  void poll()
+  {
+    if (not m_waiting) {
+      // Wait out the frame gap, and any late response to the last request
+      if (not m_master->line_idle()) {
+        return;
+      }
+      m_master->send(m_requests[m_index].frame);
+      m_waiting = true;
+      return;
+    }
+
+    auto& request = m_requests[m_index];
+    auto const response = m_master->receive();
+    if (response && response->address() == request.slave &&
+        response->function() == static_cast<hal::byte>(request.function)) {
+      if (store(request, *response)) {
+        request.responses++;
+      } else {
+        request.timeouts++;
+      }
+      next();
+      return;
+    }
+
+    if (m_master->since_sent() > m_timeout_ticks) {
+      request.timeouts++;
+      next();
+    }
+  }
+
+  /**
+   * @brief Number of times every request has been sent
+   *
+   * @return std::uint32_t - completed cycles
+   */
+  [[nodiscard]] std::uint32_t cycles() const
+  {
+    return m_cycles;
+  }
+
+private:
+  static bool store(poll_request& p_request, frame_view const& p_response)
+  {
+    if (p_response.is_exception()) {
+      p_request.exception = p_response.exception();
+      return true;
+    }
+    auto const data = p_response.data();
+    auto const count = p_request.registers.size();
+    if (data.size() != 1 + count * 2 || data[0] != count * 2) {
+      return false;
+    }
+    for (std::size_t i = 0; i < count; i++) {
+      p_request.registers[i] = detail::read_u16(data.subspan(1 + i * 2, 2));
+    }
+    p_request.exception = exception_code::none;
+    return true;
+  }
+
+  void next()
+  {
+    m_waiting = false;
+    m_index++;
+    if (m_index == m_requests.size()) {
+      m_index = 0;
+      m_cycles++;
+    }
+  }
+
+  master* m_master;
+  std::span<poll_request> m_requests;
+  std::uint64_t m_timeout_ticks;
+  std::size_t m_index = 0;
+  std::uint32_t m_cycles = 0;
+  bool m_waiting = false;
+};
+
+/**
+ * @brief Modbus RTU slave serving register tables
+ *
+ * Serves read holding registers, read input registers, write single register
+ * and write multiple registers directly from caller owned register tables.
+ * Requests outside the tables receive illegal_data_address exception
+ * responses, unsupported functions receive illegal_function.
+ */
+class slave
+{
+public:
+  /// Called after registers have been written by a master with the first
+  /// address and number of registers written.
+  using write_handler = void(std::uint16_t p_address, std::uint16_t p_count);
+
+  /**
+   * @brief Construct a new slave object
+   *
+   * @param p_serial - serial port connected to the bus
+   * @param p_clock - clock used to measure frame gaps
+   * @param p_baud_rate - baud rate of p_serial
+   * @param p_buffer - receive buffer, at least max_frame_size bytes
+   * @param p_address - address of this slave, 1 to 247
+   * @param p_holding_registers - read and write registers starting at 0
+   * @param p_input_registers - read only registers starting at 0
+   * @throws hal::argument_out_of_domain - if p_buffer is too small or
+   * p_address is invalid
+   */
+  slave(hal::serial& p_serial,
+        hal::steady_clock& p_clock,
+        hertz p_baud_rate,
+        std::span<hal::byte> p_buffer,
+        hal::byte p_address,
+        std::span<std::uint16_t> p_holding_registers,
+        std::span<std::uint16_t const> p_input_registers)
+    : m_serial(&p_serial)
+    , m_receiver(p_serial, p_clock, p_baud_rate, p_buffer)
+    , m_holding(p_holding_registers)
+    , m_input(p_input_registers)
+    , m_address(p_address)
+  {
+    if (p_address == broadcast_address || p_address > 247) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+  }
+
+  slave(slave const&) = delete;
+  slave& operator=(slave const&) = delete;
+  slave(slave&&) = delete;
+  slave& operator=(slave&&) = delete;
+
+  /**
+   * @brief Set the handler called after registers are written
+   *
+   * @param p_handler - write handler
+   */
+  void on_write(hal::callback<write_handler> p_handler)
+  {
+    m_on_write = p_handler;
+  }
+
+  /**
+   * @brief Receive and respond to requests without blocking
+   *
+   * @return true - a request addressed to this slave was handled
+   */
+  bool poll()
+  {
+    auto const request = m_receiver.poll();
+    if (not request || (request->address() != m_address &&
+                        request->address() != broadcast_address)) {
+      return false;
+    }
+
+    auto const exception = handle(*request);
+    if (request->address() == broadcast_address) {
+      return true;
+    }
+    if (exception != exception_code::none) {
+      m_response[1] = static_cast<hal::byte>(request->function() | 0x80);
+      m_response[2] = static_cast<hal::byte>(exception);
+      m_response_length = 3;
+    }
+    m_response[0] = m_address;
+    auto const crc = crc16(std::span(m_response).first(m_response_length));
+    m_response[m_response_length++] = static_cast<hal::byte>(crc);
+    m_response[m_response_length++] = static_cast<hal::byte>(crc >> 8);
+    detail::write_frame(*m_serial,
+                        std::span(m_response).first(m_response_length));
+    m_requests++;
+    return true;
+  }
+
+  /**
+   * @brief Number of requests responded to
+   *
+   * @return std::uint32_t - request count
+   */
+  [[nodiscard]] std::uint32_t requests() const
+  {
+    return m_requests;
+  }
+
+  /**
+   * @brief Number of frames discarded due to CRC errors or overflow
+   *
+   * @return std::uint32_t - discarded frame count
+   */
+  [[nodiscard]] std::uint32_t errors() const
+  {
+    return m_receiver.errors();
+  }
+
+private:
+  exception_code handle(frame_view const& p_request)
+  {
+    auto const data = p_request.data();
+    m_response[1] = p_request.function();
+    switch (static_cast<function_code>(p_request.function())) {
+      case function_code::read_holding_registers:
+        return read(data, m_holding);
+      case function_code::read_input_registers:
+        return read(data, m_input);
+      case function_code::write_single_register:
+        return write_single(data);
+      case function_code::write_multiple_registers:
+        return write_multiple(data);
+      default:
+        return exception_code::illegal_function;
+    }
+  }
+
+  exception_code read(std::span<hal::byte const> p_data,
+                      std::span<std::uint16_t const> p_table)
+  {
+    if (p_data.size() != 4) {
+      return exception_code::illegal_data_value;
+    }
+    std::size_t const address = detail::read_u16(p_data.subspan(0, 2));
+    std::size_t const count = detail::read_u16(p_data.subspan(2, 2));
+    if (count == 0 || count > max_read_registers) {
+      return exception_code::illegal_data_value;
+    }
+    if (address + count > p_table.size()) {
+      return exception_code::illegal_data_address;
+    }
+    m_response[2] = static_cast<hal::byte>(count * 2);
+    for (std::size_t i = 0; i < count; i++) {
+      detail::write_u16(std::span(m_response).subspan(3 + i * 2, 2),
+                        p_table[address + i]);
+    }
+    m_response_length = 3 + count * 2;
+    return exception_code::none;
+  }
+
+  exception_code write_single(std::span<hal::byte const> p_data)
+  {
+    if (p_data.size() != 4) {
+      return exception_code::illegal_data_value;
+    }
+    auto const address = detail::read_u16(p_data.subspan(0, 2));
+    if (address >= m_holding.size()) {
+      return exception_code::illegal_data_address;
+    }
+    m_holding[address] = detail::read_u16(p_data.subspan(2, 2));
+    m_on_write(address, 1);
+    std::ranges::copy(p_data, m_response.begin() + 2);
+    m_response_length = 6;
+    return exception_code::none;
+  }
+
+  exception_code write_multiple(std::span<hal::byte const> p_data)
+  {
+    if (p_data.size() < 5) {
+      return exception_code::illegal_data_value;
+    }
+    auto const address = detail::read_u16(p_data.subspan(0, 2));
+    std::size_t const count = detail::read_u16(p_data.subspan(2, 2));
+    if (count == 0 || count > max_write_registers || p_data[4] != count * 2 ||
+        p_data.size() != 5 + count * 2) {
+      return exception_code::illegal_data_value;
+    }
+    if (address + count > m_holding.size()) {
+      return exception_code::illegal_data_address;
+    }
+    for (std::size_t i = 0; i < count; i++) {
+      m_holding[address + i] = detail::read_u16(p_data.subspan(5 + i * 2, 2));
+    }
+    m_on_write(address, static_cast<std::uint16_t>(count));
+    std::ranges::copy(p_data.first(4), m_response.begin() + 2);
+    m_response_length = 6;
+    return exception_code::none;
+  }
+
+  hal::serial* m_serial;
+  frame_receiver m_receiver;
+  std::span<std::uint16_t> m_holding;
+  std::span<std::uint16_t const> m_input;
+  hal::callback<write_handler> m_on_write = [](std::uint16_t, std::uint16_t) {};
+  std::array<hal::byte, max_frame_size> m_response{};
+  std::size_t m_response_length = 0;
+  std::uint32_t m_requests = 0;
+  hal::byte m_address;
+};
+}  // namespace hal::modbus
@@ -0,0 +1,377 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <limits>
+#include <numbers>
+#include <numeric>
+#include <span>
+
+#include "error.hpp"
+#include "stream_dac.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Streaming rational sample rate converter using a polyphase filter
+ * bank.
+ *
+ * Converts a stream of samples from an input rate to an output rate by the
+ * rational factor L/M, where L is the interpolation factor and M is the
+ * decimation factor. Both are derived from the integer sample rates passed to
+ * `configure()`. For example, 44.1kHz to 48kHz results in L = 160 and M = 147.
+ *
+ * The prototype low pass filter is a Blackman windowed sinc which is computed
+ * once in `configure()` and split into L phases of `taps_per_phase`
+ * coefficients. Each output sample costs exactly `taps_per_phase` multiply
+ * accumulates regardless of the conversion ratio. Each phase is normalized to
+ * unity DC gain.
+ *
+ * The resampler is streaming, meaning that filter state is retained between
+ * calls to `process()`, allowing live sources to be converted block by block
+ * without discontinuities at block boundaries.
+ *
+ * @tparam max_phases - the maximum interpolation factor (L) supported. The
+ * filter bank requires `max_phases * taps_per_phase` floats of storage.
+ * @tparam taps_per_phase - number of filter coefficients applied per output
+ * sample. Higher values improve the stop band attenuation at the cost of CPU
+ * time.
+ */
+template<std::size_t max_phases, std::size_t taps_per_phase>
+class polyphase_resampler
+{
+public:
+  static_assert(max_phases > 0, "max_phases must be at least 1");
+  static_assert(taps_per_phase > 0, "taps_per_phase must be at least 1");
+
+  /// Proportion of the lowest Nyquist frequency (between the input and output
+  /// rates) that the anti-aliasing/anti-imaging filter passes.
+  static constexpr float cutoff_ratio = 0.9f;
+
+  /// Return type for process operations
+  struct result_t
+  {
+    /// Number of input samples consumed
+    std::size_t consumed;
+    /// Number of output samples generated
+    std::size_t produced;
+  };
+
+  /**
+   * @brief Construct a resampler with 1:1 conversion ratio
+   *
+   */
+  polyphase_resampler()
+  {
+    build_filter_bank();
+    reset();
+  }
+
+  /**
+   * @brief Configure the conversion ratio and rebuild the filter bank
+   *
+   * Rates are rounded to the nearest integer hertz and reduced by their
+   * greatest common divisor to determine L and M. The filter history is
+   * cleared.
+   *
+   * This api has a strong exception guarantee, in that, it will throw an
+   * exception before modifying the state of the resampler.
+   *
+   * @param p_input_rate - sample rate of the input stream
+   * @param p_output_rate - sample rate of the output stream
+   * @throws hal::argument_out_of_domain - if either rate is less than 1Hz or
+   * if the reduced interpolation factor exceeds `max_phases`.
+   */
+  void configure(hertz p_input_rate, hertz p_output_rate)
+  {
+    if (p_input_rate < 1.0f || p_output_rate < 1.0f) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+
+    auto const input = static_cast<std::uint32_t>(std::lround(p_input_rate));
+    auto const output = static_cast<std::uint32_t>(std::lround(p_output_rate));
+
+    auto const divisor = std::gcd(input, output);
+    auto const up = output / divisor;
+    auto const down = input / divisor;
+
+    if (up > max_phases) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+
+    m_up = up;
+    m_down = down;
+    build_filter_bank();
+    reset();
+  }
+
+  /**
+   * @brief Clear the filter history without changing the conversion ratio
+   *
+   */
+  void reset()
+  {
+    m_history.fill(0.0f);
+    m_head = 0;
+    // Starting the phase at L forces the first input sample to be loaded
+    // before the first output sample is computed.
+    m_phase = m_up;
+  }
+
+  /**
+   * @brief Convert a block of samples
+   *
+   * Consumes input samples and generates output samples until either the input
+   * is exhausted or the output is full. Callers should call this repeatedly
+   * with the remaining input until `consumed` covers the whole input block.
+   *
+   * @param p_input - input samples at the input rate
+   * @param p_output - buffer to fill with samples at the output rate
+   * @return result_t - number of samples consumed and produced
+   */
+  result_t process(std::span<float const> p_input, std::span<float> p_output)
+  {
+    result_t result{ .consumed = 0, .produced = 0 };
+
+    while (true) {
+      while (m_phase >= m_up) {
+        if (result.consumed == p_input.size()) {
+          return result;
+        }
+        push(p_input[result.consumed++]);
+        m_phase -= m_up;
+      }
+
+      if (result.produced == p_output.size()) {
+        return result;
+      }
+
+      p_output[result.produced++] = filter(m_phase);
+      m_phase += m_down;
+    }
+  }
+
+  /**
+   * @brief Get the interpolation factor (L)
+   *
+   * @return std::uint32_t - interpolation factor
+   */
+  [[nodiscard]] std::uint32_t interpolation() const
+  {
+    return m_up;
+  }
+
+  /**
+   * @brief Get the decimation factor (M)
+   *
+   * @return std::uint32_t - decimation factor
+   */
+  [[nodiscard]] std::uint32_t decimation() const
+  {
+    return m_down;
+  }
+
+private:
+  void push(float p_sample)
+  {
+    m_head = (m_head == 0) ? taps_per_phase - 1 : m_head - 1;
+    // Store each sample twice so that the window starting at m_head is always
+    // contiguous, removing the modulo from the inner loop.
+    m_history[m_head] = p_sample;
+    m_history[m_head + taps_per_phase] = p_sample;
+  }
+
+  [[nodiscard]] float filter(std::uint32_t p_phase) const
+  {
+    auto const* coefficients = &m_bank[p_phase * taps_per_phase];
+    auto const* window = &m_history[m_head];
+    float accumulator = 0.0f;
+    for (std::size_t i = 0; i < taps_per_phase; i++) {
+      accumulator += coefficients[i] * window[i];
+    }
+    return accumulator;
+  }
+
+  void build_filter_bank()
+  {
+    constexpr double pi = std::numbers::pi;
+    auto const length = static_cast<double>(m_up * taps_per_phase);
+    auto const center = (length - 1.0) / 2.0;
+    auto const cutoff =
+      cutoff_ratio / (2.0 * static_cast<double>(std::max(m_up, m_down)));
+
+    for (std::uint32_t phase = 0; phase < m_up; phase++) {
+      auto* coefficients = &m_bank[phase * taps_per_phase];
+      double sum = 0.0;
+
+      for (std::size_t tap = 0; tap < taps_per_phase; tap++) {
+        // Prototype coefficient index for this phase and tap
+        auto const n = static_cast<double>(phase + tap * m_up);
+        auto const x = n - center;
+        double sinc = 2.0 * cutoff;
+        if (x != 0.0) {
+          sinc = std::sin(2.0 * pi * cutoff * x) / (pi * x);
+        }
+        // The window is stretched by one sample on each side so that none of
+        // the coefficients land on its zero valued end points.
+        auto const ratio = (n + 1.0) / (length + 1.0);
+        auto const blackman = 0.42 - 0.5 * std::cos(2.0 * pi * ratio) +
+                              0.08 * std::cos(4.0 * pi * ratio);
+        auto const value = sinc * blackman;
+        coefficients[tap] = static_cast<float>(value);
+        sum += value;
+      }
+
+      for (std::size_t tap = 0; tap < taps_per_phase; tap++) {
+        coefficients[tap] = static_cast<float>(coefficients[tap] / sum);
+      }
+    }
+  }
+
+  std::array<float, max_phases * taps_per_phase> m_bank{};
+  std::array<float, taps_per_phase * 2> m_history{};
+  std::size_t m_head = 0;
+  std::uint32_t m_up = 1;
+  std::uint32_t m_down = 1;
+  std::uint32_t m_phase = 1;
+};
+
+/**
+ * @brief A stream_dac that converts incoming samples to the native sample
+ * rate of another stream_dac.
+ *
+ * DAC peripherals are usually driven by timers that can only reach a subset of
+ * sample rates cleanly. This adapter accepts any sample rate that can be
+ * reduced to an interpolation factor of `max_phases` or less and streams the
+ * converted samples to the output dac at its native rate in blocks of
+ * `block_size` samples.
+ *
+ * Samples already at the native rate are forwarded without conversion.
+ *
+ * USAGE:
+ *
+ *      hal::resampling_stream_dac<std::uint16_t, 320, 16> dac(dma_dac, 48_kHz);
+ *      dac.write({ .sample_rate = 44.1_kHz, .data = pcm });
+ *
+ * @tparam data_t - container size for the sample data
+ * @tparam max_phases - see polyphase_resampler
+ * @tparam taps_per_phase - see polyphase_resampler
+ * @tparam block_size - number of output samples written to the output dac
+ * per call.
+ */
+template<std::unsigned_integral data_t,
+         std::size_t max_phases,
+         std::size_t taps_per_phase,
+         std::size_t block_size = 256>
+class resampling_stream_dac : public hal::stream_dac<data_t>
+{
+public:
+  using samples = typename hal::stream_dac<data_t>::samples;
+
+  /**
+   * @brief Construct a new resampling stream dac object
+   *
+   * @param p_output - stream dac to write converted samples to
+   * @param p_native_rate - the sample rate that p_output operates at
+   */
+  resampling_stream_dac(hal::stream_dac<data_t>& p_output,
+                        hertz p_native_rate)
+    : m_output(&p_output)
+    , m_native_rate(p_native_rate)
+  {
+  }
+
+private:
+  static constexpr float midpoint =
+    static_cast<float>((std::uintmax_t{ 1 } << (sizeof(data_t) * 8 - 1)));
+  static constexpr float maximum =
+    static_cast<float>(std::numeric_limits<data_t>::max());
+
+  void driver_write(samples const& p_samples) override
+  {
+    if (p_samples.data.empty()) {
+      return;
+    }
+
+    if (p_samples.sample_rate == m_native_rate) {
+      m_output->write(p_samples);
+      return;
+    }
+
+    if (p_samples.sample_rate != m_input_rate) {
+      m_resampler.configure(p_samples.sample_rate, m_native_rate);
+      m_input_rate = p_samples.sample_rate;
+    }
+
+    auto remaining = p_samples.data;
+    while (not remaining.empty()) {
+      auto const chunk = std::min(remaining.size(), m_input_block.size());
+      for (std::size_t i = 0; i < chunk; i++) {
+        m_input_block[i] = (static_cast<float>(remaining[i]) - midpoint) /
+                           midpoint;
+      }
+      remaining = remaining.subspan(chunk);
+
+      std::span<float const> input(m_input_block.data(), chunk);
+      while (not input.empty()) {
+        auto output = std::span(m_output_block).subspan(m_output_count);
+        auto const result = m_resampler.process(input, output);
+        input = input.subspan(result.consumed);
+        m_output_count += result.produced;
+        if (m_output_count == block_size) {
+          flush();
+        }
+      }
+    }
+
+    flush();
+  }
+
+  void flush()
+  {
+    if (m_output_count == 0) {
+      return;
+    }
+
+    for (std::size_t i = 0; i < m_output_count; i++) {
+      auto const value =
+        std::clamp(m_output_block[i] * midpoint + midpoint, 0.0f, maximum);
+      m_output_data[i] = static_cast<data_t>(std::lround(value));
+    }
+
+    m_output->write({
+      .sample_rate = m_native_rate,
+      .data = std::span<data_t const>(m_output_data.data(), m_output_count),
+    });
+    m_output_count = 0;
+  }
+
+  hal::stream_dac<data_t>* m_output;
+  hertz m_native_rate;
+  hertz m_input_rate = 0.0f;
+  std::size_t m_output_count = 0;
+  polyphase_resampler<max_phases, taps_per_phase> m_resampler{};
+  std::array<float, block_size> m_input_block{};
+  std::array<float, block_size> m_output_block{};
+  std::array<data_t, block_size> m_output_data{};
+};
+}  // namespace hal
@@ -0,0 +1,517 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <compare>
+#include <numeric>
+#include <ratio>
+#include <type_traits>
+
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Physical dimension as exponents of the SI base quantities
+ *
+ * Only the base quantities used by libhal interfaces are represented.
+ *
+ * @tparam length - exponent of meters
+ * @tparam mass - exponent of kilograms
+ * @tparam time - exponent of seconds
+ * @tparam current - exponent of amperes
+ * @tparam temperature - exponent of kelvin
+ */
+template<int length, int mass, int time, int current, int temperature>
+struct dimension
+{
+  static constexpr int length_exponent = length;
+  static constexpr int mass_exponent = mass;
+  static constexpr int time_exponent = time;
+  static constexpr int current_exponent = current;
+  static constexpr int temperature_exponent = temperature;
+};
+
+/**
+ * @brief Dimension of the product of two quantities
+ *
+ */
+template<class left_t, class right_t>
+using dimension_multiply =
+  dimension<left_t::length_exponent + right_t::length_exponent,
+            left_t::mass_exponent + right_t::mass_exponent,
+            left_t::time_exponent + right_t::time_exponent,
+            left_t::current_exponent + right_t::current_exponent,
+            left_t::temperature_exponent + right_t::temperature_exponent>;
+
+/**
+ * @brief Dimension of the quotient of two quantities
+ *
+ */
+template<class left_t, class right_t>
+using dimension_divide =
+  dimension<left_t::length_exponent - right_t::length_exponent,
+            left_t::mass_exponent - right_t::mass_exponent,
+            left_t::time_exponent - right_t::time_exponent,
+            left_t::current_exponent - right_t::current_exponent,
+            left_t::temperature_exponent - right_t::temperature_exponent>;
+
+/// Dimensions of commonly used quantities
+namespace dimensions {
+using dimensionless = dimension<0, 0, 0, 0, 0>;
+using length = dimension<1, 0, 0, 0, 0>;
+using time = dimension<0, 0, 1, 0, 0>;
+using current = dimension<0, 0, 0, 1, 0>;
+using temperature = dimension<0, 0, 0, 0, 1>;
+using frequency = dimension<0, 0, -1, 0, 0>;
+using velocity = dimension<1, 0, -1, 0, 0>;
+using acceleration = dimension<1, 0, -2, 0, 0>;
+using power = dimension<2, 1, -3, 0, 0>;
+using voltage = dimension<2, 1, -3, -1, 0>;
+using resistance = dimension<2, 1, -3, -2, 0>;
+using charge = dimension<0, 0, 1, 1, 0>;
+}  // namespace dimensions
+
+template<class dimension_t, class scale_t = std::ratio<1>, class rep_t = float>
+class quantity;
+
+namespace detail {
+template<class T>
+struct is_quantity : std::false_type
+{};
+
+template<class dimension_t, class scale_t, class rep_t>
+struct is_quantity<quantity<dimension_t, scale_t, rep_t>> : std::true_type
+{};
+
+/// Scale to which both scales convert without loss, as with std::chrono
+template<class left_t, class right_t>
+using common_scale = std::ratio<std::gcd(left_t::num, right_t::num),
+                                std::lcm(left_t::den, right_t::den)>;
+
+/**
+ * @brief Convert a value between scales with the factor folded at compile
+ * time
+ *
+ */
+template<class to_scale_t, class to_rep_t, class from_scale_t, class from_rep_t>
+[[nodiscard]] constexpr to_rep_t rescale(from_rep_t p_value)
+{
+  using factor = std::ratio_divide<from_scale_t, to_scale_t>;
+  using common_rep = std::common_type_t<to_rep_t, from_rep_t>;
+  if constexpr (factor::num == 1 && factor::den == 1) {
+    return static_cast<to_rep_t>(p_value);
+  } else if constexpr (std::is_floating_point_v<common_rep>) {
+    constexpr auto multiplier =
+      static_cast<common_rep>(static_cast<long double>(factor::num) /
+                              static_cast<long double>(factor::den));
+    return static_cast<to_rep_t>(static_cast<common_rep>(p_value) *
+                                 multiplier);
+  } else if constexpr (factor::den == 1) {
+    return static_cast<to_rep_t>(static_cast<common_rep>(p_value) *
+                                 static_cast<common_rep>(factor::num));
+  } else if constexpr (factor::num == 1) {
+    return static_cast<to_rep_t>(static_cast<common_rep>(p_value) /
+                                 static_cast<common_rep>(factor::den));
+  } else {
+    return static_cast<to_rep_t>(static_cast<common_rep>(p_value) *
+                                 static_cast<common_rep>(factor::num) /
+                                 static_cast<common_rep>(factor::den));
+  }
+}
+}  // namespace detail
+
+/**
+ * @brief A value with a physical dimension and a compile time scale
+ *
+ * Quantities of different dimensions cannot be mixed, so passing volts where
+ * hertz are expected is a compile error. Scales are std::ratio prefixes, and
+ * conversions between them multiply by a constant computed at compile time,
+ * so a quantity compiles down to the same arithmetic as its underlying rep.
+ *
+ * Conversions between scales of the same dimension are implicit when they
+ * cannot lose information: always for floating point reps, and for integer
+ * reps only when converting to a finer scale (such as kilohertz to hertz). Use
+ * hal::quantity_cast for lossy conversions.
+ *
+ * The existing libhal unit aliases, such as hal::hertz, are floats in base SI
+ * units, and the existing literals produce values in those units. A quantity
+ * of any scale is created from them with `from_base_value()` and converted
+ * back to them with `hal::base_value()`:
+ *
+ * ```C++
+ * auto rate = hal::quantities::kilohertz::from_base_value(400.0_kHz);
+ * i2c.configure({ .clock_rate = hal::base_value(rate) });
+ * ```
+ *
+ * A count of units of scale_t is given with `from_count()`. There is no
+ * constructor from a bare number, so a base unit value such as `400.0_kHz`
+ * cannot be mistaken for a count of kilohertz.
+ *
+ * @tparam dimension_t - hal::dimension of the quantity
+ * @tparam scale_t - std::ratio of one unit of this quantity to the base unit
+ * @tparam rep_t - arithmetic type holding the value
+ */
+template<class dimension_t, class scale_t, class rep_t>
+class quantity
+{
+public:
+  static_assert(std::is_arithmetic_v<rep_t>, "rep_t must be arithmetic");
+  static_assert(scale_t::num > 0, "scale_t must be positive");
+
+  using dimension = dimension_t;
+  using scale = typename scale_t::type;
+  using rep = rep_t;
+
+  constexpr quantity() = default;
+
+  /**
+   * @brief Create a quantity from a count of units of scale_t
+   *
+   * The count is already scaled: `kilohertz::from_count(400.0f)` is 400 kHz.
+   * Use `from_base_value()` for values in base SI units, such as those
+   * produced by the libhal unit literals.
+   *
+   * @param p_count - number of units of scale_t
+   * @return quantity - the quantity holding p_count
+   */
+  [[nodiscard]] static constexpr quantity from_count(rep_t p_count)
+  {
+    quantity result;
+    result.m_value = p_count;
+    return result;
+  }
+
+  /**
+   * @brief Create a quantity from a value in base SI units
+   *
+   * With a float rep, accepts the unit types used by the existing libhal
+   * interfaces and the values produced by the libhal unit literals. Integer
+   * reps truncate.
+   *
+   * @param p_value - value in base units, such as hertz or volts
+   * @return quantity - the value rescaled to scale_t
+   */
+  [[nodiscard]] static constexpr quantity from_base_value(rep_t p_value)
+  {
+    return from_count(detail::rescale<scale_t, rep_t, std::ratio<1>>(p_value));
+  }
+
+  /**
+   * @brief Convert from a quantity of the same dimension
+   *
+   * @param p_other - quantity of any scale and rep that converts without loss
+   */
+  template<class other_scale_t, class other_rep_t>
+  requires(std::is_floating_point_v<rep_t> ||
+           (not std::is_floating_point_v<other_rep_t> &&
+            std::ratio_divide<other_scale_t, scale_t>::den == 1))
+  constexpr quantity(  // NOLINT(google-explicit-constructor)
+    quantity<dimension_t, other_scale_t, other_rep_t> const& p_other)
+    : m_value(detail::rescale<scale_t, rep_t, other_scale_t>(p_other.count()))
+  {
+  }
+
+  /**
+   * @brief Construct a time quantity from a std::chrono::duration
+   *
+   * @param p_duration - duration of any period
+   */
+  template<class other_rep_t, class period_t>
+  requires(std::is_same_v<dimension_t, dimensions::time>)
+  constexpr quantity(  // NOLINT(google-explicit-constructor)
+    std::chrono::duration<other_rep_t, period_t> p_duration)
+    : m_value(detail::rescale<scale_t, rep_t, period_t>(p_duration.count()))
+  {
+  }
+
+  /**
+   * @brief Number of units of scale_t
+   *
+   * @return constexpr rep_t - the stored value
+   */
+  [[nodiscard]] constexpr rep_t count() const
+  {
+    return m_value;
+  }
+
+  constexpr quantity operator+() const
+  {
+    return *this;
+  }
+
+  constexpr quantity operator-() const
+  {
+    return from_count(static_cast<rep_t>(-m_value));
+  }
+
+  constexpr quantity& operator+=(quantity const& p_other)
+  {
+    m_value = static_cast<rep_t>(m_value + p_other.m_value);
+    return *this;
+  }
+
+  constexpr quantity& operator-=(quantity const& p_other)
+  {
+    m_value = static_cast<rep_t>(m_value - p_other.m_value);
+    return *this;
+  }
+
+  // Computed in the common type, then narrowed back to rep_t explicitly
+  template<class scalar_t>
+  requires(std::is_arithmetic_v<scalar_t>)
+  constexpr quantity& operator*=(scalar_t p_scalar)
+  {
+    using common = std::common_type_t<rep_t, scalar_t>;
+    m_value = static_cast<rep_t>(static_cast<common>(m_value) *
+                                 static_cast<common>(p_scalar));
+    return *this;
+  }
+
+  template<class scalar_t>
+  requires(std::is_arithmetic_v<scalar_t>)
+  constexpr quantity& operator/=(scalar_t p_scalar)
+  {
+    using common = std::common_type_t<rep_t, scalar_t>;
+    m_value = static_cast<rep_t>(static_cast<common>(m_value) /
+                                 static_cast<common>(p_scalar));
+    return *this;
+  }
+
+private:
+  rep_t m_value{};
+};
+
+/**
+ * @brief Convert a quantity to another scale or rep, allowing loss
+ *
+ * @tparam to_t - target quantity type, must have the same dimension
+ * @param p_quantity - quantity to convert
+ * @return to_t - converted quantity
+ */
+template<class to_t, class dimension_t, class scale_t, class rep_t>
+requires(detail::is_quantity<to_t>::value &&
+         std::is_same_v<typename to_t::dimension, dimension_t>)
+[[nodiscard]] constexpr to_t quantity_cast(
+  quantity<dimension_t, scale_t, rep_t> const& p_quantity)
+{
+  return to_t::from_count(
+    detail::rescale<typename to_t::scale, typename to_t::rep, scale_t>(
+      p_quantity.count()));
+}
+
+/**
+ * @brief Value of a quantity in base SI units, such as hertz or volts
+ *
+ * Returns the float unit types used by the existing libhal interfaces.
+ *
+ * @param p_quantity - quantity to convert
+ * @return float - value in base units
+ */
+template<class dimension_t, class scale_t, class rep_t>
+[[nodiscard]] constexpr float base_value(
+  quantity<dimension_t, scale_t, rep_t> const& p_quantity)
+{
+  return detail::rescale<std::ratio<1>, float, scale_t>(p_quantity.count());
+}
+
+/**
+ * @brief Convert a time quantity to a hal::time_duration
+ *
+ * @param p_quantity - time quantity
+ * @return hal::time_duration - the time in nanoseconds, truncated
+ */
+template<class scale_t, class rep_t>
+[[nodiscard]] constexpr hal::time_duration to_duration(
+  quantity<dimensions::time, scale_t, rep_t> const& p_quantity)
+{
+  return hal::time_duration(
+    detail::rescale<std::nano, hal::time_duration::rep, scale_t>(
+      p_quantity.count()));
+}
+
+template<class dimension_t,
+         class left_scale_t,
+         class left_rep_t,
+         class right_scale_t,
+         class right_rep_t>
+[[nodiscard]] constexpr auto operator+(
+  quantity<dimension_t, left_scale_t, left_rep_t> const& p_left,
+  quantity<dimension_t, right_scale_t, right_rep_t> const& p_right)
+{
+  using result = quantity<dimension_t,
+                          detail::common_scale<left_scale_t, right_scale_t>,
+                          std::common_type_t<left_rep_t, right_rep_t>>;
+  using rep = typename result::rep;
+  return result::from_count(
+    static_cast<rep>(result(p_left).count() + result(p_right).count()));
+}
+
+template<class dimension_t,
+         class left_scale_t,
+         class left_rep_t,
+         class right_scale_t,
+         class right_rep_t>
+[[nodiscard]] constexpr auto operator-(
+  quantity<dimension_t, left_scale_t, left_rep_t> const& p_left,
+  quantity<dimension_t, right_scale_t, right_rep_t> const& p_right)
+{
+  using result = quantity<dimension_t,
+                          detail::common_scale<left_scale_t, right_scale_t>,
+                          std::common_type_t<left_rep_t, right_rep_t>>;
+  using rep = typename result::rep;
+  return result::from_count(
+    static_cast<rep>(result(p_left).count() - result(p_right).count()));
+}
+
+template<class dimension_t,
+         class left_scale_t,
+         class left_rep_t,
+         class right_scale_t,
+         class right_rep_t>
+[[nodiscard]] constexpr bool operator==(
+  quantity<dimension_t, left_scale_t, left_rep_t> const& p_left,
+  quantity<dimension_t, right_scale_t, right_rep_t> const& p_right)
+{
+  using common = quantity<dimension_t,
+                          detail::common_scale<left_scale_t, right_scale_t>,
+                          std::common_type_t<left_rep_t, right_rep_t>>;
+  return common(p_left).count() == common(p_right).count();
+}
+
+template<class dimension_t,
+         class left_scale_t,
+         class left_rep_t,
+         class right_scale_t,
+         class right_rep_t>
+[[nodiscard]] constexpr auto operator<=>(
+  quantity<dimension_t, left_scale_t, left_rep_t> const& p_left,
+  quantity<dimension_t, right_scale_t, right_rep_t> const& p_right)
+{
+  using common = quantity<dimension_t,
+                          detail::common_scale<left_scale_t, right_scale_t>,
+                          std::common_type_t<left_rep_t, right_rep_t>>;
+  return common(p_left).count() <=> common(p_right).count();
+}
+
+/// Scaling by any arithmetic scalar, the rep is the common type as with
+/// std::chrono::duration
+template<class dimension_t, class scale_t, class rep_t, class scalar_t>
+requires(std::is_arithmetic_v<scalar_t>)
+[[nodiscard]] constexpr auto operator*(
+  quantity<dimension_t, scale_t, rep_t> const& p_quantity,
+  scalar_t p_scalar)
+{
+  using rep = std::common_type_t<rep_t, scalar_t>;
+  using result = quantity<dimension_t, scale_t, rep>;
+  return result::from_count(static_cast<rep>(
+    static_cast<rep>(p_quantity.count()) * static_cast<rep>(p_scalar)));
+}
+
+template<class dimension_t, class scale_t, class rep_t, class scalar_t>
+requires(std::is_arithmetic_v<scalar_t>)
+[[nodiscard]] constexpr auto operator*(
+  scalar_t p_scalar,
+  quantity<dimension_t, scale_t, rep_t> const& p_quantity)
+{
+  return p_quantity * p_scalar;
+}
+
+template<class dimension_t, class scale_t, class rep_t, class scalar_t>
+requires(std::is_arithmetic_v<scalar_t>)
+[[nodiscard]] constexpr auto operator/(
+  quantity<dimension_t, scale_t, rep_t> const& p_quantity,
+  scalar_t p_scalar)
+{
+  using rep = std::common_type_t<rep_t, scalar_t>;
+  using result = quantity<dimension_t, scale_t, rep>;
+  return result::from_count(static_cast<rep>(
+    static_cast<rep>(p_quantity.count()) / static_cast<rep>(p_scalar)));
+}
+
+template<class left_dimension_t,
+         class left_scale_t,
+         class left_rep_t,
+         class right_dimension_t,
+         class right_scale_t,
+         class right_rep_t>
+[[nodiscard]] constexpr auto operator*(
+  quantity<left_dimension_t, left_scale_t, left_rep_t> const& p_left,
+  quantity<right_dimension_t, right_scale_t, right_rep_t> const& p_right)
+{
+  using result =
+    quantity<dimension_multiply<left_dimension_t, right_dimension_t>,
+             std::ratio_multiply<left_scale_t, right_scale_t>,
+             std::common_type_t<left_rep_t, right_rep_t>>;
+  using rep = typename result::rep;
+  return result::from_count(static_cast<rep>(
+    static_cast<rep>(p_left.count()) * static_cast<rep>(p_right.count())));
+}
+
+template<class left_dimension_t,
+         class left_scale_t,
+         class left_rep_t,
+         class right_dimension_t,
+         class right_scale_t,
+         class right_rep_t>
+[[nodiscard]] constexpr auto operator/(
+  quantity<left_dimension_t, left_scale_t, left_rep_t> const& p_left,
+  quantity<right_dimension_t, right_scale_t, right_rep_t> const& p_right)
+{
+  using result =
+    quantity<dimension_divide<left_dimension_t, right_dimension_t>,
+             std::ratio_divide<left_scale_t, right_scale_t>,
+             std::common_type_t<left_rep_t, right_rep_t>>;
+  using rep = typename result::rep;
+  return result::from_count(static_cast<rep>(
+    static_cast<rep>(p_left.count()) / static_cast<rep>(p_right.count())));
+}
+
+/**
+ * @brief Strongly typed counterparts to the unit aliases in units.hpp
+ *
+ * Names match the aliases in namespace hal, so this namespace should be
+ * referred to explicitly rather than brought in with a using directive.
+ */
+namespace quantities {
+using hertz = quantity<dimensions::frequency>;
+using kilohertz = quantity<dimensions::frequency, std::kilo>;
+using megahertz = quantity<dimensions::frequency, std::mega>;
+using ampere = quantity<dimensions::current>;
+using milliampere = quantity<dimensions::current, std::milli>;
+using microampere = quantity<dimensions::current, std::micro>;
+using volts = quantity<dimensions::voltage>;
+using millivolts = quantity<dimensions::voltage, std::milli>;
+using ohms = quantity<dimensions::resistance>;
+using kiloohms = quantity<dimensions::resistance, std::kilo>;
+using watts = quantity<dimensions::power>;
+using milliwatts = quantity<dimensions::power, std::milli>;
+using meters = quantity<dimensions::length>;
+using millimeters = quantity<dimensions::length, std::milli>;
+using micrometers = quantity<dimensions::length, std::micro>;
+using seconds = quantity<dimensions::time>;
+using milliseconds = quantity<dimensions::time, std::milli>;
+using microseconds = quantity<dimensions::time, std::micro>;
+using meters_per_second = quantity<dimensions::velocity>;
+using meters_per_second_squared = quantity<dimensions::acceleration>;
+/// Temperature differences in kelvin. Absolute celsius temperatures are an
+/// offset scale and remain represented by hal::celsius.
+using kelvin = quantity<dimensions::temperature>;
+using scalar = quantity<dimensions::dimensionless>;
+}  // namespace quantities
+}  // namespace hal
@@ -0,0 +1,484 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <span>
+
+#include "cobs.hpp"
+#include "crc.hpp"
+#include "error.hpp"
+#include "serial.hpp"
+#include "units.hpp"
+
+namespace hal {
+namespace detail {
+/// Fixed capacity FIFO of bytes over caller supplied storage
+class byte_ring
+{
+public:
+  explicit byte_ring(std::span<hal::byte> p_storage)
+    : m_storage(p_storage)
+  {
+  }
+
+  std::size_t push(std::span<hal::byte const> p_data)
+  {
+    auto const count = std::min(p_data.size(), m_storage.size() - m_count);
+    for (std::size_t i = 0; i < count; i++) {
+      m_storage[(m_head + m_count + i) % m_storage.size()] = p_data[i];
+    }
+    m_count += count;
+    return count;
+  }
+
+  std::size_t pop(std::span<hal::byte> p_data)
+  {
+    auto const count = std::min(p_data.size(), m_count);
+    for (std::size_t i = 0; i < count; i++) {
+      p_data[i] = m_storage[m_head];
+      m_head = (m_head + 1) % m_storage.size();
+    }
+    m_count -= count;
+    return count;
+  }
+
+  void clear()
+  {
+    m_head = 0;
+    m_count = 0;
+  }
+
+  [[nodiscard]] std::size_t size() const
+  {
+    return m_count;
+  }
+
+  [[nodiscard]] std::size_t capacity() const
+  {
+    return m_storage.size();
+  }
+
+private:
+  std::span<hal::byte> m_storage;
+  std::size_t m_head = 0;
+  std::size_t m_count = 0;
+};
+}  // namespace detail
+
+class serial_channel;
+
+/**
+ * @brief Multiplex several virtual serial channels over one serial port
+ *
+ * Each `hal::serial_channel` attached to the multiplexer is a `hal::serial`
+ * with its own transmit and receive buffers, so drivers written against
+ * `hal::serial` (consoles, loggers, bootloaders) can share one physical link
+ * without knowing about each other.
+ *
+ * On the link, every frame carries a channel id, up to `max_payload` bytes of
+ * channel data and a CRC-16/CCITT-FALSE, encoded with consistent overhead
+ * byte stuffing (COBS) and terminated by a zero byte. Corrupt frames are
+ * discarded and resynchronization happens at the next zero byte.
+ *
+ * Transmit bandwidth is shared with deficit round robin scheduling. In every
+ * round each channel with pending data may send up to its weight in bytes,
+ * so a channel's share of the link is proportional to its weight and no
+ * channel waits more than one round, whatever the others have queued. A bulk
+ * firmware upload with a small weight cannot stall telemetry sharing the
+ * link.
+ *
+ * USAGE:
+ *
+ *      hal::serial_mux mux(uart);
+ *      hal::serial_channel console(mux, 0, 64, console_tx, console_rx);
+ *      hal::serial_channel update(mux, 1, 32, update_tx, update_rx);
+ *
+ *      while (true) {
+ *        mux.poll();
+ *        // ...
+ *      }
+ */
+class serial_mux
+{
+public:
+  /// Maximum number of channels attached to a single multiplexer
+  static constexpr std::size_t max_channels = 8;
+  /// Maximum channel bytes carried by a single frame
+  static constexpr std::size_t max_payload = 250;
+
+  /**
+   * @brief Construct a new serial mux object
+   *
+   * @param p_link - serial port carrying the multiplexed frames
+   */
+  serial_mux(hal::serial& p_link)
+    : m_link(&p_link)
+  {
+  }
+
+  serial_mux(serial_mux const&) = delete;
+  serial_mux& operator=(serial_mux const&) = delete;
+  serial_mux(serial_mux&&) = delete;
+  serial_mux& operator=(serial_mux&&) = delete;
+
+  /**
+   * @brief Receive and then transmit pending frames
+   *
+   */
+  void poll()
+  {
+    receive();
+    transmit();
+  }
+
+  /**
+   * @brief Read every available byte from the link and deliver frames
+   *
+   * Payloads of valid frames are placed in the receive buffer of the channel
+   * with the frame's id.
+   */
+  void receive();
+
+  /**
+   * @brief Transmit one round of frames
+   *
+   * Every channel with pending transmit data sends up to its weight in bytes
+   * plus any allowance left from the previous round.
+   *
+   * If the link accepts only part of a frame, the rest of the frame is kept
+   * and the round stops. The next call sends the rest of the frame first and
+   * then finishes the interrupted round.
+   *
+   * @return std::size_t - number of channel bytes transmitted
+   */
+  std::size_t transmit();
+
+  /**
+   * @brief Number of frames discarded as invalid
+   *
+   * Counts frames that fail to decode, fail their CRC, exceed the frame size
+   * or address a channel that is not attached.
+   *
+   * @return std::uint32_t - discarded frame count
+   */
+  [[nodiscard]] std::uint32_t errors() const
+  {
+    return m_errors;
+  }
+
+private:
+  friend class serial_channel;
+
+  // channel id, payload and CRC
+  static constexpr std::size_t max_frame = 1 + max_payload + 2;
+  // COBS code bytes and the zero delimiter
+  static constexpr std::size_t max_encoded = max_frame + 2;
+
+  using frame_crc = crc16_ccitt_false<1>;
+
+  void attach(serial_channel* p_channel);
+  void detach(serial_channel* p_channel);
+  void deliver(std::span<hal::byte> p_encoded);
+  bool send_encoded();
+
+  hal::serial* m_link;
+  std::array<serial_channel*, max_channels> m_channels{};
+  std::size_t m_channel_count = 0;
+  std::array<hal::byte, max_frame> m_frame{};
+  std::array<hal::byte, max_encoded> m_encoded{};
+  std::size_t m_encoded_length = 0;
+  std::size_t m_encoded_sent = 0;
+  // Channel at which an interrupted round resumes, its allowance for the
+  // round already given
+  std::size_t m_round_position = 0;
+  bool m_round_interrupted = false;
+  std::array<hal::byte, max_encoded> m_received{};
+  std::size_t m_received_length = 0;
+  bool m_received_overflow = false;
+  std::uint32_t m_errors = 0;
+};
+
+/**
+ * @brief Virtual serial port carried over a hal::serial_mux
+ *
+ * Writes are queued in the channel's transmit buffer and sent by the
+ * multiplexer. A write accepts as many bytes as fit in the transmit buffer
+ * and never blocks; the returned `write_t::data` holds the accepted bytes.
+ * Reads behave like any buffered serial port: bytes that did not fit in the
+ * receive buffer are dropped and reported via `read_t::available`.
+ *
+ * Baud rate, parity and stop bits belong to the physical link, so
+ * `configure()` on a channel accepts and ignores every setting.
+ */
+class serial_channel : public hal::serial
+{
+public:
+  /**
+   * @brief Construct a new serial channel object and attach it to the mux
+   *
+   * @param p_mux - multiplexer carrying this channel
+   * @param p_id - channel id, unique within the multiplexer and shared with
+   * the peer's channel
+   * @param p_weight - bytes this channel may transmit per scheduling round
+   * @param p_transmit_buffer - bytes waiting to be transmitted
+   * @param p_receive_buffer - bytes received and waiting to be read
+   * @throws hal::argument_out_of_domain - if p_id is already attached,
+   * p_weight is zero or either buffer is empty
+   * @throws hal::resource_unavailable_try_again - if the multiplexer already
+   * has serial_mux::max_channels channels.
+   */
+  serial_channel(serial_mux& p_mux,
+                 hal::byte p_id,
+                 std::uint16_t p_weight,
+                 std::span<hal::byte> p_transmit_buffer,
+                 std::span<hal::byte> p_receive_buffer)
+    : m_mux(&p_mux)
+    , m_transmit(p_transmit_buffer)
+    , m_receive(p_receive_buffer)
+    , m_weight(p_weight)
+    , m_id(p_id)
+  {
+    if (p_weight == 0 || p_transmit_buffer.empty() ||
+        p_receive_buffer.empty()) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    m_mux->attach(this);
+  }
+
+  serial_channel(serial_channel const&) = delete;
+  serial_channel& operator=(serial_channel const&) = delete;
+  serial_channel(serial_channel&&) = delete;
+  serial_channel& operator=(serial_channel&&) = delete;
+
+  /**
+   * @brief Channel id carried in this channel's frames
+   *
+   * @return hal::byte - channel id
+   */
+  [[nodiscard]] hal::byte id() const
+  {
+    return m_id;
+  }
+
+  /**
+   * @brief Bytes written but not yet transmitted
+   *
+   * @return std::size_t - pending transmit byte count
+   */
+  [[nodiscard]] std::size_t pending() const
+  {
+    return m_transmit.size();
+  }
+
+  ~serial_channel() override
+  {
+    m_mux->detach(this);
+  }
+
+private:
+  friend class serial_mux;
+
+  void driver_configure(settings const&) override
+  {
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    return { .data = p_data.first(m_transmit.push(p_data)) };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    auto const available = m_receive.size() + m_dropped;
+    auto const count = m_receive.pop(p_data);
+    m_dropped = 0;
+    return {
+      .data = p_data.first(count),
+      .available = available,
+      .capacity = m_receive.capacity(),
+    };
+  }
+
+  void driver_flush() override
+  {
+    m_receive.clear();
+    m_dropped = 0;
+  }
+
+  serial_mux* m_mux;
+  detail::byte_ring m_transmit;
+  detail::byte_ring m_receive;
+  std::size_t m_deficit = 0;
+  std::size_t m_dropped = 0;
+  std::uint16_t m_weight;
+  hal::byte m_id;
+};
+
+inline void serial_mux::receive()
+{
+  std::array<hal::byte, 32> buffer{};
+  while (true) {
+    auto const received = m_link->read(buffer).data;
+    for (auto const value : received) {
+      if (value == 0) {
+        if (m_received_overflow) {
+          m_errors++;
+        } else if (m_received_length != 0) {
+          deliver(std::span(m_received).first(m_received_length));
+        }
+        m_received_length = 0;
+        m_received_overflow = false;
+      } else if (m_received_length == m_received.size()) {
+        m_received_overflow = true;
+      } else {
+        m_received[m_received_length++] = value;
+      }
+    }
+    if (received.size() < buffer.size()) {
+      return;
+    }
+  }
+}
+
+inline std::size_t serial_mux::transmit()
+{
+  std::size_t sent = 0;
+  if (not send_encoded()) {
+    return sent;
+  }
+
+  for (; m_round_position < m_channel_count; m_round_position++) {
+    auto* channel = m_channels[m_round_position];
+    if (not m_round_interrupted) {
+      if (channel->m_transmit.size() == 0) {
+        channel->m_deficit = 0;
+        continue;
+      }
+      channel->m_deficit += channel->m_weight;
+    }
+    m_round_interrupted = false;
+
+    while (channel->m_deficit != 0 && channel->m_transmit.size() != 0) {
+      auto const length = std::min(
+        { channel->m_deficit, channel->m_transmit.size(), max_payload });
+      m_frame[0] = channel->m_id;
+      channel->m_transmit.pop(std::span(m_frame).subspan(1, length));
+      auto const crc = frame_crc::compute(std::span(m_frame).first(1 + length));
+      m_frame[1 + length] = static_cast<hal::byte>(crc >> 8);
+      m_frame[2 + length] = static_cast<hal::byte>(crc);
+
+      auto const encoded = detail::cobs_encode(
+        std::span(m_frame).first(3 + length), m_encoded);
+      m_encoded[encoded] = 0;
+      m_encoded_length = encoded + 1;
+      m_encoded_sent = 0;
+
+      channel->m_deficit -= length;
+      sent += length;
+      if (not send_encoded()) {
+        m_round_interrupted = true;
+        return sent;
+      }
+    }
+
+    // An idle channel does not bank allowance for later rounds
+    if (channel->m_transmit.size() == 0) {
+      channel->m_deficit = 0;
+    }
+  }
+  m_round_position = 0;
+  return sent;
+}
+
+inline bool serial_mux::send_encoded()
+{
+  while (m_encoded_sent < m_encoded_length) {
+    auto const remaining = std::span(m_encoded).subspan(
+      m_encoded_sent, m_encoded_length - m_encoded_sent);
+    auto const written = m_link->write(remaining).data.size();
+    if (written == 0) {
+      return false;
+    }
+    m_encoded_sent += written;
+  }
+  return true;
+}
+
+inline void serial_mux::attach(serial_channel* p_channel)
+{
+  auto const end = m_channels.begin() + m_channel_count;
+  auto const same_id = std::find_if(
+    m_channels.begin(), end, [p_channel](serial_channel const* p_other) {
+      return p_other->m_id == p_channel->m_id;
+    });
+  if (same_id != end) {
+    hal::safe_throw(hal::argument_out_of_domain(this));
+  }
+  if (m_channel_count == m_channels.size()) {
+    hal::safe_throw(hal::resource_unavailable_try_again(this));
+  }
+  m_channels[m_channel_count++] = p_channel;
+}
+
+inline void serial_mux::detach(serial_channel* p_channel)
+{
+  auto const end = m_channels.begin() + m_channel_count;
+  auto const found = std::find(m_channels.begin(), end, p_channel);
+  if (found != end) {
+    std::copy(found + 1, end, found);
+    m_channel_count--;
+    // Positions have shifted, so start a new round
+    m_round_position = 0;
+    m_round_interrupted = false;
+  }
+}
+
+inline void serial_mux::deliver(std::span<hal::byte> p_encoded)
+{
+  auto const decoded = detail::cobs_decode(p_encoded, p_encoded);
+  if (not decoded || *decoded < 3) {
+    m_errors++;
+    return;
+  }
+
+  auto const frame = p_encoded.first(*decoded);
+  auto const body = frame.first(frame.size() - 2);
+  auto const received_crc = static_cast<std::uint16_t>(
+    (frame[frame.size() - 2] << 8) | frame[frame.size() - 1]);
+  if (frame_crc::compute(body) != received_crc) {
+    m_errors++;
+    return;
+  }
+
+  auto const end = m_channels.begin() + m_channel_count;
+  auto const found = std::find_if(
+    m_channels.begin(), end, [&body](serial_channel const* p_channel) {
+      return p_channel->m_id == body[0];
+    });
+  if (found == end) {
+    m_errors++;
+    return;
+  }
+
+  auto* channel = *found;
+  auto const payload = body.subspan(1);
+  channel->m_dropped += payload.size() - channel->m_receive.push(payload);
+}
+}  // namespace hal
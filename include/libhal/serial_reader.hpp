@@ -0,0 +1,176 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+
+#include <atomic>
+#include <span>
+
+#include "error.hpp"
+#include "io_waiter.hpp"
+#include "serial.hpp"
+#include "timeout.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Blocking reads from a serial port that sleep instead of polling
+ *
+ * `hal::serial::read` returns whatever has been received, which is often
+ * nothing, so waiting for a complete message usually means calling it in a
+ * loop. serial_reader instead waits on a hal::io_waiter between reads, so the
+ * caller's thread blocks or the system sleeps until the serial port's
+ * interrupts report activity.
+ *
+ * The serial driver, or the application's interrupt handler for it, calls
+ * `notify_receive()` when bytes arrive and `notify_idle()` when the receive
+ * line goes idle after a burst of bytes (the "idle line" interrupt of most
+ * UARTs). Both are safe to call from an interrupt and resume the waiter.
+ *
+ * The timeout passed to each read is checked every time the waiter returns,
+ * so the waiter must also return when the deadline passes, for example by
+ * having the timer backing the timeout resume it.
+ *
+ * USAGE:
+ *
+ *      hal::serial_reader reader(uart, waiter);
+ *      // In the UART interrupt handler:
+ *      //   reader.notify_receive();  on receive
+ *      //   reader.notify_idle();     on idle line
+ *
+ *      std::array<hal::byte, 64> buffer{};
+ *      auto const header = reader.read_at_least(buffer, 4, timeout);
+ *      auto const burst = reader.read_until_idle(buffer, timeout);
+ */
+class serial_reader
+{
+public:
+  /**
+   * @brief Construct a new serial reader object
+   *
+   * @param p_serial - serial port to read from
+   * @param p_waiter - waiter used while no bytes are available
+   */
+  serial_reader(hal::serial& p_serial,
+                hal::io_waiter& p_waiter = hal::polling_io_waiter())
+    : m_serial(&p_serial)
+    , m_waiter(&p_waiter)
+  {
+  }
+
+  serial_reader(serial_reader const&) = delete;
+  serial_reader& operator=(serial_reader const&) = delete;
+  serial_reader(serial_reader&&) = delete;
+  serial_reader& operator=(serial_reader&&) = delete;
+
+  /**
+   * @brief Report that the serial port has received bytes
+   *
+   * Safe to call from an interrupt service routine.
+   */
+  void notify_receive() noexcept
+  {
+    m_waiter->resume();
+  }
+
+  /**
+   * @brief Report that the receive line has gone idle
+   *
+   * Safe to call from an interrupt service routine.
+   */
+  void notify_idle() noexcept
+  {
+    m_idle.store(true, std::memory_order_release);
+    m_waiter->resume();
+  }
+
+  /**
+   * @brief Read until at least p_minimum bytes have been received
+   *
+   * Bytes already received beyond p_minimum are also returned, up to the size
+   * of p_buffer.
+   *
+   * @param p_buffer - buffer to read into
+   * @param p_minimum - number of bytes to wait for, at most p_buffer.size()
+   * @param p_timeout - called each time the waiter returns
+   * @return std::span<hal::byte> - the filled portion of p_buffer
+   * @throws hal::argument_out_of_domain - if p_minimum exceeds the buffer
+   * @throws hal::timed_out - (or whatever p_timeout throws) if the bytes did
+   * not arrive in time. Bytes read so far are left in p_buffer.
+   */
+  std::span<hal::byte> read_at_least(std::span<hal::byte> p_buffer,
+                                     std::size_t p_minimum,
+                                     hal::timeout auto p_timeout)
+  {
+    if (p_minimum > p_buffer.size()) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+
+    std::size_t length = 0;
+    while (true) {
+      length += m_serial->read(p_buffer.subspan(length)).data.size();
+      if (length >= p_minimum) {
+        return p_buffer.first(length);
+      }
+      m_waiter->wait();
+      p_timeout();
+    }
+  }
+
+  /**
+   * @brief Read a burst of bytes, returning once the line goes idle
+   *
+   * Waits for the first byte, then keeps reading until `notify_idle()`
+   * reports the end of the burst or p_buffer is full. Idle notifications from
+   * before the first byte of the burst are ignored.
+   *
+   * @param p_buffer - buffer to read into
+   * @param p_timeout - called each time the waiter returns
+   * @return std::span<hal::byte> - the filled portion of p_buffer
+   * @throws hal::timed_out - (or whatever p_timeout throws) if the burst did
+   * not end in time. Bytes read so far are left in p_buffer.
+   */
+  std::span<hal::byte> read_until_idle(std::span<hal::byte> p_buffer,
+                                       hal::timeout auto p_timeout)
+  {
+    m_idle.store(false, std::memory_order_relaxed);
+
+    std::size_t length = 0;
+    while (true) {
+      length += m_serial->read(p_buffer.subspan(length)).data.size();
+      if (length == p_buffer.size()) {
+        return p_buffer;
+      }
+      if (m_idle.exchange(false, std::memory_order_acquire)) {
+        // Collect bytes received between the last read and the idle event.
+        // The whole burst may have landed there, so an idle event is only
+        // stale if there are still no bytes afterwards.
+        length += m_serial->read(p_buffer.subspan(length)).data.size();
+        if (length != 0) {
+          return p_buffer.first(length);
+        }
+      }
+      m_waiter->wait();
+      p_timeout();
+    }
+  }
+
+private:
+  hal::serial* m_serial;
+  hal::io_waiter* m_waiter;
+  std::atomic<bool> m_idle = false;
+};
+}  // namespace hal
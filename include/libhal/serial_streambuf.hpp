@@ -0,0 +1,143 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+
+#include <algorithm>
+#include <span>
+#include <streambuf>
+
+#include "error.hpp"
+#include "serial.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief std::streambuf over a hal::serial port
+ *
+ * Lets host code use iostreams with any serial port:
+ *
+ *      std::array<char, 256> output{};
+ *      std::array<char, 64> input{};
+ *      hal::serial_streambuf buffer(serial, output, input);
+ *      std::ostream stream(&buffer);
+ *      stream << "temperature=" << 23.5 << std::endl;
+ *
+ * Output is gathered in the output buffer and written to the serial port in
+ * one call when the buffer fills or the stream is flushed. Bytes the port
+ * does not accept stay in the buffer for the next write. If the port accepts
+ * nothing while the buffer is full, the stream sets badbit, as it does when a
+ * flush leaves bytes unwritten. Pair with
+ * hal::buffered_serial_writer when writes must also be flushed on a deadline.
+ *
+ * Input never waits: when no bytes have been received, reading reaches end of
+ * file, which the stream reports by setting eofbit. Clear the stream state and
+ * read again once more bytes are expected.
+ *
+ * The destructor does not write pending output, because errors from the
+ * serial port cannot propagate out of it. Flush the stream before the buffer
+ * is destroyed.
+ */
+class serial_streambuf : public std::streambuf
+{
+public:
+  /**
+   * @brief Construct a new serial streambuf object
+   *
+   * @param p_serial - serial port to read and write
+   * @param p_output - buffer for output, at least 2 characters
+   * @param p_input - buffer for input, at least 1 character
+   * @throws hal::argument_out_of_domain - if either buffer is too small
+   */
+  serial_streambuf(hal::serial& p_serial,
+                   std::span<char> p_output,
+                   std::span<char> p_input)
+    : m_serial(&p_serial)
+    , m_input(p_input)
+  {
+    if (p_output.size() < 2 || p_input.empty()) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    // Leave room for the character passed to overflow()
+    setp(p_output.data(), p_output.data() + p_output.size() - 1);
+    setg(p_input.data(), p_input.data(), p_input.data());
+  }
+
+  serial_streambuf(serial_streambuf const&) = delete;
+  serial_streambuf& operator=(serial_streambuf const&) = delete;
+  serial_streambuf(serial_streambuf&&) = delete;
+  serial_streambuf& operator=(serial_streambuf&&) = delete;
+
+protected:
+  int_type overflow(int_type p_character) override
+  {
+    if (not traits_type::eq_int_type(p_character, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(p_character);
+      pbump(1);
+    }
+    write_pending();
+    if (pptr() > epptr()) {
+      // Nothing was accepted, give back the reserved character
+      pbump(-1);
+      return traits_type::eof();
+    }
+    return traits_type::not_eof(p_character);
+  }
+
+  int sync() override
+  {
+    write_pending();
+    return pptr() == pbase() ? 0 : -1;
+  }
+
+  int_type underflow() override
+  {
+    if (gptr() < egptr()) {
+      return traits_type::to_int_type(*gptr());
+    }
+    auto const received =
+      m_serial
+        ->read(std::span(reinterpret_cast<hal::byte*>(m_input.data()),
+                         m_input.size()))
+        .data.size();
+    if (received == 0) {
+      return traits_type::eof();
+    }
+    setg(m_input.data(), m_input.data(), m_input.data() + received);
+    return traits_type::to_int_type(*gptr());
+  }
+
+private:
+  /// Write pending output, keeping whatever the port does not accept
+  void write_pending()
+  {
+    auto const length = static_cast<std::size_t>(pptr() - pbase());
+    if (length == 0) {
+      return;
+    }
+    auto const written =
+      m_serial
+        ->write(std::span(reinterpret_cast<hal::byte const*>(pbase()), length))
+        .data.size();
+    std::copy(pbase() + written, pptr(), pbase());
+    setp(pbase(), epptr());
+    pbump(static_cast<int>(length - written));
+  }
+
+  hal::serial* m_serial;
+  std::span<char> m_input;
+};
+}  // namespace hal
@@ -0,0 +1,291 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <span>
+
+#include "error.hpp"
+#include "serial.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Lock-free multi-producer single-consumer transmit queue for serial
+ *
+ * Any number of tasks or interrupts push complete frames with `push()` without
+ * blocking on each other or on the serial port. A single context calls
+ * `drain()`, which gathers every committed frame into a staging buffer and
+ * passes it to `hal::serial::write` in as few calls as possible.
+ *
+ * Frames are never interleaved: each frame is written to the serial port
+ * after every frame pushed before it. If the serial port accepts only part of
+ * a write, the rest stays in the staging buffer and is written first by the
+ * next `drain()`, so no bytes are lost or reordered. When the queue is
+ * full, `push()` returns false rather than waiting, leaving the producer to
+ * decide whether to drop, retry or slow down. The number of rejected frames is
+ * available from `rejected()`.
+ *
+ * Internally the queue is a ring of 32-bit words. Each frame occupies a header
+ * word followed by its payload. Producers reserve space by advancing the head
+ * with a compare and swap, copy their payload, then publish the header with a
+ * release store. Frames never wrap around the end of the ring; a padding
+ * record fills the remainder of the ring instead.
+ */
+class serial_tx_queue
+{
+public:
+  /**
+   * @brief Construct a new serial tx queue object
+   *
+   * @param p_storage - ring storage, the number of words must be a power of 2
+   * and at least 4.
+   * @param p_staging - buffer frames are gathered into before each write to
+   * the serial port, must be at least `max_frame_size()` bytes.
+   * @throws hal::argument_out_of_domain - if p_storage is not a power of 2 or
+   * p_staging is too small to hold the largest frame
+   */
+  serial_tx_queue(std::span<std::uint32_t> p_storage,
+                  std::span<hal::byte> p_staging)
+    : m_ring(p_storage)
+    , m_staging(p_staging)
+    , m_mask(p_storage.size() - 1)
+  {
+    if (p_storage.size() < 4 || not std::has_single_bit(p_storage.size()) ||
+        p_staging.size() < max_frame_size()) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    std::ranges::fill(m_ring, 0U);
+  }
+
+  serial_tx_queue(serial_tx_queue const&) = delete;
+  serial_tx_queue& operator=(serial_tx_queue const&) = delete;
+  serial_tx_queue(serial_tx_queue&&) = delete;
+  serial_tx_queue& operator=(serial_tx_queue&&) = delete;
+
+  /**
+   * @brief Largest frame that can be pushed
+   *
+   * Limited to half of the ring so a frame always fits once the queue drains,
+   * regardless of where it lands relative to the end of the ring.
+   *
+   * @return std::size_t - maximum frame length in bytes
+   */
+  [[nodiscard]] std::size_t max_frame_size() const
+  {
+    return (m_ring.size() / 2 - 1) * sizeof(std::uint32_t);
+  }
+
+  /**
+   * @brief Queue a complete frame for transmission
+   *
+   * Safe to call concurrently from any number of threads and interrupts.
+   *
+   * @param p_frame - bytes to transmit as one unit
+   * @return true - the frame was queued
+   * @return false - the queue is full, the frame was not queued
+   * @throws hal::message_size - if p_frame exceeds `max_frame_size()`
+   */
+  bool push(std::span<hal::byte const> p_frame)
+  {
+    if (p_frame.size() > max_frame_size()) {
+      hal::safe_throw(
+        hal::message_size(static_cast<std::uint32_t>(max_frame_size()), this));
+    }
+
+    auto const record_words = 1 + words_for(p_frame.size());
+    auto head = m_head.load(std::memory_order_relaxed);
+    std::size_t padding_words = 0;
+    while (true) {
+      auto const tail = m_tail.load(std::memory_order_acquire);
+      auto const until_end = m_ring.size() - (head & m_mask);
+      padding_words = record_words <= until_end ? 0 : until_end;
+      if (head + padding_words + record_words - tail > m_ring.size()) {
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      if (m_head.compare_exchange_weak(head,
+                                       head + padding_words + record_words,
+                                       std::memory_order_relaxed)) {
+        break;
+      }
+    }
+
+    if (padding_words != 0) {
+      publish(head & m_mask,
+              committed_flag | padding_flag |
+                static_cast<std::uint32_t>(padding_words));
+      head += padding_words;
+    }
+
+    auto const index = head & m_mask;
+    if (not p_frame.empty()) {
+      std::memcpy(&m_ring[index + 1], p_frame.data(), p_frame.size());
+    }
+    publish(index, committed_flag | static_cast<std::uint32_t>(p_frame.size()));
+    return true;
+  }
+
+  /// Result of a drain operation
+  struct drain_t
+  {
+    /// Number of frames taken from the queue for writing
+    std::size_t frames = 0;
+    /// Number of frame bytes taken from the queue for writing
+    std::size_t bytes = 0;
+  };
+
+  /**
+   * @brief Write every committed frame to the serial port
+   *
+   * Must only be called from one context at a time. Frames are gathered into
+   * the staging buffer and written whenever the next frame would not fit.
+   * Draining stops at the first frame that has been reserved by a producer
+   * but not yet committed, preserving the order of frames.
+   *
+   * Bytes the serial port did not accept are kept in the staging buffer and
+   * written before anything else on the next call. Draining also stops when
+   * the staging buffer cannot be emptied to make room for the next frame, the
+   * frame then stays in the queue.
+   *
+   * @param p_serial - serial port to transmit frames over
+   * @return drain_t - number of frames and bytes taken from the queue
+   */
+  drain_t drain(hal::serial& p_serial)
+  {
+    drain_t result{};
+    if (not write_staged(p_serial)) {
+      return result;
+    }
+
+    auto tail = m_tail.load(std::memory_order_relaxed);
+
+    while (true) {
+      auto const index = tail & m_mask;
+      auto const header =
+        std::atomic_ref(m_ring[index]).load(std::memory_order_acquire);
+      if ((header & committed_flag) == 0) {
+        break;
+      }
+
+      auto words = std::size_t{ header & length_mask };
+      if ((header & padding_flag) == 0) {
+        auto const length = std::size_t{ header & length_mask };
+        if (m_staged + length > m_staging.size() &&
+            not write_staged(p_serial)) {
+          break;
+        }
+        if (length != 0) {
+          std::memcpy(&m_staging[m_staged], &m_ring[index + 1], length);
+        }
+        m_staged += length;
+        result.frames++;
+        result.bytes += length;
+        words = 1 + words_for(length);
+      }
+
+      std::fill_n(&m_ring[index], words, 0U);
+      tail += words;
+      m_tail.store(tail, std::memory_order_release);
+    }
+
+    write_staged(p_serial);
+    return result;
+  }
+
+  /**
+   * @brief Number of frames rejected because the queue was full
+   *
+   * @return std::uint32_t - rejected frame count
+   */
+  [[nodiscard]] std::uint32_t rejected() const
+  {
+    return m_rejected.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Bytes of the ring reserved by queued frames, including headers
+   *
+   * Producers can use this to throttle themselves before the queue is full.
+   *
+   * @return std::size_t - number of bytes in use
+   */
+  [[nodiscard]] std::size_t used() const
+  {
+    auto const tail = m_tail.load(std::memory_order_relaxed);
+    auto const head = m_head.load(std::memory_order_relaxed);
+    return (head - tail) * sizeof(std::uint32_t);
+  }
+
+  /**
+   * @brief Total bytes of the ring
+   *
+   * @return std::size_t - ring capacity in bytes
+   */
+  [[nodiscard]] std::size_t capacity() const
+  {
+    return m_ring.size() * sizeof(std::uint32_t);
+  }
+
+private:
+  static constexpr std::uint32_t committed_flag = 1U << 31;
+  static constexpr std::uint32_t padding_flag = 1U << 30;
+  static constexpr std::uint32_t length_mask = padding_flag - 1;
+
+  static constexpr std::size_t words_for(std::size_t p_bytes)
+  {
+    return (p_bytes + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t);
+  }
+
+  void publish(std::size_t p_index, std::uint32_t p_header)
+  {
+    std::atomic_ref(m_ring[p_index]).store(p_header, std::memory_order_release);
+  }
+
+  /// Write staged bytes until the port stops accepting them, true if all were
+  /// written
+  bool write_staged(hal::serial& p_serial)
+  {
+    while (m_written < m_staged) {
+      auto const remaining =
+        m_staging.subspan(m_written, m_staged - m_written);
+      auto const written = p_serial.write(remaining).data.size();
+      if (written == 0) {
+        return false;
+      }
+      m_written += written;
+    }
+    m_staged = 0;
+    m_written = 0;
+    return true;
+  }
+
+  std::span<std::uint32_t> m_ring;
+  std::span<hal::byte> m_staging;
+  std::size_t m_mask;
+  // Bytes in the staging buffer, and how many of them have been written
+  std::size_t m_staged = 0;
+  std::size_t m_written = 0;
+  std::atomic<std::size_t> m_head = 0;
+  std::atomic<std::size_t> m_tail = 0;
+  std::atomic<std::uint32_t> m_rejected = 0;
+};
+}  // namespace hal
@@ -0,0 +1,921 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @defgroup Simulation Simulation
+ * @file simulation.hpp
+ * @brief Deterministic virtual time simulation kernel and simulated drivers
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <span>
+
+#include "can.hpp"
+#include "error.hpp"
+#include "functional.hpp"
+#include "i2c.hpp"
+#include "interrupt_pin.hpp"
+#include "serial.hpp"
+#include "spi.hpp"
+#include "steady_clock.hpp"
+#include "timeout.hpp"
+#include "timer.hpp"
+#include "units.hpp"
+
+/**
+ * @ingroup Simulation
+ * @brief Simulated hardware driven by a virtual clock
+ *
+ * Every simulated driver shares a single hal::sim::kernel. Time only moves
+ * forward when the kernel is told to run or when a simulated driver performs a
+ * blocking operation, such as transmitting bytes over serial, which advances
+ * the clock by the time the operation would take on real hardware. Events
+ * scheduled for the same instant run in the order they were scheduled, making
+ * every run of a simulation identical.
+ *
+ * Because no real time passes, whole applications can be run far faster than
+ * real time, making the simulation suitable for load tests and performance
+ * regression tests in CI.
+ */
+namespace hal::sim {
+/**
+ * @ingroup Simulation
+ * @brief Identifier of a scheduled event, used for cancellation
+ *
+ */
+using event_id = std::uint64_t;
+
+/**
+ * @ingroup Simulation
+ * @brief Entry in the kernel's event queue
+ *
+ * Only the kernel should access the fields of this type. It is public so that
+ * applications can supply storage for the event queue.
+ */
+struct event
+{
+  hal::time_duration time{};
+  event_id id = 0;
+  bool cancelled = false;
+  hal::callback<void(void)> action = []() {};
+};
+
+/**
+ * @ingroup Simulation
+ * @brief Virtual clock and event queue shared by all simulated drivers
+ *
+ */
+class kernel
+{
+public:
+  /**
+   * @brief Construct a new kernel object
+   *
+   * @param p_storage - storage for the event queue. The size of this span is
+   * the maximum number of events that can be pending at once.
+   */
+  explicit kernel(std::span<event> p_storage)
+    : m_storage(p_storage)
+  {
+  }
+
+  kernel(kernel const&) = delete;
+  kernel& operator=(kernel const&) = delete;
+  kernel(kernel&&) = delete;
+  kernel& operator=(kernel&&) = delete;
+
+  /**
+   * @brief Current virtual time
+   *
+   * @return hal::time_duration - time since the start of the simulation
+   */
+  [[nodiscard]] hal::time_duration now() const
+  {
+    return m_now;
+  }
+
+  /**
+   * @brief Schedule an action to run at an absolute virtual time
+   *
+   * Times in the past are run at the current time on the next call to any of
+   * the run functions.
+   *
+   * @param p_time - time at which to run the action
+   * @param p_action - action to run
+   * @return event_id - identifier that can be passed to `cancel()`
+   * @throws hal::resource_unavailable_try_again - if the event queue is full
+   */
+  event_id schedule_at(hal::time_duration p_time,
+                       hal::callback<void(void)> p_action)
+  {
+    if (m_size == m_storage.size()) {
+      hal::safe_throw(hal::resource_unavailable_try_again(this));
+    }
+    auto const id = ++m_last_id;
+    m_storage[m_size] = event{
+      .time = std::max(p_time, m_now),
+      .id = id,
+      .cancelled = false,
+      .action = p_action,
+    };
+    m_size++;
+    std::push_heap(m_storage.begin(), m_storage.begin() + m_size, later);
+    return id;
+  }
+
+  /**
+   * @brief Schedule an action to run after a delay
+   *
+   * @param p_delay - amount of virtual time from now
+   * @param p_action - action to run
+   * @return event_id - identifier that can be passed to `cancel()`
+   * @throws hal::resource_unavailable_try_again - if the event queue is full
+   */
+  event_id schedule_after(hal::time_duration p_delay,
+                          hal::callback<void(void)> p_action)
+  {
+    return schedule_at(m_now + p_delay, p_action);
+  }
+
+  /**
+   * @brief Prevent a pending event from running
+   *
+   * @param p_id - id returned when the event was scheduled
+   * @return true - if the event was pending and is now cancelled
+   */
+  bool cancel(event_id p_id)
+  {
+    for (auto& entry : m_storage.first(m_size)) {
+      if (entry.id == p_id && not entry.cancelled) {
+        entry.cancelled = true;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Run all events up to and including p_time, then set the clock to
+   * p_time
+   *
+   * Events may schedule further events, which are also run if they fall
+   * within p_time. The clock never moves backwards, so a nested call that
+   * already moved beyond p_time leaves the clock where it is.
+   *
+   * @param p_time - absolute virtual time to run to
+   */
+  void run_until(hal::time_duration p_time)
+  {
+    while (m_size != 0 && m_storage[0].time <= p_time) {
+      run_next();
+    }
+    m_now = std::max(m_now, p_time);
+  }
+
+  /**
+   * @brief Run the simulation for a duration of virtual time
+   *
+   * @param p_duration - amount of virtual time to run for
+   */
+  void run_for(hal::time_duration p_duration)
+  {
+    run_until(m_now + p_duration);
+  }
+
+  /**
+   * @brief Run the next pending event, advancing the clock to its time
+   *
+   * @return true - if an event was found, false if the queue was empty
+   */
+  bool step()
+  {
+    if (m_size == 0) {
+      return false;
+    }
+    run_next();
+    return true;
+  }
+
+  /**
+   * @brief Number of pending events, including cancelled events that have not
+   * been discarded yet
+   *
+   * @return std::size_t - number of events in the queue
+   */
+  [[nodiscard]] std::size_t pending() const
+  {
+    return m_size;
+  }
+
+private:
+  static bool later(event const& p_left, event const& p_right)
+  {
+    if (p_left.time != p_right.time) {
+      return p_left.time > p_right.time;
+    }
+    return p_left.id > p_right.id;
+  }
+
+  void run_next()
+  {
+    std::pop_heap(m_storage.begin(), m_storage.begin() + m_size, later);
+    m_size--;
+    // Copy the event out before running it, as the action may schedule new
+    // events into the slot it occupied.
+    auto next = m_storage[m_size];
+    m_now = std::max(m_now, next.time);
+    if (not next.cancelled) {
+      next.action();
+    }
+  }
+
+  std::span<event> m_storage;
+  std::size_t m_size = 0;
+  event_id m_last_id = 0;
+  hal::time_duration m_now{};
+};
+
+/**
+ * @ingroup Simulation
+ * @brief Steady clock that reads the kernel's virtual time
+ *
+ */
+class steady_clock : public hal::steady_clock
+{
+public:
+  /**
+   * @brief Construct a new steady clock object
+   *
+   * @param p_kernel - simulation kernel
+   * @param p_frequency - tick rate of the clock, defaults to 1 tick per
+   * nanosecond of virtual time.
+   */
+  steady_clock(kernel& p_kernel, hertz p_frequency = 1.0_GHz)
+    : m_kernel(&p_kernel)
+    , m_frequency(p_frequency)
+  {
+  }
+
+private:
+  hertz driver_frequency() override
+  {
+    return m_frequency;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    auto const nanoseconds = static_cast<double>(m_kernel->now().count());
+    return static_cast<std::uint64_t>(nanoseconds * m_frequency / 1e9);
+  }
+
+  kernel* m_kernel;
+  hertz m_frequency;
+};
+
+/**
+ * @ingroup Simulation
+ * @brief Timer that fires its callback from the kernel's event queue
+ *
+ */
+class timer : public hal::timer
+{
+public:
+  /**
+   * @brief Construct a new timer object
+   *
+   * @param p_kernel - simulation kernel
+   */
+  timer(kernel& p_kernel)
+    : m_kernel(&p_kernel)
+  {
+  }
+
+  timer(timer const&) = delete;
+  timer& operator=(timer const&) = delete;
+  timer(timer&&) = delete;
+  timer& operator=(timer&&) = delete;
+
+  ~timer() override
+  {
+    driver_cancel();
+  }
+
+private:
+  bool driver_is_running() override
+  {
+    return m_running;
+  }
+
+  void driver_cancel() override
+  {
+    if (m_running) {
+      m_kernel->cancel(m_event);
+      m_running = false;
+    }
+  }
+
+  void driver_schedule(hal::callback<void(void)> p_callback,
+                       hal::time_duration p_delay) override
+  {
+    driver_cancel();
+    m_callback = p_callback;
+    // A delay of zero ticks is scheduled for one tick, see hal::timer
+    auto const delay = std::max(p_delay, hal::time_duration(1));
+    m_event = m_kernel->schedule_after(delay, [this]() { expire(); });
+    m_running = true;
+  }
+
+  void expire()
+  {
+    m_running = false;
+    m_callback();
+  }
+
+  kernel* m_kernel;
+  hal::callback<void(void)> m_callback = []() {};
+  event_id m_event = 0;
+  bool m_running = false;
+};
+
+/**
+ * @ingroup Simulation
+ * @brief Interrupt pin whose level is driven by the test or application
+ *
+ */
+class interrupt_pin : public hal::interrupt_pin
+{
+public:
+  /**
+   * @brief Construct a new interrupt pin object
+   *
+   * @param p_kernel - simulation kernel
+   * @param p_initial_level - level of the pin at construction
+   */
+  interrupt_pin(kernel& p_kernel, bool p_initial_level = true)
+    : m_kernel(&p_kernel)
+    , m_level(p_initial_level)
+  {
+  }
+
+  /**
+   * @brief Drive the pin to a level now
+   *
+   * If the transition matches the trigger edge, the handler is called
+   * immediately.
+   *
+   * @param p_level - new level of the pin
+   */
+  void set_level(bool p_level)
+  {
+    if (p_level == m_level) {
+      return;
+    }
+    m_level = p_level;
+    using enum trigger_edge;
+    auto const trigger = m_settings.trigger;
+    if (trigger == both || (trigger == rising && p_level) ||
+        (trigger == falling && not p_level)) {
+      m_handler(p_level);
+    }
+  }
+
+  /**
+   * @brief Drive the pin to a level at a future virtual time
+   *
+   * @param p_time - absolute virtual time of the transition
+   * @param p_level - new level of the pin
+   * @return event_id - id of the scheduled transition
+   * @throws hal::resource_unavailable_try_again - if the event queue is full
+   */
+  event_id set_level_at(hal::time_duration p_time, bool p_level)
+  {
+    return m_kernel->schedule_at(p_time,
+                                 [this, p_level]() { set_level(p_level); });
+  }
+
+  /**
+   * @brief Current level of the pin
+   *
+   * @return true - if HIGH
+   */
+  [[nodiscard]] bool level() const
+  {
+    return m_level;
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    m_settings = p_settings;
+  }
+
+  void driver_on_trigger(hal::callback<handler> p_callback) override
+  {
+    m_handler = p_callback;
+  }
+
+  kernel* m_kernel;
+  settings m_settings{};
+  hal::callback<handler> m_handler = [](bool) {};
+  bool m_level;
+};
+
+/**
+ * @ingroup Simulation
+ * @brief Serial port that transmits bytes in virtual time
+ *
+ * A write blocks the caller while advancing the kernel by the transmission time
+ * of each byte at the configured baud rate. Each byte is delivered to the
+ * connected peer port at the virtual time its stop bit completes, so events
+ * scheduled during the transmission interleave exactly as they would on real
+ * hardware.
+ *
+ * Bytes from outside of the simulation, such as a simulated sensor, can be
+ * delivered with `receive()`.
+ */
+class serial : public hal::serial
+{
+public:
+  /**
+   * @brief Construct a new serial object
+   *
+   * @param p_kernel - simulation kernel
+   * @param p_receive_buffer - working buffer for received bytes
+   */
+  serial(kernel& p_kernel, std::span<hal::byte> p_receive_buffer)
+    : m_kernel(&p_kernel)
+    , m_buffer(p_receive_buffer)
+  {
+  }
+
+  serial(serial const&) = delete;
+  serial& operator=(serial const&) = delete;
+  serial(serial&&) = delete;
+  serial& operator=(serial&&) = delete;
+
+  /**
+   * @brief Connect the transmit line of this port to the receive line of
+   * another port and vice versa.
+   *
+   * @param p_peer - port to connect to
+   */
+  void connect(serial& p_peer)
+  {
+    m_peer = &p_peer;
+    p_peer.m_peer = this;
+  }
+
+  /**
+   * @brief Place bytes in the receive buffer now
+   *
+   * Bytes that do not fit are dropped and reported via the `available` field
+   * of read_t.
+   *
+   * @param p_data - bytes received
+   */
+  void receive(std::span<hal::byte const> p_data)
+  {
+    for (auto const value : p_data) {
+      if (m_count == m_buffer.size()) {
+        m_dropped++;
+        continue;
+      }
+      m_buffer[(m_head + m_count) % m_buffer.size()] = value;
+      m_count++;
+    }
+  }
+
+  /**
+   * @brief Time to transmit a single frame at the configured settings
+   *
+   * @return hal::time_duration - duration of one start bit, eight data bits,
+   * the parity bit if enabled and the stop bits.
+   */
+  [[nodiscard]] hal::time_duration byte_time() const
+  {
+    auto bits = 10.0f;
+    if (m_settings.parity != settings::parity::none) {
+      bits += 1.0f;
+    }
+    if (m_settings.stop == settings::stop_bits::two) {
+      bits += 1.0f;
+    }
+    using seconds = std::chrono::duration<float>;
+    return std::chrono::duration_cast<hal::time_duration>(
+      seconds(bits / m_settings.baud_rate));
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    if (p_settings.baud_rate <= 0.0f) {
+      hal::safe_throw(hal::operation_not_supported(this));
+    }
+    m_settings = p_settings;
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    auto const frame = byte_time();
+    auto const start = m_kernel->now();
+    for (std::size_t i = 0; i < p_data.size(); i++) {
+      m_kernel->run_until(start + frame * static_cast<std::int64_t>(i + 1));
+      if (m_peer != nullptr) {
+        m_peer->receive(p_data.subspan(i, 1));
+      }
+    }
+    return { .data = p_data };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    auto const available = m_count + m_dropped;
+    auto const count = std::min(p_data.size(), m_count);
+    for (std::size_t i = 0; i < count; i++) {
+      p_data[i] = m_buffer[m_head];
+      m_head = (m_head + 1) % m_buffer.size();
+    }
+    m_count -= count;
+    m_dropped = 0;
+    return {
+      .data = p_data.first(count),
+      .available = available,
+      .capacity = m_buffer.size(),
+    };
+  }
+
+  void driver_flush() override
+  {
+    m_head = 0;
+    m_count = 0;
+    m_dropped = 0;
+  }
+
+  kernel* m_kernel;
+  std::span<hal::byte> m_buffer;
+  serial* m_peer = nullptr;
+  settings m_settings{};
+  std::size_t m_head = 0;
+  std::size_t m_count = 0;
+  std::size_t m_dropped = 0;
+};
+
+class can;
+
+/**
+ * @ingroup Simulation
+ * @brief A CAN bus connecting simulated CAN controllers
+ *
+ */
+class can_bus
+{
+public:
+  /// Maximum number of controllers attached to a single bus
+  static constexpr std::size_t max_nodes = 16;
+
+  /**
+   * @brief Construct a new can bus object
+   *
+   * @param p_kernel - simulation kernel
+   */
+  can_bus(kernel& p_kernel)
+    : m_kernel(&p_kernel)
+  {
+  }
+
+  can_bus(can_bus const&) = delete;
+  can_bus& operator=(can_bus const&) = delete;
+  can_bus(can_bus&&) = delete;
+  can_bus& operator=(can_bus&&) = delete;
+
+  /**
+   * @brief Number of frames transmitted on the bus
+   *
+   * @return std::uint64_t - total frame count
+   */
+  [[nodiscard]] std::uint64_t frame_count() const
+  {
+    return m_frame_count;
+  }
+
+private:
+  friend class can;
+
+  void attach(can* p_node)
+  {
+    if (m_node_count == m_nodes.size()) {
+      hal::safe_throw(hal::resource_unavailable_try_again(this));
+    }
+    m_nodes[m_node_count++] = p_node;
+  }
+
+  void detach(can* p_node)
+  {
+    auto const end = m_nodes.begin() + m_node_count;
+    auto const found = std::find(m_nodes.begin(), end, p_node);
+    if (found != end) {
+      std::copy(found + 1, end, found);
+      m_node_count--;
+    }
+  }
+
+  void transmit(can const* p_sender,
+                hal::can::message_t const& p_message,
+                hertz p_baud_rate);
+
+  kernel* m_kernel;
+  std::array<can*, max_nodes> m_nodes{};
+  std::size_t m_node_count = 0;
+  std::uint64_t m_frame_count = 0;
+};
+
+/**
+ * @ingroup Simulation
+ * @brief CAN controller attached to a simulated CAN bus
+ *
+ * Sending a message blocks the caller while advancing the kernel by the frame
+ * time at the configured baud rate (bit stuffing is not modelled), after which
+ * every other controller on the bus receives the message.
+ */
+class can : public hal::can
+{
+public:
+  /**
+   * @brief Construct a new can object and attach it to the bus
+   *
+   * @param p_bus - bus to attach to
+   * @throws hal::resource_unavailable_try_again - if the bus already has
+   * can_bus::max_nodes controllers.
+   */
+  can(can_bus& p_bus)
+    : m_bus(&p_bus)
+  {
+    m_bus->attach(this);
+  }
+
+  can(can const&) = delete;
+  can& operator=(can const&) = delete;
+  can(can&&) = delete;
+  can& operator=(can&&) = delete;
+
+  /**
+   * @brief Simulate the controller entering or leaving the bus-off state
+   *
+   * @param p_bus_off - true to enter bus-off
+   */
+  void set_bus_off(bool p_bus_off)
+  {
+    m_bus_off = p_bus_off;
+  }
+
+  ~can() override
+  {
+    m_bus->detach(this);
+  }
+
+private:
+  friend class can_bus;
+
+  void driver_configure(settings const& p_settings) override
+  {
+    if (p_settings.baud_rate <= 0.0f) {
+      hal::safe_throw(hal::operation_not_supported(this));
+    }
+    m_settings = p_settings;
+  }
+
+  void driver_bus_on() override
+  {
+    m_bus_off = false;
+  }
+
+  void driver_send(message_t const& p_message) override
+  {
+    if (m_bus_off) {
+      hal::safe_throw(hal::operation_not_permitted(this));
+    }
+    m_bus->transmit(this, p_message, m_settings.baud_rate);
+  }
+
+  void driver_on_receive(hal::callback<handler> p_handler) override
+  {
+    m_handler = p_handler;
+  }
+
+  can_bus* m_bus;
+  settings m_settings{};
+  hal::callback<handler> m_handler = [](message_t const&) {};
+  bool m_bus_off = false;
+};
+
+inline void can_bus::transmit(can const* p_sender,
+                              hal::can::message_t const& p_message,
+                              hertz p_baud_rate)
+{
+  // Frame overhead without bit stuffing: 47 bits for standard frames and 67
+  // bits for extended frames.
+  constexpr hal::can::id_t standard_id_limit = 0x7FF;
+  auto bits = p_message.id > standard_id_limit ? 67.0f : 47.0f;
+  if (not p_message.is_remote_request) {
+    bits += 8.0f * static_cast<float>(p_message.length);
+  }
+  using seconds = std::chrono::duration<float>;
+  m_kernel->run_for(std::chrono::duration_cast<hal::time_duration>(
+    seconds(bits / p_baud_rate)));
+  m_frame_count++;
+
+  for (auto* node : std::span(m_nodes).first(m_node_count)) {
+    if (node != p_sender && not node->m_bus_off) {
+      node->m_handler(p_message);
+    }
+  }
+}
+
+/**
+ * @ingroup Simulation
+ * @brief Signature of a simulated i2c device
+ *
+ * @param p_data_out - bytes written by the controller
+ * @param p_data_in - bytes the device must fill to be read by the controller
+ */
+using i2c_device = void(std::span<hal::byte const> p_data_out,
+                        std::span<hal::byte> p_data_in);
+
+/**
+ * @ingroup Simulation
+ * @brief I2C controller with simulated devices attached to its bus
+ *
+ * A transaction advances the kernel by the time to clock every address and
+ * data byte (9 bits each) at the configured clock rate.
+ */
+class i2c : public hal::i2c
+{
+public:
+  /// Maximum number of devices attached to a single bus
+  static constexpr std::size_t max_devices = 16;
+
+  /**
+   * @brief Construct a new i2c object
+   *
+   * @param p_kernel - simulation kernel
+   */
+  i2c(kernel& p_kernel)
+    : m_kernel(&p_kernel)
+  {
+  }
+
+  /**
+   * @brief Attach a simulated device to the bus
+   *
+   * @param p_address - 7-bit address of the device
+   * @param p_device - device behavior
+   * @throws hal::resource_unavailable_try_again - if max_devices are attached
+   */
+  void attach(hal::byte p_address, hal::callback<i2c_device> p_device)
+  {
+    if (m_device_count == m_devices.size()) {
+      hal::safe_throw(hal::resource_unavailable_try_again(this));
+    }
+    m_devices[m_device_count++] = { .address = p_address, .device = p_device };
+  }
+
+private:
+  struct entry
+  {
+    hal::byte address = 0;
+    hal::callback<i2c_device> device = [](std::span<hal::byte const>,
+                                          std::span<hal::byte>) {};
+  };
+
+  void driver_configure(settings const& p_settings) override
+  {
+    if (p_settings.clock_rate <= 0.0f) {
+      hal::safe_throw(hal::operation_not_supported(this));
+    }
+    m_settings = p_settings;
+  }
+
+  void driver_transaction(
+    hal::byte p_address,
+    std::span<hal::byte const> p_data_out,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    if (p_data_out.empty() && p_data_in.empty()) {
+      return;
+    }
+
+    // One address byte for each of the write and read phases
+    std::size_t const phases =
+      (p_data_out.empty() ? 0 : 1) + (p_data_in.empty() ? 0 : 1);
+    auto const begin = m_devices.begin();
+    auto const end = begin + m_device_count;
+    auto const found =
+      std::find_if(begin, end, [p_address](entry const& p_entry) {
+        return p_entry.address == p_address;
+      });
+
+    if (found == end) {
+      advance(1);
+      p_timeout();
+      hal::safe_throw(hal::no_such_device(p_address, this));
+    }
+
+    found->device(p_data_out, p_data_in);
+    advance(phases + p_data_out.size() + p_data_in.size());
+    p_timeout();
+  }
+
+  void advance(std::size_t p_bytes)
+  {
+    // 9 clocks per byte for the data and acknowledge bits
+    auto const bits = static_cast<float>(p_bytes * 9);
+    using seconds = std::chrono::duration<float>;
+    m_kernel->run_for(std::chrono::duration_cast<hal::time_duration>(
+      seconds(bits / m_settings.clock_rate)));
+  }
+
+  kernel* m_kernel;
+  settings m_settings{};
+  std::array<entry, max_devices> m_devices{};
+  std::size_t m_device_count = 0;
+};
+
+/**
+ * @ingroup Simulation
+ * @brief Signature of a simulated spi device
+ *
+ * @param p_data_out - bytes written by the controller
+ * @param p_data_in - bytes the device must fill to be read by the controller
+ * @param p_filler - byte the controller clocks out after p_data_out
+ */
+using spi_device = void(std::span<hal::byte const> p_data_out,
+                        std::span<hal::byte> p_data_in,
+                        hal::byte p_filler);
+
+/**
+ * @ingroup Simulation
+ * @brief SPI controller connected to a simulated device
+ *
+ * A transfer advances the kernel by the time to clock the longer of the two
+ * buffers at the configured clock rate.
+ */
+class spi : public hal::spi
+{
+public:
+  /**
+   * @brief Construct a new spi object
+   *
+   * @param p_kernel - simulation kernel
+   * @param p_device - device behavior
+   */
+  spi(kernel& p_kernel, hal::callback<spi_device> p_device)
+    : m_kernel(&p_kernel)
+    , m_device(p_device)
+  {
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    if (p_settings.clock_rate <= 0.0f) {
+      hal::safe_throw(hal::operation_not_supported(this));
+    }
+    m_settings = p_settings;
+  }
+
+  void driver_transfer(std::span<hal::byte const> p_data_out,
+                       std::span<hal::byte> p_data_in,
+                       hal::byte p_filler) override
+  {
+    m_device(p_data_out, p_data_in, p_filler);
+    auto const bytes = std::max(p_data_out.size(), p_data_in.size());
+    auto const bits = static_cast<float>(bytes * 8);
+    using seconds = std::chrono::duration<float>;
+    m_kernel->run_for(std::chrono::duration_cast<hal::time_duration>(
+      seconds(bits / m_settings.clock_rate)));
+  }
+
+  kernel* m_kernel;
+  hal::callback<spi_device> m_device;
+  settings m_settings{};
+};
+}  // namespace hal::sim
@@ -0,0 +1,486 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "error.hpp"
+#include "initializers.hpp"
+#include "serial.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Lock policy that performs no locking
+ *
+ * For allocators used from a single context.
+ */
+struct no_lock
+{
+  void lock()
+  {
+  }
+  void unlock()
+  {
+  }
+};
+
+/**
+ * @brief Lock policy that busy waits on an atomic flag
+ *
+ * Suitable for threads on multi-core systems and RTOS tasks. It must not be
+ * used to share an allocator between an interrupt service routine and the code
+ * it interrupts, as the ISR would spin forever on a lock held by the
+ * interrupted code. For that case, supply a lock policy type with `lock()` and
+ * `unlock()` functions that mask interrupts.
+ */
+class spin_lock
+{
+public:
+  void lock()
+  {
+    while (m_flag.test_and_set(std::memory_order_acquire)) {
+    }
+  }
+
+  void unlock()
+  {
+    m_flag.clear(std::memory_order_release);
+  }
+
+private:
+  std::atomic_flag m_flag = ATOMIC_FLAG_INIT;
+};
+
+/**
+ * @brief Memory usage statistics reported by the static allocators
+ *
+ */
+struct allocator_usage
+{
+  /// Total bytes (arena) or blocks (pool) available
+  std::size_t capacity = 0;
+  /// Bytes or blocks currently allocated
+  std::size_t used = 0;
+  /// Greatest value of `used` since construction
+  std::size_t peak = 0;
+  /// Number of allocation requests that could not be satisfied
+  std::size_t failed = 0;
+};
+
+/**
+ * @brief Bump allocator over a static buffer
+ *
+ * Allocation advances a pointer through the buffer in O(1). Individual
+ * allocations cannot be freed; the whole arena is released at once with
+ * `reset()`. This suits memory that lives for the duration of the
+ * application, such as driver buffers and callback storage created at startup.
+ *
+ * The storage is normally created with `hal::create_static_arena()`, which
+ * places it in a statically allocated buffer whose size is fixed at compile
+ * time.
+ *
+ * @tparam lock_t - lock policy, see hal::no_lock and hal::spin_lock
+ */
+template<class lock_t = no_lock>
+class static_arena
+{
+public:
+  /**
+   * @brief Construct a new static arena object
+   *
+   * @param p_storage - memory to allocate from
+   */
+  explicit static_arena(std::span<hal::byte> p_storage)
+    : m_storage(p_storage)
+  {
+  }
+
+  static_arena(static_arena const&) = delete;
+  static_arena& operator=(static_arena const&) = delete;
+  static_arena(static_arena&&) = delete;
+  static_arena& operator=(static_arena&&) = delete;
+
+  /**
+   * @brief Allocate a block of memory
+   *
+   * @param p_size - number of bytes
+   * @param p_alignment - alignment of the block, must be a power of 2
+   * @return std::span<hal::byte> - the allocated memory
+   * @throws hal::resource_unavailable_try_again - if the remaining memory is
+   * insufficient
+   */
+  std::span<hal::byte> allocate(
+    std::size_t p_size,
+    std::size_t p_alignment = alignof(std::max_align_t))
+  {
+    std::lock_guard guard(m_lock);
+    auto const address =
+      reinterpret_cast<std::uintptr_t>(m_storage.data()) + m_used;
+    auto const padding = (p_alignment - (address % p_alignment)) % p_alignment;
+    if (padding + p_size > m_storage.size() - m_used) {
+      m_failed++;
+      hal::safe_throw(hal::resource_unavailable_try_again(this));
+    }
+    auto const block = m_storage.subspan(m_used + padding, p_size);
+    m_used += padding + p_size;
+    m_peak = std::max(m_peak, m_used);
+    return block;
+  }
+
+  /**
+   * @brief Allocate and construct an object
+   *
+   * The object's destructor is never run by the arena. Objects with
+   * non-trivial destructors must be destroyed by the caller if required.
+   *
+   * @tparam T - type of object
+   * @param p_args - constructor arguments
+   * @return T& - the constructed object
+   * @throws hal::resource_unavailable_try_again - if the remaining memory is
+   * insufficient
+   */
+  template<class T, class... args_t>
+  T& create(args_t&&... p_args)
+  {
+    auto memory = allocate(sizeof(T), alignof(T));
+    return *std::construct_at(reinterpret_cast<T*>(memory.data()),
+                              std::forward<args_t>(p_args)...);
+  }
+
+  /**
+   * @brief Allocate an array of value initialized objects
+   *
+   * @tparam T - trivially destructible element type
+   * @param p_count - number of elements
+   * @return std::span<T> - the array
+   * @throws hal::resource_unavailable_try_again - if the remaining memory is
+   * insufficient
+   */
+  template<class T>
+  std::span<T> allocate_array(std::size_t p_count)
+  {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "Array elements must be trivially destructible");
+    auto memory = allocate(sizeof(T) * p_count, alignof(T));
+    auto* first = reinterpret_cast<T*>(memory.data());
+    for (std::size_t i = 0; i < p_count; i++) {
+      std::construct_at(first + i);
+    }
+    return { first, p_count };
+  }
+
+  /**
+   * @brief Release every allocation
+   *
+   * All memory previously returned by this arena must no longer be in use.
+   */
+  void reset()
+  {
+    std::lock_guard guard(m_lock);
+    m_used = 0;
+  }
+
+  /**
+   * @brief Usage statistics in bytes
+   *
+   * @return allocator_usage - usage report
+   */
+  [[nodiscard]] allocator_usage usage()
+  {
+    std::lock_guard guard(m_lock);
+    return {
+      .capacity = m_storage.size(),
+      .used = m_used,
+      .peak = m_peak,
+      .failed = m_failed,
+    };
+  }
+
+private:
+  std::span<hal::byte> m_storage;
+  std::size_t m_used = 0;
+  std::size_t m_peak = 0;
+  std::size_t m_failed = 0;
+  lock_t m_lock{};
+};
+
+/**
+ * @brief Fixed block allocator over a static buffer
+ *
+ * Blocks are kept on an intrusive free list, making allocation and
+ * deallocation O(1) with no per block overhead. Every block is aligned to
+ * `alignof(std::max_align_t)`.
+ *
+ * The storage is normally created with `hal::create_static_pool()`, which
+ * places it in a statically allocated buffer of exactly `storage_size` bytes.
+ *
+ * @tparam block_size - size of each block in bytes
+ * @tparam block_count - number of blocks
+ * @tparam lock_t - lock policy, see hal::no_lock and hal::spin_lock
+ */
+template<std::size_t block_size,
+         std::size_t block_count,
+         class lock_t = no_lock>
+class static_pool
+{
+public:
+  static_assert(block_size > 0 && block_count > 0,
+                "block_size and block_count must be non-zero");
+
+  /// Alignment of every block
+  static constexpr std::size_t alignment = alignof(std::max_align_t);
+  /// Distance between the start of consecutive blocks
+  static constexpr std::size_t stride =
+    (std::max(block_size, sizeof(void*)) + alignment - 1) / alignment *
+    alignment;
+  /// Bytes of storage required for any placement of the storage buffer
+  static constexpr std::size_t storage_size =
+    stride * block_count + alignment - 1;
+
+  /**
+   * @brief Construct a new static pool object
+   *
+   * @param p_storage - memory to carve blocks from
+   * @throws hal::argument_out_of_domain - if p_storage is smaller than
+   * storage_size
+   */
+  explicit static_pool(std::span<hal::byte> p_storage)
+  {
+    if (p_storage.size() < storage_size) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    auto const address = reinterpret_cast<std::uintptr_t>(p_storage.data());
+    auto const padding = (alignment - (address % alignment)) % alignment;
+    m_blocks = p_storage.data() + padding;
+    for (std::size_t i = 0; i < block_count; i++) {
+      auto* node = reinterpret_cast<free_node*>(m_blocks + i * stride);
+      node->next = i + 1 < block_count
+                     ? reinterpret_cast<free_node*>(m_blocks + (i + 1) * stride)
+                     : nullptr;
+    }
+    m_free = reinterpret_cast<free_node*>(m_blocks);
+  }
+
+  static_pool(static_pool const&) = delete;
+  static_pool& operator=(static_pool const&) = delete;
+  static_pool(static_pool&&) = delete;
+  static_pool& operator=(static_pool&&) = delete;
+
+  /**
+   * @brief Allocate a single block
+   *
+   * @return void* - pointer to block_size bytes
+   * @throws hal::resource_unavailable_try_again - if every block is in use
+   */
+  void* allocate()
+  {
+    std::lock_guard guard(m_lock);
+    if (m_free == nullptr) {
+      m_failed++;
+      hal::safe_throw(hal::resource_unavailable_try_again(this));
+    }
+    auto* block = m_free;
+    m_free = block->next;
+    m_used++;
+    m_peak = std::max(m_peak, m_used);
+    return block;
+  }
+
+  /**
+   * @brief Return a block to the pool
+   *
+   * @param p_block - block returned by allocate()
+   * @throws hal::argument_out_of_domain - if p_block did not come from this
+   * pool
+   */
+  void deallocate(void* p_block)
+  {
+    auto* byte_pointer = static_cast<hal::byte*>(p_block);
+    auto const offset = byte_pointer - m_blocks;
+    if (byte_pointer < m_blocks ||
+        static_cast<std::size_t>(offset) >= stride * block_count ||
+        static_cast<std::size_t>(offset) % stride != 0) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    std::lock_guard guard(m_lock);
+    auto* node = static_cast<free_node*>(p_block);
+    node->next = m_free;
+    m_free = node;
+    m_used--;
+  }
+
+  /**
+   * @brief Allocate a block and construct an object in it
+   *
+   * @tparam T - type of object, must fit within a block
+   * @param p_args - constructor arguments
+   * @return T* - the constructed object, release with `destroy()`
+   * @throws hal::resource_unavailable_try_again - if every block is in use
+   */
+  template<class T, class... args_t>
+  T* create(args_t&&... p_args)
+  {
+    static_assert(sizeof(T) <= block_size, "T does not fit within a block");
+    static_assert(alignof(T) <= alignment, "T is over aligned");
+    auto* block = allocate();
+    try {
+      return std::construct_at(static_cast<T*>(block),
+                               std::forward<args_t>(p_args)...);
+    } catch (...) {
+      deallocate(block);
+      throw;
+    }
+  }
+
+  /**
+   * @brief Destroy an object made by `create()` and release its block
+   *
+   * @tparam T - type of object
+   * @param p_object - object to destroy
+   */
+  template<class T>
+  void destroy(T* p_object)
+  {
+    std::destroy_at(p_object);
+    deallocate(p_object);
+  }
+
+  /**
+   * @brief Usage statistics in blocks
+   *
+   * @return allocator_usage - usage report
+   */
+  [[nodiscard]] allocator_usage usage()
+  {
+    std::lock_guard guard(m_lock);
+    return {
+      .capacity = block_count,
+      .used = m_used,
+      .peak = m_peak,
+      .failed = m_failed,
+    };
+  }
+
+private:
+  struct free_node
+  {
+    free_node* next;
+  };
+
+  hal::byte* m_blocks = nullptr;
+  free_node* m_free = nullptr;
+  std::size_t m_used = 0;
+  std::size_t m_peak = 0;
+  std::size_t m_failed = 0;
+  lock_t m_lock{};
+};
+
+/**
+ * @brief Create a static arena backed by a unique statically allocated buffer
+ *
+ * USAGE:
+ *
+ *      auto& arena = hal::create_static_arena(hal::buffer<4096>);
+ *
+ * As with `create_unique_static_buffer()`, never set the `unique_t` template
+ * argument.
+ *
+ * @tparam lock_t - lock policy
+ * @param p_buffer_size - size of the arena in bytes
+ * @return static_arena<lock_t>& - statically allocated arena
+ */
+template<class lock_t = no_lock, class unique_t = decltype([]() {})>
+static_arena<lock_t>& create_static_arena(buffer_param auto p_buffer_size)
+{
+  static static_arena<lock_t> arena(
+    create_unique_static_buffer<unique_t>(p_buffer_size));
+  return arena;
+}
+
+/**
+ * @brief Create a static pool backed by a unique statically allocated buffer
+ *
+ * USAGE:
+ *
+ *      auto& pool = hal::create_static_pool<64, 16>();
+ *
+ * As with `create_unique_static_buffer()`, never set the `unique_t` template
+ * argument.
+ *
+ * @tparam block_size - size of each block in bytes
+ * @tparam block_count - number of blocks
+ * @tparam lock_t - lock policy
+ * @return static_pool<block_size, block_count, lock_t>& - statically
+ * allocated pool
+ */
+template<std::size_t block_size,
+         std::size_t block_count,
+         class lock_t = no_lock,
+         class unique_t = decltype([]() {})>
+static_pool<block_size, block_count, lock_t>& create_static_pool()
+{
+  using pool_t = static_pool<block_size, block_count, lock_t>;
+  static pool_t pool(create_unique_static_buffer<unique_t>(
+    buffer<static_cast<std::int64_t>(pool_t::storage_size)>));
+  return pool;
+}
+
+/**
+ * @brief Write a single line usage report for an allocator to a serial port
+ *
+ * Intended to be called at shutdown or on demand to audit static memory:
+ *
+ *      dma_pool: capacity=16 used=2 peak=11 failed=0
+ *
+ * @param p_serial - serial port to write the report to
+ * @param p_name - name of the allocator
+ * @param p_usage - usage returned by the allocator's `usage()` function
+ */
+inline void write_usage_report(hal::serial& p_serial,
+                               std::string_view p_name,
+                               allocator_usage const& p_usage)
+{
+  std::array<char, 96> line{};
+  auto const length =
+    std::snprintf(line.data(),
+                  line.size(),
+                  "%.*s: capacity=%zu used=%zu peak=%zu failed=%zu\n",
+                  static_cast<int>(p_name.size()),
+                  p_name.data(),
+                  p_usage.capacity,
+                  p_usage.used,
+                  p_usage.peak,
+                  p_usage.failed);
+  auto const count =
+    std::min(static_cast<std::size_t>(std::max(length, 0)), line.size() - 1);
+  auto const bytes = std::as_bytes(std::span(line.data(), count));
+  p_serial.write(std::span(reinterpret_cast<hal::byte const*>(bytes.data()),
+                           bytes.size()));
+}
+}  // namespace hal
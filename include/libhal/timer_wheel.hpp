@@ -0,0 +1,264 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <chrono>
+#include <span>
+
+#include "error.hpp"
+#include "functional.hpp"
+#include "units.hpp"
+
+namespace hal {
+class timer_wheel;
+
+/**
+ * @brief A callback scheduled on a hal::timer_wheel
+ *
+ * Entries are owned by the code that schedules them, typically as members,
+ * so the wheel itself needs no storage per scheduled callback. An entry must
+ * outlive its time on the wheel; destroying a scheduled entry cancels it.
+ */
+class timer_wheel_entry
+{
+public:
+  timer_wheel_entry() = default;
+
+  timer_wheel_entry(timer_wheel_entry const&) = delete;
+  timer_wheel_entry& operator=(timer_wheel_entry const&) = delete;
+  timer_wheel_entry(timer_wheel_entry&&) = delete;
+  timer_wheel_entry& operator=(timer_wheel_entry&&) = delete;
+
+  /**
+   * @brief Determine if the entry is waiting to expire
+   *
+   * @return true - the entry is scheduled on a wheel
+   */
+  [[nodiscard]] bool is_scheduled() const
+  {
+    return m_link != nullptr;
+  }
+
+  ~timer_wheel_entry();
+
+private:
+  friend class timer_wheel;
+
+  void unlink()
+  {
+    *m_link = m_next;
+    if (m_next != nullptr) {
+      m_next->m_link = m_link;
+    }
+    m_link = nullptr;
+    m_next = nullptr;
+  }
+
+  void link(timer_wheel_entry*& p_head)
+  {
+    m_next = p_head;
+    if (m_next != nullptr) {
+      m_next->m_link = &m_next;
+    }
+    p_head = this;
+    m_link = &p_head;
+  }
+
+  hal::callback<void(void)> m_callback = []() {};
+  timer_wheel_entry* m_next = nullptr;
+  // Address of the pointer that points to this entry
+  timer_wheel_entry** m_link = nullptr;
+  std::uint32_t m_rounds = 0;
+};
+
+/**
+ * @brief Hashed timing wheel for many timeouts driven by a single tick
+ *
+ * Schedules any number of callbacks a whole number of ticks into the future
+ * with O(1) scheduling and cancellation. Each call to `tick()` advances the
+ * wheel by one tick and runs the callbacks that expire on it. The caller
+ * decides what a tick is, usually by calling `tick()` from a periodic
+ * hal::timer callback or a main loop running at a fixed rate.
+ *
+ * Timeouts longer than one revolution of the wheel are supported; they stay
+ * in their slot for extra revolutions. More slots mean fewer entries visited
+ * per tick.
+ *
+ * Callbacks run within `tick()` and may schedule or cancel any entry,
+ * including their own.
+ */
+class timer_wheel
+{
+public:
+  /**
+   * @brief Construct a new timer wheel object
+   *
+   * @param p_slots - storage for the wheel's slots, one per tick of a
+   * revolution
+   * @param p_tick_period - time represented by one tick
+   * @throws hal::argument_out_of_domain - if p_slots is empty or
+   * p_tick_period is not positive
+   */
+  timer_wheel(std::span<timer_wheel_entry*> p_slots,
+              hal::time_duration p_tick_period)
+    : m_slots(p_slots)
+    , m_tick_period(p_tick_period)
+  {
+    if (p_slots.empty() || p_tick_period <= hal::time_duration::zero()) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+    std::ranges::fill(m_slots, nullptr);
+  }
+
+  timer_wheel(timer_wheel const&) = delete;
+  timer_wheel& operator=(timer_wheel const&) = delete;
+  timer_wheel(timer_wheel&&) = delete;
+  timer_wheel& operator=(timer_wheel&&) = delete;
+
+  /**
+   * @brief Schedule a callback a number of ticks from now
+   *
+   * Rescheduling an entry that is already scheduled replaces its previous
+   * callback and expiry.
+   *
+   * @param p_entry - entry to schedule
+   * @param p_ticks - ticks until expiry, a value of 0 is treated as 1
+   * @param p_callback - called from `tick()` on expiry
+   */
+  void schedule(timer_wheel_entry& p_entry,
+                std::uint32_t p_ticks,
+                hal::callback<void(void)> p_callback)
+  {
+    cancel(p_entry);
+    p_ticks = std::max(p_ticks, std::uint32_t{ 1 });
+    auto const slot = (m_current + p_ticks) % m_slots.size();
+    p_entry.m_callback = p_callback;
+    p_entry.m_rounds =
+      static_cast<std::uint32_t>((p_ticks - 1) / m_slots.size());
+    p_entry.link(m_slots[slot]);
+  }
+
+  /**
+   * @brief Schedule a callback after a duration
+   *
+   * The duration is rounded up to a whole number of ticks.
+   *
+   * @param p_entry - entry to schedule
+   * @param p_delay - time until expiry
+   * @param p_callback - called from `tick()` on expiry
+   */
+  void schedule(timer_wheel_entry& p_entry,
+                hal::time_duration p_delay,
+                hal::callback<void(void)> p_callback)
+  {
+    schedule(p_entry, ticks(p_delay), p_callback);
+  }
+
+  /**
+   * @brief Remove an entry from the wheel without calling it
+   *
+   * Does nothing if the entry is not scheduled.
+   *
+   * @param p_entry - entry to cancel
+   */
+  void cancel(timer_wheel_entry& p_entry)
+  {
+    if (p_entry.is_scheduled()) {
+      p_entry.unlink();
+    }
+  }
+
+  /**
+   * @brief Advance the wheel by one tick and run expired callbacks
+   *
+   */
+  void tick()
+  {
+    m_current = (m_current + 1) % m_slots.size();
+    m_now++;
+
+    // Detach the slot so entries rescheduled into it wait a full revolution
+    m_expiring = nullptr;
+    if (m_slots[m_current] != nullptr) {
+      m_slots[m_current]->m_link = &m_expiring;
+      m_expiring = m_slots[m_current];
+      m_slots[m_current] = nullptr;
+    }
+
+    while (m_expiring != nullptr) {
+      auto* entry = m_expiring;
+      entry->unlink();
+      if (entry->m_rounds != 0) {
+        entry->m_rounds--;
+        entry->link(m_slots[m_current]);
+        continue;
+      }
+      // Call a copy, the callback may reschedule and replace its own entry
+      auto callback = entry->m_callback;
+      callback();
+    }
+  }
+
+  /**
+   * @brief Number of ticks since construction
+   *
+   * @return std::uint64_t - tick count
+   */
+  [[nodiscard]] std::uint64_t now() const
+  {
+    return m_now;
+  }
+
+  /**
+   * @brief Time represented by one tick
+   *
+   * @return hal::time_duration - tick period
+   */
+  [[nodiscard]] hal::time_duration tick_period() const
+  {
+    return m_tick_period;
+  }
+
+  /**
+   * @brief Convert a duration to ticks, rounding up
+   *
+   * @param p_duration - duration to convert
+   * @return std::uint32_t - number of ticks
+   */
+  [[nodiscard]] std::uint32_t ticks(hal::time_duration p_duration) const
+  {
+    return static_cast<std::uint32_t>(
+      (p_duration + m_tick_period - hal::time_duration(1)) / m_tick_period);
+  }
+
+private:
+  std::span<timer_wheel_entry*> m_slots;
+  hal::time_duration m_tick_period;
+  timer_wheel_entry* m_expiring = nullptr;
+  std::size_t m_current = 0;
+  std::uint64_t m_now = 0;
+};
+
+inline timer_wheel_entry::~timer_wheel_entry()
+{
+  if (is_scheduled()) {
+    unlink();
+  }
+}
+}  // namespace hal
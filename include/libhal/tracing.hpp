@@ -0,0 +1,1139 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <span>
+
+#include "adc.hpp"
+#include "can.hpp"
+#include "dac.hpp"
+#include "functional.hpp"
+#include "i2c.hpp"
+#include "input_pin.hpp"
+#include "output_pin.hpp"
+#include "pwm.hpp"
+#include "serial.hpp"
+#include "spi.hpp"
+#include "steady_clock.hpp"
+#include "timer.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Interface operation captured by a trace record
+ *
+ */
+enum class trace_operation : std::uint8_t
+{
+  /// Call to a configure() method of any interface
+  configure = 0,
+  /// hal::i2c::transaction()
+  i2c_transaction,
+  /// hal::spi::transfer()
+  spi_transfer,
+  /// hal::serial::write()
+  serial_write,
+  /// hal::serial::read() that returned at least one byte or failed
+  serial_read,
+  /// hal::serial::flush()
+  serial_flush,
+  /// hal::can::send()
+  can_send,
+  /// hal::can::bus_on()
+  can_bus_on,
+  /// A message delivered to the hal::can::on_receive() handler
+  can_receive,
+  /// hal::adc::read()
+  adc_read,
+  /// hal::dac::write()
+  dac_write,
+  /// hal::pwm::frequency()
+  pwm_frequency,
+  /// hal::pwm::duty_cycle()
+  pwm_duty_cycle,
+  /// hal::output_pin::level() setting the level
+  output_pin_level,
+  /// hal::input_pin::level()
+  input_pin_level,
+  /// hal::timer::schedule()
+  timer_schedule,
+  /// hal::timer::cancel()
+  timer_cancel,
+  /// A scheduled hal::timer callback being called
+  timer_expire,
+};
+
+/**
+ * @brief Fixed size binary record of a single traced call
+ *
+ * The meaning of the argument fields depend on the operation:
+ *
+ *   - i2c_transaction: argument = address, size_out/in = buffer lengths
+ *   - spi_transfer: argument = filler byte, size_out/in = buffer lengths
+ *   - serial_write: size_out = bytes written
+ *   - serial_read: size_in = bytes read, argument = bytes still available
+ *   - can_send & can_receive: argument = message id, size_out = length
+ *   - adc_read, dac_write & pwm_duty_cycle: argument = value in parts per
+ *     million of full scale
+ *   - pwm_frequency: argument = frequency in hertz
+ *   - output_pin_level & input_pin_level: argument = 1 for high, 0 for low
+ *   - timer_schedule: argument = delay in microseconds
+ *
+ */
+struct trace_record
+{
+  /// steady_clock uptime at entry
+  std::uint64_t start = 0;
+  /// Number of steady_clock ticks spent in the call, saturates at UINT32_MAX
+  std::uint32_t duration = 0;
+  trace_operation operation = trace_operation::configure;
+  /// Set to 1 if the call exited via an exception
+  std::uint8_t failed = 0;
+  /// User chosen identifier of the traced driver, becomes the trace thread id
+  std::uint16_t track = 0;
+  std::uint32_t argument = 0;
+  std::uint32_t size_out = 0;
+  std::uint32_t size_in = 0;
+  /// Position of the record in the stream plus 1, 0 if being written
+  std::uint32_t sequence = 0;
+};
+
+/**
+ * @brief Lock-free ring buffer of trace records
+ *
+ * Any number of producers, including interrupt service routines, may record
+ * concurrently. Each producer claims a slot with a single atomic increment and
+ * publishes it by writing the slot's sequence number last. Once full, the
+ * oldest records are overwritten, keeping the most recent history, like a
+ * flight recorder.
+ *
+ * Readers validate each slot's sequence number before and after copying it, so
+ * records overwritten during a read are skipped rather than returned torn.
+ */
+class trace_buffer
+{
+public:
+  /**
+   * @brief Construct a new trace buffer object
+   *
+   * @param p_storage - memory for the records. The size should be a power of 2
+   * so that the ring index remains contiguous when the 32-bit record counter
+   * wraps.
+   */
+  explicit trace_buffer(std::span<trace_record> p_storage)
+    : m_storage(p_storage)
+  {
+  }
+
+  trace_buffer(trace_buffer const&) = delete;
+  trace_buffer& operator=(trace_buffer const&) = delete;
+  trace_buffer(trace_buffer&&) = delete;
+  trace_buffer& operator=(trace_buffer&&) = delete;
+
+  /**
+   * @brief Store a record, overwriting the oldest if the buffer is full
+   *
+   * Does nothing if tracing is disabled or the buffer has no storage.
+   *
+   * @param p_record - record to store, the sequence field is ignored
+   */
+  void record(trace_record const& p_record)
+  {
+    if (m_storage.empty() || not m_enabled.load(std::memory_order_relaxed)) {
+      return;
+    }
+    auto const position = m_next.fetch_add(1, std::memory_order_relaxed);
+    auto& slot = m_storage[position % m_storage.size()];
+    std::atomic_ref<std::uint32_t> sequence(slot.sequence);
+    sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    copy_payload(slot, p_record);
+    sequence.store(position + 1, std::memory_order_release);
+  }
+
+  /**
+   * @brief Start or stop accepting records
+   *
+   * @param p_enabled - true to accept records
+   */
+  void enable(bool p_enabled)
+  {
+    m_enabled.store(p_enabled, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Total number of records stored since construction or clear
+   *
+   * @return std::uint32_t - record count, including overwritten records
+   */
+  [[nodiscard]] std::uint32_t recorded() const
+  {
+    return m_next.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Discard all records
+   *
+   * Must not be called while producers are recording.
+   */
+  void clear()
+  {
+    for (auto& slot : m_storage) {
+      slot = trace_record{};
+    }
+    m_next.store(0, std::memory_order_release);
+  }
+
+  /**
+   * @brief Visit each valid record from oldest to newest
+   *
+   * @param p_visitor - called with each trace_record
+   */
+  void for_each(hal::function_ref<void(trace_record const&)> p_visitor) const
+  {
+    auto const end = m_next.load(std::memory_order_acquire);
+    auto const size = static_cast<std::uint32_t>(m_storage.size());
+    auto const begin = end > size ? end - size : 0;
+    for (auto position = begin; position != end; position++) {
+      auto& slot = m_storage[position % m_storage.size()];
+      std::atomic_ref<std::uint32_t> sequence(slot.sequence);
+      if (sequence.load(std::memory_order_acquire) != position + 1) {
+        continue;
+      }
+      trace_record copy{};
+      copy_payload(copy, slot);
+      copy.sequence = position + 1;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence.load(std::memory_order_relaxed) != position + 1) {
+        continue;
+      }
+      p_visitor(copy);
+    }
+  }
+
+private:
+  /// Copies every field except the sequence number
+  static void copy_payload(trace_record& p_destination,
+                           trace_record const& p_source)
+  {
+    p_destination.start = p_source.start;
+    p_destination.duration = p_source.duration;
+    p_destination.operation = p_source.operation;
+    p_destination.failed = p_source.failed;
+    p_destination.track = p_source.track;
+    p_destination.argument = p_source.argument;
+    p_destination.size_out = p_source.size_out;
+    p_destination.size_in = p_source.size_in;
+  }
+
+  std::span<trace_record> m_storage;
+  std::atomic<std::uint32_t> m_next = 0;
+  std::atomic<bool> m_enabled = true;
+};
+
+namespace detail {
+/**
+ * @brief Records a single call into a trace buffer
+ *
+ */
+class trace_call
+{
+public:
+  trace_call(trace_buffer& p_buffer,
+             hal::steady_clock& p_clock,
+             trace_operation p_operation,
+             std::uint16_t p_track)
+    : m_buffer(&p_buffer)
+    , m_clock(&p_clock)
+  {
+    m_record.operation = p_operation;
+    m_record.track = p_track;
+    m_record.start = p_clock.uptime();
+  }
+
+  trace_record& record()
+  {
+    return m_record;
+  }
+
+  void failed()
+  {
+    m_record.failed = 1;
+  }
+
+  ~trace_call()
+  {
+    constexpr auto limit = std::numeric_limits<std::uint32_t>::max();
+    auto const elapsed = m_clock->uptime() - m_record.start;
+    m_record.duration = static_cast<std::uint32_t>(
+      std::min<std::uint64_t>(elapsed, limit));
+    m_buffer->record(m_record);
+  }
+
+  trace_call(trace_call const&) = delete;
+  trace_call& operator=(trace_call const&) = delete;
+  trace_call(trace_call&&) = delete;
+  trace_call& operator=(trace_call&&) = delete;
+
+private:
+  trace_buffer* m_buffer;
+  hal::steady_clock* m_clock;
+  trace_record m_record{};
+};
+
+inline std::uint32_t trace_size(std::size_t p_size)
+{
+  return static_cast<std::uint32_t>(p_size);
+}
+
+/// A value from 0.0f to 1.0f in parts per million
+inline std::uint32_t trace_ppm(float p_value)
+{
+  return static_cast<std::uint32_t>(
+    std::lround(std::clamp(p_value, 0.0f, 1.0f) * 1'000'000.0f));
+}
+
+/// Write p_text as a quoted JSON string, escaping quotes, backslashes and
+/// control characters
+inline void write_json_string(std::FILE* p_file, char const* p_text)
+{
+  std::fputc('"', p_file);
+  for (; *p_text != '\0'; p_text++) {
+    auto const character = static_cast<unsigned char>(*p_text);
+    if (character == '"' || character == '\\') {
+      std::fputc('\\', p_file);
+      std::fputc(character, p_file);
+    } else if (character < 0x20) {
+      std::fprintf(p_file, "\\u%04x", character);
+    } else {
+      std::fputc(character, p_file);
+    }
+  }
+  std::fputc('"', p_file);
+}
+}  // namespace detail
+
+/**
+ * @brief i2c decorator that traces every call into a trace buffer
+ *
+ */
+class traced_i2c : public hal::i2c
+{
+public:
+  /**
+   * @brief Construct a new traced i2c object
+   *
+   * @param p_i2c - i2c to forward calls to
+   * @param p_buffer - buffer to record calls into
+   * @param p_clock - clock used to timestamp calls
+   * @param p_track - identifier for this driver in the trace
+   */
+  traced_i2c(hal::i2c& p_i2c,
+             trace_buffer& p_buffer,
+             hal::steady_clock& p_clock,
+             std::uint16_t p_track)
+    : m_i2c(&p_i2c)
+    , m_buffer(&p_buffer)
+    , m_clock(&p_clock)
+    , m_track(p_track)
+  {
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::configure, m_track);
+    try {
+      m_i2c->configure(p_settings);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  void driver_transaction(
+    hal::byte p_address,
+    std::span<hal::byte const> p_data_out,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::i2c_transaction, m_track);
+    call.record().argument = p_address;
+    call.record().size_out = detail::trace_size(p_data_out.size());
+    call.record().size_in = detail::trace_size(p_data_in.size());
+    try {
+      m_i2c->transaction(p_address, p_data_out, p_data_in, p_timeout);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  hal::i2c* m_i2c;
+  trace_buffer* m_buffer;
+  hal::steady_clock* m_clock;
+  std::uint16_t m_track;
+};
+
+/**
+ * @brief spi decorator that traces every call into a trace buffer
+ *
+ */
+class traced_spi : public hal::spi
+{
+public:
+  /**
+   * @brief Construct a new traced spi object
+   *
+   * @param p_spi - spi to forward calls to
+   * @param p_buffer - buffer to record calls into
+   * @param p_clock - clock used to timestamp calls
+   * @param p_track - identifier for this driver in the trace
+   */
+  traced_spi(hal::spi& p_spi,
+             trace_buffer& p_buffer,
+             hal::steady_clock& p_clock,
+             std::uint16_t p_track)
+    : m_spi(&p_spi)
+    , m_buffer(&p_buffer)
+    , m_clock(&p_clock)
+    , m_track(p_track)
+  {
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::configure, m_track);
+    try {
+      m_spi->configure(p_settings);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  void driver_transfer(std::span<hal::byte const> p_data_out,
+                       std::span<hal::byte> p_data_in,
+                       hal::byte p_filler) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::spi_transfer, m_track);
+    call.record().argument = p_filler;
+    call.record().size_out = detail::trace_size(p_data_out.size());
+    call.record().size_in = detail::trace_size(p_data_in.size());
+    try {
+      m_spi->transfer(p_data_out, p_data_in, p_filler);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  hal::spi* m_spi;
+  trace_buffer* m_buffer;
+  hal::steady_clock* m_clock;
+  std::uint16_t m_track;
+};
+
+/**
+ * @brief serial decorator that traces every call into a trace buffer
+ *
+ * Reads that return no data are not recorded, as applications commonly poll
+ * serial ports and those records would flush all other history from the
+ * buffer.
+ */
+class traced_serial : public hal::serial
+{
+public:
+  /**
+   * @brief Construct a new traced serial object
+   *
+   * @param p_serial - serial to forward calls to
+   * @param p_buffer - buffer to record calls into
+   * @param p_clock - clock used to timestamp calls
+   * @param p_track - identifier for this driver in the trace
+   */
+  traced_serial(hal::serial& p_serial,
+                trace_buffer& p_buffer,
+                hal::steady_clock& p_clock,
+                std::uint16_t p_track)
+    : m_serial(&p_serial)
+    , m_buffer(&p_buffer)
+    , m_clock(&p_clock)
+    , m_track(p_track)
+  {
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::configure, m_track);
+    try {
+      m_serial->configure(p_settings);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::serial_write, m_track);
+    call.record().size_out = detail::trace_size(p_data.size());
+    try {
+      return m_serial->write(p_data);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    auto const start = m_clock->uptime();
+    try {
+      auto const result = m_serial->read(p_data);
+      if (not result.data.empty()) {
+        record_read(start,
+                    { .argument = detail::trace_size(result.available),
+                      .size_in = detail::trace_size(result.data.size()) });
+      }
+      return result;
+    } catch (...) {
+      record_read(start, { .failed = 1 });
+      throw;
+    }
+  }
+
+  /// Fields of p_record besides the timing, operation and track are kept
+  void record_read(std::uint64_t p_start, trace_record p_record)
+  {
+    constexpr auto limit = std::numeric_limits<std::uint32_t>::max();
+    auto const elapsed = m_clock->uptime() - p_start;
+    p_record.start = p_start;
+    p_record.duration =
+      static_cast<std::uint32_t>(std::min<std::uint64_t>(elapsed, limit));
+    p_record.operation = trace_operation::serial_read;
+    p_record.track = m_track;
+    m_buffer->record(p_record);
+  }
+
+  void driver_flush() override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::serial_flush, m_track);
+    try {
+      m_serial->flush();
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  hal::serial* m_serial;
+  trace_buffer* m_buffer;
+  hal::steady_clock* m_clock;
+  std::uint16_t m_track;
+};
+
+/**
+ * @brief can decorator that traces every call and received message into a
+ * trace buffer
+ *
+ * Received messages are recorded as zero duration records at the time the
+ * handler is called.
+ */
+class traced_can : public hal::can
+{
+public:
+  /**
+   * @brief Construct a new traced can object
+   *
+   * @param p_can - can to forward calls to
+   * @param p_buffer - buffer to record calls into
+   * @param p_clock - clock used to timestamp calls
+   * @param p_track - identifier for this driver in the trace
+   */
+  traced_can(hal::can& p_can,
+             trace_buffer& p_buffer,
+             hal::steady_clock& p_clock,
+             std::uint16_t p_track)
+    : m_can(&p_can)
+    , m_buffer(&p_buffer)
+    , m_clock(&p_clock)
+    , m_track(p_track)
+  {
+  }
+
+  traced_can(traced_can const&) = delete;
+  traced_can& operator=(traced_can const&) = delete;
+  traced_can(traced_can&&) = delete;
+  traced_can& operator=(traced_can&&) = delete;
+  ~traced_can() override = default;
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::configure, m_track);
+    try {
+      m_can->configure(p_settings);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  void driver_bus_on() override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::can_bus_on, m_track);
+    try {
+      m_can->bus_on();
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  void driver_send(message_t const& p_message) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::can_send, m_track);
+    call.record().argument = p_message.id;
+    call.record().size_out = p_message.length;
+    try {
+      m_can->send(p_message);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  void driver_on_receive(hal::callback<handler> p_handler) override
+  {
+    m_handler = p_handler;
+    m_can->on_receive([this](message_t const& p_message) {
+      m_buffer->record({
+        .start = m_clock->uptime(),
+        .operation = trace_operation::can_receive,
+        .track = m_track,
+        .argument = p_message.id,
+        .size_out = p_message.length,
+      });
+      m_handler(p_message);
+    });
+  }
+
+  hal::can* m_can;
+  trace_buffer* m_buffer;
+  hal::steady_clock* m_clock;
+  hal::callback<handler> m_handler = [](message_t const&) {};
+  std::uint16_t m_track;
+};
+
+/**
+ * @brief adc decorator that traces every read into a trace buffer
+ *
+ */
+class traced_adc : public hal::adc
+{
+public:
+  /**
+   * @brief Construct a new traced adc object
+   *
+   * @param p_adc - adc to forward calls to
+   * @param p_buffer - buffer to record calls into
+   * @param p_clock - clock used to timestamp calls
+   * @param p_track - identifier for this driver in the trace
+   */
+  traced_adc(hal::adc& p_adc,
+             trace_buffer& p_buffer,
+             hal::steady_clock& p_clock,
+             std::uint16_t p_track)
+    : m_adc(&p_adc)
+    , m_buffer(&p_buffer)
+    , m_clock(&p_clock)
+    , m_track(p_track)
+  {
+  }
+
+private:
+  float driver_read() override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::adc_read, m_track);
+    try {
+      auto const value = m_adc->read();
+      call.record().argument = detail::trace_ppm(value);
+      return value;
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  hal::adc* m_adc;
+  trace_buffer* m_buffer;
+  hal::steady_clock* m_clock;
+  std::uint16_t m_track;
+};
+
+/**
+ * @brief dac decorator that traces every write into a trace buffer
+ *
+ */
+class traced_dac : public hal::dac
+{
+public:
+  /**
+   * @brief Construct a new traced dac object
+   *
+   * @param p_dac - dac to forward calls to
+   * @param p_buffer - buffer to record calls into
+   * @param p_clock - clock used to timestamp calls
+   * @param p_track - identifier for this driver in the trace
+   */
+  traced_dac(hal::dac& p_dac,
+             trace_buffer& p_buffer,
+             hal::steady_clock& p_clock,
+             std::uint16_t p_track)
+    : m_dac(&p_dac)
+    , m_buffer(&p_buffer)
+    , m_clock(&p_clock)
+    , m_track(p_track)
+  {
+  }
+
+private:
+  void driver_write(float p_percentage) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::dac_write, m_track);
+    call.record().argument = detail::trace_ppm(p_percentage);
+    try {
+      m_dac->write(p_percentage);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  hal::dac* m_dac;
+  trace_buffer* m_buffer;
+  hal::steady_clock* m_clock;
+  std::uint16_t m_track;
+};
+
+/**
+ * @brief pwm decorator that traces every call into a trace buffer
+ *
+ */
+class traced_pwm : public hal::pwm
+{
+public:
+  /**
+   * @brief Construct a new traced pwm object
+   *
+   * @param p_pwm - pwm to forward calls to
+   * @param p_buffer - buffer to record calls into
+   * @param p_clock - clock used to timestamp calls
+   * @param p_track - identifier for this driver in the trace
+   */
+  traced_pwm(hal::pwm& p_pwm,
+             trace_buffer& p_buffer,
+             hal::steady_clock& p_clock,
+             std::uint16_t p_track)
+    : m_pwm(&p_pwm)
+    , m_buffer(&p_buffer)
+    , m_clock(&p_clock)
+    , m_track(p_track)
+  {
+  }
+
+private:
+  void driver_frequency(hertz p_frequency) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::pwm_frequency, m_track);
+    call.record().argument =
+      static_cast<std::uint32_t>(std::lround(p_frequency));
+    try {
+      m_pwm->frequency(p_frequency);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  void driver_duty_cycle(float p_duty_cycle) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::pwm_duty_cycle, m_track);
+    call.record().argument = detail::trace_ppm(p_duty_cycle);
+    try {
+      m_pwm->duty_cycle(p_duty_cycle);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  hal::pwm* m_pwm;
+  trace_buffer* m_buffer;
+  hal::steady_clock* m_clock;
+  std::uint16_t m_track;
+};
+
+/**
+ * @brief output_pin decorator that traces every call into a trace buffer
+ *
+ * Reading the level back is forwarded without being recorded, only changes
+ * to the level are.
+ */
+class traced_output_pin : public hal::output_pin
+{
+public:
+  /**
+   * @brief Construct a new traced output pin object
+   *
+   * @param p_pin - output pin to forward calls to
+   * @param p_buffer - buffer to record calls into
+   * @param p_clock - clock used to timestamp calls
+   * @param p_track - identifier for this driver in the trace
+   */
+  traced_output_pin(hal::output_pin& p_pin,
+                    trace_buffer& p_buffer,
+                    hal::steady_clock& p_clock,
+                    std::uint16_t p_track)
+    : m_pin(&p_pin)
+    , m_buffer(&p_buffer)
+    , m_clock(&p_clock)
+    , m_track(p_track)
+  {
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::configure, m_track);
+    try {
+      m_pin->configure(p_settings);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  void driver_level(bool p_high) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::output_pin_level, m_track);
+    call.record().argument = p_high ? 1 : 0;
+    try {
+      m_pin->level(p_high);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  bool driver_level() override
+  {
+    return m_pin->level();
+  }
+
+  hal::output_pin* m_pin;
+  trace_buffer* m_buffer;
+  hal::steady_clock* m_clock;
+  std::uint16_t m_track;
+};
+
+/**
+ * @brief input_pin decorator that traces every call into a trace buffer
+ *
+ */
+class traced_input_pin : public hal::input_pin
+{
+public:
+  /**
+   * @brief Construct a new traced input pin object
+   *
+   * @param p_pin - input pin to forward calls to
+   * @param p_buffer - buffer to record calls into
+   * @param p_clock - clock used to timestamp calls
+   * @param p_track - identifier for this driver in the trace
+   */
+  traced_input_pin(hal::input_pin& p_pin,
+                   trace_buffer& p_buffer,
+                   hal::steady_clock& p_clock,
+                   std::uint16_t p_track)
+    : m_pin(&p_pin)
+    , m_buffer(&p_buffer)
+    , m_clock(&p_clock)
+    , m_track(p_track)
+  {
+  }
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::configure, m_track);
+    try {
+      m_pin->configure(p_settings);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  bool driver_level() override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::input_pin_level, m_track);
+    try {
+      auto const high = m_pin->level();
+      call.record().argument = high ? 1 : 0;
+      return high;
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  hal::input_pin* m_pin;
+  trace_buffer* m_buffer;
+  hal::steady_clock* m_clock;
+  std::uint16_t m_track;
+};
+
+/**
+ * @brief timer decorator that traces every call and expiry into a trace
+ * buffer
+ *
+ * Expiries are recorded as zero duration records at the time the callback is
+ * called. Calls to `is_running()` are forwarded without being recorded.
+ */
+class traced_timer : public hal::timer
+{
+public:
+  /**
+   * @brief Construct a new traced timer object
+   *
+   * @param p_timer - timer to forward calls to
+   * @param p_buffer - buffer to record calls into
+   * @param p_clock - clock used to timestamp calls
+   * @param p_track - identifier for this driver in the trace
+   */
+  traced_timer(hal::timer& p_timer,
+               trace_buffer& p_buffer,
+               hal::steady_clock& p_clock,
+               std::uint16_t p_track)
+    : m_timer(&p_timer)
+    , m_buffer(&p_buffer)
+    , m_clock(&p_clock)
+    , m_track(p_track)
+  {
+  }
+
+  traced_timer(traced_timer const&) = delete;
+  traced_timer& operator=(traced_timer const&) = delete;
+  traced_timer(traced_timer&&) = delete;
+  traced_timer& operator=(traced_timer&&) = delete;
+  ~traced_timer() override = default;
+
+private:
+  bool driver_is_running() override
+  {
+    return m_timer->is_running();
+  }
+
+  void driver_cancel() override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::timer_cancel, m_track);
+    try {
+      m_timer->cancel();
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  void driver_schedule(hal::callback<void(void)> p_callback,
+                       hal::time_duration p_delay) override
+  {
+    detail::trace_call call(
+      *m_buffer, *m_clock, trace_operation::timer_schedule, m_track);
+    constexpr std::int64_t limit = std::numeric_limits<std::uint32_t>::max();
+    auto const microseconds =
+      std::chrono::duration_cast<std::chrono::microseconds>(p_delay).count();
+    call.record().argument = static_cast<std::uint32_t>(
+      std::clamp<std::int64_t>(microseconds, 0, limit));
+    m_callback = p_callback;
+    try {
+      m_timer->schedule(
+        [this]() {
+          m_buffer->record({
+            .start = m_clock->uptime(),
+            .operation = trace_operation::timer_expire,
+            .track = m_track,
+          });
+          m_callback();
+        },
+        p_delay);
+    } catch (...) {
+      call.failed();
+      throw;
+    }
+  }
+
+  hal::timer* m_timer;
+  trace_buffer* m_buffer;
+  hal::steady_clock* m_clock;
+  hal::callback<void(void)> m_callback = []() {};
+  std::uint16_t m_track;
+};
+
+/**
+ * @brief Name of a trace operation as it appears in exported traces
+ *
+ * @param p_operation - operation
+ * @return char const* - null terminated name
+ */
+[[nodiscard]] inline char const* to_string(trace_operation p_operation)
+{
+  switch (p_operation) {
+    case trace_operation::configure:
+      return "configure";
+    case trace_operation::i2c_transaction:
+      return "i2c::transaction";
+    case trace_operation::spi_transfer:
+      return "spi::transfer";
+    case trace_operation::serial_write:
+      return "serial::write";
+    case trace_operation::serial_read:
+      return "serial::read";
+    case trace_operation::serial_flush:
+      return "serial::flush";
+    case trace_operation::can_send:
+      return "can::send";
+    case trace_operation::can_bus_on:
+      return "can::bus_on";
+    case trace_operation::can_receive:
+      return "can::receive";
+    case trace_operation::adc_read:
+      return "adc::read";
+    case trace_operation::dac_write:
+      return "dac::write";
+    case trace_operation::pwm_frequency:
+      return "pwm::frequency";
+    case trace_operation::pwm_duty_cycle:
+      return "pwm::duty_cycle";
+    case trace_operation::output_pin_level:
+      return "output_pin::level";
+    case trace_operation::input_pin_level:
+      return "input_pin::level";
+    case trace_operation::timer_schedule:
+      return "timer::schedule";
+    case trace_operation::timer_cancel:
+      return "timer::cancel";
+    case trace_operation::timer_expire:
+      return "timer::expire";
+    default:
+      return "unknown";
+  }
+}
+
+/**
+ * @brief Export a trace buffer as Chrome trace event JSON
+ *
+ * The output can be opened with Perfetto (ui.perfetto.dev) or
+ * chrome://tracing. Each track becomes a thread of the timeline, named from
+ * p_track_names when provided. Names are escaped, so they may contain any
+ * characters.
+ *
+ * @param p_file - file opened for writing
+ * @param p_buffer - trace buffer to export
+ * @param p_clock_frequency - frequency of the steady_clock used by the traced
+ * decorators, used to convert ticks to microseconds.
+ * @param p_track_names - optional names indexed by track id
+ * @return std::size_t - number of records written
+ */
+inline std::size_t write_chrome_trace(
+  std::FILE* p_file,
+  trace_buffer const& p_buffer,
+  hertz p_clock_frequency,
+  std::span<char const* const> p_track_names = {})
+{
+  auto const microseconds_per_tick =
+    1'000'000.0 / static_cast<double>(p_clock_frequency);
+  std::size_t count = 0;
+
+  std::fputs("{\"traceEvents\":[", p_file);
+  for (std::size_t track = 0; track < p_track_names.size(); track++) {
+    std::fprintf(p_file,
+                 "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                 "\"tid\":%zu,\"args\":{\"name\":",
+                 track == 0 ? "" : ",",
+                 track);
+    detail::write_json_string(p_file, p_track_names[track]);
+    std::fputs("}}", p_file);
+  }
+  bool first = p_track_names.empty();
+  p_buffer.for_each([&](trace_record const& p_record) {
+    // Events with no duration of their own are drawn as instants
+    auto const instant =
+      p_record.operation == trace_operation::can_receive ||
+      p_record.operation == trace_operation::timer_expire;
+    std::fprintf(p_file, "%s\n{\"name\":", first ? "" : ",");
+    detail::write_json_string(p_file, to_string(p_record.operation));
+    std::fprintf(
+      p_file,
+      ",\"ph\":\"%s\",\"pid\":1,\"tid\":%u,"
+      "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"argument\":%lu,"
+      "\"out\":%lu,\"in\":%lu,\"failed\":%s}}",
+      instant ? "i" : "X",
+      static_cast<unsigned>(p_record.track),
+      static_cast<double>(p_record.start) * microseconds_per_tick,
+      static_cast<double>(p_record.duration) * microseconds_per_tick,
+      static_cast<unsigned long>(p_record.argument),
+      static_cast<unsigned long>(p_record.size_out),
+      static_cast<unsigned long>(p_record.size_in),
+      p_record.failed ? "true" : "false");
+    first = false;
+    count++;
+  });
+  std::fputs("\n]}\n", p_file);
+  return count;
+}
+}  // namespace hal
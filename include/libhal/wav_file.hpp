@@ -0,0 +1,500 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <limits>
+#include <span>
+
+#include "adc.hpp"
+#include "error.hpp"
+#include "stream_dac.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief File formats supported by the sample file drivers
+ *
+ */
+enum class sample_file_format : std::uint8_t
+{
+  /// RIFF WAVE file with a single channel of PCM samples. 8-bit samples are
+  /// stored unsigned and 16-bit samples are stored signed, as the WAV format
+  /// requires.
+  wav = 0,
+  /// Headerless little endian samples stored exactly as they are passed to the
+  /// stream_dac (unsigned PCM).
+  raw,
+};
+
+namespace detail {
+/// Size of the canonical 44 byte WAV header written by wav_file_stream_dac
+inline constexpr std::size_t wav_header_size = 44;
+
+template<std::unsigned_integral data_t>
+constexpr data_t wav_sign_flip()
+{
+  // 8-bit WAV samples are unsigned, all wider samples are two's complement.
+  // Flipping the MSB converts between unsigned PCM and two's complement.
+  if constexpr (sizeof(data_t) == 1) {
+    return 0;
+  } else {
+    return static_cast<data_t>(data_t{ 1 } << (sizeof(data_t) * 8 - 1));
+  }
+}
+
+inline void store_le(std::span<hal::byte> p_buffer,
+                     std::uint32_t p_value,
+                     std::size_t p_size)
+{
+  for (std::size_t i = 0; i < p_size; i++) {
+    p_buffer[i] = static_cast<hal::byte>(p_value >> (8 * i));
+  }
+}
+
+inline std::uint32_t load_le(std::span<hal::byte const> p_buffer,
+                             std::size_t p_size)
+{
+  std::uint32_t value = 0;
+  for (std::size_t i = 0; i < p_size; i++) {
+    value |= static_cast<std::uint32_t>(p_buffer[i]) << (8 * i);
+  }
+  return value;
+}
+}  // namespace detail
+
+/**
+ * @brief A stream_dac that writes its samples to a file on the host
+ *
+ * Intended for running audio and signal pipelines on a host machine faster
+ * than real time, for benchmarking and for inspecting the output of the
+ * pipeline with standard audio tools.
+ *
+ * Samples are converted into a staging buffer of `buffer_size` bytes and
+ * written to the file one full staging buffer at a time, keeping the number of
+ * calls into the C library low regardless of how small each stream_dac write
+ * is.
+ *
+ * WAV files are single channel. The sample rate of the first write is recorded
+ * in the header, all subsequent writes must use the same sample rate. The
+ * header's size fields are finalized by `close()` or the destructor.
+ *
+ * @tparam data_t - container size for the sample data
+ * @tparam buffer_size - size of the staging buffer in bytes
+ */
+template<std::unsigned_integral data_t, std::size_t buffer_size = 16384>
+class wav_file_stream_dac : public hal::stream_dac<data_t>
+{
+public:
+  static_assert(sizeof(data_t) <= 4, "Samples wider than 32-bits unsupported");
+  static_assert(buffer_size >= sizeof(data_t),
+                "Staging buffer must fit at least one sample");
+
+  using samples = typename hal::stream_dac<data_t>::samples;
+
+  /**
+   * @brief Create or truncate the file at p_path
+   *
+   * @param p_path - path of the file to write
+   * @param p_format - format of the file
+   * @throws hal::io_error - if the file could not be opened
+   */
+  wav_file_stream_dac(char const* p_path,
+                      sample_file_format p_format = sample_file_format::wav)
+    : m_file(std::fopen(p_path, "wb"))
+    , m_format(p_format)
+  {
+    if (m_file == nullptr) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    if (m_format == sample_file_format::wav) {
+      // Reserve space for the header, which is written by close() once the
+      // sample rate and length are known.
+      std::array<hal::byte, detail::wav_header_size> header{};
+      if (std::fwrite(header.data(), 1, header.size(), m_file) !=
+          header.size()) {
+        std::fclose(m_file);
+        hal::safe_throw(hal::io_error(this));
+      }
+    }
+  }
+
+  wav_file_stream_dac(wav_file_stream_dac const&) = delete;
+  wav_file_stream_dac& operator=(wav_file_stream_dac const&) = delete;
+  wav_file_stream_dac(wav_file_stream_dac&&) = delete;
+  wav_file_stream_dac& operator=(wav_file_stream_dac&&) = delete;
+
+  /**
+   * @brief Flush all buffered samples, finalize the header and close the file
+   *
+   * Subsequent writes will throw hal::io_error.
+   *
+   * @throws hal::io_error - if the file could not be written
+   */
+  void close()
+  {
+    if (not finish()) {
+      hal::safe_throw(hal::io_error(this));
+    }
+  }
+
+  /**
+   * @brief Number of samples written to this stream dac
+   *
+   * @return std::uint64_t - total samples accepted by write()
+   */
+  [[nodiscard]] std::uint64_t sample_count() const
+  {
+    return m_sample_count;
+  }
+
+  ~wav_file_stream_dac() override
+  {
+    static_cast<void>(finish());
+  }
+
+private:
+  static constexpr auto sign_flip = detail::wav_sign_flip<data_t>();
+
+  void driver_write(samples const& p_samples) override
+  {
+    if (m_file == nullptr) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    if (p_samples.data.empty()) {
+      return;
+    }
+    if (m_sample_rate == 0.0f) {
+      m_sample_rate = p_samples.sample_rate;
+    } else if (m_format == sample_file_format::wav &&
+               p_samples.sample_rate != m_sample_rate) {
+      hal::safe_throw(hal::argument_out_of_domain(this));
+    }
+
+    for (auto sample : p_samples.data) {
+      if (m_staged + sizeof(data_t) > m_staging.size()) {
+        flush_staging();
+      }
+      if (m_format == sample_file_format::wav) {
+        sample ^= sign_flip;
+      }
+      detail::store_le(std::span(m_staging).subspan(m_staged),
+                       static_cast<std::uint32_t>(sample),
+                       sizeof(data_t));
+      m_staged += sizeof(data_t);
+    }
+    m_sample_count += p_samples.data.size();
+  }
+
+  void flush_staging()
+  {
+    write_bytes(std::span(m_staging).first(m_staged));
+    m_staged = 0;
+  }
+
+  void write_bytes(std::span<hal::byte const> p_bytes)
+  {
+    if (std::fwrite(p_bytes.data(), 1, p_bytes.size(), m_file) !=
+        p_bytes.size()) {
+      hal::safe_throw(hal::io_error(this));
+    }
+  }
+
+  bool finish() noexcept
+  {
+    if (m_file == nullptr) {
+      return true;
+    }
+
+    bool success = true;
+    auto const staged = m_staged;
+    success &= std::fwrite(m_staging.data(), 1, staged, m_file) == staged;
+    m_staged = 0;
+
+    if (m_format == sample_file_format::wav) {
+      success &= write_header();
+    }
+
+    success &= std::fclose(m_file) == 0;
+    m_file = nullptr;
+    return success;
+  }
+
+  bool write_header() noexcept
+  {
+    constexpr std::uint32_t bits = sizeof(data_t) * 8;
+    auto const rate = static_cast<std::uint32_t>(std::lround(m_sample_rate));
+    auto const data_size =
+      static_cast<std::uint32_t>(m_sample_count * sizeof(data_t));
+    std::array<hal::byte, detail::wav_header_size> header{
+      'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+      'f', 'm', 't', ' ', 0, 0, 0, 0, 0, 0, 0, 0,
+    };
+    std::span<hal::byte> view(header);
+    detail::store_le(view.subspan(4), 36 + data_size, 4);
+    detail::store_le(view.subspan(16), 16, 4);  // fmt chunk size
+    detail::store_le(view.subspan(20), 1, 2);   // PCM
+    detail::store_le(view.subspan(22), 1, 2);   // channels
+    detail::store_le(view.subspan(24), rate, 4);
+    detail::store_le(view.subspan(28), rate * sizeof(data_t), 4);
+    detail::store_le(view.subspan(32), sizeof(data_t), 2);  // block align
+    detail::store_le(view.subspan(34), bits, 2);
+    view[36] = 'd';
+    view[37] = 'a';
+    view[38] = 't';
+    view[39] = 'a';
+    detail::store_le(view.subspan(40), data_size, 4);
+
+    if (std::fseek(m_file, 0, SEEK_SET) != 0) {
+      return false;
+    }
+    return std::fwrite(header.data(), 1, header.size(), m_file) ==
+           header.size();
+  }
+
+  std::FILE* m_file;
+  sample_file_format m_format;
+  hertz m_sample_rate = 0.0f;
+  std::uint64_t m_sample_count = 0;
+  std::size_t m_staged = 0;
+  std::array<hal::byte, buffer_size> m_staging{};
+};
+
+/**
+ * @brief A sample source that reads samples from a file on the host
+ *
+ * The counterpart to wav_file_stream_dac, used to feed captured or synthetic
+ * signals into pipelines on a host machine. Samples can be read in blocks with
+ * `read()` or one at a time through the hal::adc interface, allowing the file
+ * to stand in for any driver that consumes a hal::adc.
+ *
+ * Samples are read from the file one staging buffer of `buffer_size` bytes at
+ * a time.
+ *
+ * @tparam data_t - container size for the sample data. Must match the bit
+ * width of WAV files.
+ * @tparam buffer_size - size of the staging buffer in bytes
+ */
+template<std::unsigned_integral data_t, std::size_t buffer_size = 16384>
+class wav_file_adc : public hal::adc
+{
+public:
+  static_assert(sizeof(data_t) <= 4, "Samples wider than 32-bits unsupported");
+  static_assert(buffer_size >= sizeof(data_t),
+                "Staging buffer must fit at least one sample");
+
+  /// Settings for the sample file
+  struct settings
+  {
+    /// Format of the file
+    sample_file_format format = sample_file_format::wav;
+    /// Sample rate of raw files. Ignored for WAV files as the sample rate is
+    /// taken from the header.
+    hertz sample_rate = 0.0f;
+    /// Rewind to the first sample when the end of the file is reached
+    bool loop = false;
+  };
+
+  /**
+   * @brief Open the file at p_path for reading
+   *
+   * @param p_path - path of the file to read
+   * @param p_settings - file settings
+   * @throws hal::io_error - if the file could not be opened or the WAV header
+   * is malformed.
+   * @throws hal::operation_not_supported - if the WAV file is not single
+   * channel PCM with samples the width of data_t.
+   */
+  wav_file_adc(char const* p_path, settings const& p_settings = {})
+    : m_file(std::fopen(p_path, "rb"))
+    , m_settings(p_settings)
+  {
+    if (m_file == nullptr) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    if (m_settings.format == sample_file_format::wav) {
+      try {
+        parse_header();
+      } catch (...) {
+        std::fclose(m_file);
+        throw;
+      }
+    }
+  }
+
+  wav_file_adc(wav_file_adc const&) = delete;
+  wav_file_adc& operator=(wav_file_adc const&) = delete;
+  wav_file_adc(wav_file_adc&&) = delete;
+  wav_file_adc& operator=(wav_file_adc&&) = delete;
+
+  /**
+   * @brief Sample rate of the file
+   *
+   * @return hertz - sample rate from the WAV header or the settings
+   */
+  [[nodiscard]] hertz sample_rate() const
+  {
+    return m_settings.sample_rate;
+  }
+
+  // Keep the single sample hal::adc::read() visible next to the block read
+  using hal::adc::read;
+
+  /**
+   * @brief Read a block of samples
+   *
+   * @param p_samples - buffer to fill with unsigned PCM samples
+   * @return std::span<data_t> - the filled portion of p_samples. This will
+   * only be shorter than p_samples when the end of a non-looping file has been
+   * reached.
+   */
+  std::span<data_t> read(std::span<data_t> p_samples)
+  {
+    std::size_t filled = 0;
+    while (filled < p_samples.size()) {
+      if (m_cursor == m_staged && not refill()) {
+        break;
+      }
+      auto sample = static_cast<data_t>(detail::load_le(
+        std::span(m_staging).subspan(m_cursor), sizeof(data_t)));
+      if (m_settings.format == sample_file_format::wav) {
+        sample ^= sign_flip;
+      }
+      p_samples[filled++] = sample;
+      m_cursor += sizeof(data_t);
+    }
+    return p_samples.first(filled);
+  }
+
+  ~wav_file_adc() override
+  {
+    std::fclose(m_file);
+  }
+
+private:
+  static constexpr auto sign_flip = detail::wav_sign_flip<data_t>();
+
+  /**
+   * @return float - next sample scaled between 0.0f and 1.0f
+   * @throws hal::io_error - if the end of a non-looping file has been reached
+   */
+  float driver_read() override
+  {
+    constexpr auto full_scale =
+      static_cast<float>(std::numeric_limits<data_t>::max());
+    data_t sample{};
+    if (read(std::span(&sample, 1)).empty()) {
+      hal::safe_throw(hal::io_error(this));
+    }
+    return static_cast<float>(sample) / full_scale;
+  }
+
+  bool refill()
+  {
+    m_cursor = 0;
+    m_staged = fill();
+    if (m_staged == 0 && m_settings.loop) {
+      std::fseek(m_file, m_data_offset, SEEK_SET);
+      m_remaining = m_data_size;
+      m_staged = fill();
+    }
+    return m_staged != 0;
+  }
+
+  std::size_t fill()
+  {
+    auto request = m_staging.size() - (m_staging.size() % sizeof(data_t));
+    if (m_remaining < request) {
+      request = static_cast<std::size_t>(m_remaining);
+    }
+    auto const count = std::fread(m_staging.data(), 1, request, m_file);
+    m_remaining -= count;
+    // Drop any trailing partial sample
+    return count - (count % sizeof(data_t));
+  }
+
+  void read_exact(std::span<hal::byte> p_buffer)
+  {
+    if (std::fread(p_buffer.data(), 1, p_buffer.size(), m_file) !=
+        p_buffer.size()) {
+      hal::safe_throw(hal::io_error(this));
+    }
+  }
+
+  void parse_header()
+  {
+    std::array<hal::byte, 12> riff{};
+    read_exact(riff);
+    if (riff[0] != 'R' || riff[1] != 'I' || riff[2] != 'F' || riff[3] != 'F' ||
+        riff[8] != 'W' || riff[9] != 'A' || riff[10] != 'V' ||
+        riff[11] != 'E') {
+      hal::safe_throw(hal::io_error(this));
+    }
+
+    bool found_format = false;
+    while (true) {
+      std::array<hal::byte, 8> chunk{};
+      read_exact(chunk);
+      auto const size = detail::load_le(std::span(chunk).subspan(4), 4);
+
+      if (chunk[0] == 'f' && chunk[1] == 'm' && chunk[2] == 't') {
+        std::array<hal::byte, 16> format{};
+        if (size < format.size()) {
+          hal::safe_throw(hal::io_error(this));
+        }
+        read_exact(format);
+        std::span<hal::byte const> view(format);
+        auto const pcm = detail::load_le(view.subspan(0), 2) == 1;
+        auto const channels = detail::load_le(view.subspan(2), 2);
+        auto const rate = detail::load_le(view.subspan(4), 4);
+        auto const bits = detail::load_le(view.subspan(14), 2);
+        if (not pcm || channels != 1 || bits != sizeof(data_t) * 8) {
+          hal::safe_throw(hal::operation_not_supported(this));
+        }
+        m_settings.sample_rate = static_cast<hertz>(rate);
+        found_format = true;
+        // Skip extension bytes and the pad byte of odd sized chunks
+        std::fseek(m_file, (size - format.size()) + (size & 1), SEEK_CUR);
+      } else if (chunk[0] == 'd' && chunk[1] == 'a' && chunk[2] == 't' &&
+                 chunk[3] == 'a') {
+        if (not found_format) {
+          hal::safe_throw(hal::io_error(this));
+        }
+        m_data_offset = std::ftell(m_file);
+        m_data_size = size;
+        m_remaining = size;
+        return;
+      } else {
+        std::fseek(m_file, size + (size & 1), SEEK_CUR);
+      }
+    }
+  }
+
+  std::FILE* m_file;
+  settings m_settings;
+  long m_data_offset = 0;
+  std::uint64_t m_data_size = std::numeric_limits<std::uint64_t>::max();
+  std::uint64_t m_remaining = std::numeric_limits<std::uint64_t>::max();
+  std::size_t m_staged = 0;
+  std::size_t m_cursor = 0;
+  std::array<hal::byte, buffer_size> m_staging{};
+};
+}  // namespace hal
@@ -0,0 +1,260 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/binary_logger.hpp>
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <libhal/error.hpp>
+#include <libhal/serial.hpp>
+#include <libhal/serial_tx_queue.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class capture_serial : public hal::serial
+{
+public:
+  std::array<hal::byte, 512> m_sent{};
+  std::size_t m_length = 0;
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    std::ranges::copy(p_data, m_sent.begin() + m_length);
+    m_length += p_data.size();
+    return write_t{ .data = p_data };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    return read_t{ .data = p_data.first(0), .available = 0, .capacity = 0 };
+  }
+
+  void driver_flush() override
+  {
+  }
+};
+
+struct decoded_message
+{
+  log_level level;
+  std::array<char, 160> text{};
+  std::size_t length = 0;
+
+  [[nodiscard]] std::string_view view() const
+  {
+    return { text.data(), length };
+  }
+};
+
+template<class... entries_t>
+std::array<hal::byte, 256> make_image()
+{
+  std::array<hal::byte, 256> image{};
+  // Bytes resembling the start of a record but failing validation
+  std::ranges::copy(std::string_view("hlog\x01\x02\x03\x04\x02\x01\x00x"),
+                    image.begin());
+  std::size_t position = 16;
+  (
+    [&image, &position]() {
+      auto const bytes = std::as_bytes(std::span(&entries_t::record, 1));
+      for (auto const value : bytes) {
+        image[position++] = static_cast<hal::byte>(value);
+      }
+      position += 3;
+    }(),
+    ...);
+  return image;
+}
+
+// Format string tables are validated at compile time
+static_assert(detail::parse_log_format("a=%d b=%-4.2f %% %s").count == 3);
+static_assert(detail::parse_log_format("a=%d b=%-4.2f %% %s").types[1] == 'f');
+static_assert(detail::log_id(log_level::info, "x") !=
+              detail::log_id(log_level::warning, "x"));
+}  // namespace
+
+void binary_logger_test()
+{
+  using namespace boost::ut;
+
+  "binary_logger & log_decoder"_test = []() {
+    // Setup
+    std::array<std::uint32_t, 128> ring{};
+    std::array<hal::byte, 256> staging{};
+    serial_tx_queue queue(ring, staging);
+    binary_logger logger(queue, log_level::debug);
+    capture_serial serial;
+    std::array<decoded_message, 4> messages{};
+    std::size_t count = 0;
+    std::array<log_format, 8> formats{};
+
+    // Exercise
+    logger.info<"temperature=%d.%u C">(-12, 5U);
+    logger.trace<"filtered %d">(1);
+    logger.warning<"%s: %.2f%% (0x%04X)">(std::string_view("duty"), 42.5f, 255);
+    logger.error<"no arguments">();
+    (void)queue.drain(serial);
+    // Stand in for the firmware image: the records surrounded by other data
+    auto const image = make_image<
+      detail::log_format_entry<log_level::info, "temperature=%d.%u C">,
+      detail::log_format_entry<log_level::warning, "%s: %.2f%% (0x%04X)">,
+      detail::log_format_entry<log_level::error, "no arguments">>();
+    log_decoder decoder(image, formats);
+    auto const consumed =
+      decoder.decode(std::span(serial.m_sent).first(serial.m_length),
+                     [&](log_level p_level, std::string_view p_text) {
+                       auto& message = messages[count++];
+                       message.level = p_level;
+                       message.length = p_text.size();
+                       std::ranges::copy(p_text, message.text.begin());
+                     });
+
+    // Verify
+    expect(that % 3 == decoder.formats().size());
+    // COBS code byte, id, 2 single byte varints and the delimiter
+    expect(that % 0 == serial.m_sent[7]);
+    expect(std::ranges::none_of(std::span(serial.m_sent).first(7),
+                                [](hal::byte p_byte) { return p_byte == 0; }));
+    expect(that % serial.m_length == consumed);
+    expect(that % 3 == count);
+    expect(log_level::info == messages[0].level);
+    expect(std::string_view("temperature=-12.5 C") == messages[0].view());
+    expect(log_level::warning == messages[1].level);
+    expect(std::string_view("duty: 42.50% (0x00FF)") == messages[1].view());
+    expect(log_level::error == messages[2].level);
+    expect(std::string_view("no arguments") == messages[2].view());
+  };
+
+  "log_decoder handles partial and unknown messages"_test = []() {
+    // Setup
+    log_decoder decoder({}, {});
+    std::array<hal::byte, 9> const stream{ 5,    0x78, 0x56, 0x34, 0x12,
+                                           0x00, 3,    0x78, 0x56 };
+    std::array<char, 64> text{};
+    std::size_t length = 0;
+
+    // Exercise
+    auto const consumed =
+      decoder.decode(stream, [&](log_level, std::string_view p_text) {
+        length = p_text.size();
+        std::ranges::copy(p_text, text.begin());
+      });
+
+    // Verify
+    expect(that % 6 == consumed);
+    expect(that % 0 == decoder.errors());
+    expect(std::string_view("<unknown log id 0x12345678>") ==
+           std::string_view(text.data(), length));
+  };
+
+  "log_decoder skips corrupt frames and resynchronizes"_test = []() {
+    // Setup
+    std::array<std::uint32_t, 128> ring{};
+    std::array<hal::byte, 256> staging{};
+    serial_tx_queue queue(ring, staging);
+    binary_logger logger(queue);
+    capture_serial serial;
+    std::array<log_format, 2> formats{};
+    auto const image =
+      make_image<detail::log_format_entry<log_level::info, "count=%u">>();
+    log_decoder decoder(image, formats);
+    std::array<decoded_message, 4> messages{};
+    std::size_t count = 0;
+    auto const handler = [&](log_level, std::string_view p_text) {
+      auto& message = messages[count++];
+      message.length = p_text.size();
+      std::ranges::copy(p_text, message.text.begin());
+    };
+    logger.info<"count=%u">(1U);
+    logger.info<"count=%u">(2U);
+    logger.info<"count=%u">(3U);
+    (void)queue.drain(serial);
+    // Frames are 7 bytes long. Join the stream part way through the first
+    // frame and drop a byte from the second.
+    std::array<hal::byte, 512> received{};
+    auto const sent = std::span(serial.m_sent).first(serial.m_length);
+    auto const tail = std::ranges::copy(sent.subspan(3, 6), received.begin());
+    auto const end = std::ranges::copy(sent.subspan(10), tail.out).out;
+    auto const length =
+      static_cast<std::size_t>(std::distance(received.begin(), end));
+
+    // Exercise
+    auto const consumed = decoder.decode(std::span(received).first(length),
+                                         handler);
+
+    // Verify
+    expect(that % length == consumed);
+    expect(that % 2 == decoder.errors());
+    expect(that % 1 == count);
+    expect(std::string_view("count=3") == messages[0].view());
+  };
+
+  "binary_logger truncates strings to fit later arguments"_test = []() {
+    // Setup
+    std::array<std::uint32_t, 128> ring{};
+    std::array<hal::byte, 256> staging{};
+    serial_tx_queue queue(ring, staging);
+    binary_logger logger(queue);
+    capture_serial serial;
+    std::array<decoded_message, 1> messages{};
+    std::size_t count = 0;
+    std::array<log_format, 2> formats{};
+
+    // Exercise
+    logger.info<"%s %d">(std::string(200, 'x'), -5);
+    (void)queue.drain(serial);
+    auto const image =
+      make_image<detail::log_format_entry<log_level::info, "%s %d">>();
+    log_decoder decoder(image, formats);
+    auto const consumed =
+      decoder.decode(std::span(serial.m_sent).first(serial.m_length),
+                     [&](log_level, std::string_view p_text) {
+                       auto& message = messages[count++];
+                       message.length = p_text.size();
+                       std::ranges::copy(p_text, message.text.begin());
+                     });
+
+    // Verify
+    // The string leaves room for the 5 byte worst case of the int
+    auto const expected = std::string(116, 'x') + " -5";
+    expect(that % serial.m_length == consumed);
+    expect(that % 1 == count);
+    expect(std::string_view(expected) == messages[0].view());
+    expect(serial.m_length <= binary_logger::max_message_size);
+  };
+
+  "binary_logger rejects small queues"_test = []() {
+    // Setup
+    std::array<std::uint32_t, 64> ring{};
+    std::array<hal::byte, 256> staging{};
+    serial_tx_queue queue(ring, staging);
+
+    // Exercise
+    // Verify
+    expect(throws<hal::argument_out_of_domain>(
+      [&queue]() { binary_logger logger(queue); }));
+  };
+};
+}  // namespace hal
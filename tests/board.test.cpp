@@ -0,0 +1,128 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/board.hpp>
+
+#include <cstdint>
+
+#include <libhal/initializers.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+struct test_pin
+{
+  constexpr test_pin(port_param auto p_port, pin_param auto p_pin)
+    : m_port(p_port())
+    , m_pin(p_pin())
+  {
+  }
+
+  std::int64_t m_port;
+  std::int64_t m_pin;
+};
+
+struct test_bus
+{
+  constexpr explicit test_bus(bus_param auto p_bus)
+    : m_bus(p_bus())
+  {
+  }
+
+  std::int64_t m_bus;
+};
+
+struct test_device
+{
+  constexpr test_device(test_bus& p_bus, test_pin& p_reset, int p_address)
+    : m_bus(&p_bus)
+    , m_reset(&p_reset)
+    , m_address(p_address)
+  {
+  }
+
+  test_bus* m_bus;
+  test_pin* m_reset;
+  int m_address;
+};
+
+struct led;
+struct reset;
+struct i2c0;
+struct i2c1;
+struct sensor;
+struct second_sensor;
+
+using test_board =
+  board<peripheral<led, test_pin, port<1>, pin<10>>,
+        peripheral<reset, test_pin, port<2>, pin<10>>,
+        peripheral<i2c0, test_bus, bus<0>>,
+        peripheral<i2c1, test_bus, bus<1>>,
+        device<sensor, test_device, depends<i2c1, reset>, 0x68>,
+        device<second_sensor, test_device, depends<i2c1, reset>, 0x69>>;
+
+// Every driver has a constexpr constructor, so no initialization code runs
+constinit test_board static_board;
+
+using led_entry = peripheral<led, test_pin, port<1>, pin<10>>;
+using bus_entry = peripheral<i2c0, test_bus, bus<0>>;
+static_assert(detail::board_entries_conflict<
+              led_entry,
+              peripheral<reset, test_pin, port<1>, pin<10>>>());
+static_assert(not detail::board_entries_conflict<
+              led_entry,
+              peripheral<reset, test_pin, port<1>, pin<11>>>());
+static_assert(
+  detail::board_entries_conflict<bus_entry,
+                                 peripheral<i2c1, test_bus, bus<0>>>());
+static_assert(
+  not detail::board_entries_conflict<bus_entry,
+                                     peripheral<i2c1, test_pin, bus<0>>>());
+// Devices of the same type, such as two sensors at different addresses, and
+// entries without selectors claim no hardware
+using sensor_entry = device<sensor, test_device, depends<i2c1, reset>, 0x68>;
+using second_sensor_entry =
+  device<second_sensor, test_device, depends<i2c1, reset>, 0x69>;
+static_assert(
+  not detail::board_entries_conflict<sensor_entry, second_sensor_entry>());
+static_assert(not detail::board_entries_conflict<peripheral<i2c0, test_bus>,
+                                                 peripheral<i2c1, test_bus>>());
+static_assert(test_board::index_of<sensor>() == 4);
+static_assert(test_board::declared_before<i2c1, sensor>());
+static_assert(not test_board::declared_before<sensor, i2c1>());
+}  // namespace
+
+void board_test()
+{
+  using namespace boost::ut;
+
+  "board::get()"_test = []() {
+    // Setup
+    auto& led_pin = static_board.get<led>();
+    auto& reset_pin = static_board.get<reset>();
+    auto& sensor_device = static_board.get<sensor>();
+
+    // Exercise
+    // Verify
+    expect(that % 1 == led_pin.m_port);
+    expect(that % 10 == led_pin.m_pin);
+    expect(that % 2 == reset_pin.m_port);
+    expect(that % 0 == static_board.get<i2c0>().m_bus);
+    expect(that % &static_board.get<i2c1>() == sensor_device.m_bus);
+    expect(that % &reset_pin == sensor_device.m_reset);
+    expect(that % 0x68 == sensor_device.m_address);
+  };
+};
+}  // namespace hal
@@ -0,0 +1,234 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/buffered_serial_writer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+#include <libhal/error.hpp>
+#include <libhal/serial.hpp>
+#include <libhal/steady_clock.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class capture_serial : public hal::serial
+{
+public:
+  std::array<hal::byte, 256> m_sent{};
+  std::size_t m_length = 0;
+  std::size_t m_write_calls = 0;
+  settings m_settings{};
+  /// Bytes accepted by further writes, the rest of a write is refused
+  std::size_t m_budget = std::numeric_limits<std::size_t>::max();
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    m_settings = p_settings;
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    auto const accepted = p_data.first(std::min(p_data.size(), m_budget));
+    std::ranges::copy(accepted, m_sent.begin() + m_length);
+    m_length += accepted.size();
+    m_budget -= accepted.size();
+    m_write_calls++;
+    return write_t{ .data = accepted };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    return read_t{ .data = p_data.first(0), .available = 0, .capacity = 0 };
+  }
+
+  void driver_flush() override
+  {
+  }
+};
+
+class manual_steady_clock : public hal::steady_clock
+{
+public:
+  std::uint64_t m_uptime = 0;
+
+private:
+  hertz driver_frequency() override
+  {
+    return 1.0_MHz;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    return m_uptime;
+  }
+};
+}  // namespace
+
+void buffered_serial_writer_test()
+{
+  using namespace boost::ut;
+  using namespace std::chrono_literals;
+
+  "buffered_serial_writer coalesces writes"_test = []() {
+    // Setup
+    capture_serial serial;
+    manual_steady_clock clock;
+    std::array<hal::byte, 16> buffer{};
+    buffered_serial_writer writer(serial, clock, buffer, 1ms);
+    std::array<hal::byte, 3> const data{ 'a', 'b', 'c' };
+
+    // Exercise
+    for (int i = 0; i < 4; i++) {
+      writer.write(data);
+    }
+    auto const calls_before_flush = serial.m_write_calls;
+    writer.flush_writes();
+
+    // Verify
+    expect(that % 0 == calls_before_flush);
+    expect(that % 1 == serial.m_write_calls);
+    expect(that % 12 == serial.m_length);
+    expect(that % 0 == writer.buffered());
+    expect(std::ranges::equal(std::span(serial.m_sent).first(3), data));
+    expect(std::ranges::equal(std::span(serial.m_sent).subspan(9, 3), data));
+  };
+
+  "buffered_serial_writer writes when full"_test = []() {
+    // Setup
+    capture_serial serial;
+    manual_steady_clock clock;
+    std::array<hal::byte, 8> buffer{};
+    buffered_serial_writer writer(serial, clock, buffer, 1ms);
+    std::array<hal::byte, 5> const data{ 1, 2, 3, 4, 5 };
+
+    // Exercise
+    writer.write(data);
+    writer.write(data);
+
+    // Verify
+    expect(that % 1 == serial.m_write_calls);
+    expect(that % 8 == serial.m_length);
+    expect(that % 2 == writer.buffered());
+  };
+
+  "buffered_serial_writer passes large writes through"_test = []() {
+    // Setup
+    capture_serial serial;
+    manual_steady_clock clock;
+    std::array<hal::byte, 4> buffer{};
+    buffered_serial_writer writer(serial, clock, buffer, 1ms);
+    std::array<hal::byte, 10> const data{};
+
+    // Exercise
+    writer.write(data);
+
+    // Verify
+    expect(that % 1 == serial.m_write_calls);
+    expect(that % 10 == serial.m_length);
+    expect(that % 0 == writer.buffered());
+  };
+
+  "buffered_serial_writer writes after the deadline"_test = []() {
+    // Setup
+    capture_serial serial;
+    manual_steady_clock clock;
+    std::array<hal::byte, 64> buffer{};
+    buffered_serial_writer writer(serial, clock, buffer, 1ms);
+    std::array<hal::byte, 2> const data{ 'o', 'k' };
+
+    // Exercise
+    clock.m_uptime = 100;
+    writer.write(data);
+    clock.m_uptime = 1099;
+    auto const early = writer.poll();
+    writer.write(data);
+    auto const calls_before_deadline = serial.m_write_calls;
+    clock.m_uptime = 1100;
+    auto const due = writer.poll();
+
+    // Verify
+    expect(not early);
+    expect(that % 0 == calls_before_deadline);
+    expect(due);
+    expect(that % 1 == serial.m_write_calls);
+    expect(that % 4 == serial.m_length);
+  };
+
+  "buffered_serial_writer keeps bytes the port did not accept"_test = []() {
+    // Setup
+    capture_serial serial;
+    manual_steady_clock clock;
+    std::array<hal::byte, 8> buffer{};
+    buffered_serial_writer writer(serial, clock, buffer, 1ms);
+    std::array<hal::byte, 6> const data{ 1, 2, 3, 4, 5, 6 };
+    serial.m_budget = 3;
+
+    // Exercise
+    auto const first = writer.write(data).data.size();
+    // Buffer is full and the port accepts nothing
+    auto const second = writer.write(data).data.size();
+    auto const writes_while_blocked = writer.serial_writes();
+    serial.m_budget = std::numeric_limits<std::size_t>::max();
+    writer.flush_writes();
+
+    // Verify
+    expect(that % 6 == first);
+    expect(that % 5 == second);
+    expect(that % 1 == writes_while_blocked);
+    expect(that % 2 == writer.serial_writes());
+    expect(that % 11 == serial.m_length);
+    std::array<hal::byte, 11> const expected{ 1, 2, 3, 4, 5, 6,
+                                              1, 2, 3, 4, 5 };
+    expect(std::ranges::equal(expected, std::span(serial.m_sent).first(11)));
+    expect(that % 0 == writer.buffered());
+  };
+
+  "buffered_serial_writer::configure() writes first"_test = []() {
+    // Setup
+    capture_serial serial;
+    manual_steady_clock clock;
+    std::array<hal::byte, 64> buffer{};
+    buffered_serial_writer writer(serial, clock, buffer, 1ms);
+    std::array<hal::byte, 2> const data{ 'o', 'k' };
+
+    // Exercise
+    writer.write(data);
+    writer.configure({ .baud_rate = 9600.0f });
+
+    // Verify
+    expect(that % 2 == serial.m_length);
+    expect(that % 9600.0f == serial.m_settings.baud_rate);
+  };
+
+  "buffered_serial_writer requires a buffer"_test = []() {
+    // Setup
+    capture_serial serial;
+    manual_steady_clock clock;
+
+    // Exercise
+    // Verify
+    expect(throws<hal::argument_out_of_domain>([&]() {
+      buffered_serial_writer writer(serial, clock, {}, 1ms);
+    }));
+  };
+};
+}  // namespace hal
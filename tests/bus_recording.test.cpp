@@ -0,0 +1,286 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/bus_recording.hpp>
+
+#include <algorithm>
+#include <array>
+#include <span>
+
+#include <libhal/error.hpp>
+#include <libhal/simulation.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+/// Serial port that accepts at most two bytes per write, or throws
+class partial_serial : public hal::serial
+{
+public:
+  bool m_fail = false;
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    if (m_fail) {
+      hal::safe_throw(hal::timed_out(this));
+    }
+    return { .data = p_data.first(std::min<std::size_t>(p_data.size(), 2)) };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    return { .data = p_data.first(0), .available = 0, .capacity = 0 };
+  }
+
+  void driver_flush() override
+  {
+  }
+};
+}  // namespace
+
+void bus_recording_test()
+{
+  using namespace boost::ut;
+
+  "bus_log_writer & bus_log_reader round trip"_test = []() {
+    // Setup
+    std::array<hal::byte, 64> storage{};
+    bus_log_writer writer(storage);
+    std::array<hal::byte, 2> const out{ 0xAB, 0xCD };
+    std::array<hal::byte, 1> const in{ 0xEF };
+
+    // Exercise
+    writer.append({ .kind = bus_log_kind::i2c_transaction,
+                    .argument = 0x42,
+                    .start = 1000,
+                    .duration = 200,
+                    .data_out = out,
+                    .data_in = in });
+    writer.append({ .kind = bus_log_kind::i2c_transaction,
+                    .failed = true,
+                    .error = std::errc::no_such_device,
+                    .argument = 0x10,
+                    .start = 5000 });
+    bus_log_reader reader(writer.data());
+    auto const first = reader.next();
+    auto const second = reader.next();
+    auto const end = reader.next();
+
+    // Verify
+    expect(that % 19 == writer.data().size());
+    expect(that % first.has_value());
+    expect(that % 1000 == first->start);
+    expect(that % 200 == first->duration);
+    expect(that % 0x42 == first->argument);
+    expect(that % 2 == first->data_out.size());
+    expect(that % 0xCD == first->data_out[1]);
+    expect(that % 0xEF == first->data_in[0]);
+    expect(that % not first->failed);
+    expect(that % second->failed);
+    expect(std::errc::no_such_device == second->error);
+    expect(that % 5000 == second->start);
+    expect(that % not end.has_value());
+  };
+
+  "bus_log_writer stops when full"_test = []() {
+    // Setup
+    std::array<hal::byte, 12> storage{};
+    bus_log_writer writer(storage);
+    std::array<hal::byte, 4> const out{};
+
+    // Exercise
+    auto const first = writer.append(
+      { .kind = bus_log_kind::serial_write, .data_out = out });
+    auto const second = writer.append(
+      { .kind = bus_log_kind::serial_write, .data_out = out });
+
+    // Verify
+    expect(that % first);
+    expect(that % not second);
+    expect(that % writer.overflowed());
+    expect(that % 10 == writer.data().size());
+  };
+
+  "recording_i2c then replay_i2c"_test = []() {
+    // Setup
+    std::array<sim::event, 4> events{};
+    sim::kernel kernel(events);
+    sim::steady_clock clock(kernel);
+    sim::i2c i2c(kernel);
+    i2c.attach(0x42, [](std::span<hal::byte const>, std::span<hal::byte> p_in) {
+      p_in[0] = 0x12;
+      p_in[1] = 0x34;
+    });
+    std::array<hal::byte, 128> storage{};
+    bus_log_writer log(storage);
+    recording_i2c recorder(i2c, log, clock);
+    std::array<hal::byte, 1> const out{ 0x05 };
+    std::array<hal::byte, 2> in{};
+    recorder.transaction(0x42, out, in, []() {});
+    expect(throws<hal::no_such_device>(
+      [&]() { recorder.transaction(0x11, out, {}, []() {}); }));
+
+    // Exercise
+    replay_i2c replay(log.data());
+    std::array<hal::byte, 2> replayed{};
+    replay.transaction(0x42, out, replayed, []() {});
+
+    // Verify
+    expect(that % 0x12 == replayed[0]);
+    expect(that % 0x34 == replayed[1]);
+    expect(throws<hal::no_such_device>(
+      [&]() { replay.transaction(0x11, out, {}, []() {}); }));
+    expect(throws<hal::io_error>(
+      [&]() { replay.transaction(0x42, out, replayed, []() {}); }));
+    replay.rewind();
+    expect(throws<hal::io_error>(
+      [&]() { replay.transaction(0x43, out, replayed, []() {}); }));
+  };
+
+  "recording_spi then replay_spi"_test = []() {
+    // Setup
+    std::array<sim::event, 4> events{};
+    sim::kernel kernel(events);
+    sim::steady_clock clock(kernel);
+    sim::spi spi(kernel,
+                 [](std::span<hal::byte const>, std::span<hal::byte> p_in,
+                    hal::byte) { p_in[0] = 0x77; });
+    std::array<hal::byte, 64> storage{};
+    bus_log_writer log(storage);
+    recording_spi recorder(spi, log, clock);
+    std::array<hal::byte, 1> const out{ 0x9F };
+    std::array<hal::byte, 3> in{};
+    recorder.transfer(out, in, 0xFF);
+
+    // Exercise
+    replay_spi replay(log.data());
+    std::array<hal::byte, 3> replayed{};
+    replay.transfer(out, replayed, 0xFF);
+
+    // Verify
+    expect(that % 0x77 == replayed[0]);
+    expect(throws<hal::io_error>(
+      [&]() { replay.transfer(out, replayed, 0xFF); }));
+  };
+
+  "recording_serial then replay_serial with different chunking"_test = []() {
+    // Setup
+    std::array<sim::event, 4> events{};
+    sim::kernel kernel(events);
+    sim::steady_clock clock(kernel);
+    std::array<hal::byte, 16> buffer{};
+    sim::serial port(kernel, buffer);
+    std::array<hal::byte, 128> storage{};
+    bus_log_writer log(storage);
+    recording_serial recorder(port, log, clock);
+    std::array<hal::byte, 3> const command{ 'A', 'T', '\r' };
+    std::array<hal::byte, 4> const response{ 'O', 'K', '\r', '\n' };
+    std::array<hal::byte, 8> scratch{};
+    recorder.write(command);
+    port.receive(std::span(response).first(2));
+    auto const ok = recorder.read(scratch);
+    auto const nothing = recorder.read(scratch);
+    port.receive(std::span(response).subspan(2));
+    auto const rest = recorder.read(scratch);
+
+    // Exercise
+    replay_serial replay(log.data());
+    replay.write(std::span(command).first(1));
+    replay.write(std::span(command).subspan(1));
+    std::array<hal::byte, 3> first{};
+    std::array<hal::byte, 3> second{};
+    auto const first_read = replay.read(first);
+    auto const second_read = replay.read(second);
+    auto const exhausted = replay.read(second);
+
+    // Verify
+    expect(that % 2 == ok.data.size());
+    expect(that % 0 == nothing.data.size());
+    expect(that % 2 == rest.data.size());
+    expect(that % 3 == first_read.data.size());
+    expect(that % 'O' == first[0]);
+    expect(that % '\r' == first[2]);
+    expect(that % 1 == second_read.data.size());
+    expect(that % '\n' == second[0]);
+    expect(that % 0 == exhausted.data.size());
+    expect(throws<hal::io_error>([&]() { replay.write(command); }));
+    replay.rewind();
+    std::array<hal::byte, 1> const wrong{ 'X' };
+    expect(throws<hal::io_error>([&]() { replay.write(wrong); }));
+  };
+
+  "recording_serial then replay_serial with partial writes"_test = []() {
+    // Setup
+    std::array<sim::event, 2> events{};
+    sim::kernel kernel(events);
+    sim::steady_clock clock(kernel);
+    partial_serial port;
+    std::array<hal::byte, 128> storage{};
+    bus_log_writer log(storage);
+    recording_serial recorder(port, log, clock);
+    std::array<hal::byte, 5> const command{ 'A', 'T', 'Z', '\r', '\n' };
+    std::span<hal::byte const> remaining = command;
+    while (not remaining.empty()) {
+      remaining = remaining.subspan(recorder.write(remaining).data.size());
+    }
+    port.m_fail = true;
+    expect(throws<hal::timed_out>([&]() { recorder.write(command); }));
+
+    // Exercise
+    replay_serial replay(log.data());
+    auto const written = replay.write(command);
+
+    // Verify
+    expect(that % command.size() == written.data.size());
+    expect(throws<hal::timed_out>([&]() { replay.write(command); }));
+    replay.rewind();
+    replay.write(command);
+    std::array<hal::byte, 1> const wrong{ 'X' };
+    expect(throws<hal::io_error>([&]() { replay.write(wrong); }));
+  };
+
+  "replay_serial skips empty entries"_test = []() {
+    // Setup
+    std::array<hal::byte, 128> storage{};
+    bus_log_writer log(storage);
+    std::array<hal::byte, 2> const command{ 'A', 'T' };
+    std::array<hal::byte, 2> const response{ 'O', 'K' };
+    log.append({ .kind = bus_log_kind::serial_write,
+                 .data_out = std::span(command).first(1) });
+    log.append({ .kind = bus_log_kind::serial_write });
+    log.append({ .kind = bus_log_kind::serial_write,
+                 .data_out = std::span(command).subspan(1) });
+    log.append({ .kind = bus_log_kind::serial_read,
+                 .data_in = std::span(response).first(1) });
+    log.append({ .kind = bus_log_kind::serial_read });
+    log.append({ .kind = bus_log_kind::serial_read,
+                 .data_in = std::span(response).subspan(1) });
+    replay_serial replay(log.data());
+    std::array<hal::byte, 4> buffer{};
+
+    // Exercise
+    replay.write(command);
+    auto const result = replay.read(buffer);
+
+    // Verify
+    expect(std::ranges::equal(response, result.data));
+  };
+};
+}  // namespace hal
@@ -0,0 +1,255 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/can_scheduler.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <libhal/error.hpp>
+#include <libhal/simulation.hpp>
+#include <libhal/timer_wheel.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+using namespace std::chrono_literals;
+
+/// Sending node and a listener on a simulated 500kbit/s bus
+struct network
+{
+  network()
+  {
+    sender.configure({ .baud_rate = 500.0_kHz });
+    listener.configure({ .baud_rate = 500.0_kHz });
+    listener.on_receive([this](can::message_t const& p_message) {
+      received.push_back({ kernel.now(), p_message });
+    });
+  }
+
+  struct reception
+  {
+    hal::time_duration time;
+    can::message_t message;
+  };
+
+  /// Number of frames received with each id
+  std::map<can::id_t, int> counts() const
+  {
+    std::map<can::id_t, int> result;
+    for (auto const& entry : received) {
+      result[entry.message.id]++;
+    }
+    return result;
+  }
+
+  /// Largest number of frames received within the same millisecond
+  int largest_burst() const
+  {
+    std::map<std::int64_t, int> per_tick;
+    int result = 0;
+    for (auto const& entry : received) {
+      auto const tick = std::chrono::floor<std::chrono::milliseconds>(
+                          entry.time - std::chrono::microseconds(1))
+                          .count();
+      result = std::max(result, ++per_tick[tick]);
+    }
+    return result;
+  }
+
+  std::array<sim::event, 8> events{};
+  sim::kernel kernel{ events };
+  sim::can_bus bus{ kernel };
+  sim::can sender{ bus };
+  sim::can listener{ bus };
+  sim::timer timer{ kernel };
+  sim::steady_clock clock{ kernel };
+  std::array<timer_wheel_entry*, 32> slots{};
+  timer_wheel wheel{ slots, 1ms };
+  std::vector<reception> received;
+};
+}  // namespace
+
+void can_scheduler_test()
+{
+  using namespace boost::ut;
+
+  "can_cyclic_scheduler sends each message every period"_test = []() {
+    // Setup
+    network net;
+    std::uint8_t counter = 0;
+    std::array<can_cyclic_message, 6> messages{ {
+      { { .id = 0x100, .length = 8 },
+        10ms,
+        [&counter](can::message_t& p_message) {
+          p_message.payload[0] = counter++;
+        } },
+      { { .id = 0x101, .length = 8 }, 10ms },
+      { { .id = 0x102, .length = 8 }, 10ms },
+      { { .id = 0x103, .length = 8 }, 10ms },
+      { { .id = 0x200, .length = 4 }, 25ms },
+      { { .id = 0x300, .length = 2 }, 100ms },
+    } };
+    can_cyclic_scheduler scheduler(
+      net.sender, net.timer, net.clock, net.wheel, messages);
+
+    // Exercise
+    scheduler.start();
+    net.kernel.run_for(1s);
+
+    // Verify
+    auto counts = net.counts();
+    expect(that % 100 == counts[0x100]);
+    expect(that % 100 == counts[0x101]);
+    expect(that % 100 == counts[0x102]);
+    expect(that % 100 == counts[0x103]);
+    expect(that % 40 == counts[0x200]);
+    expect(that % 10 == counts[0x300]);
+    // Phases are spread so no two messages share a tick
+    expect(that % 1 == net.largest_burst());
+    expect(that % 0 == scheduler.late_ticks());
+    for (auto const& message : messages) {
+      auto const& statistics = message.statistics();
+      expect(that % 0 == statistics.failed);
+      expect(statistics.max_jitter < scheduler.tick_clocks() / 10);
+    }
+    // The update handler ran before each send
+    std::uint8_t expected = 0;
+    bool in_order = true;
+    for (auto const& entry : net.received) {
+      if (entry.message.id == 0x100) {
+        in_order = in_order && entry.message.payload[0] == expected++;
+      }
+    }
+    expect(in_order);
+  };
+
+  "can_cyclic_scheduler does not drift on an uneven clock"_test = []() {
+    // Setup
+    network net;
+    // 32.768 clock ticks per 1ms wheel tick
+    sim::steady_clock watch_clock(net.kernel, 32.768_kHz);
+    std::array<can_cyclic_message, 1> messages{ {
+      { { .id = 0x100, .length = 1 }, 10ms },
+    } };
+    can_cyclic_scheduler scheduler(
+      net.sender, net.timer, watch_clock, net.wheel, messages);
+
+    // Exercise
+    scheduler.start();
+    net.kernel.run_for(10s);
+
+    // Verify
+    // A truncated 32 clock tick period would run 2.4% fast, 1024 sends
+    expect(that % 1000 == net.counts()[0x100]);
+    expect(that % 33 == scheduler.tick_clocks());
+    expect(that % 0 == scheduler.late_ticks());
+  };
+
+  "can_cyclic_scheduler catches up on late ticks"_test = []() {
+    // Setup
+    network net;
+    bool stalled = false;
+    std::array<can_cyclic_message, 2> messages{ {
+      { { .id = 0x100, .length = 1 }, 1ms },
+      { { .id = 0x200, .length = 1 },
+        10ms,
+        [&net, &stalled](can::message_t&) {
+          // Hold up the timer callback for several ticks, once
+          if (not stalled) {
+            stalled = true;
+            net.kernel.run_for(3500us);
+          }
+        } },
+    } };
+    can_cyclic_scheduler scheduler(
+      net.sender, net.timer, net.clock, net.wheel, messages);
+
+    // Exercise
+    scheduler.start();
+    net.kernel.run_for(100ms);
+
+    // Verify
+    auto counts = net.counts();
+    expect(that % 100 == counts[0x100]);
+    expect(that % 10 == counts[0x200]);
+    expect(that % 2 == scheduler.late_ticks());
+    auto const& statistics = messages[0].statistics();
+    expect(statistics.max_jitter > 2 * scheduler.tick_clocks());
+    expect(statistics.min_interval < scheduler.tick_clocks() / 2);
+  };
+
+  "can_cyclic_scheduler counts failed sends"_test = []() {
+    // Setup
+    network net;
+    std::array<can_cyclic_message, 1> messages{ {
+      { { .id = 0x100, .length = 8 }, 5ms },
+    } };
+    can_cyclic_scheduler scheduler(
+      net.sender, net.timer, net.clock, net.wheel, messages);
+    scheduler.start();
+
+    // Exercise
+    net.kernel.run_for(20ms);
+    net.sender.set_bus_off(true);
+    net.kernel.run_for(20ms);
+    net.sender.bus_on();
+    net.kernel.run_for(20ms);
+
+    // Verify
+    auto const& statistics = messages[0].statistics();
+    expect(that % 8 == statistics.sent);
+    expect(that % 4 == statistics.failed);
+    expect(that % 8 == net.counts()[0x100]);
+  };
+
+  "can_cyclic_scheduler::stop()"_test = []() {
+    // Setup
+    network net;
+    std::array<can_cyclic_message, 1> messages{ {
+      { { .id = 0x100, .length = 8 }, 5ms },
+    } };
+    can_cyclic_scheduler scheduler(
+      net.sender, net.timer, net.clock, net.wheel, messages);
+    scheduler.start();
+    net.kernel.run_for(20ms);
+
+    // Exercise
+    scheduler.stop();
+    net.kernel.run_for(20ms);
+
+    // Verify
+    expect(that % 4 == net.counts()[0x100]);
+    expect(not net.timer.is_running());
+  };
+
+  "can_cyclic_scheduler rejects a zero period"_test = []() {
+    // Setup
+    network net;
+    std::array<can_cyclic_message, 1> messages{ {
+      { { .id = 0x100, .length = 8 }, 0ms },
+    } };
+    can_cyclic_scheduler scheduler(
+      net.sender, net.timer, net.clock, net.wheel, messages);
+
+    // Exercise
+    // Verify
+    expect(throws<hal::argument_out_of_domain>([&]() { scheduler.start(); }));
+  };
+};
+}  // namespace hal
@@ -0,0 +1,198 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/can_signal.hpp>
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#include <libhal/units.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+constexpr auto engine_speed_definition = parse_dbc_signal(
+  R"(SG_ EngineSpeed : 24|16@1+ (0.125,0) [0|8031.875] "rpm" Vector__XXX)");
+static_assert(engine_speed_definition ==
+              can_signal_definition{
+                .start_bit = 24,
+                .length = 16,
+                .byte_order = can_byte_order::little_endian,
+                .is_signed = false,
+                .scale = 0.125f,
+                .offset = 0.0f,
+              });
+
+constexpr auto coolant_definition = parse_dbc_signal(
+  R"(SG_ Coolant m2 : 7|12@0- (1E-1,-4.0e1) [-40|215] "degC" ECU,TCU)");
+static_assert(coolant_definition ==
+              can_signal_definition{ .start_bit = 7,
+                                     .length = 12,
+                                     .byte_order = can_byte_order::big_endian,
+                                     .is_signed = true,
+                                     .scale = 0.1f,
+                                     .offset = -40.0f });
+
+using engine_speed = can_signal<engine_speed_definition>;
+static_assert(std::is_same_v<engine_speed::raw_t, std::uint16_t>);
+static_assert(engine_speed::segments.size() == 2);
+
+// Decoding is usable in constant expressions
+constexpr std::array<hal::byte, 8> idle_payload{ 0, 0, 0, 0x40, 0x1F };
+static_assert(engine_speed::decode(idle_payload) == 1000.0f);
+
+// Bit by bit decoder following the DBC numbering rules
+std::uint64_t reference_unpack(can_signal_definition p_definition,
+                               std::array<hal::byte, 8> const& p_payload)
+{
+  std::uint64_t result = 0;
+  unsigned bit = p_definition.start_bit;
+  for (unsigned i = 0; i < p_definition.length; i++) {
+    auto const value = (p_payload[bit / 8] >> (bit % 8)) & 1U;
+    if (p_definition.byte_order == can_byte_order::little_endian) {
+      result |= std::uint64_t{ value } << i;
+      bit++;
+    } else {
+      result = (result << 1) | value;
+      bit = bit % 8 == 0 ? bit + 15 : bit - 1;
+    }
+  }
+  return result;
+}
+
+template<can_signal_definition definition>
+bool matches_reference()
+{
+  using signal = can_signal<definition>;
+  std::array<hal::byte, 8> payload{};
+  std::uint32_t state = 12345;
+  for (int trial = 0; trial < 64; trial++) {
+    for (auto& value : payload) {
+      state = state * 1103515245U + 12345U;
+      value = static_cast<hal::byte>(state >> 16);
+    }
+
+    auto const raw = static_cast<std::uint64_t>(signal::unpack(payload));
+    auto const mask = definition.length == 64
+                        ? ~std::uint64_t{ 0 }
+                        : (std::uint64_t{ 1 } << definition.length) - 1;
+    if ((raw & mask) != reference_unpack(definition, payload)) {
+      return false;
+    }
+
+    // Packing the value back leaves the payload unchanged
+    auto copy = payload;
+    signal::pack(copy, signal::unpack(payload));
+    if (copy != payload) {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+void can_signal_test()
+{
+  using namespace boost::ut;
+
+  "can_signal::unpack() matches bitwise reference"_test = []() {
+    constexpr auto big = can_byte_order::big_endian;
+
+    // Setup
+    // Exercise
+    // Verify
+    expect(matches_reference<can_signal_definition{ 0, 1 }>());
+    expect(matches_reference<can_signal_definition{ 3, 7 }>());
+    expect(matches_reference<can_signal_definition{ 4, 12 }>());
+    expect(matches_reference<can_signal_definition{ 13, 29 }>());
+    expect(matches_reference<can_signal_definition{ 0, 64 }>());
+    expect(matches_reference<can_signal_definition{ 7, 1, big }>());
+    expect(matches_reference<can_signal_definition{ 3, 12, big }>());
+    expect(matches_reference<can_signal_definition{ 7, 16, big }>());
+    expect(matches_reference<can_signal_definition{ 12, 37, big }>());
+    expect(matches_reference<can_signal_definition{ 7, 64, big }>());
+  };
+
+  "can_signal big endian layout"_test = []() {
+    // Setup
+    using signal = can_signal<parse_dbc_signal(
+      R"(SG_ Pressure : 3|12@0+ (1,0) [0|4095] "" ECU)")>;
+    std::array<hal::byte, 8> payload{ 0xA5, 0xBC, 0x77 };
+
+    // Exercise
+    auto const raw = signal::unpack(payload);
+    signal::pack(payload, 0x123);
+
+    // Verify
+    expect(that % 0x5BC == raw);
+    expect(that % 0xA1 == payload[0]);
+    expect(that % 0x23 == payload[1]);
+    expect(that % 0x77 == payload[2]);
+  };
+
+  "can_signal signed values"_test = []() {
+    // Setup
+    using signal = can_signal<can_signal_definition{ .start_bit = 4,
+                                                     .length = 8,
+                                                     .is_signed = true }>;
+    std::array<hal::byte, 8> payload{ 0x0F, 0xF0 };
+
+    // Exercise
+    signal::pack(payload, -2);
+
+    // Verify
+    expect(that % 0xEF == payload[0]);
+    expect(that % 0xFF == payload[1]);
+    expect(that % -2 == signal::unpack(payload));
+  };
+
+  "can_signal::decode() and encode()"_test = []() {
+    // Setup
+    using coolant = can_signal<coolant_definition>;
+    std::array<hal::byte, 8> payload{};
+
+    // Exercise
+    coolant::encode(payload, 23.46f);
+    auto const decoded = coolant::decode(payload);
+
+    // Verify
+    expect(that % 635 == coolant::unpack(payload));
+    expect(that % 23.5f == decoded);
+  };
+
+  "can_signal::encode() saturates"_test = []() {
+    // Setup
+    using coolant = can_signal<coolant_definition>;
+    std::array<hal::byte, 8> payload{};
+
+    // Exercise
+    engine_speed::encode(payload, -10.0f);
+    auto const low = engine_speed::unpack(payload);
+    engine_speed::encode(payload, 1e9f);
+    auto const high = engine_speed::unpack(payload);
+    coolant::encode(payload, -1000.0f);
+    auto const signed_low = coolant::unpack(payload);
+    coolant::encode(payload, 1000.0f);
+    auto const signed_high = coolant::unpack(payload);
+
+    // Verify
+    expect(that % 0 == low);
+    expect(that % 0xFFFF == high);
+    expect(that % -2048 == signed_low);
+    expect(that % 2047 == signed_high);
+  };
+};
+}  // namespace hal
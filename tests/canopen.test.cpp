@@ -0,0 +1,314 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/canopen.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <libhal/error.hpp>
+#include <libhal/simulation.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+constexpr std::uint8_t device_id = 0x22;
+
+constexpr std::uint32_t device_type = 0x0002'0192;
+constexpr std::array<char, 12> device_name{ "libhal node" };
+std::uint8_t digital_inputs = 0;
+std::uint16_t analog_input = 0;
+std::uint8_t digital_outputs = 0;
+std::int16_t analog_output = 0;
+std::array<hal::byte, 10> configuration{};
+std::uint32_t command = 0;
+
+constexpr auto dictionary = canopen::make_dictionary(std::array{
+  canopen::entry(0x6411, 1, analog_output),
+  canopen::entry(0x6200, 1, digital_outputs),
+  canopen::entry(0x6401, 1, analog_input, canopen::access::read_only),
+  canopen::entry(0x6000, 1, digital_inputs, canopen::access::read_only),
+  canopen::entry(0x2001, 0, command, canopen::access::write_only),
+  canopen::entry(0x2000, 0, configuration),
+  canopen::entry(0x1008, 0, device_name),
+  canopen::entry(0x1000, 0, device_type),
+});
+static_assert(dictionary.front().index == 0x1000);
+static_assert(dictionary.back().index == 0x6411);
+static_assert(canopen::find(dictionary, 0x6401, 1)->size == 2);
+static_assert(canopen::find(dictionary, 0x1008, 0)->mode ==
+              canopen::access::read_only);
+static_assert(canopen::find(dictionary, 0x6401, 2) == nullptr);
+
+constexpr auto tpdo1_mapping = canopen::make_pdo_mapping(
+  dictionary,
+  canopen::pdo_direction::transmit,
+  std::array{ canopen::pdo_entry{ 0x6000, 1 },
+              canopen::pdo_entry{ 0x6401, 1 } });
+static_assert(tpdo1_mapping.length == 3);
+static_assert(tpdo1_mapping.copies[1].offset == 1);
+
+constexpr auto rpdo1_mapping = canopen::make_pdo_mapping(
+  dictionary,
+  canopen::pdo_direction::receive,
+  std::array{ canopen::pdo_entry{ 0x6200, 1 },
+              canopen::pdo_entry{ 0x6411, 1 } });
+
+constexpr std::array<canopen::pdo, 1> tpdos{ canopen::pdo(
+  canopen::tpdo_id(1, device_id),
+  tpdo1_mapping,
+  canopen::pdo_trigger::sync) };
+constexpr std::array<canopen::pdo, 1> rpdos{
+  canopen::pdo(canopen::rpdo_id(1, device_id), rpdo1_mapping)
+};
+static_assert(tpdos[0].id() == 0x1A2);
+static_assert(rpdos[0].id() == 0x222);
+
+/// CANopen device and a client on a simulated bus
+struct network
+{
+  network()
+  {
+    digital_inputs = 0;
+    analog_input = 0;
+    digital_outputs = 0;
+    analog_output = 0;
+    configuration = {};
+    command = 0;
+    client.on_receive([this](can::message_t const& p_message) {
+      received.push_back(p_message);
+    });
+  }
+
+  /// Send an SDO request and return the response payload
+  std::array<hal::byte, 8> request(std::array<hal::byte, 8> const& p_payload)
+  {
+    send({ .id = canopen::sdo_request_base + device_id,
+           .payload = p_payload,
+           .length = 8 });
+    if (received.empty()) {
+      return {};
+    }
+    return received.back().payload;
+  }
+
+  void send(can::message_t const& p_message)
+  {
+    received.clear();
+    client.send(p_message);
+  }
+
+  std::array<sim::event, 4> events{};
+  sim::kernel kernel{ events };
+  sim::can_bus bus{ kernel };
+  sim::can device_can{ bus };
+  sim::can client{ bus };
+  canopen::node device{ device_can, device_id, dictionary, rpdos, tpdos };
+  std::vector<can::message_t> received;
+};
+
+std::array<hal::byte, 8> abort_response(std::uint16_t p_index,
+                                        hal::byte p_subindex,
+                                        canopen::sdo_abort p_reason)
+{
+  auto const code = static_cast<std::uint32_t>(p_reason);
+  return { 0x80,
+           static_cast<hal::byte>(p_index),
+           static_cast<hal::byte>(p_index >> 8),
+           p_subindex,
+           static_cast<hal::byte>(code),
+           static_cast<hal::byte>(code >> 8),
+           static_cast<hal::byte>(code >> 16),
+           static_cast<hal::byte>(code >> 24) };
+}
+}  // namespace
+
+void canopen_test()
+{
+  using namespace boost::ut;
+  using response = std::array<hal::byte, 8>;
+
+  "canopen::node expedited upload"_test = []() {
+    // Setup
+    network net;
+
+    // Exercise
+    auto const result = net.request({ 0x40, 0x00, 0x10, 0x00 });
+
+    // Verify
+    expect(response{ 0x43, 0x00, 0x10, 0x00, 0x92, 0x01, 0x02, 0x00 } ==
+           result);
+    expect(that % net.received.back().id ==
+           canopen::sdo_response_base + device_id);
+  };
+
+  "canopen::node expedited download"_test = []() {
+    // Setup
+    network net;
+
+    // Exercise
+    auto const result =
+      net.request({ 0x2B, 0x11, 0x64, 0x01, 0x34, 0x12, 0x00, 0x00 });
+
+    // Verify
+    expect(response{ 0x60, 0x11, 0x64, 0x01 } == result);
+    expect(that % 0x1234 == analog_output);
+  };
+
+  "canopen::node segmented upload"_test = []() {
+    // Setup
+    network net;
+
+    // Exercise
+    auto const initiate = net.request({ 0x40, 0x08, 0x10, 0x00 });
+    auto const first = net.request({ 0x60 });
+    auto const second = net.request({ 0x70 });
+
+    // Verify
+    expect(response{ 0x41, 0x08, 0x10, 0x00, 12, 0, 0, 0 } == initiate);
+    expect(response{ 0x00, 'l', 'i', 'b', 'h', 'a', 'l', ' ' } == first);
+    // 5 bytes and the last segment
+    expect(response{ 0x15, 'n', 'o', 'd', 'e', 0, 0, 0 } == second);
+  };
+
+  "canopen::node segmented download"_test = []() {
+    // Setup
+    network net;
+
+    // Exercise
+    auto const initiate = net.request({ 0x21, 0x00, 0x20, 0x00, 10, 0, 0, 0 });
+    auto const first = net.request({ 0x00, 1, 2, 3, 4, 5, 6, 7 });
+    // 3 bytes and the last segment
+    auto const second = net.request({ 0x19, 8, 9, 10 });
+
+    // Verify
+    expect(response{ 0x60, 0x00, 0x20, 0x00 } == initiate);
+    expect(response{ 0x20 } == first);
+    expect(response{ 0x30 } == second);
+    expect(std::array<hal::byte, 10>{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 } ==
+           configuration);
+  };
+
+  "canopen::node aborts invalid requests"_test = []() {
+    using canopen::sdo_abort;
+
+    // Setup
+    network net;
+
+    // Exercise
+    // Verify
+    expect(abort_response(0x5000, 0, sdo_abort::no_object) ==
+           net.request({ 0x40, 0x00, 0x50, 0x00 }));
+    expect(abort_response(0x6000, 2, sdo_abort::no_subindex) ==
+           net.request({ 0x40, 0x00, 0x60, 0x02 }));
+    expect(abort_response(0x1000, 0, sdo_abort::read_only_object) ==
+           net.request({ 0x23, 0x00, 0x10, 0x00, 1, 2, 3, 4 }));
+    expect(abort_response(0x2001, 0, sdo_abort::write_only_object) ==
+           net.request({ 0x40, 0x01, 0x20, 0x00 }));
+    expect(abort_response(0x6200, 1, sdo_abort::length_mismatch) ==
+           net.request({ 0x2B, 0x00, 0x62, 0x01, 1, 2 }));
+    expect(abort_response(0x2000, 0, sdo_abort::length_mismatch) ==
+           net.request({ 0x21, 0x00, 0x20, 0x00, 11, 0, 0, 0 }));
+    expect(abort_response(0, 0, sdo_abort::invalid_command) ==
+           net.request({ 0x00, 1, 2, 3, 4, 5, 6, 7 }));
+    expect(abort_response(0x1000, 0, sdo_abort::invalid_command) ==
+           net.request({ 0xA0, 0x00, 0x10, 0x00 }));
+    expect(that % 0 == digital_outputs);
+  };
+
+  "canopen::node aborts segmented transfer errors"_test = []() {
+    using canopen::sdo_abort;
+
+    // Setup
+    network net;
+    net.request({ 0x21, 0x00, 0x20, 0x00, 10, 0, 0, 0 });
+
+    // Exercise
+    auto const toggle = net.request({ 0x10, 1, 2, 3, 4, 5, 6, 7 });
+    net.request({ 0x21, 0x00, 0x20, 0x00, 10, 0, 0, 0 });
+    net.request({ 0x00, 1, 2, 3, 4, 5, 6, 7 });
+    // Last segment with 7 more bytes overruns the 10 byte object
+    auto const too_long = net.request({ 0x11, 8, 9, 10, 11, 12, 13, 14 });
+    net.request({ 0x21, 0x00, 0x20, 0x00, 10, 0, 0, 0 });
+    // Last segment after 2 bytes
+    auto const too_short = net.request({ 0x0B, 1, 2 });
+
+    // Verify
+    expect(abort_response(0x2000, 0, sdo_abort::toggle_bit_not_alternated) ==
+           toggle);
+    expect(abort_response(0x2000, 0, sdo_abort::length_too_high) == too_long);
+    expect(abort_response(0x2000, 0, sdo_abort::length_too_low) == too_short);
+  };
+
+  "canopen::node receives PDOs"_test = []() {
+    // Setup
+    network net;
+
+    // Exercise
+    net.send({ .id = canopen::rpdo_id(1, device_id),
+               .payload = { 0x5A, 0xFE, 0xFF },
+               .length = 3 });
+    auto const outputs = digital_outputs;
+    // Too short for the mapping, ignored
+    net.send({ .id = canopen::rpdo_id(1, device_id),
+               .payload = { 0x01, 0x02 },
+               .length = 2 });
+
+    // Verify
+    expect(that % 0x5A == outputs);
+    expect(that % 0x5A == digital_outputs);
+    expect(that % -2 == analog_output);
+  };
+
+  "canopen::node sends PDOs"_test = []() {
+    // Setup
+    network net;
+    digital_inputs = 0x81;
+    analog_input = 0x0302;
+
+    // Exercise
+    net.send({ .id = canopen::sync_id });
+    auto const on_sync = net.received;
+    net.received.clear();
+    net.device.send_tpdo(0);
+
+    // Verify
+    expect(that % 1 == on_sync.size());
+    expect(that % 0x1A2 == on_sync[0].id);
+    expect(that % 3 == on_sync[0].length);
+    expect(response{ 0x81, 0x02, 0x03 } == on_sync[0].payload);
+    expect(that % 1 == net.received.size());
+    expect(response{ 0x81, 0x02, 0x03 } == net.received[0].payload);
+    expect(throws<hal::argument_out_of_domain>(
+      [&net]() { net.device.send_tpdo(1); }));
+  };
+
+  "canopen::node rejects invalid node ids"_test = []() {
+    // Setup
+    std::array<sim::event, 2> events{};
+    sim::kernel kernel{ events };
+    sim::can_bus bus{ kernel };
+    sim::can port{ bus };
+
+    // Exercise
+    // Verify
+    expect(throws<hal::argument_out_of_domain>(
+      [&port]() { canopen::node(port, 0, dictionary, rpdos, tpdos); }));
+    expect(throws<hal::argument_out_of_domain>(
+      [&port]() { canopen::node(port, 128, dictionary, rpdos, tpdos); }));
+  };
+};
+}  // namespace hal
@@ -0,0 +1,139 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/crc.hpp>
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include <libhal/units.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+constexpr std::array<hal::byte, 9> check_input{ '1', '2', '3', '4', '5',
+                                                '6', '7', '8', '9' };
+
+// Check values from the catalogue of parametrised CRC algorithms
+static_assert(crc8_smbus<>::compute(check_input) == 0xF4);
+static_assert(crc8_sae_j1850<>::compute(check_input) == 0x4B);
+static_assert(crc16_modbus<>::compute(check_input) == 0x4B37);
+static_assert(crc16_ccitt_false<>::compute(check_input) == 0x29B1);
+static_assert(crc16_xmodem<>::compute(check_input) == 0x31C3);
+static_assert(crc32<>::compute(check_input) == 0xCBF43926);
+static_assert(crc32c<>::compute(check_input) == 0xE3069283);
+static_assert(crc32_mpeg2<>::compute(check_input) == 0x0376E6E7);
+static_assert(crc64_xz<>::compute(check_input) == 0x995DC9BBDF1939FA);
+
+// Carry-less multiply constants match the published CRC-32 constants
+constexpr auto crc32_constants = detail::make_crc32_fold_constants(0x04C11DB7);
+static_assert(crc32_constants.r1 == 0x154442BD4);
+static_assert(crc32_constants.r2 == 0x1C6E41596);
+static_assert(crc32_constants.r3 == 0x1751997D0);
+static_assert(crc32_constants.r4 == 0x0CCAA009E);
+static_assert(crc32_constants.r5 == 0x163CD6124);
+static_assert(crc32_constants.polynomial == 0x1DB710641);
+static_assert(crc32_constants.mu == 0x1F7011641);
+
+template<class crc_t, class reference_t>
+bool matches_reference(std::span<hal::byte const> p_data)
+{
+  // Every length and split point exercises the sliced loop, the byte tail
+  // and the incremental interface.
+  for (std::size_t length = 0; length <= p_data.size(); length++) {
+    auto const data = p_data.first(length);
+    auto const expected = reference_t::compute(data);
+    if (crc_t::compute(data) != expected) {
+      return false;
+    }
+    crc_t split;
+    split.update(data.first(length / 3)).update(data.subspan(length / 3));
+    if (split.value() != expected) {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+void crc_test()
+{
+  using namespace boost::ut;
+
+  "crc slicing matches byte at a time"_test = []() {
+    // Setup
+    std::array<hal::byte, 300> data{};
+    std::uint32_t state = 12345;
+    for (auto& value : data) {
+      state = state * 1103515245U + 12345U;
+      value = static_cast<hal::byte>(state >> 16);
+    }
+
+    // Exercise
+    // Verify
+    expect(matches_reference<crc8_smbus<8>, crc8_smbus<1>>(data));
+    expect(matches_reference<crc8_sae_j1850<4>, crc8_sae_j1850<1>>(data));
+    expect(matches_reference<crc16_modbus<8>, crc16_modbus<1>>(data));
+    expect(matches_reference<crc16_ccitt_false<2>, crc16_ccitt_false<1>>(data));
+    expect(matches_reference<crc32<8>, crc32<1>>(data));
+    expect(matches_reference<crc32<2>, crc32<1>>(data));
+    expect(matches_reference<crc32c<4>, crc32c<1>>(data));
+    expect(matches_reference<crc32_mpeg2<8>, crc32_mpeg2<1>>(data));
+    expect(matches_reference<crc32_mpeg2<2>, crc32_mpeg2<1>>(data));
+    expect(matches_reference<crc64_xz<8>, crc64_xz<1>>(data));
+    expect(matches_reference<crc64_xz<4>, crc64_xz<1>>(data));
+  };
+
+  "crc32 of long buffers matches known values"_test = []() {
+    // Setup
+    // Independent of the code under test, so lengths of 64 bytes and more
+    // also check the carry-less multiply folding when built with -mpclmul.
+    // Values computed with zlib (CRC-32) and a bitwise CRC-32C.
+    std::array<hal::byte, 1024> data{};
+    for (std::size_t i = 0; i < data.size(); i++) {
+      data[i] = static_cast<hal::byte>(i * 7 + 3);
+    }
+    auto const first_64 = std::span(data).first(64);
+    auto const first_100 = std::span(data).first(100);
+
+    // Exercise
+    crc32<> split;
+    split.update(first_100).update(std::span(data).subspan(100));
+
+    // Verify
+    expect(that % 0xCBD9ECF0U == crc32<>::compute(first_64));
+    expect(that % 0xAA316B09U == crc32<>::compute(first_100));
+    expect(that % 0x5D3DE8EDU == crc32<>::compute(data));
+    expect(that % 0x5D3DE8EDU == split.value());
+    expect(that % 0x2884F9F3U == crc32c<>::compute(first_64));
+    expect(that % 0x594B1B65U == crc32c<>::compute(first_100));
+    expect(that % 0x29022EF0U == crc32c<>::compute(data));
+  };
+
+  "crc::reset()"_test = []() {
+    // Setup
+    crc32<> test;
+    test.update(check_input);
+
+    // Exercise
+    test.reset();
+    test.update(check_input);
+
+    // Verify
+    expect(that % 0xCBF43926 == test.value());
+  };
+};
+}  // namespace hal
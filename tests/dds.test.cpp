@@ -0,0 +1,234 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/dds.hpp>
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#include <libhal/error.hpp>
+
+#include "helpers.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class test_dac : public hal::dac
+{
+public:
+  float m_passed_value = -1.0f;
+  int m_write_count = 0;
+
+private:
+  void driver_write(float p_value) override
+  {
+    m_passed_value = p_value;
+    m_write_count++;
+  }
+};
+
+class test_timer : public hal::timer
+{
+public:
+  bool m_is_running{ false };
+  hal::callback<void(void)> m_callback = []() {};
+  hal::time_duration m_delay{};
+
+private:
+  bool driver_is_running() override
+  {
+    return m_is_running;
+  }
+
+  void driver_cancel() override
+  {
+    m_is_running = false;
+  }
+
+  void driver_schedule(hal::callback<void(void)> p_callback,
+                       hal::time_duration p_delay) override
+  {
+    m_is_running = true;
+    m_callback = p_callback;
+    m_delay = p_delay;
+  }
+};
+
+class test_steady_clock : public hal::steady_clock
+{
+public:
+  hertz m_frequency = 1.0_MHz;
+  std::uint64_t m_uptime = 0;
+
+private:
+  hertz driver_frequency() override
+  {
+    return m_frequency;
+  }
+
+  std::uint64_t driver_uptime() override
+  {
+    return m_uptime;
+  }
+};
+}  // namespace
+
+void dds_test()
+{
+  using namespace boost::ut;
+
+  "dds::render() sine"_test = []() {
+    // Setup
+    hal::dds<8> test;
+    std::array<float, 5> output{};
+    test.frequency(1.0_kHz, 4.0_kHz);
+
+    // Exercise
+    test.render(output);
+
+    // Verify
+    expect(compare_floats({ .a = 0.5f, .b = output[0] }));
+    expect(compare_floats({ .a = 1.0f, .b = output[1] }));
+    expect(compare_floats({ .a = 0.5f, .b = output[2] }));
+    expect(compare_floats({ .a = 0.0f, .b = output[3] }));
+    expect(compare_floats({ .a = 0.5f, .b = output[4] }));
+  };
+
+  "dds::render() triangle interpolates & amplitude"_test = []() {
+    // Setup
+    hal::dds<2> test(hal::dds<2>::waveform::triangle);
+    std::array<float, 3> output{};
+    test.frequency(1.0_kHz, 8.0_kHz);
+    test.amplitude(0.5f);
+
+    // Exercise
+    test.render(output);
+
+    // Verify
+    expect(compare_floats({ .a = 0.5f, .b = output[0] }));
+    expect(compare_floats({ .a = 0.625f, .b = output[1] }));
+    expect(compare_floats({ .a = 0.75f, .b = output[2] }));
+  };
+
+  "dds::render() unsigned PCM"_test = []() {
+    // Setup
+    hal::dds<8> test(hal::dds<8>::waveform::square);
+    std::array<std::uint16_t, 4> output{};
+    test.frequency(1.0_kHz, 4.0_kHz);
+    test.phase(0.125f);
+
+    // Exercise
+    test.render(std::span<std::uint16_t>(output));
+
+    // Verify
+    expect(that % 0xFFFF == output[0]);
+    expect(that % 0xFFFF == output[1]);
+    expect(that % 0x0000 == output[2]);
+    expect(that % 0x0000 == output[3]);
+  };
+
+  "dds arbitrary table & errors"_test = []() {
+    // Setup
+    std::array<float, 4> const table{ 0.0f, 1.0f, 0.0f, -1.0f };
+    std::array<float, 3> const bad_table{};
+    hal::dds<2> test(table);
+
+    // Exercise
+    test.frequency(1.0_kHz, 4.0_kHz);
+
+    // Verify
+    expect(compare_floats({ .a = 0.5f, .b = test.next() }));
+    expect(compare_floats({ .a = 1.0f, .b = test.next() }));
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { test.load(std::span<float const>(bad_table)); }));
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { test.frequency(3.0_kHz, 4.0_kHz); }));
+  };
+
+  "dds_dac_player"_test = []() {
+    // Setup
+    hal::dds<8> generator;
+    test_dac dac;
+    test_timer timer;
+    test_steady_clock clock;
+    generator.frequency(1.0_kHz, 4.0_kHz);
+    hal::dds_dac_player player(generator, dac, timer, clock);
+
+    // Exercise
+    player.start();
+    auto const first_delay = timer.m_delay;
+    // The second event runs 10us late, the next deadline stays at 500us
+    clock.m_uptime = 260;
+    timer.m_callback();
+
+    // Verify
+    expect(that % 2 == dac.m_write_count);
+    expect(compare_floats({ .a = 1.0f, .b = dac.m_passed_value }));
+    expect(std::chrono::microseconds(250) == first_delay);
+    expect(std::chrono::microseconds(240) == timer.m_delay);
+    expect(that % true == timer.m_is_running);
+
+    player.stop();
+    expect(that % false == timer.m_is_running);
+  };
+
+  "dds_dac_player does not drift on an uneven period"_test = []() {
+    // Setup
+    hal::dds<8> generator;
+    test_dac dac;
+    test_timer timer;
+    test_steady_clock clock;
+    // 333.33 clock ticks per sample
+    generator.frequency(1.0_kHz, 3.0_kHz);
+    hal::dds_dac_player player(generator, dac, timer, clock);
+
+    // Exercise
+    player.start();
+    std::array<hal::time_duration, 3> delays{};
+    for (auto& delay : delays) {
+      delay = timer.m_delay;
+      clock.m_uptime += static_cast<std::uint64_t>(delay.count() / 1000);
+      timer.m_callback();
+    }
+
+    // Verify
+    expect(std::chrono::microseconds(333) == delays[0]);
+    expect(std::chrono::microseconds(334) == delays[1]);
+    expect(std::chrono::microseconds(333) == delays[2]);
+    expect(that % 1000 == clock.m_uptime);
+  };
+
+  "dds_dac_player::start() errors"_test = []() {
+    // Setup
+    hal::dds<8> generator;
+    test_dac dac;
+    test_timer timer;
+    test_steady_clock clock;
+    clock.m_frequency = 1.0_kHz;
+    hal::dds_dac_player player(generator, dac, timer, clock);
+
+    // Exercise
+    // Verify
+    expect(throws<hal::argument_out_of_domain>([&]() { player.start(); }));
+    generator.frequency(100.0f, 4.0_kHz);
+    expect(throws<hal::argument_out_of_domain>([&]() { player.start(); }));
+    generator.frequency(100.0f, 500.0f);
+    player.start();
+    expect(that % true == timer.m_is_running);
+  };
+};
+}  // namespace hal
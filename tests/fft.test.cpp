@@ -0,0 +1,124 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/fft.hpp>
+
+#include <array>
+#include <cmath>
+#include <complex>
+#include <numbers>
+
+#include <libhal/error.hpp>
+
+#include "helpers.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+constexpr std::size_t block_size = 64;
+constexpr float two_pi = 2.0f * std::numbers::pi_v<float>;
+
+class test_adc : public hal::adc
+{
+public:
+  std::size_t m_index = 0;
+
+private:
+  float driver_read() override
+  {
+    // 0.5V offset sine in bin 4
+    auto const phase = two_pi * 4.0f * static_cast<float>(m_index++) /
+                       static_cast<float>(block_size);
+    return 0.5f + 0.25f * std::sin(phase);
+  }
+};
+}  // namespace
+
+void fft_test()
+{
+  using namespace boost::ut;
+
+  "real_fft matches direct DFT"_test = []() {
+    // Setup
+    hal::real_fft<16> test;
+    std::array<float, 16> input{};
+    std::array<std::complex<float>, 9> output{};
+    for (std::size_t i = 0; i < input.size(); i++) {
+      input[i] = std::sin(0.7f * static_cast<float>(i * i)) + 0.1f;
+    }
+
+    // Exercise
+    test.transform(input, output);
+
+    // Verify
+    for (std::size_t k = 0; k < output.size(); k++) {
+      std::complex<float> expected{};
+      for (std::size_t n = 0; n < input.size(); n++) {
+        auto const angle = -two_pi * static_cast<float>(k * n) / 16.0f;
+        expected += input[n] * std::polar(1.0f, angle);
+      }
+      expect(compare_floats(
+        { .a = expected.real(), .b = output[k].real(), .margin = 0.001f }));
+      expect(compare_floats(
+        { .a = expected.imag(), .b = output[k].imag(), .margin = 0.001f }));
+    }
+  };
+
+  "spectrum_analyzer::add_block() & push()"_test = []() {
+    // Setup
+    hal::spectrum_analyzer<block_size> test(6.4_kHz,
+                                            hal::fft_window::rectangular);
+    std::array<float, block_size> block{};
+    for (std::size_t i = 0; i < block.size(); i++) {
+      block[i] = std::cos(two_pi * 8.0f * static_cast<float>(i) /
+                          static_cast<float>(block_size));
+    }
+
+    // Exercise
+    test.add_block(block);
+    test.push(std::span(block).first(10));
+    test.push(std::span(block).subspan(10));
+    auto const power = test.power();
+
+    // Verify
+    expect(that % 2 == test.blocks());
+    expect(that % 8 == test.peak_bin());
+    expect(that % 800.0f == test.bin_frequency(8));
+    expect(compare_floats({ .a = 0.25f, .b = power[8] }));
+    expect(compare_floats({ .a = 0.0f, .b = power[7] }));
+    expect(compare_floats({ .a = 0.0f, .b = power[0] }));
+
+    test.reset();
+    expect(that % 0 == test.blocks());
+    expect(that % 0.0f == test.power()[8]);
+  };
+
+  "spectrum_analyzer::acquire()"_test = []() {
+    // Setup
+    test_adc adc;
+    hal::spectrum_analyzer<block_size> test(1.0_kHz);
+
+    // Exercise
+    test.acquire(adc);
+    test.acquire(adc);
+    auto const power = test.power();
+
+    // Verify
+    expect(that % 128 == adc.m_index);
+    expect(compare_floats({ .a = 0.25f, .b = power[0] }));
+    expect(compare_floats({ .a = 0.015625f, .b = power[4] }));
+  };
+};
+}  // namespace hal
@@ -0,0 +1,53 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/fixed_adc.hpp>
+
+#include <libhal/error.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+constexpr fixed_proportion expected_value = 0.5f;
+
+class test_fixed_adc : public hal::fixed_adc
+{
+public:
+  ~test_fixed_adc() override = default;
+
+private:
+  fixed_proportion driver_read() override
+  {
+    // Half scale of a 12-bit converter
+    return fixed_proportion::from_ratio(2048, 4096);
+  }
+};
+}  // namespace
+
+void fixed_adc_test()
+{
+  using namespace boost::ut;
+  "fixed_adc interface test"_test = []() {
+    // Setup
+    test_fixed_adc test;
+
+    // Exercise
+    auto sample = test.read();
+
+    // Verify
+    expect(that % expected_value.raw() == sample.raw());
+  };
+}
+}  // namespace hal
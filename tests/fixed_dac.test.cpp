@@ -0,0 +1,60 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/fixed_dac.hpp>
+
+#include <libhal/error.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class test_fixed_dac : public hal::fixed_dac
+{
+public:
+  fixed_proportion m_passed_value{};
+  ~test_fixed_dac() override = default;
+
+private:
+  void driver_write(fixed_proportion p_value) override
+  {
+    m_passed_value = p_value;
+  }
+};
+}  // namespace
+
+void fixed_dac_test()
+{
+  using namespace boost::ut;
+
+  "fixed_dac interface test"_test = []() {
+    // Setup
+    test_fixed_dac test;
+    constexpr fixed_proportion expected_value = 0.25f;
+
+    // Exercise
+    test.write(expected_value);
+    auto const passed = test.m_passed_value;
+    test.write(1.5f);
+    auto const clamped_high = test.m_passed_value;
+    test.write(-0.5f);
+    auto const clamped_low = test.m_passed_value;
+
+    // Verify
+    expect(that % expected_value.raw() == passed.raw());
+    expect(that % 65536 == clamped_high.raw());
+    expect(that % 0 == clamped_low.raw());
+  };
+};
+}  // namespace hal
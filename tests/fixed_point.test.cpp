@@ -0,0 +1,88 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/fixed_point.hpp>
+
+#include <cstdint>
+
+#include <libhal/error.hpp>
+#include <libhal/units.hpp>
+
+#include "helpers.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+// Literals convert at compile time, rounding to the nearest value
+static_assert(fixed_volts(3.3_V).raw() == 216269);
+static_assert(fixed_ampere(-1.5_mA).raw() == -98);
+static_assert(fixed_hertz(100.0_kHz).raw() == 1'600'000);
+static_assert(sizeof(fixed_volts) == sizeof(std::int32_t));
+
+// Arithmetic is usable in constant expressions
+static_assert((fixed_volts(1.5_V) * fixed_volts(2.0_V)).raw() ==
+              fixed_volts(3.0_V).raw());
+static_assert((fixed_volts(1.0_V) / fixed_volts(4.0_V)).raw() ==
+              fixed_volts(0.25_V).raw());
+static_assert((fixed_volts(-1.5_V) * 3).raw() == fixed_volts(-4.5_V).raw());
+static_assert((fixed_volts(1.5_V) * std::int64_t{ 4 }).raw() ==
+              fixed_volts(6.0_V).raw());
+static_assert(fixed_volts(1.0_V) > fixed_volts(0.5_V));
+}  // namespace
+
+void fixed_point_test()
+{
+  using namespace boost::ut;
+
+  "fixed_point arithmetic"_test = []() {
+    // Setup
+    fixed_volts const reference = 3.3_V;
+    auto const reading = fixed_proportion::from_ratio(1024, 4096);
+
+    // Exercise
+    auto const measured = reference * reading;
+    auto const sum = measured + fixed_volts(0.175_V);
+    auto const halved = sum / 2;
+    auto const negated = -halved;
+
+    // Verify
+    expect(compare_floats({ .a = 0.825f, .b = measured.to_float() }));
+    expect(compare_floats({ .a = 1.0f, .b = sum.to_float() }));
+    expect(compare_floats({ .a = 0.5f, .b = halved.to_float() }));
+    expect(that % -1 == negated.to_integer());
+    expect(that % (negated < halved));
+  };
+
+  "fixed_point conversions"_test = []() {
+    // Setup
+    auto const value = fixed_point<16>::from_integer(3);
+
+    // Exercise
+    fixed_point<8> const narrowed(value);
+    fixed_point<24> const widened(narrowed);
+    auto const from_float = fixed_point<16>::from_float(-2.75f);
+    auto const saturated = fixed_point<16>::from_float(1e9f);
+    auto const saturated_low = fixed_hertz::from_float(-5.0f);
+
+    // Verify
+    expect(that % 768 == narrowed.raw());
+    expect(that % 3 == widened.to_integer());
+    expect(that % -180224 == from_float.raw());
+    expect(that % -3 == from_float.to_integer());
+    expect(that % fixed_point<16>::highest().raw() == saturated.raw());
+    expect(that % 0 == saturated_low.raw());
+  };
+};
+}  // namespace hal
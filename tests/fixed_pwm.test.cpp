@@ -0,0 +1,74 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/fixed_pwm.hpp>
+
+#include <libhal/error.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+constexpr fixed_hertz expected_frequency = 1.0_kHz;
+constexpr fixed_proportion expected_duty_cycle = 0.5f;
+
+class test_fixed_pwm : public hal::fixed_pwm
+{
+public:
+  fixed_hertz m_frequency{};
+  fixed_proportion m_duty_cycle{};
+  ~test_fixed_pwm() override = default;
+
+private:
+  void driver_frequency(fixed_hertz p_frequency) override
+  {
+    m_frequency = p_frequency;
+  }
+  void driver_duty_cycle(fixed_proportion p_duty_cycle) override
+  {
+    m_duty_cycle = p_duty_cycle;
+  }
+};
+}  // namespace
+
+void fixed_pwm_test()
+{
+  using namespace boost::ut;
+  "fixed_pwm interface test"_test = []() {
+    // Setup
+    test_fixed_pwm test;
+
+    // Exercise
+    test.frequency(expected_frequency);
+    test.duty_cycle(expected_duty_cycle);
+
+    // Verify
+    expect(that % expected_frequency.raw() == test.m_frequency.raw());
+    expect(that % expected_duty_cycle.raw() == test.m_duty_cycle.raw());
+  };
+
+  "fixed_pwm clamps to interface limits"_test = []() {
+    // Setup
+    test_fixed_pwm test;
+
+    // Exercise
+    test.frequency(0.25_Hz);
+    test.duty_cycle(2.0f);
+
+    // Verify
+    expect(that % 1 == test.m_frequency.to_integer());
+    expect(that % 65536 == test.m_duty_cycle.raw());
+  };
+};
+}  // namespace hal
@@ -0,0 +1,109 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/goertzel.hpp>
+
+#include <array>
+#include <cmath>
+#include <numbers>
+
+#include <libhal/error.hpp>
+
+#include "helpers.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+constexpr hal::hertz sample_rate = 8.0_kHz;
+constexpr std::size_t block_size = 205;
+constexpr std::array<hal::hertz, 7> dtmf{
+  697.0_Hz, 770.0_Hz, 852.0_Hz, 941.0_Hz, 1209.0_Hz, 1336.0_Hz, 1477.0_Hz,
+};
+
+float dtmf_one(std::size_t p_index)
+{
+  constexpr float two_pi = 2.0f * std::numbers::pi_v<float>;
+  auto const time = static_cast<float>(p_index) / sample_rate;
+  return 0.5f * std::sin(two_pi * 697.0f * time) +
+         0.5f * std::sin(two_pi * 1209.0f * time);
+}
+
+class test_adc : public hal::adc
+{
+public:
+  std::size_t m_index = 0;
+
+private:
+  float driver_read() override
+  {
+    return dtmf_one(m_index++);
+  }
+};
+}  // namespace
+
+void goertzel_test()
+{
+  using namespace boost::ut;
+
+  "goertzel_bank::process() detects DTMF '1'"_test = []() {
+    // Setup
+    hal::goertzel_bank<dtmf.size()> test(sample_rate, dtmf, block_size);
+    std::array<float, block_size + 10> samples{};
+    for (std::size_t i = 0; i < samples.size(); i++) {
+      samples[i] = dtmf_one(i);
+    }
+
+    // Exercise
+    test.process(std::span(samples).first(100));
+    expect(that % 0 == test.blocks());
+    test.process(std::span(samples).subspan(100));
+
+    // Verify
+    auto const power = test.power();
+    expect(that % 1 == test.blocks());
+    expect(compare_floats({ .a = 0.0625f, .b = power[0], .margin = 0.005f }));
+    expect(compare_floats({ .a = 0.0625f, .b = power[4], .margin = 0.005f }));
+    for (auto const index : { 1, 2, 3, 5, 6 }) {
+      expect(that % 0.005f > power[index]);
+    }
+  };
+
+  "goertzel_bank::acquire()"_test = []() {
+    // Setup
+    test_adc adc;
+    hal::goertzel_bank<dtmf.size()> test(sample_rate, dtmf, block_size);
+
+    // Exercise
+    test.acquire(adc);
+
+    // Verify
+    expect(that % block_size == adc.m_index);
+    expect(that % 1 == test.blocks());
+    expect(that % 0.05f < test.power()[4]);
+
+    test.reset();
+    expect(that % 0 == test.blocks());
+    expect(that % 0.0f == test.power()[4]);
+  };
+
+  "goertzel_bank invalid arguments"_test = []() {
+    std::array<hal::hertz, 1> const too_high{ 5.0_kHz };
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { hal::goertzel_bank<1> test(sample_rate, too_high, 100); }));
+    expect(throws<hal::argument_out_of_domain>(
+      []() { hal::goertzel_bank<dtmf.size()> test(sample_rate, dtmf, 0); }));
+  };
+};
+}  // namespace hal
@@ -0,0 +1,323 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/j1939.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <libhal/error.hpp>
+#include <libhal/simulation.hpp>
+#include <libhal/timer_wheel.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+// EEC1 from an engine at address 0 with priority 3
+static_assert(j1939::make_id({ .priority = 3,
+                               .pgn = 0xF004,
+                               .destination = j1939::global_address,
+                               .source = 0x00 }) == 0x0CF00400);
+// Request from address 0xF9 to address 0x21
+static_assert(j1939::make_id({ .priority = 6,
+                               .pgn = j1939::pgn_request,
+                               .destination = 0x21,
+                               .source = 0xF9 }) == 0x18EA21F9);
+static_assert(j1939::parse_id(0x18EA21F9).pgn == j1939::pgn_request);
+static_assert(j1939::parse_id(0x18EA21F9).destination == 0x21);
+static_assert(j1939::parse_id(0x0CF00400).pgn == 0xF004);
+static_assert(j1939::parse_id(0x0CF00400).destination ==
+              j1939::global_address);
+static_assert(j1939::parse_id(0x0CF00400).priority == 3);
+
+constexpr std::uint64_t arbitrary_address_capable = std::uint64_t{ 1 } << 63;
+
+/// J1939 node on a simulated bus with its own timer wheel
+struct node
+{
+  node(sim::can_bus& p_bus, std::uint64_t p_name, hal::byte p_address)
+    : can(p_bus)
+    , stack(can, wheel, p_name, p_address, sessions, subscriptions)
+  {
+    can.configure({ .baud_rate = 250.0_kHz });
+  }
+
+  sim::can can;
+  std::array<timer_wheel_entry*, 64> slots{};
+  timer_wheel wheel{ slots, std::chrono::milliseconds(1) };
+  std::array<j1939::receive_session, 2> sessions{};
+  std::array<j1939::subscription, 4> subscriptions{};
+  j1939::stack stack;
+};
+
+struct network
+{
+  /// Advance the bus and both wheels by p_milliseconds
+  void run(int p_milliseconds)
+  {
+    for (int i = 0; i < p_milliseconds; i++) {
+      kernel.run_for(std::chrono::milliseconds(1));
+      first.wheel.tick();
+      second.wheel.tick();
+    }
+  }
+
+  std::array<sim::event, 4> events{};
+  sim::kernel kernel{ events };
+  sim::can_bus bus{ kernel };
+  node first{ bus, arbitrary_address_capable | 0x1000, 0x80 };
+  node second{ bus, arbitrary_address_capable | 0x2000, 0x90 };
+};
+
+/// Records every message delivered for one PGN
+struct receiver
+{
+  void subscribe(j1939::stack& p_stack, std::uint32_t p_pgn)
+  {
+    p_stack.subscribe(p_pgn, [this](j1939::message const& p_message) {
+      source = p_message.source;
+      destination = p_message.destination;
+      data.assign(p_message.data.begin(), p_message.data.end());
+      count++;
+    });
+  }
+
+  hal::byte source = 0;
+  hal::byte destination = 0;
+  std::vector<hal::byte> data;
+  int count = 0;
+};
+
+std::vector<hal::byte> make_data(std::size_t p_size)
+{
+  std::vector<hal::byte> result(p_size);
+  for (std::size_t i = 0; i < p_size; i++) {
+    result[i] = static_cast<hal::byte>(i * 7 + 3);
+  }
+  return result;
+}
+}  // namespace
+
+void j1939_test()
+{
+  using namespace boost::ut;
+
+  "j1939 address claim"_test = []() {
+    // Setup
+    network net;
+
+    // Exercise
+    net.first.stack.start();
+    net.second.stack.start();
+    auto const claiming = net.first.stack.state();
+    net.run(260);
+
+    // Verify
+    expect(claiming == j1939::address_state::claiming);
+    expect(net.first.stack.state() == j1939::address_state::claimed);
+    expect(net.second.stack.state() == j1939::address_state::claimed);
+    expect(that % 0x80 == net.first.stack.address());
+    expect(that % 0x90 == net.second.stack.address());
+  };
+
+  "j1939 address claim contention"_test = []() {
+    // Setup
+    std::array<sim::event, 4> events{};
+    sim::kernel kernel{ events };
+    sim::can_bus bus{ kernel };
+    // NAMEs with the arbitrary address capable bit set have lower priority
+    node low_name(bus, 0x1000, 0x80);
+    node high_name(bus, arbitrary_address_capable | 0x2000, 0x80);
+    node fixed(bus, 0x3000, 0x80);
+
+    // Exercise
+    low_name.stack.start();
+    high_name.stack.start();
+    fixed.stack.start();
+    for (int i = 0; i < 300; i++) {
+      low_name.wheel.tick();
+      high_name.wheel.tick();
+      fixed.wheel.tick();
+    }
+
+    // Verify
+    expect(low_name.stack.state() == j1939::address_state::claimed);
+    expect(that % 0x80 == low_name.stack.address());
+    expect(high_name.stack.state() == j1939::address_state::claimed);
+    expect(that % 0x81 == high_name.stack.address());
+    expect(fixed.stack.state() == j1939::address_state::cannot_claim);
+    expect(that % j1939::null_address == fixed.stack.address());
+  };
+
+  "j1939 single frame dispatch"_test = []() {
+    // Setup
+    network net;
+    receiver engine_speed;
+    engine_speed.subscribe(net.second.stack, 0xF004);
+    net.first.stack.start();
+    net.second.stack.start();
+    net.run(260);
+    std::array<hal::byte, 8> const data{ 1, 2, 3, 4, 5, 6, 7, 8 };
+
+    // Exercise
+    auto const sent = net.first.stack.send(0xF004, data);
+    auto const count_before_tick = engine_speed.count;
+    net.run(1);
+
+    // Verify
+    expect(sent);
+    expect(that % 0 == count_before_tick);
+    expect(that % 1 == engine_speed.count);
+    expect(that % 0x80 == engine_speed.source);
+    expect(std::ranges::equal(data, engine_speed.data));
+  };
+
+  "j1939 broadcast announce message"_test = []() {
+    // Setup
+    network net;
+    receiver diagnostics;
+    diagnostics.subscribe(net.second.stack, 0xFECA);
+    net.first.stack.start();
+    net.second.stack.start();
+    net.run(260);
+    auto const data = make_data(20);
+
+    // Exercise
+    net.first.stack.send(0xFECA, data);
+    net.run(149);
+    auto const count_before_last_packet = diagnostics.count;
+    net.run(2);
+
+    // Verify
+    expect(that % 0 == count_before_last_packet);
+    expect(that % 1 == diagnostics.count);
+    expect(that % j1939::global_address == diagnostics.destination);
+    expect(std::ranges::equal(data, diagnostics.data));
+    expect(net.first.stack.transfer() == j1939::transfer_state::complete);
+  };
+
+  "j1939 connection mode transfer"_test = []() {
+    // Setup
+    network net;
+    receiver configuration;
+    configuration.subscribe(net.second.stack, 0xD000);
+    net.first.stack.start();
+    net.second.stack.start();
+    net.run(260);
+    auto const data = make_data(j1939::max_transport_size);
+    auto const frames_before = net.bus.frame_count();
+
+    // Exercise
+    net.first.stack.send(0xD000, data, 0x90);
+    auto const state = net.first.stack.transfer();
+    // Two ticks for each of the 16 windows, one for the RTS and one for the
+    // acknowledgement
+    net.run(34);
+
+    // Verify
+    expect(state == j1939::transfer_state::in_progress);
+    expect(net.first.stack.transfer() == j1939::transfer_state::complete);
+    expect(that % 1 == configuration.count);
+    expect(that % 0x90 == configuration.destination);
+    expect(std::ranges::equal(data, configuration.data));
+    // RTS, a CTS per window of receive_queue_size packets, 255 data packets
+    // and the acknowledgement
+    expect(that % 273 == net.bus.frame_count() - frames_before);
+  };
+
+  "j1939 connection mode timeout"_test = []() {
+    // Setup
+    network net;
+    net.first.stack.start();
+    net.run(260);
+    auto const data = make_data(30);
+
+    // Exercise
+    net.first.stack.send(0xD000, data, 0x42);
+    net.run(1249);
+    auto const state_before_timeout = net.first.stack.transfer();
+    net.run(2);
+
+    // Verify
+    expect(state_before_timeout == j1939::transfer_state::in_progress);
+    expect(net.first.stack.transfer() == j1939::transfer_state::aborted);
+  };
+
+  "j1939 rejects sessions beyond storage"_test = []() {
+    // Setup
+    network net;
+    std::array<j1939::receive_session, 0> no_sessions{};
+    std::array<j1939::subscription, 1> subscriptions{};
+    sim::can can(net.bus);
+    j1939::stack third(
+      can, net.first.wheel, 0x4000, 0xA0, no_sessions, subscriptions);
+    net.first.stack.start();
+    third.start();
+    net.run(260);
+    auto const data = make_data(30);
+
+    // Exercise
+    net.first.stack.send(0xD000, data, 0xA0);
+    net.run(2);
+
+    // Verify
+    expect(net.first.stack.transfer() == j1939::transfer_state::aborted);
+  };
+
+  "j1939 drops frames beyond the receive queue"_test = []() {
+    // Setup
+    network net;
+    receiver engine_speed;
+    engine_speed.subscribe(net.second.stack, 0xF004);
+    net.first.stack.start();
+    net.second.stack.start();
+    net.run(260);
+    std::array<hal::byte, 8> const data{};
+    constexpr auto extra = 4;
+
+    // Exercise
+    for (std::size_t i = 0; i < j1939::stack::receive_queue_size + extra;
+         i++) {
+      net.first.stack.send(0xF004, data);
+    }
+    net.run(1);
+
+    // Verify
+    expect(that % j1939::stack::receive_queue_size == engine_speed.count);
+    expect(that % extra == net.second.stack.dropped_frames());
+  };
+
+  "j1939 send errors"_test = []() {
+    // Setup
+    network net;
+    auto const data = make_data(j1939::max_transport_size + 1);
+
+    // Exercise
+    // Verify
+    expect(throws<hal::operation_not_permitted>(
+      [&]() { net.first.stack.send(0xF004, std::span(data).first(8)); }));
+    net.first.stack.start();
+    net.run(260);
+    expect(throws<hal::message_size>(
+      [&]() { net.first.stack.send(0xD000, data, 0x90); }));
+    expect(net.first.stack.send(0xD000, std::span(data).first(100)));
+    expect(not net.first.stack.send(0xD000, std::span(data).first(100)));
+  };
+};
+}  // namespace hal
@@ -0,0 +1,138 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/latency_histogram.hpp>
+
+#include <array>
+
+#include <libhal/error.hpp>
+#include <libhal/simulation.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+void latency_histogram_test()
+{
+  using namespace boost::ut;
+
+  "latency_histogram bucket boundaries"_test = []() {
+    using histogram = latency_histogram<4>;
+    expect(that % 15 == histogram::bucket_index(15));
+    expect(that % 16 == histogram::bucket_index(16));
+    expect(that % 31 == histogram::bucket_index(31));
+    expect(that % 32 == histogram::bucket_index(32));
+    expect(that % 32 == histogram::bucket_index(33));
+    expect(that % 33 == histogram::highest_equivalent(32));
+    expect(that % (histogram::bucket_count - 1) ==
+           histogram::bucket_index(0xFFFF'FFFF));
+    expect(that % 0xFFFF'FFFF ==
+           histogram::highest_equivalent(histogram::bucket_count - 1));
+  };
+
+  "latency_histogram::percentile()"_test = []() {
+    // Setup
+    latency_histogram<4> test;
+
+    // Exercise
+    for (std::uint32_t i = 1; i <= 1000; i++) {
+      test.record(100);
+    }
+    for (std::uint32_t i = 1; i <= 10; i++) {
+      test.record(5000);
+    }
+    test.record(std::uint64_t{ 1 } << 40);
+
+    // Verify
+    expect(that % 1011 == test.count());
+    expect(that % 100 == test.min());
+    expect(that % 0xFFFF'FFFF == test.max());
+    expect(that % 103 == test.percentile(50.0f));
+    expect(that % 103 == test.percentile(98.9f));
+    // 5000 is counted in the bucket [4992, 5119]
+    expect(that % 5119 == test.percentile(99.9f));
+    expect(that % 0xFFFF'FFFF == test.percentile(100.0f));
+    expect(throws<hal::argument_out_of_domain>(
+      [&test]() { (void)test.percentile(100.1f); }));
+  };
+
+  "latency_histogram::merge() & serialize() & deserialize()"_test = []() {
+    // Setup
+    latency_histogram<4> first;
+    latency_histogram<4> second;
+    latency_histogram<4> restored;
+    first.record(10);
+    first.record(20);
+    second.record(3);
+    second.record(70000);
+    std::array<hal::byte, latency_histogram<4>::max_serialized_size> buffer{};
+
+    // Exercise
+    first.merge(second);
+    auto const encoded = first.serialize(buffer);
+    restored.deserialize(encoded);
+
+    // Verify
+    expect(that % 4 == first.count());
+    expect(that % 3 == first.min());
+    expect(that % 70000 == first.max());
+    expect(that % encoded.size() < 20);
+    expect(that % 4 == restored.count());
+    expect(that % 3 == restored.min());
+    expect(that % 70000 == restored.max());
+    expect(that % first.percentile(75.0f) == restored.percentile(75.0f));
+    expect(throws<hal::io_error>(
+      [&restored, &encoded]() { restored.deserialize(encoded.first(5)); }));
+    expect(throws<hal::argument_out_of_domain>([&first, &buffer]() {
+      (void)first.serialize(std::span(buffer).first(4));
+    }));
+
+    first.reset();
+    expect(that % 0 == first.count());
+    expect(that % 0 == first.min());
+    expect(that % 0 == first.percentile(99.0f));
+  };
+
+  "timed_i2c & timed_spi"_test = []() {
+    // Setup
+    std::array<sim::event, 4> events{};
+    sim::kernel kernel(events);
+    sim::steady_clock clock(kernel, 1.0_MHz);
+    sim::i2c i2c(kernel);
+    i2c.attach(0x20, [](std::span<hal::byte const>, std::span<hal::byte>) {});
+    sim::spi spi(kernel,
+                 [](std::span<hal::byte const>, std::span<hal::byte>, byte) {});
+    latency_histogram<4> i2c_latency;
+    latency_histogram<4> spi_latency;
+    timed_i2c timed_i2c(i2c, clock, i2c_latency);
+    timed_spi timed_spi(spi, clock, spi_latency);
+    std::array<hal::byte, 1> const out{ 0x00 };
+
+    // Exercise
+    timed_i2c.transaction(0x20, out, {}, []() {});
+    expect(throws<hal::no_such_device>(
+      [&]() { timed_i2c.transaction(0x21, out, {}, []() {}); }));
+    timed_spi.transfer(out, {}, 0xFF);
+
+    // Verify
+    expect(that % 2 == i2c_latency.count());
+    // 2 bytes at 9 clocks and 100kHz
+    expect(that % 180 == i2c_latency.max());
+    // Address phase only
+    expect(that % 90 == i2c_latency.min());
+    expect(that % 1 == spi_latency.count());
+    // 8 bits at the default 100kHz
+    expect(that % 80 == spi_latency.max());
+  };
+};
+}  // namespace hal
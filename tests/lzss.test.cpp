@@ -0,0 +1,270 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/lzss.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <libhal/simulation.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+std::vector<hal::byte> make_telemetry(std::size_t p_lines)
+{
+  std::vector<hal::byte> result;
+  std::uint32_t state = 1;
+  for (std::size_t line = 0; line < p_lines; line++) {
+    state = state * 1103515245U + 12345U;
+    std::array<char, 64> text{};
+    auto const length = std::snprintf(text.data(),
+                                      text.size(),
+                                      "t=%zu temp=%d.%d rh=%d.%d\n",
+                                      line,
+                                      20 + static_cast<int>(state >> 28),
+                                      static_cast<int>((state >> 20) % 10),
+                                      40 + static_cast<int>((state >> 24) % 4),
+                                      static_cast<int>((state >> 16) % 10));
+    result.insert(result.end(), text.begin(), text.begin() + length);
+  }
+  return result;
+}
+
+/// Serial port that accepts at most one byte per write
+class byte_link : public hal::serial
+{
+public:
+  std::vector<hal::byte> m_sent;
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    auto const accepted = p_data.first(p_data.empty() ? 0 : 1);
+    m_sent.insert(m_sent.end(), accepted.begin(), accepted.end());
+    return { .data = accepted };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    return { .data = p_data.first(0), .available = 0, .capacity = 0 };
+  }
+
+  void driver_flush() override
+  {
+  }
+};
+
+std::vector<hal::byte> make_noise(std::size_t p_length)
+{
+  std::vector<hal::byte> result(p_length);
+  std::uint32_t state = 7;
+  for (auto& value : result) {
+    state = state * 1103515245U + 12345U;
+    value = static_cast<hal::byte>(state >> 16);
+  }
+  return result;
+}
+
+/// Compress with a small output buffer, flushing at the end
+template<class encoder_t>
+std::vector<hal::byte> compress(encoder_t& p_encoder,
+                                std::span<hal::byte const> p_data,
+                                std::size_t p_chunk)
+{
+  std::vector<hal::byte> result;
+  std::vector<hal::byte> output(p_chunk);
+  while (not p_data.empty()) {
+    auto const step = p_encoder.encode(p_data, output);
+    p_data = p_data.subspan(step.consumed);
+    result.insert(result.end(), step.output.begin(), step.output.end());
+  }
+  while (true) {
+    auto const flushed = p_encoder.flush(output);
+    if (flushed.empty()) {
+      break;
+    }
+    result.insert(result.end(), flushed.begin(), flushed.end());
+  }
+  return result;
+}
+
+/// Decompress everything with a small output buffer
+template<class decoder_t>
+std::vector<hal::byte> decompress(decoder_t& p_decoder,
+                                  std::span<hal::byte const> p_data,
+                                  std::size_t p_chunk)
+{
+  std::vector<hal::byte> result;
+  std::vector<hal::byte> output(p_chunk);
+  while (true) {
+    auto const step = p_decoder.decode(p_data, output);
+    p_data = p_data.subspan(step.consumed);
+    result.insert(result.end(), step.output.begin(), step.output.end());
+    if (step.output.empty() && p_data.empty()) {
+      return result;
+    }
+  }
+}
+
+template<std::size_t window_bits, std::size_t lookahead_bits>
+bool round_trips(std::span<hal::byte const> p_data, std::size_t p_chunk)
+{
+  lzss_encoder<window_bits, lookahead_bits> encoder;
+  lzss_decoder<window_bits, lookahead_bits> decoder;
+  auto const compressed = compress(encoder, p_data, p_chunk);
+  auto const decompressed = decompress(decoder, compressed, p_chunk);
+  return std::ranges::equal(p_data, decompressed);
+}
+}  // namespace
+
+void lzss_test()
+{
+  using namespace boost::ut;
+
+  "lzss round trip"_test = []() {
+    // Setup
+    auto const telemetry = make_telemetry(200);
+    auto const noise = make_noise(1000);
+    std::vector<hal::byte> const zeros(700);
+
+    // Exercise
+    // Verify
+    for (std::size_t chunk : { 1, 3, 64 }) {
+      expect(round_trips<8, 4>(telemetry, chunk));
+      expect(round_trips<8, 4>(noise, chunk));
+      expect(round_trips<8, 4>(zeros, chunk));
+      expect(round_trips<4, 3>(telemetry, chunk));
+      expect(round_trips<4, 3>(zeros, chunk));
+      expect(round_trips<11, 8>(telemetry, chunk));
+      expect(round_trips<11, 8>(noise, chunk));
+      expect(round_trips<15, 8>(telemetry, chunk));
+      expect(round_trips<15, 8>(noise, chunk));
+      expect(round_trips<15, 8>(zeros, chunk));
+      expect(round_trips<12, 5>(telemetry, chunk));
+      expect(round_trips<10, 8>(noise, chunk));
+    }
+  };
+
+  "lzss flushes each message with a full output buffer"_test = []() {
+    // Setup
+    lzss_encoder<15, 8> encoder;
+    lzss_decoder<15, 8> decoder;
+    auto const telemetry = make_telemetry(20);
+    std::vector<hal::byte> compressed;
+
+    // Exercise
+    // Flushing every few bytes pads after almost every back reference
+    for (std::size_t i = 0; i < telemetry.size(); i += 5) {
+      auto const length = std::min<std::size_t>(5, telemetry.size() - i);
+      auto const part = compress(
+        encoder, std::span(telemetry).subspan(i, length), 1);
+      compressed.insert(compressed.end(), part.begin(), part.end());
+    }
+    auto const decompressed = decompress(decoder, compressed, 1);
+
+    // Verify
+    expect(std::ranges::equal(telemetry, decompressed));
+  };
+
+  "lzss compresses telemetry"_test = []() {
+    // Setup
+    lzss_encoder<8, 4> encoder;
+    auto const telemetry = make_telemetry(100);
+
+    // Exercise
+    auto const compressed = compress(encoder, telemetry, 64);
+
+    // Verify
+    expect(that % compressed.size() < telemetry.size() / 2);
+  };
+
+  "lzss flush delivers each message"_test = []() {
+    // Setup
+    lzss_encoder<8, 4> encoder;
+    lzss_decoder<8, 4> decoder;
+    auto const telemetry = make_telemetry(20);
+    auto remaining = std::span<hal::byte const>(telemetry);
+    std::size_t total_compressed = 0;
+
+    // Exercise
+    // Verify
+    while (not remaining.empty()) {
+      auto const line_end = std::ranges::find(remaining, '\n');
+      auto const line = remaining.first(line_end - remaining.begin() + 1);
+      remaining = remaining.subspan(line.size());
+      auto const compressed = compress(encoder, line, 64);
+      total_compressed += compressed.size();
+      expect(std::ranges::equal(line, decompress(decoder, compressed, 64)));
+    }
+    expect(total_compressed < telemetry.size());
+  };
+
+  "lzss_serial compresses over a link"_test = []() {
+    // Setup
+    std::array<sim::event, 4> events{};
+    sim::kernel kernel{ events };
+    std::array<hal::byte, 512> near_rx{};
+    std::array<hal::byte, 512> far_rx{};
+    sim::serial near_port{ kernel, near_rx };
+    sim::serial far_port{ kernel, far_rx };
+    near_port.connect(far_port);
+    lzss_serial<> near(near_port);
+    lzss_serial<> far(far_port);
+    std::string_view const message = "status=ok status=ok status=ok\n";
+    auto const bytes = std::span(
+      reinterpret_cast<hal::byte const*>(message.data()), message.size());
+    std::array<hal::byte, 64> buffer{};
+
+    // Exercise
+    auto const start = kernel.now();
+    near.write(bytes);
+    auto const elapsed = kernel.now() - start;
+    auto const first = far.read(buffer).data;
+    auto const first_matches = std::ranges::equal(bytes, first);
+    near.write(bytes);
+    auto const second = far.read(buffer).data;
+
+    // Verify
+    expect(first_matches);
+    expect(std::ranges::equal(bytes, second));
+    expect(elapsed < near_port.byte_time() * bytes.size());
+  };
+
+  "lzss_serial writes every compressed byte to the link"_test = []() {
+    // Setup
+    byte_link link;
+    lzss_serial<> near(link);
+    lzss_decoder<> decoder;
+    auto const telemetry = make_telemetry(10);
+
+    // Exercise
+    near.write(telemetry);
+    auto const decompressed = decompress(decoder, link.m_sent, 64);
+
+    // Verify
+    expect(std::ranges::equal(telemetry, decompressed));
+  };
+};
+}  // namespace hal
@@ -36,6 +36,36 @@ extern void current_sensor_test();
 extern void initializers_test();
 extern void stream_dac_test();
 extern void io_waiter_test();
+extern void polyphase_resampler_test();
+extern void dds_test();
+extern void wav_file_test();
+extern void fft_test();
+extern void goertzel_test();
+extern void simulation_test();
+extern void tracing_test();
+extern void bus_recording_test();
+extern void latency_histogram_test();
+extern void quantity_test();
+extern void fixed_point_test();
+extern void fixed_adc_test();
+extern void fixed_dac_test();
+extern void fixed_pwm_test();
+extern void static_allocator_test();
+extern void board_test();
+extern void serial_tx_queue_test();
+extern void binary_logger_test();
+extern void modbus_test();
+extern void crc_test();
+extern void serial_mux_test();
+extern void lzss_test();
+extern void buffered_serial_writer_test();
+extern void serial_streambuf_test();
+extern void serial_reader_test();
+extern void timer_wheel_test();
+extern void j1939_test();
+extern void can_signal_test();
+extern void can_scheduler_test();
+extern void canopen_test();
 }  // namespace hal
 
 int main()
@@ -62,4 +92,34 @@ int main()
   hal::angular_velocity_sensor_test();
   hal::current_sensor_test();
   hal::stream_dac_test();
+  hal::polyphase_resampler_test();
+  hal::dds_test();
+  hal::wav_file_test();
+  hal::fft_test();
+  hal::goertzel_test();
+  hal::simulation_test();
+  hal::tracing_test();
+  hal::bus_recording_test();
+  hal::latency_histogram_test();
+  hal::quantity_test();
+  hal::fixed_point_test();
+  hal::fixed_adc_test();
+  hal::fixed_dac_test();
+  hal::fixed_pwm_test();
+  hal::static_allocator_test();
+  hal::board_test();
+  hal::serial_tx_queue_test();
+  hal::binary_logger_test();
+  hal::modbus_test();
+  hal::crc_test();
+  hal::serial_mux_test();
+  hal::lzss_test();
+  hal::buffered_serial_writer_test();
+  hal::serial_streambuf_test();
+  hal::serial_reader_test();
+  hal::timer_wheel_test();
+  hal::j1939_test();
+  hal::can_signal_test();
+  hal::can_scheduler_test();
+  hal::canopen_test();
 }
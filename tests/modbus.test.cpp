@@ -0,0 +1,282 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/modbus.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+
+#include <libhal/error.hpp>
+#include <libhal/serial.hpp>
+#include <libhal/simulation.hpp>
+
+#include "helpers.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+// Reference frame from the Modbus over serial line specification
+static_assert(modbus::make_read_request(
+                1, modbus::function_code::read_holding_registers, 0, 10) ==
+              std::array<hal::byte, 8>{
+                0x01, 0x03, 0x00, 0x00, 0x00, 0x0A, 0xC5, 0xCD });
+
+constexpr hal::serial::settings bus_settings{ .baud_rate = 19200.0f };
+
+/// Serial port decorator that accepts at most 3 bytes per write
+class chunked_serial : public hal::serial
+{
+public:
+  explicit chunked_serial(hal::serial& p_serial)
+    : m_serial(&p_serial)
+  {
+  }
+
+  static constexpr std::size_t chunk = 3;
+  std::size_t m_writes = 0;
+
+private:
+  void driver_configure(settings const& p_settings) override
+  {
+    m_serial->configure(p_settings);
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    m_writes++;
+    return m_serial->write(p_data.first(std::min(p_data.size(), chunk)));
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    return m_serial->read(p_data);
+  }
+
+  void driver_flush() override
+  {
+    m_serial->flush();
+  }
+
+  hal::serial* m_serial;
+};
+
+/// Master and slave connected over a simulated RS-485 link
+struct test_bus
+{
+  test_bus()
+  {
+    master_port.configure(bus_settings);
+    slave_port.configure(bus_settings);
+    master_port.connect(slave_port);
+    slave_port.connect(master_port);
+  }
+
+  /// Timeout that runs the slave while the master waits
+  auto timeout()
+  {
+    auto const limit = kernel.now() + std::chrono::milliseconds(50);
+    return [this, limit]() {
+      slave.poll();
+      kernel.run_for(std::chrono::microseconds(100));
+      if (kernel.now() > limit) {
+        hal::safe_throw(hal::timed_out(nullptr));
+      }
+    };
+  }
+
+  std::array<sim::event, 4> events{};
+  sim::kernel kernel{ events };
+  sim::steady_clock clock{ kernel, 1.0_MHz };
+  std::array<hal::byte, 64> master_rx{};
+  std::array<hal::byte, 64> slave_rx{};
+  sim::serial master_port{ kernel, master_rx };
+  sim::serial slave_port{ kernel, slave_rx };
+  std::array<hal::byte, modbus::max_frame_size> master_buffer{};
+  std::array<hal::byte, modbus::max_frame_size> slave_buffer{};
+  std::array<std::uint16_t, 8> holding{ 10, 11, 12, 13, 14, 15, 16, 17 };
+  std::array<std::uint16_t, 2> const input{ 0xBEEF, 0xCAFE };
+  modbus::master master{ master_port, clock, 19200.0f, master_buffer };
+  modbus::slave slave{ slave_port,   clock,   19200.0f, slave_buffer,
+                       0x11,         holding, input };
+};
+}  // namespace
+
+void modbus_test()
+{
+  using namespace boost::ut;
+
+  "modbus::frame_gap()"_test = []() {
+    expect(that % 0.00175f == modbus::frame_gap(115200.0f));
+    // 3.5 characters of 11 bits at 9600 baud
+    expect(compare_floats({ .a = 0.0040104f,
+                           .b = modbus::frame_gap(9600.0f),
+                           .margin = 0.0000001f }));
+  };
+
+  "modbus::master reads and writes slave registers"_test = []() {
+    // Setup
+    test_bus bus;
+    std::array<std::uint16_t, 3> holding{};
+    std::array<std::uint16_t, 2> input{};
+    std::array<std::uint16_t, 2> const values{ 0x1234, 0x5678 };
+    std::uint16_t written_address = 0;
+    std::uint16_t written_count = 0;
+    bus.slave.on_write([&](std::uint16_t p_address, std::uint16_t p_count) {
+      written_address = p_address;
+      written_count = p_count;
+    });
+
+    // Exercise
+    bus.master.read_holding_registers(0x11, 2, holding, bus.timeout());
+    bus.master.read_input_registers(0x11, 0, input, bus.timeout());
+    bus.master.write_multiple_registers(0x11, 6, values, bus.timeout());
+    bus.master.write_single_register(0x11, 0, 0xAAAA, bus.timeout());
+
+    // Verify
+    expect(that % 12 == holding[0]);
+    expect(that % 14 == holding[2]);
+    expect(that % 0xBEEF == input[0]);
+    expect(that % 0xCAFE == input[1]);
+    expect(that % 0x1234 == bus.holding[6]);
+    expect(that % 0x5678 == bus.holding[7]);
+    expect(that % 0xAAAA == bus.holding[0]);
+    expect(that % 0 == written_address);
+    expect(that % 1 == written_count);
+    expect(that % 4 == bus.slave.requests());
+  };
+
+  "modbus::master reports exceptions and timeouts"_test = []() {
+    // Setup
+    test_bus bus;
+    std::array<std::uint16_t, 4> registers{};
+
+    // Exercise
+    // Verify
+    expect(throws<hal::argument_out_of_domain>([&]() {
+      bus.master.read_holding_registers(0x11, 6, registers, bus.timeout());
+    }));
+    expect(modbus::exception_code::illegal_data_address ==
+           bus.master.last_exception());
+    expect(throws<hal::timed_out>([&]() {
+      bus.master.read_holding_registers(0x12, 0, registers, bus.timeout());
+    }));
+    expect(throws<hal::argument_out_of_domain>([&]() {
+      bus.master.read_holding_registers(
+        0x11, 0, std::span(registers).first(0), bus.timeout());
+    }));
+  };
+
+  "modbus::poller cycles through requests"_test = []() {
+    // Setup
+    test_bus bus;
+    std::array<std::uint16_t, 2> first{};
+    std::array<std::uint16_t, 1> second{};
+    std::array<std::uint16_t, 1> missing{};
+    std::array<modbus::poll_request, 3> requests{
+      modbus::poll_request{ .slave = 0x11, .address = 0, .registers = first },
+      modbus::poll_request{
+        .slave = 0x11,
+        .function = modbus::function_code::read_input_registers,
+        .address = 1,
+        .registers = second },
+      modbus::poll_request{ .slave = 0x12, .registers = missing },
+    };
+    modbus::poller poller(bus.master, requests, std::chrono::milliseconds(10));
+
+    // Exercise
+    while (poller.cycles() < 2) {
+      poller.poll();
+      bus.slave.poll();
+      bus.kernel.run_for(std::chrono::microseconds(100));
+    }
+
+    // Verify
+    expect(that % 10 == first[0]);
+    expect(that % 11 == first[1]);
+    expect(that % 0xCAFE == second[0]);
+    expect(that % 2 == requests[0].responses);
+    expect(that % 2 == requests[1].responses);
+    expect(that % 0 == requests[2].responses);
+    expect(that % 2 == requests[2].timeouts);
+  };
+
+  "modbus::master writes whole frames over partial writes"_test = []() {
+    // Setup
+    test_bus bus;
+    chunked_serial port(bus.master_port);
+    std::array<hal::byte, modbus::max_frame_size> buffer{};
+    modbus::master master(port, bus.clock, 19200.0f, buffer);
+    std::array<std::uint16_t, 3> registers{};
+
+    // Exercise
+    master.read_holding_registers(0x11, 1, registers, bus.timeout());
+
+    // Verify
+    expect(that % 3 == port.m_writes);
+    expect(that % 11 == registers[0]);
+    expect(that % 13 == registers[2]);
+    expect(that % 0 == bus.slave.errors());
+  };
+
+  "modbus::master waits out a late response"_test = []() {
+    // Setup
+    test_bus bus;
+    std::array<std::uint16_t, 4> registers{};
+    std::array<std::uint16_t, 2> input{};
+    // Gives up while the response is still being received
+    auto const start = bus.kernel.now();
+    auto const impatient = [&bus, start]() {
+      bus.slave.poll();
+      bus.kernel.run_for(std::chrono::microseconds(100));
+      if (bus.kernel.now() - start > std::chrono::milliseconds(9)) {
+        hal::safe_throw(hal::timed_out(nullptr));
+      }
+    };
+    expect(throws<hal::timed_out>([&]() {
+      bus.master.read_holding_registers(0x11, 0, registers, impatient);
+    }));
+
+    // Exercise
+    auto const idle = bus.master.line_idle();
+    bus.master.read_input_registers(0x11, 0, input, bus.timeout());
+
+    // Verify
+    expect(not idle);
+    expect(that % 0xBEEF == input[0]);
+    expect(that % 0xCAFE == input[1]);
+  };
+
+  "modbus::slave discards corrupt frames"_test = []() {
+    // Setup
+    test_bus bus;
+    auto request = modbus::make_read_request(
+      0x11, modbus::function_code::read_holding_registers, 0, 1);
+    request[7] ^= 0xFF;
+
+    // Exercise
+    bus.master.send(request);
+    for (int i = 0; i < 40; i++) {
+      bus.slave.poll();
+      bus.kernel.run_for(std::chrono::microseconds(100));
+    }
+
+    // Verify
+    expect(that % 1 == bus.slave.errors());
+    expect(that % 0 == bus.slave.requests());
+  };
+};
+}  // namespace hal
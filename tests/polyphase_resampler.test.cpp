@@ -0,0 +1,139 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/polyphase_resampler.hpp>
+
+#include <array>
+#include <cmath>
+
+#include <libhal/error.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class test_stream_dac : public hal::stream_dac_u16
+{
+public:
+  hal::hertz m_sample_rate = 0.0f;
+  std::size_t m_write_count = 0;
+  std::size_t m_sample_count = 0;
+  std::uint16_t m_last_sample = 0;
+
+private:
+  void driver_write(samples const& p_samples) override
+  {
+    m_sample_rate = p_samples.sample_rate;
+    m_write_count++;
+    m_sample_count += p_samples.data.size();
+    m_last_sample = p_samples.data.back();
+  }
+};
+}  // namespace
+
+void polyphase_resampler_test()
+{
+  using namespace boost::ut;
+
+  "polyphase_resampler::configure()"_test = []() {
+    // Setup
+    hal::polyphase_resampler<160, 8> test;
+
+    // Exercise
+    test.configure(44.1_kHz, 48.0_kHz);
+
+    // Verify
+    expect(that % 160 == test.interpolation());
+    expect(that % 147 == test.decimation());
+    expect(throws<hal::argument_out_of_domain>(
+      [&test]() { test.configure(22.05_kHz, 48.0_kHz); }));
+    expect(throws<hal::argument_out_of_domain>(
+      [&test]() { test.configure(0.0_Hz, 48.0_kHz); }));
+    // Verify: failed configure did not change the ratio
+    expect(that % 160 == test.interpolation());
+  };
+
+  "polyphase_resampler::process() ratio & DC gain"_test = []() {
+    // Setup
+    hal::polyphase_resampler<160, 16> test;
+    test.configure(44.1_kHz, 48.0_kHz);
+    std::array<float, 441> input{};
+    std::array<float, 1024> output{};
+    input.fill(0.5f);
+
+    // Exercise
+    std::size_t produced = 0;
+    for (int i = 0; i < 10; i++) {
+      auto result = test.process(input, output);
+      expect(that % input.size() == result.consumed);
+      produced += result.produced;
+    }
+
+    // Verify
+    expect(that % 4800 == produced);
+    expect(that % 0.0001f > std::abs(output[479] - 0.5f));
+  };
+
+  "polyphase_resampler::process() output limited"_test = []() {
+    // Setup
+    hal::polyphase_resampler<2, 8> test;
+    test.configure(8.0_kHz, 16.0_kHz);
+    std::array<float, 8> input{};
+    std::array<float, 5> output{};
+
+    // Exercise
+    auto result = test.process(input, output);
+
+    // Verify
+    expect(that % output.size() == result.produced);
+    expect(that % 3 == result.consumed);
+  };
+
+  "resampling_stream_dac"_test = []() {
+    // Setup
+    test_stream_dac output;
+    hal::resampling_stream_dac<std::uint16_t, 160, 16, 128> test(output,
+                                                                 48.0_kHz);
+    std::array<std::uint16_t, 441> input{};
+    input.fill(0xC000);
+
+    // Exercise
+    test.write({ .sample_rate = 44.1_kHz, .data = input });
+    test.write({ .sample_rate = 44.1_kHz, .data = input });
+
+    // Verify
+    expect(that % 48.0_kHz == output.m_sample_rate);
+    expect(that % 960 == output.m_sample_count);
+    expect(that % 0xC000 == output.m_last_sample);
+    expect(throws<hal::argument_out_of_domain>([&]() {
+      test.write({ .sample_rate = 22.05_kHz, .data = input });
+    }));
+  };
+
+  "resampling_stream_dac passthrough"_test = []() {
+    // Setup
+    test_stream_dac output;
+    hal::resampling_stream_dac<std::uint16_t, 2, 8> test(output, 48.0_kHz);
+    std::array<std::uint16_t, 7> input{ 1, 2, 3, 4, 5, 6, 7 };
+
+    // Exercise
+    test.write({ .sample_rate = 48.0_kHz, .data = input });
+
+    // Verify
+    expect(that % 1 == output.m_write_count);
+    expect(that % input.size() == output.m_sample_count);
+    expect(that % 7 == output.m_last_sample);
+  };
+};
+}  // namespace hal
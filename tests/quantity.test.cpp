@@ -0,0 +1,135 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/quantity.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+#include <libhal/units.hpp>
+
+#include "helpers.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+namespace q = hal::quantities;
+
+// Quantities are the same size as their rep and trivially copyable
+static_assert(sizeof(q::hertz) == sizeof(float));
+static_assert(std::is_trivially_copyable_v<q::volts>);
+
+// Mismatched dimensions do not convert
+static_assert(not std::is_convertible_v<q::volts, q::hertz>);
+static_assert(not std::is_constructible_v<q::ampere, q::volts>);
+// Numbers never construct a quantity, a count must be named with from_count()
+static_assert(not std::is_convertible_v<float, q::hertz>);
+static_assert(not std::is_constructible_v<q::kilohertz, hertz>);
+
+// Integer reps only convert implicitly to finer scales
+using integer_hertz = quantity<dimensions::frequency, std::ratio<1>, int>;
+using integer_kilohertz = quantity<dimensions::frequency, std::kilo, int>;
+static_assert(std::is_convertible_v<integer_kilohertz, integer_hertz>);
+static_assert(not std::is_convertible_v<integer_hertz, integer_kilohertz>);
+
+// Conversions and derived dimensions are evaluated at compile time
+constexpr auto one_hertz = integer_hertz::from_count(1);
+constexpr auto one_kilohertz = integer_kilohertz::from_count(1);
+static_assert(integer_hertz(3 * one_kilohertz).count() == 3000);
+static_assert(quantity_cast<integer_kilohertz>(2500 * one_hertz).count() ==
+              2);
+static_assert(one_kilohertz + one_hertz == 1001 * one_hertz);
+static_assert(one_kilohertz > 999 * one_hertz);
+static_assert(integer_kilohertz::from_base_value(2500).count() == 2);
+
+// Scalars of any arithmetic type, with the common rep as std::chrono does
+constexpr auto one_and_half_volts = q::volts::from_count(1.5f);
+static_assert((one_and_half_volts * 2).count() == 3.0f);
+static_assert((2 * one_and_half_volts).count() == 3.0f);
+static_assert(7 * one_hertz / 2 == 3 * one_hertz);
+static_assert(std::is_same_v<decltype(2 * one_hertz * 1.5)::rep, double>);
+static_assert(std::is_same_v<decltype(q::volts() / q::ohms())::dimension,
+                             dimensions::current>);
+static_assert(std::is_same_v<decltype(q::volts() * q::ampere())::dimension,
+                             dimensions::power>);
+static_assert(
+  std::is_same_v<decltype(q::hertz() * q::seconds())::dimension,
+                 dimensions::dimensionless>);
+
+// Arithmetic on narrow integer reps stays in the rep
+using millivolts_16 = quantity<dimensions::voltage, std::milli, std::int16_t>;
+static_assert(std::is_same_v<decltype(millivolts_16() * std::int16_t{ 2 }),
+                             millivolts_16>);
+static_assert((millivolts_16::from_count(1200) * std::int16_t{ 2 }).count() ==
+              2400);
+}  // namespace
+
+void quantity_test()
+{
+  using namespace boost::ut;
+
+  "quantity interoperates with float literals"_test = []() {
+    // Setup
+    auto const rate = q::kilohertz::from_base_value(400.0_kHz);
+    q::millivolts const reference = q::volts::from_base_value(3.3_V);
+
+    // Exercise
+    auto const clock_rate = base_value(rate);
+    auto const millivolts = reference.count();
+
+    // Verify
+    expect(compare_floats({ .a = 400.0f, .b = rate.count() }));
+    expect(
+      compare_floats({ .a = 400'000.0f, .b = clock_rate, .margin = 0.1f }));
+    expect(compare_floats({ .a = 3300.0f, .b = millivolts }));
+  };
+
+  "quantity arithmetic across scales"_test = []() {
+    // Setup
+    auto const drop = q::millivolts::from_count(500.0f);
+    auto const load = q::kiloohms::from_count(2.0f);
+    auto const bias = q::milliampere::from_count(0.05f);
+
+    // Exercise
+    q::milliampere const current = drop / load + bias;
+    q::milliwatts const power = drop * current;
+    q::volts doubled = drop;
+    doubled *= 2;
+
+    // Verify
+    expect(compare_floats({ .a = 0.3f, .b = current.count() }));
+    expect(compare_floats({ .a = 0.15f, .b = power.count() }));
+    expect(compare_floats({ .a = 1.0f, .b = doubled.count() }));
+    expect(that % (q::millivolts::from_count(999.0f) < doubled));
+  };
+
+  "quantity converts to and from std::chrono"_test = []() {
+    using namespace std::chrono_literals;
+    // Setup
+    q::microseconds const period = 250ms;
+    auto const frequency =
+      1.0f / (period / q::scalar::from_count(1.0f)).count();
+
+    // Exercise
+    auto const duration = to_duration(period);
+
+    // Verify
+    expect(250'000'000ns == duration);
+    expect(that % 250'000.0f == period.count());
+    expect(compare_floats({ .a = 1.0f / 250'000.0f, .b = frequency }));
+  };
+};
+}  // namespace hal
@@ -0,0 +1,346 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/serial_mux.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <libhal/error.hpp>
+#include <libhal/simulation.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+/// Two multiplexers connected over a simulated serial link
+struct test_link
+{
+  test_link()
+  {
+    near_port.connect(far_port);
+  }
+
+  std::array<sim::event, 4> events{};
+  sim::kernel kernel{ events };
+  std::array<hal::byte, 2048> near_rx{};
+  std::array<hal::byte, 2048> far_rx{};
+  sim::serial near_port{ kernel, near_rx };
+  sim::serial far_port{ kernel, far_rx };
+  serial_mux near_mux{ near_port };
+  serial_mux far_mux{ far_port };
+};
+
+/// Link that accepts at most `budget` bytes until the budget is refilled
+class throttled_link : public hal::serial
+{
+public:
+  std::size_t budget = 0;
+  std::vector<hal::byte> written;
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    auto const accepted = p_data.first(std::min(p_data.size(), budget));
+    budget -= accepted.size();
+    written.insert(written.end(), accepted.begin(), accepted.end());
+    return { .data = accepted };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    return { .data = p_data.first(0), .available = 0, .capacity = 0 };
+  }
+
+  void driver_flush() override
+  {
+  }
+};
+
+struct channel_buffers
+{
+  std::array<hal::byte, 512> transmit{};
+  std::array<hal::byte, 512> receive{};
+};
+
+/// Encoded single byte frame with its CRC XORed with p_corruption
+std::array<hal::byte, 6> encode_frame(hal::byte p_channel,
+                                      hal::byte p_payload,
+                                      std::uint16_t p_corruption)
+{
+  std::array<hal::byte, 4> frame{ p_channel, p_payload };
+  auto const crc = static_cast<std::uint16_t>(
+    crc16_ccitt_false<1>::compute(std::span(frame).first(2)) ^ p_corruption);
+  frame[2] = static_cast<hal::byte>(crc >> 8);
+  frame[3] = static_cast<hal::byte>(crc);
+  std::array<hal::byte, 6> encoded{};
+  detail::cobs_encode(frame, encoded);
+  return encoded;
+}
+
+std::size_t read_all(hal::serial& p_serial, std::span<hal::byte> p_buffer)
+{
+  return p_serial.read(p_buffer).data.size();
+}
+}  // namespace
+
+void serial_mux_test()
+{
+  using namespace boost::ut;
+
+  "serial_mux cobs round trip"_test = []() {
+    // Setup
+    std::array<hal::byte, 300> input{};
+    for (std::size_t i = 0; i < input.size(); i++) {
+      input[i] = static_cast<hal::byte>(i % 7 == 0 ? 0 : i);
+    }
+    std::array<hal::byte, 310> encoded{};
+    std::array<hal::byte, 310> decoded{};
+
+    // Exercise
+    auto const encoded_length = detail::cobs_encode(input, encoded);
+    auto const decoded_length = detail::cobs_decode(
+      std::span(encoded).first(encoded_length), decoded);
+
+    // Verify
+    expect(std::ranges::count(std::span(encoded).first(encoded_length), 0) ==
+           0);
+    expect(decoded_length.has_value());
+    expect(that % input.size() == decoded_length.value_or(0));
+    expect(std::ranges::equal(input, std::span(decoded).first(input.size())));
+  };
+
+  "serial_mux delivers each channel separately"_test = []() {
+    // Setup
+    test_link link;
+    channel_buffers near_a, near_b, far_a, far_b;
+    serial_channel near_console(
+      link.near_mux, 0, 64, near_a.transmit, near_a.receive);
+    serial_channel near_telemetry(
+      link.near_mux, 1, 64, near_b.transmit, near_b.receive);
+    serial_channel far_console(
+      link.far_mux, 0, 64, far_a.transmit, far_a.receive);
+    serial_channel far_telemetry(
+      link.far_mux, 1, 64, far_b.transmit, far_b.receive);
+    std::array<hal::byte, 4> const console_data{ 'a', 0, 'b', 0 };
+    std::array<hal::byte, 3> const telemetry_data{ 0xFF, 0x00, 0x01 };
+    std::array<hal::byte, 16> buffer{};
+
+    // Exercise
+    near_console.write(console_data);
+    near_telemetry.write(telemetry_data);
+    link.near_mux.poll();
+    link.far_mux.poll();
+
+    // Verify
+    auto const console = far_console.read(buffer).data;
+    expect(std::ranges::equal(console_data, console));
+    auto const telemetry = far_telemetry.read(buffer).data;
+    expect(std::ranges::equal(telemetry_data, telemetry));
+    expect(that % 0 == near_console.pending());
+    expect(that % 0 == link.far_mux.errors());
+  };
+
+  "serial_mux shares bandwidth by weight"_test = []() {
+    // Setup
+    test_link link;
+    channel_buffers near_bulk, near_control, far_bulk, far_control;
+    serial_channel bulk(
+      link.near_mux, 7, 16, near_bulk.transmit, near_bulk.receive);
+    serial_channel control(
+      link.near_mux, 3, 64, near_control.transmit, near_control.receive);
+    serial_channel bulk_peer(
+      link.far_mux, 7, 16, far_bulk.transmit, far_bulk.receive);
+    serial_channel control_peer(
+      link.far_mux, 3, 64, far_control.transmit, far_control.receive);
+    std::array<hal::byte, 500> const bulk_data{};
+    std::array<hal::byte, 500> const control_data{};
+    std::array<hal::byte, 512> buffer{};
+
+    // Exercise
+    bulk.write(bulk_data);
+    control.write(control_data);
+    auto const sent = link.near_mux.transmit();
+    link.far_mux.receive();
+
+    // Verify
+    expect(that % 80 == sent);
+    expect(that % 16 == read_all(bulk_peer, buffer));
+    expect(that % 64 == read_all(control_peer, buffer));
+    expect(that % 484 == bulk.pending());
+    expect(that % 436 == control.pending());
+  };
+
+  "serial_mux bulk transfer does not delay control"_test = []() {
+    // Setup
+    test_link link;
+    channel_buffers near_bulk, near_control, far_bulk, far_control;
+    serial_channel bulk(
+      link.near_mux, 1, 32, near_bulk.transmit, near_bulk.receive);
+    serial_channel control(
+      link.near_mux, 2, 32, near_control.transmit, near_control.receive);
+    serial_channel bulk_peer(
+      link.far_mux, 1, 32, far_bulk.transmit, far_bulk.receive);
+    serial_channel control_peer(
+      link.far_mux, 2, 32, far_control.transmit, far_control.receive);
+    std::array<hal::byte, 512> const bulk_data{};
+    std::array<hal::byte, 8> const control_data{ 1, 2, 3, 4, 5, 6, 7, 8 };
+    std::array<hal::byte, 512> buffer{};
+
+    // Exercise
+    bulk.write(bulk_data);
+    link.near_mux.transmit();
+    control.write(control_data);
+    link.near_mux.transmit();
+    link.far_mux.receive();
+
+    // Verify
+    auto const received = control_peer.read(buffer).data;
+    expect(std::ranges::equal(control_data, received));
+    expect(that % 64 == read_all(bulk_peer, buffer));
+    expect(that % 448 == bulk.pending());
+  };
+
+  "serial_mux resumes frames the link only partly accepted"_test = []() {
+    // Setup
+    test_link link;
+    throttled_link throttled;
+    serial_mux mux(throttled);
+    channel_buffers near_a, near_b, far_a, far_b;
+    serial_channel first(mux, 0, 16, near_a.transmit, near_a.receive);
+    serial_channel second(mux, 1, 24, near_b.transmit, near_b.receive);
+    serial_channel first_peer(
+      link.far_mux, 0, 16, far_a.transmit, far_a.receive);
+    serial_channel second_peer(
+      link.far_mux, 1, 24, far_b.transmit, far_b.receive);
+    std::array<hal::byte, 100> first_data{};
+    std::array<hal::byte, 70> second_data{};
+    for (std::size_t i = 0; i < first_data.size(); i++) {
+      first_data[i] = static_cast<hal::byte>(i);
+    }
+    for (std::size_t i = 0; i < second_data.size(); i++) {
+      second_data[i] = static_cast<hal::byte>(0xFF - i);
+    }
+    std::array<hal::byte, 128> buffer{};
+
+    // Exercise
+    first.write(first_data);
+    second.write(second_data);
+    std::size_t sent = 0;
+    for (int i = 0; i < 100; i++) {
+      throttled.budget = 7;
+      sent += mux.transmit();
+    }
+    link.far_port.receive(throttled.written);
+    link.far_mux.receive();
+
+    // Verify
+    expect(that % 170 == sent);
+    expect(that % 0 == link.far_mux.errors());
+    auto const first_received = first_peer.read(buffer).data;
+    expect(std::ranges::equal(first_data, first_received));
+    auto const second_received = second_peer.read(buffer).data;
+    expect(std::ranges::equal(second_data, second_received));
+  };
+
+  "serial_mux write accepts what fits"_test = []() {
+    // Setup
+    test_link link;
+    std::array<hal::byte, 8> transmit{};
+    std::array<hal::byte, 8> receive{};
+    serial_channel channel(link.near_mux, 0, 8, transmit, receive);
+    std::array<hal::byte, 12> const data{};
+
+    // Exercise
+    auto const written = channel.write(data).data;
+
+    // Verify
+    expect(that % 8 == written.size());
+    expect(that % data.data() == written.data());
+  };
+
+  "serial_mux reports dropped bytes"_test = []() {
+    // Setup
+    test_link link;
+    channel_buffers near_buffers;
+    std::array<hal::byte, 4> far_transmit{};
+    std::array<hal::byte, 4> far_receive{};
+    serial_channel near(
+      link.near_mux, 0, 64, near_buffers.transmit, near_buffers.receive);
+    serial_channel far(link.far_mux, 0, 64, far_transmit, far_receive);
+    std::array<hal::byte, 6> const data{ 1, 2, 3, 4, 5, 6 };
+    std::array<hal::byte, 8> buffer{};
+
+    // Exercise
+    near.write(data);
+    link.near_mux.poll();
+    link.far_mux.poll();
+    auto const result = far.read(buffer);
+
+    // Verify
+    expect(that % 4 == result.data.size());
+    expect(that % 6 == result.available);
+    expect(that % 4 == result.capacity);
+  };
+
+  "serial_mux discards corrupt frames"_test = []() {
+    // Setup
+    test_link link;
+    channel_buffers far_buffers;
+    serial_channel far(
+      link.far_mux, 0, 64, far_buffers.transmit, far_buffers.receive);
+    auto const bad_crc = encode_frame(0, 0x41, 0x0001);
+    auto const unknown_channel = encode_frame(9, 0x41, 0);
+    std::array<hal::byte, 8> buffer{};
+
+    // Exercise
+    link.far_port.receive(bad_crc);
+    link.far_port.receive(unknown_channel);
+    link.far_mux.receive();
+
+    // Verify
+    expect(that % 2 == link.far_mux.errors());
+    expect(that % 0 == far.read(buffer).data.size());
+  };
+
+  "serial_mux rejects invalid channels"_test = []() {
+    // Setup
+    test_link link;
+    channel_buffers buffers;
+    serial_channel first(
+      link.near_mux, 5, 8, buffers.transmit, buffers.receive);
+
+    // Exercise
+    // Verify
+    expect(throws<hal::argument_out_of_domain>([&]() {
+      serial_channel duplicate(
+        link.near_mux, 5, 8, buffers.transmit, buffers.receive);
+    }));
+    expect(throws<hal::argument_out_of_domain>([&]() {
+      serial_channel no_weight(
+        link.near_mux, 6, 0, buffers.transmit, buffers.receive);
+    }));
+    serial_channel second(
+      link.near_mux, 6, 8, buffers.transmit, buffers.receive);
+    expect(that % 6 == second.id());
+  };
+};
+}  // namespace hal
@@ -0,0 +1,260 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/serial_reader.hpp>
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <string_view>
+
+#include <libhal/error.hpp>
+#include <libhal/io_waiter.hpp>
+#include <libhal/serial.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class fake_serial : public hal::serial
+{
+public:
+  void receive(std::string_view p_data)
+  {
+    for (auto const character : p_data) {
+      m_received[m_length++] = static_cast<hal::byte>(character);
+    }
+  }
+
+  std::size_t m_read_calls = 0;
+  /// Burst received, along with its idle event, just after a read that
+  /// found nothing
+  std::string_view m_late_burst;
+  serial_reader* m_reader = nullptr;
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    return write_t{ .data = p_data };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    m_read_calls++;
+    auto const count = std::min(p_data.size(), m_length);
+    std::copy_n(m_received.begin(), count, p_data.begin());
+    std::copy(m_received.begin() + count,
+              m_received.begin() + m_length,
+              m_received.begin());
+    m_length -= count;
+    if (count == 0 && not m_late_burst.empty()) {
+      receive(m_late_burst);
+      m_late_burst = {};
+      m_reader->notify_idle();
+    }
+    return read_t{ .data = p_data.first(count),
+                   .available = count,
+                   .capacity = m_received.size() };
+  }
+
+  void driver_flush() override
+  {
+    m_length = 0;
+  }
+
+  std::array<hal::byte, 64> m_received{};
+  std::size_t m_length = 0;
+};
+
+/// Interrupt that fires while waiting, empty data means an idle line event
+struct interrupt_event
+{
+  std::string_view data;
+};
+
+/// Waiter that runs the next scripted interrupt each time it waits
+class scripted_waiter : public hal::io_waiter
+{
+public:
+  scripted_waiter(fake_serial& p_serial,
+                  std::span<interrupt_event const> p_events)
+    : m_serial(&p_serial)
+    , m_events(p_events)
+  {
+  }
+
+  serial_reader* m_reader = nullptr;
+  std::size_t m_waits = 0;
+  std::size_t m_resumes = 0;
+
+private:
+  void driver_wait() override
+  {
+    if (m_waits < m_events.size()) {
+      auto const& event = m_events[m_waits];
+      if (event.data.empty()) {
+        m_reader->notify_idle();
+      } else {
+        m_serial->receive(event.data);
+        m_reader->notify_receive();
+      }
+    }
+    m_waits++;
+  }
+
+  void driver_resume() noexcept override
+  {
+    m_resumes++;
+  }
+
+  fake_serial* m_serial;
+  std::span<interrupt_event const> m_events;
+};
+
+auto wait_limit(std::size_t p_waits)
+{
+  return [p_waits, count = std::size_t{ 0 }]() mutable {
+    if (++count > p_waits) {
+      hal::safe_throw(hal::timed_out(nullptr));
+    }
+  };
+}
+
+bool equals(std::span<hal::byte const> p_bytes, std::string_view p_text)
+{
+  return std::ranges::equal(p_bytes, p_text, [](hal::byte p_a, char p_b) {
+    return p_a == static_cast<hal::byte>(p_b);
+  });
+}
+}  // namespace
+
+void serial_reader_test()
+{
+  using namespace boost::ut;
+
+  "serial_reader::read_at_least()"_test = []() {
+    // Setup
+    fake_serial serial;
+    std::array<interrupt_event, 3> const events{
+      { { "ab" }, { "cd" }, { "efg" } }
+    };
+    scripted_waiter waiter(serial, events);
+    serial_reader reader(serial, waiter);
+    waiter.m_reader = &reader;
+    std::array<hal::byte, 16> buffer{};
+
+    // Exercise
+    auto const result = reader.read_at_least(buffer, 5, wait_limit(10));
+
+    // Verify
+    expect(equals(result, "abcdefg"));
+    expect(that % 3 == waiter.m_waits);
+    expect(that % 3 == waiter.m_resumes);
+  };
+
+  "serial_reader::read_at_least() returns without waiting"_test = []() {
+    // Setup
+    fake_serial serial;
+    scripted_waiter waiter(serial, {});
+    serial_reader reader(serial, waiter);
+    waiter.m_reader = &reader;
+    serial.receive("hello");
+    std::array<hal::byte, 4> buffer{};
+
+    // Exercise
+    auto const result = reader.read_at_least(buffer, 2, wait_limit(0));
+
+    // Verify
+    expect(equals(result, "hell"));
+    expect(that % 0 == waiter.m_waits);
+  };
+
+  "serial_reader::read_at_least() times out"_test = []() {
+    // Setup
+    fake_serial serial;
+    std::array<interrupt_event, 1> const events{ { { "a" } } };
+    scripted_waiter waiter(serial, events);
+    serial_reader reader(serial, waiter);
+    waiter.m_reader = &reader;
+    std::array<hal::byte, 4> buffer{};
+
+    // Exercise
+    // Verify
+    expect(throws<hal::timed_out>(
+      [&]() { (void)reader.read_at_least(buffer, 2, wait_limit(3)); }));
+    expect(that % 4 == waiter.m_waits);
+    expect(that % 'a' == buffer[0]);
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { (void)reader.read_at_least(buffer, 5, wait_limit(3)); }));
+  };
+
+  "serial_reader::read_until_idle()"_test = []() {
+    // Setup
+    fake_serial serial;
+    std::array<interrupt_event, 5> const events{
+      { { "" }, { "mod" }, { "bus" }, { "" }, { "next" } }
+    };
+    scripted_waiter waiter(serial, events);
+    serial_reader reader(serial, waiter);
+    waiter.m_reader = &reader;
+    std::array<hal::byte, 16> buffer{};
+
+    // Exercise
+    auto const result = reader.read_until_idle(buffer, wait_limit(10));
+
+    // Verify
+    expect(equals(result, "modbus"));
+    expect(that % 4 == waiter.m_waits);
+  };
+
+  "serial_reader::read_until_idle() after a burst between read and check"_test =
+    []() {
+      // Setup
+      fake_serial serial;
+      scripted_waiter waiter(serial, {});
+      serial_reader reader(serial, waiter);
+      serial.m_reader = &reader;
+      serial.m_late_burst = "ping";
+      std::array<hal::byte, 16> buffer{};
+
+      // Exercise
+      auto const result = reader.read_until_idle(buffer, wait_limit(0));
+
+      // Verify
+      expect(equals(result, "ping"));
+      expect(that % 0 == waiter.m_waits);
+    };
+
+  "serial_reader::read_until_idle() stops when full"_test = []() {
+    // Setup
+    fake_serial serial;
+    std::array<interrupt_event, 2> const events{ { { "abc" }, { "def" } } };
+    scripted_waiter waiter(serial, events);
+    serial_reader reader(serial, waiter);
+    waiter.m_reader = &reader;
+    std::array<hal::byte, 4> buffer{};
+
+    // Exercise
+    auto const result = reader.read_until_idle(buffer, wait_limit(10));
+
+    // Verify
+    expect(equals(result, "abcd"));
+    expect(that % 2 == waiter.m_waits);
+  };
+};
+}  // namespace hal
@@ -0,0 +1,158 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/serial_streambuf.hpp>
+
+#include <algorithm>
+#include <array>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <libhal/serial.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class loopback_serial : public hal::serial
+{
+public:
+  std::string m_sent;
+  std::string m_received;
+  std::size_t m_write_calls = 0;
+  /// Bytes accepted by further writes, the rest of a write is refused
+  std::size_t m_budget = std::numeric_limits<std::size_t>::max();
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    auto const accepted = p_data.first(std::min(p_data.size(), m_budget));
+    m_sent.append(accepted.begin(), accepted.end());
+    m_budget -= accepted.size();
+    m_write_calls++;
+    return write_t{ .data = accepted };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    auto const count = std::min(p_data.size(), m_received.size());
+    std::copy_n(m_received.begin(), count, p_data.begin());
+    m_received.erase(0, count);
+    return read_t{ .data = p_data.first(count),
+                   .available = count,
+                   .capacity = p_data.size() };
+  }
+
+  void driver_flush() override
+  {
+  }
+};
+}  // namespace
+
+void serial_streambuf_test()
+{
+  using namespace boost::ut;
+
+  "serial_streambuf output"_test = []() {
+    // Setup
+    loopback_serial serial;
+    std::array<char, 8> output{};
+    std::array<char, 8> input{};
+    serial_streambuf buffer(serial, output, input);
+    std::ostream stream(&buffer);
+
+    // Exercise
+    stream << "temperature=" << 23 << '\n';
+    auto const calls_before_flush = serial.m_write_calls;
+    stream << std::flush;
+
+    // Verify
+    expect(that % 1 == calls_before_flush);
+    expect(that % 2 == serial.m_write_calls);
+    expect(that % std::string_view("temperature=23\n") == serial.m_sent);
+    expect(stream.good());
+  };
+
+  "serial_streambuf keeps output the port did not accept"_test = []() {
+    // Setup
+    loopback_serial serial;
+    serial.m_budget = 4;
+    std::array<char, 8> output{};
+    std::array<char, 8> input{};
+    serial_streambuf buffer(serial, output, input);
+    std::ostream stream(&buffer);
+
+    // Exercise
+    stream << "temperature=23\n" << std::flush;
+    auto const failed = stream.bad();
+    stream.clear();
+    serial.m_budget = std::numeric_limits<std::size_t>::max();
+    stream << std::flush;
+
+    // Verify
+    // Output stops at the character that found the buffer full, everything
+    // buffered before it is written once the port accepts bytes again
+    expect(failed);
+    expect(that % std::string_view("temperature") == serial.m_sent);
+    expect(stream.good());
+  };
+
+  "serial_streambuf input"_test = []() {
+    // Setup
+    loopback_serial serial;
+    serial.m_received = "42 1234567 word";
+    std::array<char, 2> output{};
+    std::array<char, 4> input{};
+    serial_streambuf buffer(serial, output, input);
+    std::istream stream(&buffer);
+    int small = 0;
+    int large = 0;
+    std::string word;
+    std::string missing;
+
+    // Exercise
+    stream >> small >> large >> word;
+    auto const eof = stream.eof();
+    stream.clear();
+    stream >> missing;
+
+    // Verify
+    expect(that % 42 == small);
+    expect(that % 1234567 == large);
+    expect(that % std::string_view("word") == word);
+    expect(eof);
+    expect(stream.fail());
+    expect(missing.empty());
+  };
+
+  "serial_streambuf requires buffers"_test = []() {
+    // Setup
+    loopback_serial serial;
+    std::array<char, 1> small{};
+
+    // Exercise
+    // Verify
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { serial_streambuf buffer(serial, small, small); }));
+  };
+};
+}  // namespace hal
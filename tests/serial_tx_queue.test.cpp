@@ -0,0 +1,194 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/serial_tx_queue.hpp>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string_view>
+
+#include <libhal/error.hpp>
+#include <libhal/serial.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class capture_serial : public hal::serial
+{
+public:
+  std::array<hal::byte, 256> m_sent{};
+  std::size_t m_length = 0;
+  std::size_t m_write_calls = 0;
+  /// Bytes accepted by further writes, the rest of a write is refused
+  std::size_t m_budget = std::numeric_limits<std::size_t>::max();
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    auto const accepted = p_data.first(std::min(p_data.size(), m_budget));
+    std::ranges::copy(accepted, m_sent.begin() + m_length);
+    m_length += accepted.size();
+    m_budget -= accepted.size();
+    m_write_calls++;
+    return write_t{ .data = accepted };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    return read_t{ .data = p_data.first(0), .available = 0, .capacity = 0 };
+  }
+
+  void driver_flush() override
+  {
+  }
+};
+}  // namespace
+
+void serial_tx_queue_test()
+{
+  using namespace boost::ut;
+
+  "serial_tx_queue::push() & drain()"_test = []() {
+    // Setup
+    std::array<std::uint32_t, 16> ring{};
+    std::array<hal::byte, 32> staging{};
+    serial_tx_queue queue(ring, staging);
+    capture_serial serial;
+    std::array<hal::byte, 5> const first{ 'h', 'e', 'l', 'l', 'o' };
+    std::array<hal::byte, 3> const second{ 'a', 'b', 'c' };
+
+    // Exercise
+    auto const queued_first = queue.push(first);
+    auto const queued_second = queue.push(second);
+    auto const used = queue.used();
+    auto const result = queue.drain(serial);
+
+    // Verify
+    expect(queued_first);
+    expect(queued_second);
+    // Header plus 2 words, then header plus 1 word
+    expect(that % 20 == used);
+    expect(that % 2 == result.frames);
+    expect(that % 8 == result.bytes);
+    expect(that % 1 == serial.m_write_calls);
+    expect(std::string_view("helloabc") ==
+           std::string_view(reinterpret_cast<char const*>(serial.m_sent.data()),
+                            serial.m_length));
+    expect(that % 0 == queue.used());
+    expect(that % 0 == queue.drain(serial).frames);
+  };
+
+  "serial_tx_queue reports backpressure and wraps whole frames"_test = []() {
+    // Setup
+    std::array<std::uint32_t, 8> ring{};
+    std::array<hal::byte, 12> staging{};
+    serial_tx_queue queue(ring, staging);
+    capture_serial serial;
+    std::array<hal::byte, 12> const frame{ 0, 1, 2, 3, 4, 5,
+                                           6, 7, 8, 9, 10, 11 };
+    std::array<hal::byte, 13> const oversized{};
+
+    // Exercise
+    auto const max_frame_size = queue.max_frame_size();
+    auto const queued_first = queue.push(frame);
+    auto const queued_second = queue.push(frame);
+    auto const queued_full = queue.push(frame);
+    auto const first_drain = queue.drain(serial);
+    // Occupies words 0 to 1 then 2 to 5, leaving 2 words before the end
+    (void)queue.push(std::span(frame).first(4));
+    (void)queue.push(frame);
+    auto const second_drain = queue.drain(serial);
+    // Requires 4 words, placed at the start after 2 words of padding
+    auto const queued_wrapped = queue.push(frame);
+    auto const third_drain = queue.drain(serial);
+
+    // Verify
+    expect(that % 12 == max_frame_size);
+    expect(queued_first);
+    expect(queued_second);
+    expect(not queued_full);
+    expect(queued_wrapped);
+    expect(that % 1 == queue.rejected());
+    expect(that % 2 == first_drain.frames);
+    expect(that % 2 == second_drain.frames);
+    expect(that % 16 == second_drain.bytes);
+    expect(that % 1 == third_drain.frames);
+    // Staging holds one 12 byte frame at a time
+    expect(that % 5 == serial.m_write_calls);
+    expect(that % 52 == serial.m_length);
+    expect(that % 3 == serial.m_sent[27]);
+    expect(that % 10 == serial.m_sent[38]);
+    expect(that % 10 == serial.m_sent[50]);
+    expect(that % 0 == queue.used());
+    expect(throws<hal::message_size>(
+      [&queue, &oversized]() { (void)queue.push(oversized); }));
+  };
+
+  "serial_tx_queue keeps bytes the serial port did not accept"_test = []() {
+    // Setup
+    std::array<std::uint32_t, 16> ring{};
+    std::array<hal::byte, 28> staging{};
+    serial_tx_queue queue(ring, staging);
+    capture_serial serial;
+    std::string_view const text("0123456789abcdefghijKLMNOPQRST");
+    auto const bytes = std::span(
+      reinterpret_cast<hal::byte const*>(text.data()), text.size());
+    (void)queue.push(bytes.subspan(0, 10));
+    (void)queue.push(bytes.subspan(10, 10));
+    (void)queue.push(bytes.subspan(20, 10));
+
+    // Exercise
+    serial.m_budget = 3;
+    auto const first_drain = queue.drain(serial);
+    auto const used = queue.used();
+    serial.m_budget = 4;
+    auto const second_drain = queue.drain(serial);
+    serial.m_budget = std::numeric_limits<std::size_t>::max();
+    auto const third_drain = queue.drain(serial);
+
+    // Verify
+    // The third frame does not fit while the first two are still staged
+    expect(that % 2 == first_drain.frames);
+    expect(that % 16 == used);
+    expect(that % 0 == second_drain.frames);
+    expect(that % 1 == third_drain.frames);
+    expect(text ==
+           std::string_view(reinterpret_cast<char const*>(serial.m_sent.data()),
+                            serial.m_length));
+    expect(that % 0 == queue.used());
+  };
+
+  "serial_tx_queue rejects invalid storage"_test = []() {
+    // Setup
+    std::array<std::uint32_t, 6> ring{};
+    std::array<hal::byte, 16> staging{};
+
+    // Exercise
+    // Verify
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { serial_tx_queue queue(ring, staging); }));
+    expect(throws<hal::argument_out_of_domain>([&]() {
+      serial_tx_queue queue{ std::span(ring).first(4),
+                             std::span(staging).first(3) };
+    }));
+  };
+};
+}  // namespace hal
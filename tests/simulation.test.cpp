@@ -0,0 +1,230 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/simulation.hpp>
+
+#include <array>
+#include <chrono>
+
+#include <libhal/error.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+void simulation_test()
+{
+  using namespace boost::ut;
+  using namespace std::chrono_literals;
+
+  "sim::kernel runs events in time then schedule order"_test = []() {
+    // Setup
+    std::array<sim::event, 8> storage{};
+    sim::kernel kernel(storage);
+    std::array<int, 4> order{};
+    int index = 0;
+    auto record = [&order, &index](int p_value) { order[index++] = p_value; };
+
+    // Exercise
+    kernel.schedule_at(20us, [&record]() { record(3); });
+    kernel.schedule_at(10us, [&record]() { record(1); });
+    kernel.schedule_at(10us, [&record]() { record(2); });
+    auto const cancelled =
+      kernel.schedule_at(15us, [&record]() { record(100); });
+    kernel.cancel(cancelled);
+    kernel.run_until(15us);
+    auto const midpoint = index;
+    kernel.run_for(1ms);
+
+    // Verify
+    expect(that % 2 == midpoint);
+    expect(that % 3 == index);
+    expect(that % 1 == order[0]);
+    expect(that % 2 == order[1]);
+    expect(that % 3 == order[2]);
+    expect(that % 0 == kernel.pending());
+    expect(1015us == kernel.now());
+    expect(not kernel.step());
+  };
+
+  "sim::kernel throws when the event queue is full"_test = []() {
+    // Setup
+    std::array<sim::event, 1> storage{};
+    sim::kernel kernel(storage);
+    kernel.schedule_after(1us, []() {});
+
+    // Exercise & Verify
+    expect(throws<hal::resource_unavailable_try_again>(
+      [&kernel]() { kernel.schedule_after(1us, []() {}); }));
+  };
+
+  "sim::timer & sim::steady_clock"_test = []() {
+    // Setup
+    std::array<sim::event, 4> storage{};
+    sim::kernel kernel(storage);
+    sim::steady_clock clock(kernel, 1.0_MHz);
+    sim::timer timer(kernel);
+    std::uint64_t fired_at = 0;
+
+    // Exercise
+    timer.schedule([&clock, &fired_at]() { fired_at = clock.uptime(); },
+                   250us);
+    auto const running = timer.is_running();
+    kernel.run_for(1ms);
+
+    // Verify
+    expect(that % running);
+    expect(that % not timer.is_running());
+    expect(that % 250 == fired_at);
+    expect(that % 1000 == clock.uptime());
+    expect(that % 1'000'000.0f == clock.frequency());
+  };
+
+  "sim::interrupt_pin"_test = []() {
+    // Setup
+    std::array<sim::event, 4> storage{};
+    sim::kernel kernel(storage);
+    sim::interrupt_pin pin(kernel, true);
+    int falling_edges = 0;
+    pin.configure({ .trigger = hal::interrupt_pin::trigger_edge::falling });
+    pin.on_trigger([&falling_edges](bool) { falling_edges++; });
+
+    // Exercise
+    pin.set_level_at(10us, false);
+    pin.set_level_at(20us, true);
+    pin.set_level_at(30us, false);
+    kernel.run_for(25us);
+    auto const midpoint = falling_edges;
+    kernel.run_for(25us);
+
+    // Verify
+    expect(that % 1 == midpoint);
+    expect(that % 2 == falling_edges);
+    expect(that % not pin.level());
+  };
+
+  "sim::serial transmits in virtual time"_test = []() {
+    // Setup
+    std::array<sim::event, 4> storage{};
+    sim::kernel kernel(storage);
+    std::array<hal::byte, 4> buffer_a{};
+    std::array<hal::byte, 4> buffer_b{};
+    sim::serial port_a(kernel, buffer_a);
+    sim::serial port_b(kernel, buffer_b);
+    port_a.connect(port_b);
+    port_a.configure({ .baud_rate = 10000.0f });
+    std::array<hal::byte, 6> const message{ 1, 2, 3, 4, 5, 6 };
+    std::array<hal::byte, 8> received{};
+
+    // Exercise
+    port_a.write(message);
+    auto const result = port_b.read(received);
+    auto const empty = port_b.read(received);
+
+    // Verify
+    expect(1ms == port_a.byte_time());
+    expect(6ms == kernel.now());
+    expect(that % 4 == result.data.size());
+    expect(that % 6 == result.available);
+    expect(that % 4 == result.capacity);
+    expect(that % 1 == result.data[0]);
+    expect(that % 4 == result.data[3]);
+    expect(that % 0 == empty.data.size());
+    expect(that % 0 == empty.available);
+  };
+
+  "sim::can delivers to every other node"_test = []() {
+    // Setup
+    std::array<sim::event, 4> storage{};
+    sim::kernel kernel(storage);
+    sim::can_bus bus(kernel);
+    sim::can node_a(bus);
+    sim::can node_b(bus);
+    sim::can node_c(bus);
+    int a_count = 0;
+    hal::can::id_t last_id = 0;
+    node_a.on_receive([&a_count](auto const&) { a_count++; });
+    node_c.on_receive(
+      [&last_id](hal::can::message_t const& p_message) {
+        last_id = p_message.id;
+      });
+    node_a.configure({ .baud_rate = 1.0_MHz });
+
+    // Exercise
+    node_a.send({ .id = 0x111, .length = 8 });
+    node_c.set_bus_off(true);
+    node_a.send({ .id = 0x222, .length = 0 });
+
+    // Verify
+    expect(that % 0 == a_count);
+    expect(that % 0x111 == last_id);
+    expect(that % 2 == bus.frame_count());
+    expect(158us == kernel.now());
+    expect(throws<hal::operation_not_permitted>(
+      [&node_c]() { node_c.send({ .id = 0x333, .length = 0 }); }));
+  };
+
+  "sim::i2c dispatches to attached devices"_test = []() {
+    // Setup
+    std::array<sim::event, 4> storage{};
+    sim::kernel kernel(storage);
+    sim::i2c i2c(kernel);
+    hal::byte register_address = 0;
+    i2c.attach(0x42,
+               [&register_address](std::span<hal::byte const> p_out,
+                                   std::span<hal::byte> p_in) {
+                 register_address = p_out[0];
+                 for (auto& value : p_in) {
+                   value = 0xAA;
+                 }
+               });
+    std::array<hal::byte, 1> const out{ 0x10 };
+    std::array<hal::byte, 2> in{};
+
+    // Exercise
+    i2c.transaction(0x42, out, in, []() {});
+
+    // Verify
+    expect(that % 0x10 == register_address);
+    expect(that % 0xAA == in[1]);
+    // 2 address bytes + 3 data bytes at 9 clocks each and 100kHz
+    expect(450us == kernel.now());
+    expect(throws<hal::no_such_device>(
+      [&i2c, &out]() { i2c.transaction(0x50, out, {}, []() {}); }));
+  };
+
+  "sim::spi advances time by the transfer length"_test = []() {
+    // Setup
+    std::array<sim::event, 4> storage{};
+    sim::kernel kernel(storage);
+    hal::byte last_filler = 0;
+    sim::spi spi(kernel,
+                 [&last_filler](std::span<hal::byte const>,
+                                std::span<hal::byte> p_in,
+                                hal::byte p_filler) {
+                   last_filler = p_filler;
+                   std::fill(p_in.begin(), p_in.end(), hal::byte{ 0x5A });
+                 });
+    spi.configure({ .clock_rate = 1.0_MHz });
+    std::array<hal::byte, 4> in{};
+
+    // Exercise
+    spi.transfer(std::span<hal::byte const>{}, in, 0xFF);
+
+    // Verify
+    expect(that % 0xFF == last_filler);
+    expect(that % 0x5A == in[3]);
+    expect(32us == kernel.now());
+  };
+};
+}  // namespace hal
@@ -0,0 +1,154 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/static_allocator.hpp>
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include <libhal/error.hpp>
+#include <libhal/serial.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class report_serial : public hal::serial
+{
+public:
+  std::array<char, 128> m_text{};
+  std::size_t m_length = 0;
+
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    for (auto const value : p_data) {
+      m_text[m_length++] = static_cast<char>(value);
+    }
+    return write_t{ .data = p_data };
+  }
+
+  read_t driver_read(std::span<hal::byte> p_data) override
+  {
+    return read_t{ .data = p_data.first(0), .available = 0, .capacity = 0 };
+  }
+
+  void driver_flush() override
+  {
+  }
+};
+
+struct point
+{
+  std::int32_t x;
+  std::int32_t y;
+};
+}  // namespace
+
+void static_allocator_test()
+{
+  using namespace boost::ut;
+
+  "static_arena::allocate()"_test = []() {
+    // Setup
+    auto& arena = hal::create_static_arena(buffer<64>);
+
+    // Exercise
+    auto first = arena.allocate(3, 1);
+    auto& created = arena.create<point>(1, 2);
+    auto array = arena.allocate_array<std::uint16_t>(4);
+
+    // Verify
+    expect(that % 3 == first.size());
+    expect(that % 0 ==
+           reinterpret_cast<std::uintptr_t>(&created) % alignof(point));
+    expect(that % 1 == created.x);
+    expect(that % 2 == created.y);
+    expect(that % 4 == array.size());
+    expect(that % 0 == array[3]);
+    expect(throws<hal::resource_unavailable_try_again>(
+      [&arena]() { (void)arena.allocate(64); }));
+
+    auto const usage = arena.usage();
+    expect(that % 64 == usage.capacity);
+    expect(that % usage.used == usage.peak);
+    expect(that % 1 == usage.failed);
+
+    arena.reset();
+    expect(that % 0 == arena.usage().used);
+    expect(that % usage.peak == arena.usage().peak);
+    expect(that % 64 == arena.allocate(64, 1).size());
+  };
+
+  "static_pool::allocate() & deallocate()"_test = []() {
+    // Setup
+    auto& pool = hal::create_static_pool<sizeof(point), 3, hal::spin_lock>();
+
+    // Exercise
+    auto* a = pool.create<point>(1, 2);
+    auto* b = pool.create<point>(3, 4);
+    auto* c = pool.allocate();
+    expect(throws<hal::resource_unavailable_try_again>(
+      [&pool]() { (void)pool.allocate(); }));
+    pool.destroy(b);
+    auto* d = pool.allocate();
+
+    // Verify
+    expect(that % 1 == a->x);
+    expect(that % static_cast<void*>(b) == d);
+    expect(that % c != d);
+    expect(that % 0 == reinterpret_cast<std::uintptr_t>(a) %
+                         alignof(std::max_align_t));
+    expect(throws<hal::argument_out_of_domain>([&pool, a]() {
+      pool.deallocate(reinterpret_cast<hal::byte*>(a) + 1);
+    }));
+
+    auto const usage = pool.usage();
+    expect(that % 3 == usage.capacity);
+    expect(that % 3 == usage.used);
+    expect(that % 3 == usage.peak);
+    expect(that % 1 == usage.failed);
+  };
+
+  "static_pool rejects undersized storage"_test = []() {
+    // Setup
+    std::array<hal::byte, 8> storage{};
+
+    // Exercise & Verify
+    expect(throws<hal::argument_out_of_domain>(
+      [&storage]() { static_pool<8, 2> pool(storage); }));
+  };
+
+  "write_usage_report()"_test = []() {
+    // Setup
+    report_serial serial;
+    allocator_usage const usage{
+      .capacity = 16, .used = 2, .peak = 11, .failed = 0
+    };
+
+    // Exercise
+    write_usage_report(serial, "dma_pool", usage);
+
+    // Verify
+    expect(std::string_view(serial.m_text.data(), serial.m_length) ==
+           "dma_pool: capacity=16 used=2 peak=11 failed=0\n");
+  };
+};
+}  // namespace hal
@@ -0,0 +1,137 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/timer_wheel.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include <libhal/error.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+void timer_wheel_test()
+{
+  using namespace boost::ut;
+  using namespace std::chrono_literals;
+
+  "timer_wheel::schedule()"_test = []() {
+    // Setup
+    std::array<timer_wheel_entry*, 8> slots{};
+    timer_wheel wheel(slots, 1ms);
+    timer_wheel_entry short_entry;
+    timer_wheel_entry long_entry;
+    timer_wheel_entry exact_entry;
+    std::uint64_t short_fired = 0;
+    std::uint64_t long_fired = 0;
+    std::uint64_t exact_fired = 0;
+
+    // Exercise
+    wheel.schedule(short_entry, 3U, [&]() { short_fired = wheel.now(); });
+    wheel.schedule(long_entry, 21U, [&]() { long_fired = wheel.now(); });
+    wheel.schedule(exact_entry, 8ms, [&]() { exact_fired = wheel.now(); });
+    auto const scheduled = long_entry.is_scheduled();
+    for (int i = 0; i < 30; i++) {
+      wheel.tick();
+    }
+
+    // Verify
+    expect(scheduled);
+    expect(that % 3 == short_fired);
+    expect(that % 21 == long_fired);
+    expect(that % 8 == exact_fired);
+    expect(not long_entry.is_scheduled());
+  };
+
+  "timer_wheel::cancel()"_test = []() {
+    // Setup
+    std::array<timer_wheel_entry*, 4> slots{};
+    timer_wheel wheel(slots, 1ms);
+    timer_wheel_entry first;
+    timer_wheel_entry second;
+    timer_wheel_entry third;
+    int calls = 0;
+
+    // Exercise
+    wheel.schedule(first, 2U, [&]() { calls += 1; });
+    wheel.schedule(second, 2U, [&]() { calls += 10; });
+    wheel.schedule(third, 2U, [&]() { calls += 100; });
+    wheel.cancel(second);
+    {
+      timer_wheel_entry destroyed;
+      wheel.schedule(destroyed, 2U, [&]() { calls += 1000; });
+    }
+    wheel.tick();
+    wheel.tick();
+
+    // Verify
+    expect(that % 101 == calls);
+  };
+
+  "timer_wheel periodic reschedule"_test = []() {
+    // Setup
+    std::array<timer_wheel_entry*, 4> slots{};
+    timer_wheel wheel(slots, 1ms);
+    struct periodic_state
+    {
+      timer_wheel* wheel;
+      timer_wheel_entry periodic{};
+      timer_wheel_entry victim{};
+      std::array<std::uint64_t, 4> fired{};
+      std::size_t count = 0;
+      bool victim_fired = false;
+
+      void run()
+      {
+        fired[count++] = wheel->now();
+        if (count < fired.size()) {
+          wheel->schedule(periodic, 4U, [this]() { run(); });
+        }
+        wheel->cancel(victim);
+      }
+    } state{ &wheel };
+
+    // Exercise
+    // Entries expiring on the same tick run most recently scheduled first
+    wheel.schedule(state.victim, 4U, [&state]() { state.victim_fired = true; });
+    wheel.schedule(state.periodic, 4U, [&state]() { state.run(); });
+    for (int i = 0; i < 20; i++) {
+      wheel.tick();
+    }
+
+    // Verify
+    expect(that % 4 == state.fired[0]);
+    expect(that % 8 == state.fired[1]);
+    expect(that % 12 == state.fired[2]);
+    expect(that % 16 == state.fired[3]);
+    expect(not state.victim_fired);
+  };
+
+  "timer_wheel::ticks()"_test = []() {
+    // Setup
+    std::array<timer_wheel_entry*, 4> slots{};
+    timer_wheel wheel(slots, 10ms);
+
+    // Exercise
+    // Verify
+    expect(that % 1 == wheel.ticks(1ms));
+    expect(that % 1 == wheel.ticks(10ms));
+    expect(that % 2 == wheel.ticks(11ms));
+    expect(throws<hal::argument_out_of_domain>(
+      [&]() { timer_wheel invalid({}, 1ms); }));
+  };
+};
+}  // namespace hal
@@ -0,0 +1,359 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/tracing.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <span>
+
+#include <libhal/error.hpp>
+#include <libhal/simulation.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class failing_serial : public hal::serial
+{
+private:
+  void driver_configure(settings const&) override
+  {
+  }
+
+  write_t driver_write(std::span<hal::byte const> p_data) override
+  {
+    return write_t{ .data = p_data };
+  }
+
+  read_t driver_read(std::span<hal::byte>) override
+  {
+    hal::safe_throw(hal::io_error(this));
+    return {};
+  }
+
+  void driver_flush() override
+  {
+  }
+};
+
+class fixed_adc : public hal::adc
+{
+private:
+  float driver_read() override
+  {
+    return 0.25f;
+  }
+};
+
+class null_dac : public hal::dac
+{
+private:
+  void driver_write(float) override
+  {
+  }
+};
+
+class null_pwm : public hal::pwm
+{
+private:
+  void driver_frequency(hertz) override
+  {
+  }
+
+  void driver_duty_cycle(float) override
+  {
+  }
+};
+
+class loopback_pins
+  : public hal::output_pin
+  , public hal::input_pin
+{
+private:
+  void driver_configure(output_pin::settings const&) override
+  {
+  }
+
+  void driver_configure(input_pin::settings const&) override
+  {
+  }
+
+  void driver_level(bool p_high) override
+  {
+    m_high = p_high;
+  }
+
+  bool driver_level() override
+  {
+    return m_high;
+  }
+
+  bool m_high = false;
+};
+}  // namespace
+
+void tracing_test()
+{
+  using namespace boost::ut;
+
+  "trace_buffer keeps the most recent records"_test = []() {
+    // Setup
+    std::array<trace_record, 4> storage{};
+    trace_buffer test(storage);
+    std::array<std::uint32_t, 4> arguments{};
+    std::size_t count = 0;
+
+    // Exercise
+    for (std::uint32_t i = 0; i < 6; i++) {
+      test.record({ .argument = i });
+    }
+    test.enable(false);
+    test.record({ .argument = 100 });
+    test.for_each([&arguments, &count](trace_record const& p_record) {
+      arguments[count++] = p_record.argument;
+    });
+
+    // Verify
+    expect(that % 6 == test.recorded());
+    expect(that % 4 == count);
+    expect(that % 2 == arguments[0]);
+    expect(that % 5 == arguments[3]);
+  };
+
+  "traced_i2c & traced_spi record calls with durations"_test = []() {
+    // Setup
+    std::array<sim::event, 4> events{};
+    sim::kernel kernel(events);
+    sim::steady_clock clock(kernel, 1.0_MHz);
+    sim::i2c i2c(kernel);
+    i2c.attach(0x42, [](std::span<hal::byte const>, std::span<hal::byte>) {});
+    sim::spi spi(kernel,
+                 [](std::span<hal::byte const>, std::span<hal::byte>, byte) {});
+    std::array<trace_record, 8> storage{};
+    trace_buffer buffer(storage);
+    traced_i2c traced_i2c(i2c, buffer, clock, 1);
+    traced_spi traced_spi(spi, buffer, clock, 2);
+    traced_spi.configure({ .clock_rate = 1.0_MHz });
+    std::array<hal::byte, 2> const out{ 0x01, 0x02 };
+    std::array<hal::byte, 3> in{};
+    std::array<trace_record, 8> records{};
+    std::size_t count = 0;
+
+    // Exercise
+    traced_i2c.transaction(0x42, out, in, []() {});
+    traced_spi.transfer(out, in, 0xFF);
+    expect(throws<hal::no_such_device>(
+      [&]() { traced_i2c.transaction(0x10, out, {}, []() {}); }));
+    buffer.for_each([&records, &count](trace_record const& p_record) {
+      records[count++] = p_record;
+    });
+
+    // Verify
+    expect(that % 4 == count);
+    expect(trace_operation::configure == records[0].operation);
+    expect(trace_operation::i2c_transaction == records[1].operation);
+    expect(that % 0x42 == records[1].argument);
+    expect(that % 2 == records[1].size_out);
+    expect(that % 3 == records[1].size_in);
+    expect(that % 1 == records[1].track);
+    // 2 address bytes + 5 data bytes at 9 clocks each and 100kHz
+    expect(that % 630 == records[1].duration);
+    expect(trace_operation::spi_transfer == records[2].operation);
+    expect(that % 630 == records[2].start);
+    expect(that % 24 == records[2].duration);
+    expect(that % 2 == records[2].track);
+    expect(that % 1 == records[3].failed);
+  };
+
+  "traced_can records sends and received messages"_test = []() {
+    // Setup
+    std::array<sim::event, 4> events{};
+    sim::kernel kernel(events);
+    sim::steady_clock clock(kernel);
+    sim::can_bus bus(kernel);
+    sim::can node_a(bus);
+    sim::can node_b(bus);
+    std::array<trace_record, 8> storage{};
+    trace_buffer buffer(storage);
+    traced_can traced_a(node_a, buffer, clock, 1);
+    traced_can traced_b(node_b, buffer, clock, 2);
+    int received = 0;
+    traced_b.on_receive([&received](auto const&) { received++; });
+
+    // Exercise
+    traced_a.send({ .id = 0x123, .length = 4 });
+
+    // Verify
+    std::array<trace_record, 2> records{};
+    std::size_t count = 0;
+    buffer.for_each([&records, &count](trace_record const& p_record) {
+      records[count++] = p_record;
+    });
+    expect(that % 1 == received);
+    expect(that % 2 == count);
+    // The receive record is published before the send call completes
+    expect(trace_operation::can_receive == records[0].operation);
+    expect(that % 2 == records[0].track);
+    expect(trace_operation::can_send == records[1].operation);
+    expect(that % 0x123 == records[1].argument);
+    expect(that % 4 == records[1].size_out);
+  };
+
+  "traced_serial records failed reads"_test = []() {
+    // Setup
+    std::array<sim::event, 4> events{};
+    sim::kernel kernel(events);
+    sim::steady_clock clock(kernel);
+    failing_serial serial;
+    std::array<trace_record, 4> storage{};
+    trace_buffer buffer(storage);
+    traced_serial test(serial, buffer, clock, 3);
+    std::array<hal::byte, 4> data{};
+    trace_record record{};
+
+    // Exercise
+    expect(throws<hal::io_error>([&]() { (void)test.read(data); }));
+    buffer.for_each([&record](trace_record const& p_record) {
+      record = p_record;
+    });
+
+    // Verify
+    expect(that % 1 == buffer.recorded());
+    expect(trace_operation::serial_read == record.operation);
+    expect(that % 1 == record.failed);
+    expect(that % 3 == record.track);
+    expect(that % 0 == record.size_in);
+  };
+
+  "traced adc, dac, pwm, pins & timer record calls"_test = []() {
+    // Setup
+    std::array<sim::event, 4> events{};
+    sim::kernel kernel(events);
+    sim::steady_clock clock(kernel, 1.0_MHz);
+    sim::timer timer(kernel);
+    fixed_adc adc;
+    null_dac dac;
+    null_pwm pwm;
+    loopback_pins pins;
+    std::array<trace_record, 16> storage{};
+    trace_buffer buffer(storage);
+    traced_adc traced_adc(adc, buffer, clock, 1);
+    traced_dac traced_dac(dac, buffer, clock, 2);
+    traced_pwm traced_pwm(pwm, buffer, clock, 3);
+    traced_output_pin traced_output(pins, buffer, clock, 4);
+    traced_input_pin traced_input(pins, buffer, clock, 5);
+    traced_timer traced_timer(timer, buffer, clock, 6);
+    int expired = 0;
+    std::array<trace_record, 16> records{};
+    std::size_t count = 0;
+
+    // Exercise
+    auto const sample = traced_adc.read();
+    traced_dac.write(0.5f);
+    traced_pwm.frequency(20.0_kHz);
+    traced_pwm.duty_cycle(0.75f);
+    traced_output.level(true);
+    auto const readback = traced_output.level();
+    auto const level = traced_input.level();
+    traced_timer.schedule([&expired]() { expired++; },
+                          std::chrono::microseconds(100));
+    kernel.run_for(std::chrono::microseconds(200));
+    traced_timer.schedule([]() {}, std::chrono::microseconds(100));
+    traced_timer.cancel();
+    buffer.for_each([&records, &count](trace_record const& p_record) {
+      records[count++] = p_record;
+    });
+
+    // Verify
+    expect(that % 0.25f == sample);
+    expect(readback);
+    expect(level);
+    expect(that % 1 == expired);
+    // The output pin's level read back is not recorded
+    expect(that % 10 == count);
+    expect(trace_operation::adc_read == records[0].operation);
+    expect(that % 250'000 == records[0].argument);
+    expect(trace_operation::dac_write == records[1].operation);
+    expect(that % 500'000 == records[1].argument);
+    expect(trace_operation::pwm_frequency == records[2].operation);
+    expect(that % 20'000 == records[2].argument);
+    expect(trace_operation::pwm_duty_cycle == records[3].operation);
+    expect(that % 750'000 == records[3].argument);
+    expect(trace_operation::output_pin_level == records[4].operation);
+    expect(that % 1 == records[4].argument);
+    expect(trace_operation::input_pin_level == records[5].operation);
+    expect(that % 1 == records[5].argument);
+    expect(that % 5 == records[5].track);
+    expect(trace_operation::timer_schedule == records[6].operation);
+    expect(that % 100 == records[6].argument);
+    expect(trace_operation::timer_expire == records[7].operation);
+    expect(that % 100 == records[7].start);
+    expect(trace_operation::timer_schedule == records[8].operation);
+    expect(trace_operation::timer_cancel == records[9].operation);
+    expect(that % 6 == records[9].track);
+  };
+
+  "write_chrome_trace()"_test = []() {
+    // Setup
+    std::array<trace_record, 4> storage{};
+    trace_buffer buffer(storage);
+    buffer.record({ .start = 1000,
+                    .duration = 500,
+                    .operation = trace_operation::serial_write,
+                    .size_out = 16 });
+    std::array<char const*, 1> const names{ "uart0" };
+    std::array<char, 512> output{};
+    auto* file = std::tmpfile();
+
+    // Exercise
+    auto const count = write_chrome_trace(file, buffer, 1.0_MHz, names);
+    std::rewind(file);
+    auto const length = std::fread(output.data(), 1, output.size() - 1, file);
+    std::fclose(file);
+
+    // Verify
+    expect(that % 1 == count);
+    expect(that % length > 0);
+    expect(std::strstr(output.data(), "\"traceEvents\"") != nullptr);
+    expect(std::strstr(output.data(), "\"name\":\"uart0\"") != nullptr);
+    expect(std::strstr(output.data(), "\"name\":\"serial::write\"") !=
+           nullptr);
+    expect(std::strstr(output.data(), "\"ts\":1000.000") != nullptr);
+    expect(std::strstr(output.data(), "\"dur\":500.000") != nullptr);
+    expect(std::strstr(output.data(), "\"out\":16") != nullptr);
+  };
+
+  "write_chrome_trace() escapes track names"_test = []() {
+    // Setup
+    std::array<trace_record, 1> storage{};
+    trace_buffer buffer(storage);
+    std::array<char const*, 1> const names{ "i2c \"left\" C:\\bus\n" };
+    std::array<char, 512> output{};
+    auto* file = std::tmpfile();
+
+    // Exercise
+    write_chrome_trace(file, buffer, 1.0_MHz, names);
+    std::rewind(file);
+    std::fread(output.data(), 1, output.size() - 1, file);
+    std::fclose(file);
+
+    // Verify
+    expect(std::strstr(output.data(),
+                       R"("name":"i2c \"left\" C:\\bus\u000a")") != nullptr);
+  };
+};
+}  // namespace hal
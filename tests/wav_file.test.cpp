@@ -0,0 +1,108 @@
+// Copyright 2024 Khalil Estell
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/wav_file.hpp>
+
+#include <array>
+#include <filesystem>
+#include <string>
+
+#include <libhal/error.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+void wav_file_test()
+{
+  using namespace boost::ut;
+
+  "wav_file_stream_dac -> wav_file_adc"_test = []() {
+    // Setup
+    auto const path =
+      (std::filesystem::temp_directory_path() / "libhal_wav_file.wav")
+        .string();
+    std::array<std::uint16_t, 5> const expected{
+      0x0000, 0x8000, 0xFFFF, 0x1234, 0xC000
+    };
+    std::array<std::uint16_t, 8> actual{};
+
+    // Exercise
+    {
+      // Use a staging buffer smaller than the data to force multiple flushes
+      hal::wav_file_stream_dac<std::uint16_t, 4> dac(path.c_str());
+      dac.write({ .sample_rate = 8.0_kHz,
+                  .data = std::span(expected).first(2) });
+      dac.write({ .sample_rate = 8.0_kHz,
+                  .data = std::span(expected).subspan(2) });
+      expect(throws<hal::argument_out_of_domain>([&]() {
+        dac.write({ .sample_rate = 16.0_kHz, .data = expected });
+      }));
+      expect(that % 5 == dac.sample_count());
+    }
+    hal::wav_file_adc<std::uint16_t, 6> adc(path.c_str());
+    auto const filled = adc.read(actual);
+
+    // Verify
+    expect(that % 8.0_kHz == adc.sample_rate());
+    expect(that % expected.size() == filled.size());
+    for (std::size_t i = 0; i < expected.size(); i++) {
+      expect(that % expected[i] == actual[i]);
+    }
+    expect(that % std::filesystem::file_size(path) ==
+           detail::wav_header_size + sizeof(expected));
+    expect(throws<hal::io_error>([&]() { static_cast<void>(adc.read()); }));
+    expect(throws<hal::operation_not_supported>(
+      [&]() { hal::wav_file_adc<std::uint8_t> wrong_width(path.c_str()); }));
+
+    std::filesystem::remove(path);
+  };
+
+  "wav_file_adc raw & loop"_test = []() {
+    // Setup
+    auto const path =
+      (std::filesystem::temp_directory_path() / "libhal_wav_file.raw")
+        .string();
+    std::array<std::uint8_t, 3> const expected{ 0, 255, 51 };
+    {
+      hal::wav_file_stream_dac<std::uint8_t> dac(path.c_str(),
+                                                 sample_file_format::raw);
+      dac.write({ .sample_rate = 1.0_kHz, .data = expected });
+      dac.close();
+      expect(throws<hal::io_error>([&]() {
+        dac.write({ .sample_rate = 1.0_kHz, .data = expected });
+      }));
+    }
+    hal::wav_file_adc<std::uint8_t> adc(path.c_str(),
+                                        { .format = sample_file_format::raw,
+                                          .sample_rate = 1.0_kHz,
+                                          .loop = true });
+
+    // Exercise
+    auto const first = adc.read();
+    auto const second = adc.read();
+    auto const third = adc.read();
+    auto const fourth = adc.read();
+
+    // Verify
+    expect(that % 0.0f == first);
+    expect(that % 1.0f == second);
+    expect(that % 0.2f == third);
+    expect(that % 0.0f == fourth);
+    expect(throws<hal::io_error>(
+      []() { hal::wav_file_adc<std::uint8_t> missing("/does/not/exist"); }));
+
+    std::filesystem::remove(path);
+  };
+};
+}  // namespace hal